@@ -0,0 +1,310 @@
+/**
+ * @file AdmissionControl.hpp
+ * @brief Controle de admissão e contrapressão do coletor.
+ * @details
+ * Quando uma frota inteira se reconecta, cada rastreador esvazia o seu spool de uma vez e
+ * a chegada supera em muito a capacidade do coletor. Sem controle, o kernel descarta
+ * datagramas ao acaso, e fixes ao vivo se perdem junto com os atrasados. Aqui cada fix é
+ * classificado por prioridade, os atrasados são admitidos a uma taxa que acompanha a carga,
+ * e os rastreadores recebem confirmações que ditam o ritmo do esvaziamento.
+ */
+#ifndef ADMISSIONCONTROL_HPP
+#define ADMISSIONCONTROL_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+#include "CollectorFix.hpp"
+
+/**
+ * @class AdmissionControl
+ * @brief Admissão por prioridade, com taxa de atrasados e pausa ajustadas por AIMD.
+ * @details
+ *
+ * Classes, da mais à menos prioritária:
+ * - ALERTA: fix marcado pelo rastreador (CollectorFix::FLAG_ALERTA); sempre admitido.
+ * - VIVO: fix com até `limite_vivo_ms` de idade; admitido enquanto houver capacidade.
+ * - ATRASADO: fix de spool; admitido por um balde de fichas à taxa corrente.
+ *
+ * A carga é medida como no CoDel: pela espera na fila do socket do datagrama mais antigo de
+ * cada lote (carimbo de recepção do kernel), informada por report_batch(). Se nem a menor
+ * espera de uma janela de 100 ms fica abaixo de `ESPERA_ALVO_US`, a fila não se esvazia e o
+ * coletor está saturado; ao contrário da ocupação das threads, a espera não confunde lotes
+ * pequenos aguardando o group commit do WAL com falta de capacidade. A cada janela:
+ * - saturado: a taxa de atrasados cai para 70% (redução multiplicativa, como no CUBIC);
+ *   no mínimo, passam a ser descartados fixes ao vivo, mantendo apenas os de segundos
+ *   múltiplos de `fator_vivo` (2, 4 ... 16);
+ * - folgado: o desbaste dos fixes ao vivo é desfeito antes de a taxa voltar a subir.
+ *
+ * Alertas e atrasados são confirmados (decisão `confirmar`), e a confirmação carrega uma
+ * pausa: o intervalo mínimo entre dois envios do spool do rastreador. Um fix recusado
+ * permanece no spool e é reenviado após a pausa. A pausa reparte a taxa entre os
+ * rastreadores que esvaziam spools, contados aproximadamente em um mapa de bits
+ * (contagem linear) renovado a cada segundo. Fixes ao vivo só são confirmados quando
+ * descartados, com o período de envio sugerido como pausa.
+ */
+class AdmissionControl {
+public:
+
+	enum Classe : uint8_t {
+		ALERTA   = 0,
+		VIVO     = 1,
+		ATRASADO = 2
+	};
+
+	/**
+	 * @struct Decisao
+	 * @brief Resultado da admissão de um fix.
+	 */
+	struct Decisao {
+		Classe   classe;
+		bool     aceito;
+		bool     confirmar; ///< Responder ao rastreador com uma confirmação.
+		uint32_t pausa_ms;  ///< Pausa pedida ao rastreador.
+	};
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores por classe e estado do controle.
+	 */
+	struct Stats {
+		uint64_t recebidos[3];
+		uint64_t admitidos[3];
+		uint32_t taxa_atrasados; ///< Fixes atrasados por segundo.
+		uint32_t pausa_ms;
+		uint32_t fator_vivo;     ///< 1: nenhum fix ao vivo descartado.
+	};
+
+	static constexpr uint32_t TAXA_MIN   = 100;
+	static constexpr uint32_t PAUSA_MAX  = 5000;
+	static constexpr uint32_t FATOR_MAX  = 16;
+	static constexpr int64_t  JANELA_MS  = 100;
+	static constexpr uint64_t ESPERA_ALVO_US  = 50000;
+	static constexpr uint64_t ESPERA_FOLGA_US = 10000;
+	static constexpr uint32_t BITS_FONTES     = 1 << 14;
+
+private:
+
+	int64_t                 limite_vivo_ms;
+	uint32_t                      taxa_max;
+
+	std::atomic<uint32_t>             taxa;
+	std::atomic<uint32_t>            pausa{0};
+	std::atomic<uint32_t>       fator_vivo{1};
+	std::atomic<int64_t>            fichas{0};
+
+	std::mutex                 mtx_controle;
+	std::atomic<int64_t>      proximo_tick{0};
+	int64_t                    ultimo_tick = 0;
+	std::atomic<uint64_t> janela_espera{UINT64_MAX}; ///< Menor espera na fila, em us.
+	std::atomic<uint64_t>  janela_atrasados{0};
+	std::atomic<uint64_t>  fontes[2][BITS_FONTES / 64]{}; ///< Rastreadores com spool: segundo atual e anterior.
+	std::atomic<int>              fonte_atual{0};
+	int                             n_janelas = 0;
+	uint32_t                        taxa_pico = UINT32_MAX; ///< Taxa da última saturação.
+
+	std::atomic<uint64_t>     n_recebidos[3]{};
+	std::atomic<uint64_t>     n_admitidos[3]{};
+
+	/**
+	 * @brief Estima os rastreadores distintos que enviaram fixes de spool nos últimos 1 a 2 s.
+	 */
+	double
+	count_sources() const {
+
+		uint32_t zeros = 0;
+		for( uint32_t i = 0; i < BITS_FONTES / 64; i++ ){ zeros += 64 - __builtin_popcountll(fontes[0][i].load(std::memory_order_relaxed) | fontes[1][i].load(std::memory_order_relaxed)); }
+		return zeros ? -double(BITS_FONTES) * std::log(double(zeros) / BITS_FONTES) : BITS_FONTES * std::log(double(BITS_FONTES));
+	}
+
+	/**
+	 * @brief Ajusta taxa, pausa e desbaste com as medidas da janela encerrada.
+	 */
+	void
+	tick(
+		int64_t agora_ms
+	){
+
+		std::unique_lock<std::mutex> lock(mtx_controle, std::try_to_lock);
+		if( !lock.owns_lock() || agora_ms < proximo_tick.load(std::memory_order_relaxed) ){ return; }
+
+		double   dt       = ultimo_tick ? std::max<int64_t>(agora_ms - ultimo_tick, 1) / 1000.0 : JANELA_MS / 1000.0;
+		uint64_t espera   = janela_espera.exchange(UINT64_MAX, std::memory_order_relaxed);
+		double   chegadas = janela_atrasados.exchange(0, std::memory_order_relaxed) / dt;
+
+		uint32_t t = taxa.load(std::memory_order_relaxed);
+		uint32_t f = fator_vivo.load(std::memory_order_relaxed);
+
+		// Descarta primeiro os atrasados; só então os fixes ao vivo
+		if(
+			espera != UINT64_MAX && espera > ESPERA_ALVO_US
+		){
+
+			if( t > TAXA_MIN ){ taxa_pico = t; t = std::max(TAXA_MIN, t * 7 / 10); }
+			else{ f = std::min(FATOR_MAX, f * 2); }
+		}
+		else if(
+			espera < ESPERA_FOLGA_US
+		){
+
+			if( f > 1 ){ f /= 2; }
+			else if(
+				chegadas >= 0.8 * t
+			){
+
+				// Rápido até perto da taxa em que a fila cresceu da última vez; devagar a partir dela
+				double fator = t < 0.9 * taxa_pico ? 1.25 : 1.02;
+				t = static_cast<uint32_t>(std::min<double>(taxa_max, t * fator + 100));
+			}
+		}
+
+		// Cada rastreador com spool envia a t / fontes fixes por segundo
+		uint32_t p = static_cast<uint32_t>(std::min<double>(PAUSA_MAX, count_sources() * 1000.0 / t));
+
+		if(
+			++n_janelas % (1000 / JANELA_MS) == 0
+		){
+
+			int proxima = fonte_atual.load(std::memory_order_relaxed) ^ 1;
+			for( auto& palavra : fontes[proxima] ){ palavra.store(0, std::memory_order_relaxed); }
+			fonte_atual.store(proxima, std::memory_order_relaxed);
+		}
+
+		taxa.store(t, std::memory_order_relaxed);
+		fator_vivo.store(f, std::memory_order_relaxed);
+		pausa.store(p, std::memory_order_relaxed);
+
+		// Rajada de até 200 ms da taxa; decrementos concorrentes podem se perder, sem prejuízo
+		int64_t rajada = std::max<int64_t>(t / 5, 1);
+		fichas.store(std::min<int64_t>(rajada, std::max<int64_t>(fichas.load(std::memory_order_relaxed), 0) + static_cast<int64_t>(t * dt)), std::memory_order_relaxed);
+
+		ultimo_tick = agora_ms;
+		proximo_tick.store(agora_ms + JANELA_MS, std::memory_order_relaxed);
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param limite_vivo_ms_ Idade máxima de um fix ao vivo.
+	 * @param taxa_max_ Teto da taxa de atrasados, em fixes/s; 0 para nenhum.
+	 */
+	explicit AdmissionControl(
+		int64_t limite_vivo_ms_ = 10000,
+		uint32_t taxa_max_ = 0
+	) : limite_vivo_ms(limite_vivo_ms_),
+		taxa_max(taxa_max_ ? std::max(taxa_max_, TAXA_MIN) : UINT32_MAX),
+		taxa(std::min<uint32_t>(taxa_max, 5000)) {}
+
+	AdmissionControl(const AdmissionControl&)            = delete;
+	AdmissionControl& operator=(const AdmissionControl&) = delete;
+
+	/**
+	 * @brief Classe de prioridade de um fix.
+	 */
+	Classe
+	classify(
+		const CollectorFix& fix,
+		int64_t agora_ms
+	) const {
+
+		if( fix.flags & CollectorFix::FLAG_ALERTA ){ return ALERTA; }
+		return agora_ms - fix.t_ms <= limite_vivo_ms ? VIVO : ATRASADO;
+	}
+
+	/**
+	 * @brief Decide se um fix recebido segue para o coletor.
+	 * @param fix Fix interpretado.
+	 * @param agora_ms Instante de recepção.
+	 */
+	Decisao
+	admit(
+		const CollectorFix& fix,
+		int64_t agora_ms
+	){
+
+		Decisao d{ classify(fix, agora_ms), true, false, 0 };
+		n_recebidos[d.classe].fetch_add(1, std::memory_order_relaxed);
+
+		if( d.classe == ALERTA ){ d.confirmar = true; }
+		else if(
+			d.classe == VIVO
+		){
+
+			uint32_t f = fator_vivo.load(std::memory_order_relaxed);
+			if(
+				f > 1 && (fix.t_ms / 1000) % f != 0
+			){
+
+				d.aceito    = false;
+				d.confirmar = true;
+				d.pausa_ms  = f * 1000;
+			}
+		}
+		else{
+
+			janela_atrasados.fetch_add(1, std::memory_order_relaxed);
+			uint32_t bit = static_cast<uint32_t>((fix.tracker * 0x9e3779b97f4a7c15ULL) >> 50);
+			fontes[fonte_atual.load(std::memory_order_relaxed)][bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_relaxed);
+			d.confirmar = true;
+			d.pausa_ms  = pausa.load(std::memory_order_relaxed);
+			if(
+				fichas.fetch_sub(1, std::memory_order_relaxed) <= 0
+			){
+
+				fichas.fetch_add(1, std::memory_order_relaxed);
+				d.aceito   = false;
+				d.pausa_ms = std::max<uint32_t>(d.pausa_ms, 200);
+			}
+		}
+
+		if( d.aceito ){ n_admitidos[d.classe].fetch_add(1, std::memory_order_relaxed); }
+		return d;
+	}
+
+	/**
+	 * @brief Informa a espera na fila do socket de um lote recebido.
+	 * @param espera_us Espera do datagrama mais antigo do lote; 0 em timeout (fila vazia).
+	 * @param agora_ms Instante atual.
+	 * @details
+	 *
+	 * Deve ser chamado a cada recvmmsg(), inclusive nos timeouts, pois também conduz o
+	 * ajuste periódico.
+	 */
+	void
+	report_batch(
+		uint64_t espera_us,
+		int64_t agora_ms
+	){
+
+		uint64_t menor = janela_espera.load(std::memory_order_relaxed);
+		while( espera_us < menor && !janela_espera.compare_exchange_weak(menor, espera_us, std::memory_order_relaxed) ){}
+		if( agora_ms >= proximo_tick.load(std::memory_order_relaxed) ){ tick(agora_ms); }
+	}
+
+	/**
+	 * @brief Obtém os contadores e o estado corrente.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		for(
+			int c = 0; c < 3; c++
+		){
+
+			s.recebidos[c] = n_recebidos[c].load(std::memory_order_relaxed);
+			s.admitidos[c] = n_admitidos[c].load(std::memory_order_relaxed);
+		}
+		s.taxa_atrasados = taxa.load(std::memory_order_relaxed);
+		s.pausa_ms       = pausa.load(std::memory_order_relaxed);
+		s.fator_vivo     = fator_vivo.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // ADMISSIONCONTROL_HPP
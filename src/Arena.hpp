@@ -0,0 +1,161 @@
+/**
+ * @file Arena.hpp
+ * @brief Alocador bump-pointer para memória temporária de cada época de leitura.
+ * @details
+ * Uma época corresponde ao processamento de uma sentença (leitura, interpretação e envio).
+ * Toda memória temporária da época vem da arena e é descartada de uma só vez em reset(),
+ * eliminando chamadas a malloc em regime permanente.
+ */
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+//-------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Arena
+ * @brief Região contígua de memória com alocação por avanço de ponteiro.
+ * @details
+ *
+ * - allocate() apenas alinha e avança o deslocamento.
+ * - Liberações individuais não existem; reset() descarta tudo.
+ * - Caso uma época exceda a capacidade, blocos extras são obtidos do heap e, no próximo
+ *   reset(), o bloco principal é realocado com o pico observado. Assim, após poucas épocas,
+ *   a arena se estabiliza e não volta a alocar.
+ *
+ * Objetos alocados na arena não podem sobreviver ao reset() seguinte.
+ */
+class Arena {
+private:
+
+	std::unique_ptr<unsigned char[]>               bloco;
+	std::size_t                               capacidade;
+	std::size_t                                 usado = 0;
+
+	std::vector<std::unique_ptr<unsigned char[]>> extras;
+	std::size_t                           usado_extras = 0;
+	std::size_t                            transbordos = 0;
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade_ Tamanho inicial do bloco principal em bytes.
+	 */
+	explicit Arena(
+		std::size_t capacidade_ = 4096
+	) : bloco(new unsigned char[capacidade_]),
+		capacidade(capacidade_) {}
+
+	Arena(const Arena&)            = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/**
+	 * @brief Reserva memória alinhada.
+	 * @param n Quantidade de bytes.
+	 * @param alinhamento Alinhamento exigido, potência de 2.
+	 * @return Ponteiro para a região reservada.
+	 */
+	void*
+	allocate(
+		std::size_t n,
+		std::size_t alinhamento = alignof(std::max_align_t)
+	){
+
+		uintptr_t base  = reinterpret_cast<uintptr_t>(bloco.get());
+		uintptr_t atual = (base + usado + alinhamento - 1) & ~(uintptr_t)(alinhamento - 1);
+		std::size_t fim = (atual - base) + n;
+
+		if( fim <= capacidade ){
+
+			usado = fim;
+			return reinterpret_cast<void*>(atual);
+		}
+
+		// Transbordo: bloco extra dedicado, contabilizado para o redimensionamento
+		transbordos++;
+		usado_extras += n + alinhamento;
+		extras.emplace_back(new unsigned char[n + alinhamento]);
+
+		uintptr_t extra = reinterpret_cast<uintptr_t>(extras.back().get());
+		return reinterpret_cast<void*>((extra + alinhamento - 1) & ~(uintptr_t)(alinhamento - 1));
+	}
+
+	/**
+	 * @brief Descarta todas as alocações da época.
+	 * @details
+	 *
+	 * Se houve transbordo, realoca o bloco principal com folga para o pico observado.
+	 */
+	void
+	reset(){
+
+		if(
+			!extras.empty()
+		){
+
+			std::size_t pico = usado + usado_extras;
+			capacidade = pico * 2;
+			bloco.reset(new unsigned char[capacidade]);
+			extras.clear();
+			usado_extras = 0;
+		}
+
+		usado = 0;
+	}
+
+	std::size_t used()      const { return usado + usado_extras; }
+	std::size_t capacity()  const { return capacidade; }
+	std::size_t overflows() const { return transbordos; }
+};
+
+/**
+ * @class ArenaAllocator
+ * @brief Allocator padrão que obtém memória de uma Arena.
+ * @tparam T Tipo alocado.
+ * @details
+ *
+ * Permite usar contêineres da biblioteca padrão como memória temporária da época.
+ * deallocate() não faz nada; a memória retorna à arena em Arena::reset().
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+
+	using value_type = T;
+
+	Arena* arena;
+
+	explicit ArenaAllocator(Arena& arena_) noexcept : arena(&arena_) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& outro) noexcept : arena(outro.arena) {}
+
+	T*
+	allocate(
+		std::size_t n
+	){ return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+
+	void deallocate(T*, std::size_t) noexcept {}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& o) const noexcept { return arena == o.arena; }
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& o) const noexcept { return arena != o.arena; }
+};
+
+/// Vetor cuja memória vem da arena da época.
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/// String cuja memória vem da arena da época.
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+#endif // ARENA_HPP
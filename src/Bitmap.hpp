@@ -0,0 +1,370 @@
+/**
+ * @file Bitmap.hpp
+ * @brief Conjunto comprimido de inteiros de 32 bits, no estilo Roaring.
+ * @details
+ * Usado pelos índices do coletor para representar conjuntos de rastreadores. Uniões e
+ * interseções operam contêiner a contêiner, sem descomprimir o conjunto inteiro.
+ */
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "Snapshot.hpp"
+
+/**
+ * @class Bitmap
+ * @brief Conjunto de uint32_t particionado pelos 16 bits altos.
+ * @details
+ *
+ * Cada partição (contêiner) guarda os 16 bits baixos de seus elementos:
+ *
+ * - como lista ordenada de uint16_t, enquanto tiver até LIMITE_LISTA elementos (2 bytes cada);
+ * - como mapa de 65536 bits (8 KiB), acima disso.
+ *
+ * A conversão entre as formas ocorre automaticamente em add(), |= e &=.
+ */
+class Bitmap {
+public:
+
+	static constexpr std::size_t LIMITE_LISTA = 4096;
+	static constexpr std::size_t PALAVRAS     = 65536 / 64;
+
+private:
+
+	struct Conteiner {
+		uint16_t                  alto = 0;
+		uint32_t                     n = 0;
+		std::vector<uint16_t>    lista; ///< Usada quando bits está vazio.
+		std::vector<uint64_t>     bits; ///< PALAVRAS palavras quando denso.
+
+		bool denso() const { return !bits.empty(); }
+
+		void
+		to_dense(){
+
+			bits.assign(PALAVRAS, 0);
+			for( uint16_t v : lista ){ bits[v >> 6] |= uint64_t(1) << (v & 63); }
+			lista.clear();
+			lista.shrink_to_fit();
+		}
+
+		void
+		to_list(){
+
+			lista.clear();
+			lista.reserve(n);
+			for(
+				std::size_t w = 0; w < PALAVRAS; w++
+			){
+
+				for( uint64_t b = bits[w]; b; b &= b - 1 ){ lista.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(b))); }
+			}
+			bits.clear();
+			bits.shrink_to_fit();
+		}
+
+		bool
+		contains(
+			uint16_t v
+		) const {
+
+			if( denso() ){ return (bits[v >> 6] >> (v & 63)) & 1; }
+			return std::binary_search(lista.begin(), lista.end(), v);
+		}
+
+		void
+		add(
+			uint16_t v
+		){
+
+			if(
+				denso()
+			){
+
+				uint64_t& w = bits[v >> 6];
+				uint64_t  m = uint64_t(1) << (v & 63);
+				if( !(w & m) ){ w |= m; n++; }
+				return;
+			}
+
+			auto it = std::lower_bound(lista.begin(), lista.end(), v);
+			if( it != lista.end() && *it == v ){ return; }
+			lista.insert(it, v);
+			n++;
+
+			if( n > LIMITE_LISTA ){ to_dense(); }
+		}
+
+		void
+		unite(
+			const Conteiner& o
+		){
+
+			if(
+				!denso() && !o.denso()
+			){
+
+				std::vector<uint16_t> uniao;
+				uniao.reserve(lista.size() + o.lista.size());
+				std::set_union(lista.begin(), lista.end(), o.lista.begin(), o.lista.end(), std::back_inserter(uniao));
+				lista.swap(uniao);
+				n = static_cast<uint32_t>(lista.size());
+				if( n > LIMITE_LISTA ){ to_dense(); }
+				return;
+			}
+
+			if( !denso() ){ to_dense(); }
+			if( o.denso() ){ for( std::size_t w = 0; w < PALAVRAS; w++ ){ bits[w] |= o.bits[w]; } }
+			else{ for( uint16_t v : o.lista ){ bits[v >> 6] |= uint64_t(1) << (v & 63); } }
+			recount();
+		}
+
+		void
+		intersect(
+			const Conteiner& o
+		){
+
+			if(
+				denso() && o.denso()
+			){
+
+				for( std::size_t w = 0; w < PALAVRAS; w++ ){ bits[w] &= o.bits[w]; }
+				recount();
+				if( n <= LIMITE_LISTA ){ to_list(); }
+				return;
+			}
+
+			if(
+				denso()
+			){
+
+				std::vector<uint16_t> restantes;
+				for( uint16_t v : o.lista ){ if( contains(v) ){ restantes.push_back(v); } }
+				bits.clear();
+				bits.shrink_to_fit();
+				lista.swap(restantes);
+			}
+			else if(
+				o.denso()
+			){
+
+				lista.erase(std::remove_if(lista.begin(), lista.end(), [&](uint16_t v){ return !o.contains(v); }), lista.end());
+			}
+			else{
+
+				std::vector<uint16_t> comum;
+				std::set_intersection(lista.begin(), lista.end(), o.lista.begin(), o.lista.end(), std::back_inserter(comum));
+				lista.swap(comum);
+			}
+			n = static_cast<uint32_t>(lista.size());
+		}
+
+		void
+		recount(){
+
+			n = 0;
+			for( uint64_t w : bits ){ n += static_cast<uint32_t>(__builtin_popcountll(w)); }
+		}
+	};
+
+	std::vector<Conteiner> conteineres; ///< Ordenados por alto.
+
+	std::vector<Conteiner>::iterator
+	find(
+		uint16_t alto
+	){
+		return std::lower_bound(conteineres.begin(), conteineres.end(), alto,
+								[](const Conteiner& c, uint16_t a){ return c.alto < a; });
+	}
+
+public:
+
+	/**
+	 * @brief Acrescenta um elemento.
+	 */
+	void
+	add(
+		uint32_t v
+	){
+
+		uint16_t alto = static_cast<uint16_t>(v >> 16);
+		auto it = find(alto);
+		if(
+			it == conteineres.end() || it->alto != alto
+		){
+
+			it = conteineres.insert(it, Conteiner());
+			it->alto = alto;
+		}
+		it->add(static_cast<uint16_t>(v));
+	}
+
+	/**
+	 * @brief Indica se o elemento pertence ao conjunto.
+	 */
+	bool
+	contains(
+		uint32_t v
+	) const {
+
+		uint16_t alto = static_cast<uint16_t>(v >> 16);
+		auto it = std::lower_bound(conteineres.begin(), conteineres.end(), alto,
+								   [](const Conteiner& c, uint16_t a){ return c.alto < a; });
+		return it != conteineres.end() && it->alto == alto && it->contains(static_cast<uint16_t>(v));
+	}
+
+	/**
+	 * @brief União, no lugar.
+	 */
+	Bitmap&
+	operator|=(
+		const Bitmap& o
+	){
+
+		for(
+			const Conteiner& c : o.conteineres
+		){
+
+			auto it = find(c.alto);
+			if( it == conteineres.end() || it->alto != c.alto ){ conteineres.insert(it, c); }
+			else{ it->unite(c); }
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Interseção, no lugar.
+	 */
+	Bitmap&
+	operator&=(
+		const Bitmap& o
+	){
+
+		std::vector<Conteiner> resultado;
+		auto a = conteineres.begin();
+		auto b = o.conteineres.begin();
+		while(
+			a != conteineres.end() && b != o.conteineres.end()
+		){
+
+			if( a->alto < b->alto ){ ++a; continue; }
+			if( b->alto < a->alto ){ ++b; continue; }
+
+			a->intersect(*b);
+			if( a->n > 0 ){ resultado.push_back(std::move(*a)); }
+			++a; ++b;
+		}
+		conteineres.swap(resultado);
+		return *this;
+	}
+
+	friend Bitmap operator|(Bitmap a, const Bitmap& b){ a |= b; return a; }
+	friend Bitmap operator&(Bitmap a, const Bitmap& b){ a &= b; return a; }
+
+	/**
+	 * @brief Quantidade de elementos.
+	 */
+	std::size_t
+	cardinality() const {
+
+		std::size_t n = 0;
+		for( const auto& c : conteineres ){ n += c.n; }
+		return n;
+	}
+
+	bool empty() const { return conteineres.empty(); }
+
+	/**
+	 * @brief Memória ocupada pelos elementos, em bytes.
+	 */
+	std::size_t
+	bytes() const {
+
+		std::size_t n = 0;
+		for( const auto& c : conteineres ){ n += sizeof(Conteiner) + c.lista.capacity() * 2 + c.bits.capacity() * 8; }
+		return n;
+	}
+
+	/**
+	 * @brief Grava os contêineres no snapshot.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	) const {
+
+		w.put<uint32_t>(static_cast<uint32_t>(conteineres.size()));
+		for(
+			const auto& c : conteineres
+		){
+
+			w.put(c.alto);
+			w.put(c.n);
+			w.put_vector(c.lista);
+			w.put_vector(c.bits);
+		}
+	}
+
+	/**
+	 * @brief Substitui o conjunto pelo que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		uint32_t n = 0;
+		if( !r.get(n) || n > 65536 ){ return false; }
+
+		conteineres.assign(n, Conteiner());
+		for(
+			auto& c : conteineres
+		){
+
+			if( !r.get(c.alto) || !r.get(c.n) || !r.get_vector(c.lista) || !r.get_vector(c.bits) ){ return false; }
+			if( !c.bits.empty() && c.bits.size() != PALAVRAS ){ return false; }
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Percorre os elementos em ordem crescente.
+	 * @param visitar Função `void(uint32_t)`.
+	 */
+	template <typename F>
+	void
+	for_each(
+		F&& visitar
+	) const {
+
+		for(
+			const auto& c : conteineres
+		){
+
+			uint32_t base = uint32_t(c.alto) << 16;
+			if(
+				c.denso()
+			){
+
+				for(
+					std::size_t w = 0; w < PALAVRAS; w++
+				){
+
+					for( uint64_t b = c.bits[w]; b; b &= b - 1 ){ visitar(base | static_cast<uint32_t>(w * 64 + __builtin_ctzll(b))); }
+				}
+			}
+			else{
+
+				for( uint16_t v : c.lista ){ visitar(base | v); }
+			}
+		}
+	}
+};
+
+#endif // BITMAP_HPP
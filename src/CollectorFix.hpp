@@ -0,0 +1,141 @@
+/**
+ * @file CollectorFix.hpp
+ * @brief Representação de um fix recebido pelo coletor.
+ * @details
+ * O datagrama emitido por GPSTrack é a linha CSV `hhmmss.ss,lat,lon,alt` de
+ * GPSTrack::GPSData::to_csv(). No coletor, cada linha vira um CollectorFix com
+ * identificador do rastreador, instante absoluto e coordenadas em ponto fixo,
+ * formato adequado a compressão, varreduras e índices.
+ */
+#ifndef COLLECTORFIX_HPP
+#define COLLECTORFIX_HPP
+
+//-------------------------------------------------
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <string_view>
+
+// Específicos de Sistemas Linux
+#include <netinet/in.h>
+
+/**
+ * @struct CollectorFix
+ * @brief Fix de um rastreador, com coordenadas em ponto fixo.
+ * @details
+ *
+ * - Latitude e longitude em micrograus (1e-6 grau), exatamente as 6 casas do CSV.
+ * - Altitude em decímetros.
+ * - Instante em milissegundos desde a época Unix (UTC).
+ */
+struct CollectorFix {
+	uint64_t tracker = 0; ///< Identificador do rastreador.
+	int64_t  t_ms    = 0; ///< Instante do fix em ms desde 1970-01-01 UTC.
+	int32_t  lat_e6  = 0; ///< Latitude em micrograus.
+	int32_t  lon_e6  = 0; ///< Longitude em micrograus.
+	int32_t  alt_dm  = 0; ///< Altitude em decímetros.
+	uint32_t flags   = 0; ///< Marcações do rastreador e do pipeline (FLAG_*).
+
+	static constexpr uint32_t FLAG_ALERTA = 1u << 0; ///< Enviado com o campo opcional `,A`.
+
+	double lat() const { return lat_e6 * 1e-6; }
+	double lon() const { return lon_e6 * 1e-6; }
+	double alt() const { return alt_dm * 0.1;  }
+
+	/**
+	 * @brief Identificador do rastreador derivado do endereço de origem.
+	 * @details
+	 *
+	 * O datagrama não carrega identificação; cada par IPv4:porta de origem é um rastreador.
+	 */
+	static uint64_t
+	tracker_id(
+		const sockaddr_in& origem
+	){ return (static_cast<uint64_t>(ntohl(origem.sin_addr.s_addr)) << 16) | ntohs(origem.sin_port); }
+
+	/**
+	 * @brief Combina o horário do dia do fix com a data de recepção.
+	 * @param utc_ms Milissegundos desde 00:00 UTC, como enviado pelo rastreador.
+	 * @param recv_ms Instante de recepção em ms desde a época Unix.
+	 * @return Instante absoluto do fix em ms.
+	 * @details
+	 *
+	 * Escolhe o dia que deixa o fix mais próximo da recepção, tratando a virada da meia-noite
+	 * e fixes atrasados (por exemplo, esvaziamento de spool) de até 12 horas.
+	 */
+	static int64_t
+	absolute_day_ms(
+		int64_t utc_ms,
+		int64_t recv_ms
+	){
+
+		const int64_t DIA = 86400000;
+
+		int64_t inicio_dia = recv_ms - ((recv_ms % DIA) + DIA) % DIA;
+		int64_t t = inicio_dia + utc_ms;
+
+		if( t - recv_ms > DIA / 2 ){ t -= DIA; }
+		else if( recv_ms - t > DIA / 2 ){ t += DIA; }
+
+		return t;
+	}
+
+	/**
+	 * @brief Como absolute_day_ms(), com o horário do dia em segundos.
+	 */
+	static int64_t
+	absolute_ms(
+		double utc_s,
+		int64_t recv_ms
+	){ return absolute_day_ms(std::llround(utc_s * 1000.0), recv_ms); }
+
+	/**
+	 * @brief Interpreta uma linha CSV de GPSTrack com strtod.
+	 * @param linha Linha `hhmmss.ss,lat,lon,alt[,A]`, com ou sem '\\n'.
+	 * @param recv_ms Instante de recepção, para compor a data.
+	 * @param[out] fix Fix interpretado; tracker não é alterado.
+	 * @return False caso algum campo esteja vazio ou inválido. True, caso contrário.
+	 */
+	static bool
+	parse_csv(
+		std::string_view linha,
+		int64_t recv_ms,
+		CollectorFix& fix
+	){
+
+		char buffer[128];
+		if( linha.empty() || linha.size() >= sizeof(buffer) ){ return false; }
+		for( std::size_t i = 0; i < linha.size(); i++ ){ buffer[i] = linha[i]; }
+		buffer[linha.size()] = '\0';
+
+		double valores[4];
+		char* p = buffer;
+		for(
+			int i = 0; i < 4; i++
+		){
+
+			char* fim = nullptr;
+			valores[i] = std::strtod(p, &fim);
+			if( fim == p ){ return false; }
+			if( i < 3 ){
+
+				if( *fim != ',' ){ return false; }
+				p = fim + 1;
+			}
+			else if( fim[0] == ',' && fim[1] == 'A' ){ fix.flags |= FLAG_ALERTA; } // Alerta (pânico, violação)
+		}
+
+		if( valores[1] < -90 || valores[1] > 90 || valores[2] < -180 || valores[2] > 180 ){ return false; }
+
+		// hhmmss.ss em segundos: (10000h + 100m + s) - 40(100h + m) - 2400h = 3600h + 60m + s
+		double utc_s = valores[0] - 40 * std::floor(valores[0] / 100) - 2400 * std::floor(valores[0] / 10000);
+
+		fix.t_ms   = absolute_ms(utc_s, recv_ms);
+		fix.lat_e6 = static_cast<int32_t>(std::llround(valores[1] * 1e6));
+		fix.lon_e6 = static_cast<int32_t>(std::llround(valores[2] * 1e6));
+		fix.alt_dm = static_cast<int32_t>(std::llround(valores[3] * 10));
+		return true;
+	}
+};
+
+#endif // COLLECTORFIX_HPP
@@ -0,0 +1,602 @@
+/**
+ * @file CollectorWAL.hpp
+ * @brief Write-ahead log do coletor, com group commit.
+ * @details
+ * Gravar cada linha recebida com um fsync limitaria o coletor a poucos milhares de fixes
+ * por segundo. O WAL agrupa os lotes de todas as threads de recepção e realiza um único
+ * fdatasync por janela de agrupamento.
+ */
+#ifndef COLLECTORWAL_HPP
+#define COLLECTORWAL_HPP
+
+//-------------------------------------------------
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+
+#include <chrono>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <stdexcept>
+
+// Específicos de Sistemas Linux
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "CollectorFix.hpp"
+#include "Crc32.hpp"
+
+/**
+ * @class CollectorWAL
+ * @brief Log sequencial de lotes de CollectorFix, em segmentos, com recuperação.
+ * @details
+ *
+ * Formato em disco: o diretório contém segmentos `wal-<lsn>.log`, onde `<lsn>` é o LSN do
+ * primeiro fix do segmento. Cada segmento é uma sequência de lotes:
+ *
+ * - Cabecalho: mágica, quantidade de fixes, LSN do primeiro fix e CRC32 do conteúdo.
+ * - Conteúdo: os CollectorFix em sua representação binária.
+ *
+ * Cada fix recebe um LSN (Log Sequence Number) crescente, a partir de 1.
+ *
+ * Group commit: append() apenas copia o lote para um buffer compartilhado. Uma thread de
+ * gravação aguarda a janela de agrupamento, troca o buffer, grava tudo com um write() e um
+ * fdatasync(), e então avança o LSN durável.
+ *
+ * Falhas de gravação: se o write() ou o fdatasync() falham, o LSN durável não avança. O
+ * segmento é truncado no fim do último grupo íntegro (após um fdatasync com erro, as páginas
+ * sujas podem ter sido descartadas pelo kernel), o grupo volta para o início do buffer e é
+ * regravado na tentativa seguinte; quem aguarda em wait_durable() recebe false e o errno
+ * fica disponível em error().
+ *
+ * Durabilidade:
+ *
+ * - NENHUMA  : apenas write(); sobrevive à queda do processo, não à do sistema.
+ * - LOTE     : fdatasync por janela; quem grava não espera (perda limitada à janela).
+ * - SINCRONA : fdatasync por janela; quem grava espera com wait_durable().
+ *
+ * Recuperação: replay() percorre os segmentos a partir de um LSN e entrega cada lote íntegro.
+ * Ao abrir, lotes incompletos ou corrompidos no fim do último segmento são descartados.
+ */
+class CollectorWAL {
+public:
+
+	enum class Durabilidade { NENHUMA, LOTE, SINCRONA };
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de gravação.
+	 */
+	struct Stats {
+		uint64_t lotes;      ///< Lotes recebidos por append().
+		uint64_t gravacoes;  ///< Grupos gravados (write + fdatasync).
+		uint64_t bytes;      ///< Bytes gravados.
+		uint64_t lsn_duravel;
+		uint64_t falhas;     ///< Tentativas de gravação com erro.
+	};
+
+	/// Função chamada a cada lote recuperado: fixes, quantidade e LSN do primeiro.
+	using FnReplay = std::function<void(const CollectorFix*, std::size_t, uint64_t)>;
+
+private:
+
+	struct Cabecalho {
+		uint32_t magica;
+		uint32_t n;
+		uint64_t lsn;
+		uint32_t crc;
+		uint32_t reservado;
+	};
+	static_assert(sizeof(Cabecalho) == 24, "Cabecalho do WAL deve ter 24 bytes");
+
+	static constexpr uint32_t MAGICA = 0x31574c47; // "GLW1"
+
+	std::string                      dir;
+	Durabilidade                    modo;
+	std::chrono::microseconds     janela;
+	std::size_t             tam_segmento;
+
+	int                         fd = -1;
+	std::size_t         bytes_segmento = 0;
+
+	std::mutex                       mtx;
+	std::condition_variable   cv_gravador;
+	std::condition_variable    cv_duravel;
+	std::vector<char>           pendente;
+	std::vector<char>           gravando;
+	uint64_t               proximo_lsn = 1;
+	std::atomic<uint64_t> lsn_duravel{1}; ///< Todo LSN menor que este está gravado.
+	int                         erro = 0; ///< errno da última tentativa, 0 após um sucesso.
+	bool                 truncar = false; ///< O segmento tem bytes após `bytes_segmento`.
+	bool                    is_exec = true;
+	std::thread                 gravador;
+
+	std::atomic<uint64_t>        n_lotes{0};
+	std::atomic<uint64_t>    n_gravacoes{0};
+	std::atomic<uint64_t>        n_bytes{0};
+	std::atomic<uint64_t>       n_falhas{0};
+
+	static std::string
+	segment_name(
+		const std::string& dir,
+		uint64_t lsn
+	){
+
+		char nome[64];
+		std::snprintf(nome, sizeof(nome), "/wal-%020llu.log", static_cast<unsigned long long>(lsn));
+		return dir + nome;
+	}
+
+	/**
+	 * @brief Lista os segmentos do diretório, ordenados pelo LSN inicial.
+	 */
+	static std::vector<std::pair<uint64_t, std::string>>
+	list_segments(
+		const std::string& dir
+	){
+
+		std::vector<std::pair<uint64_t, std::string>> segmentos;
+
+		DIR* d = ::opendir(dir.c_str());
+		if( !d ){ return segmentos; }
+
+		while(
+			dirent* ent = ::readdir(d)
+		){
+
+			unsigned long long lsn = 0;
+			char sufixo[8] = {};
+			if( std::sscanf(ent->d_name, "wal-%20llu.%3s", &lsn, sufixo) == 2 && std::strcmp(sufixo, "log") == 0 ){
+
+				segmentos.emplace_back(lsn, dir + "/" + ent->d_name);
+			}
+		}
+		::closedir(d);
+
+		std::sort(segmentos.begin(), segmentos.end());
+		return segmentos;
+	}
+
+	/**
+	 * @brief Lê todos os bytes solicitados, tolerando leituras parciais.
+	 */
+	static bool
+	read_all(
+		int fd,
+		void* destino,
+		std::size_t n
+	){
+
+		char* p = static_cast<char*>(destino);
+		while(
+			n > 0
+		){
+
+			ssize_t k = ::read(fd, p, n);
+			if( k <= 0 ){ return false; }
+			p += k; n -= static_cast<std::size_t>(k);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Percorre um segmento entregando os lotes íntegros.
+	 * @return Deslocamento do fim do último lote íntegro.
+	 */
+	static off_t
+	scan_segment(
+		const std::string& caminho,
+		uint64_t desde_lsn,
+		uint64_t& proximo,
+		const FnReplay& fn
+	){
+
+		int f = ::open(caminho.c_str(), O_RDONLY | O_CLOEXEC);
+		if( f < 0 ){ return 0; }
+
+		off_t valido = 0;
+		std::vector<CollectorFix> lote;
+		Cabecalho cab;
+		while(
+			read_all(f, &cab, sizeof(cab))
+		){
+
+			if( cab.magica != MAGICA || cab.n == 0 || cab.n > (1u << 20) ){ break; }
+
+			lote.resize(cab.n);
+			if( !read_all(f, lote.data(), cab.n * sizeof(CollectorFix)) ){ break; }
+			if( crc32(lote.data(), cab.n * sizeof(CollectorFix)) != cab.crc ){ break; }
+
+			valido += sizeof(cab) + cab.n * sizeof(CollectorFix);
+			proximo = cab.lsn + cab.n;
+
+			if( fn && cab.lsn + cab.n > desde_lsn ){
+
+				// Entrega apenas a parte do lote a partir de desde_lsn
+				std::size_t pular = (cab.lsn < desde_lsn) ? static_cast<std::size_t>(desde_lsn - cab.lsn) : 0;
+				fn(lote.data() + pular, cab.n - pular, cab.lsn + pular);
+			}
+		}
+
+		::close(f);
+		return valido;
+	}
+
+	/**
+	 * @brief Abre um novo segmento para escrita.
+	 * @details
+	 *
+	 * O segmento anterior deve terminar no último grupo íntegro: `truncar` se refere a ele
+	 * e é zerado aqui.
+	 */
+	void
+	open_segment(
+		uint64_t lsn
+	){
+
+		if( fd >= 0 ){ ::close(fd); }
+
+		std::string caminho = segment_name(dir, lsn);
+		fd = ::open(caminho.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if( fd < 0 ){ throw std::runtime_error("\033[1;31mErro ao abrir segmento do WAL: " + caminho + "\033[0m"); }
+
+		bytes_segmento = static_cast<std::size_t>(::lseek(fd, 0, SEEK_END));
+		truncar        = false;
+
+		// Garante que a entrada do diretório também seja durável
+		int fd_dir = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if( fd_dir >= 0 ){ ::fsync(fd_dir); ::close(fd_dir); }
+	}
+
+	/**
+	 * @brief Grava o buffer `gravando` no segmento atual, sem avançar o LSN durável.
+	 * @return 0 ou o errno da falha; em caso de falha o segmento é truncado no último grupo íntegro.
+	 */
+	int
+	write_group(){
+
+		// Restos de uma tentativa anterior, caso o ftruncate() também tenha falhado
+		if( truncar && ::ftruncate(fd, static_cast<off_t>(bytes_segmento)) != 0 ){ return errno; }
+		truncar = false;
+
+		const char* p = gravando.data();
+		std::size_t n = gravando.size();
+		int      falha = 0;
+		while(
+			n > 0
+		){
+
+			ssize_t k = ::write(fd, p, n);
+			if(
+				k < 0
+			){
+
+				if( errno == EINTR ){ continue; }
+				falha = errno;
+				break;
+			}
+			p += k; n -= static_cast<std::size_t>(k);
+		}
+		if( !falha && modo != Durabilidade::NENHUMA && ::fdatasync(fd) != 0 ){ falha = errno; }
+
+		if(
+			falha
+		){
+
+			truncar = ::ftruncate(fd, static_cast<off_t>(bytes_segmento)) != 0;
+			return falha;
+		}
+
+		bytes_segmento += gravando.size();
+		return 0;
+	}
+
+	/**
+	 * @brief Loop da thread de gravação (group commit).
+	 */
+	void
+	loop(){
+
+		std::unique_lock<std::mutex> lock(mtx);
+		while(
+			true
+		){
+
+			cv_gravador.wait(lock, [this]{ return !pendente.empty() || !is_exec; });
+			if( pendente.empty() ){ break; } // Encerrado e sem pendências
+
+			// Janela de agrupamento: outras threads acumulam lotes enquanto esperamos
+			if(
+				is_exec && janela.count() > 0
+			){
+
+				lock.unlock();
+				std::this_thread::sleep_for(janela);
+				lock.lock();
+			}
+
+			std::swap(pendente, gravando);
+			uint64_t fim_lsn   = proximo_lsn;
+			uint64_t lsn_grupo = lsn_duravel.load(std::memory_order_relaxed);
+			lock.unlock();
+
+			// Rotação antes de gravar, para que o nome reflita o primeiro LSN do segmento. Com
+			// restos de uma falha, o segmento só é fechado depois de truncado por write_group():
+			// lotes íntegros deixados nele seriam reaplicados junto de sua regravação no seguinte
+			if( bytes_segmento >= tam_segmento && !truncar ){ open_segment(lsn_grupo); }
+
+			int falha = write_group();
+			if(
+				falha
+			){
+
+				std::cout << "\033[1;31mErro ao gravar WAL: " << std::strerror(falha) << "\033[0m" << std::endl;
+
+				// O grupo volta para a frente do buffer, antes dos lotes que chegaram depois
+				lock.lock();
+				pendente.insert(pendente.begin(), gravando.begin(), gravando.end());
+				gravando.clear();
+				erro = falha;
+				n_falhas.fetch_add(1, std::memory_order_relaxed);
+				cv_duravel.notify_all();
+
+				if( !is_exec ){ std::cout << "\033[1;31mWAL encerrado com " << pendente.size() << " bytes não gravados\033[0m" << std::endl; break; }
+				cv_gravador.wait_for(lock, std::chrono::milliseconds(100), [this]{ return !is_exec; });
+				continue;
+			}
+
+			n_bytes.fetch_add(gravando.size(), std::memory_order_relaxed);
+			n_gravacoes.fetch_add(1, std::memory_order_relaxed);
+			gravando.clear();
+
+			lock.lock();
+			erro = 0;
+			lsn_duravel.store(fim_lsn, std::memory_order_release);
+			cv_duravel.notify_all();
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor. Recupera o estado do diretório e inicia a thread de gravação.
+	 * @param dir_ Diretório do WAL, criado se não existir.
+	 * @param modo_ Nível de durabilidade.
+	 * @param janela_ Janela de agrupamento; zero grava assim que houver dados.
+	 * @param tam_segmento_ Tamanho a partir do qual um novo segmento é iniciado.
+	 * @details
+	 *
+	 * O fim corrompido do último segmento (gravação interrompida por queda) é truncado.
+	 * Use replay() antes de construir para reconstruir o estado em memória.
+	 */
+	CollectorWAL(
+		const std::string& dir_,
+		Durabilidade modo_ = Durabilidade::SINCRONA,
+		std::chrono::microseconds janela_ = std::chrono::microseconds(1000),
+		std::size_t tam_segmento_ = 64u << 20
+	) : dir(dir_),
+		modo(modo_),
+		janela(janela_),
+		tam_segmento(tam_segmento_)
+	{
+
+		::mkdir(dir.c_str(), 0755);
+
+		auto segmentos = list_segments(dir);
+		if(
+			segmentos.empty()
+		){
+
+			open_segment(1);
+		}
+		else{
+
+			uint64_t proximo = segmentos.back().first;
+			for( const auto& seg : segmentos ){ proximo = std::max(proximo, seg.first); }
+
+			off_t valido = scan_segment(segmentos.back().second, UINT64_MAX, proximo, nullptr);
+			if( ::truncate(segmentos.back().second.c_str(), valido) != 0 ){
+
+				throw std::runtime_error("\033[1;31mErro ao truncar fim corrompido do WAL\033[0m");
+			}
+
+			proximo_lsn = proximo;
+			lsn_duravel = proximo;
+			open_segment(segmentos.back().first);
+		}
+
+		gravador = std::thread(
+							   [this]{ loop(); }
+							  );
+	}
+
+	/**
+	 * @brief Destrutor. Grava o que estiver pendente e encerra a thread.
+	 */
+	~CollectorWAL(){
+
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			is_exec = false;
+		}
+		cv_gravador.notify_all();
+		if( gravador.joinable() ){ gravador.join(); }
+		if( fd >= 0 ){ ::fdatasync(fd); ::close(fd); }
+	}
+
+	CollectorWAL(const CollectorWAL&)            = delete;
+	CollectorWAL& operator=(const CollectorWAL&) = delete;
+
+	/**
+	 * @brief Acrescenta um lote de fixes ao log.
+	 * @param fixes Ponteiro para os fixes.
+	 * @param n Quantidade de fixes.
+	 * @return LSN seguinte ao último fix do lote, a ser passado para wait_durable().
+	 * @details
+	 *
+	 * O CRC é calculado fora do lock; sob o lock, apenas o LSN é atribuído e os bytes copiados.
+	 */
+	uint64_t
+	append(
+		const CollectorFix* fixes,
+		std::size_t n
+	){
+
+		if( n == 0 ){ return proximo_lsn; }
+
+		Cabecalho cab{};
+		cab.magica = MAGICA;
+		cab.n      = static_cast<uint32_t>(n);
+		cab.crc    = crc32(fixes, n * sizeof(CollectorFix));
+
+		uint64_t fim;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+
+			cab.lsn = proximo_lsn;
+			proximo_lsn += n;
+			fim = proximo_lsn;
+
+			const char* c = reinterpret_cast<const char*>(&cab);
+			const char* f = reinterpret_cast<const char*>(fixes);
+			pendente.insert(pendente.end(), c, c + sizeof(cab));
+			pendente.insert(pendente.end(), f, f + n * sizeof(CollectorFix));
+		}
+		cv_gravador.notify_one();
+		n_lotes.fetch_add(1, std::memory_order_relaxed);
+
+		return fim;
+	}
+
+	/**
+	 * @brief Aguarda até que todos os fixes anteriores a lsn estejam gravados.
+	 * @param lsn Valor retornado por append().
+	 * @return False caso uma tentativa de gravação falhe antes disso (ver error()); os fixes
+	 * continuam no buffer e serão regravados, mas não devem ser confirmados como duráveis.
+	 */
+	bool
+	wait_durable(
+		uint64_t lsn
+	){
+
+		if( lsn_duravel.load(std::memory_order_acquire) >= lsn ){ return true; }
+
+		std::unique_lock<std::mutex> lock(mtx);
+		uint64_t falhas = n_falhas.load(std::memory_order_relaxed);
+		cv_duravel.wait(lock, [&]{ return lsn_duravel.load(std::memory_order_acquire) >= lsn || n_falhas.load(std::memory_order_relaxed) != falhas; });
+		return lsn_duravel.load(std::memory_order_acquire) >= lsn;
+	}
+
+	/**
+	 * @brief errno da última tentativa de gravação, ou 0 caso ela tenha sido bem-sucedida.
+	 */
+	int
+	error(){
+
+		std::lock_guard<std::mutex> lock(mtx);
+		return erro;
+	}
+
+	/**
+	 * @brief Indica se quem grava deve aguardar a durabilidade.
+	 */
+	bool synchronous() const { return modo == Durabilidade::SINCRONA; }
+
+	/**
+	 * @brief Próximo LSN a ser atribuído.
+	 */
+	uint64_t
+	next_lsn(){
+
+		std::lock_guard<std::mutex> lock(mtx);
+		return proximo_lsn;
+	}
+
+	/**
+	 * @brief Remove segmentos cujos fixes são todos anteriores a lsn.
+	 * @param lsn Normalmente o LSN coberto por um snapshot.
+	 * @return Quantidade de segmentos removidos.
+	 */
+	std::size_t
+	truncate_before(
+		uint64_t lsn
+	){
+
+		auto segmentos = list_segments(dir);
+		std::size_t removidos = 0;
+		for(
+			std::size_t i = 0; i + 1 < segmentos.size(); i++
+		){
+
+			// O segmento i termina onde o i + 1 começa; o último nunca é removido
+			if( segmentos[i + 1].first <= lsn && ::unlink(segmentos[i].second.c_str()) == 0 ){ removidos++; }
+		}
+		return removidos;
+	}
+
+	/**
+	 * @brief Obtém os contadores de gravação.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.lotes       = n_lotes.load(std::memory_order_relaxed);
+		s.gravacoes   = n_gravacoes.load(std::memory_order_relaxed);
+		s.bytes       = n_bytes.load(std::memory_order_relaxed);
+		s.lsn_duravel = lsn_duravel.load(std::memory_order_relaxed);
+		s.falhas      = n_falhas.load(std::memory_order_relaxed);
+		return s;
+	}
+
+	/**
+	 * @brief LSN do primeiro fix ainda presente no diretório.
+	 * @return 1 caso nenhum segmento tenha sido removido por truncate_before() (ou não haja WAL).
+	 */
+	static uint64_t
+	first_lsn(
+		const std::string& dir
+	){
+
+		auto segmentos = list_segments(dir);
+		return segmentos.empty() ? 1 : segmentos.front().first;
+	}
+
+	/**
+	 * @brief Entrega, em ordem, todos os lotes íntegros a partir de um LSN.
+	 * @param dir Diretório do WAL.
+	 * @param desde_lsn Primeiro LSN de interesse (1 para todo o log).
+	 * @param fn Função chamada a cada lote.
+	 * @return Próximo LSN após o último fix recuperado.
+	 */
+	static uint64_t
+	replay(
+		const std::string& dir,
+		uint64_t desde_lsn,
+		const FnReplay& fn
+	){
+
+		uint64_t proximo = 1;
+		for(
+			const auto& seg : list_segments(dir)
+		){
+
+			proximo = std::max(proximo, seg.first);
+			scan_segment(seg.second, desde_lsn, proximo, fn);
+		}
+		return proximo;
+	}
+};
+
+#endif // COLLECTORWAL_HPP
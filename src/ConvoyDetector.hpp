@@ -0,0 +1,416 @@
+/**
+ * @file ConvoyDetector.hpp
+ * @brief Detecção de comboios e colocalizações entre rastreadores.
+ * @details
+ * Em cenários de roubo, a carga é levada junto de outra unidade rastreada ou fica parada
+ * ao lado de um veículo inesperado. O detector encontra, continuamente, pares de rastreadores
+ * a até D metros um do outro por pelo menos T, com custo proporcional à densidade local da
+ * frota, e não ao quadrado do seu tamanho.
+ */
+#ifndef CONVOYDETECTOR_HPP
+#define CONVOYDETECTOR_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "GPSFix.hpp"
+#include "TrackerState.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @struct ConvoyEvent
+ * @brief Início ou fim da proximidade prolongada de um par de rastreadores.
+ */
+struct ConvoyEvent {
+
+	enum class Tipo { COMBOIO, COLOCALIZACAO };
+	enum class Fase { INICIO, FIM };
+
+	Tipo     tipo        = Tipo::COMBOIO;
+	Fase     fase        = Fase::INICIO;
+	uint64_t a           = 0; ///< Rastreadores, com a < b.
+	uint64_t b           = 0;
+	int64_t  t_ini       = 0; ///< Início da proximidade, em ms desde a época Unix.
+	int64_t  t_fim       = 0; ///< Última observação da proximidade.
+	float    distancia_m = 0; ///< Distância na última observação.
+	int32_t  lat_e6      = 0, lon_e6 = 0; ///< Posição de `a` na última observação.
+
+	/**
+	 * @brief Linha CSV `fase,tipo,a,b,t_ini,t_fim,distancia_m,lat,lon`.
+	 */
+	std::string
+	to_csv() const {
+
+		char linha[192];
+		std::snprintf(linha, sizeof(linha), "%s,%s,%llu,%llu,%lld,%lld,%.1f,%.6f,%.6f\n",
+					  fase == Fase::INICIO ? "inicio" : "fim", tipo == Tipo::COMBOIO ? "comboio" : "colocalizacao",
+					  static_cast<unsigned long long>(a), static_cast<unsigned long long>(b),
+					  static_cast<long long>(t_ini), static_cast<long long>(t_fim), distancia_m, lat_e6 * 1e-6, lon_e6 * 1e-6);
+		return linha;
+	}
+};
+
+/**
+ * @class ConvoyDetector
+ * @brief Junção espaço-temporal periódica sobre as posições atuais da TrackerTable.
+ * @details
+ *
+ * A cada tick:
+ *
+ * - As posições recentes (até `atualidade_ms`) são copiadas da TrackerTable e ordenadas
+ *   por célula de uma grade de lado D. Essa é a grade viva; seu custo é O(N log N).
+ * - Cada rastreador é comparado apenas com os da própria célula e de metade das vizinhas,
+ *   de modo que cada par é examinado uma vez e o custo cresce com a densidade local.
+ * - Os pares a até D metros entram em uma janela deslizante: o par é reportado (INICIO)
+ *   quando a proximidade dura `duracao_ms`, e encerrado (FIM) quando não é observado por
+ *   mais de `atualidade_ms`.
+ *
+ * O par é um comboio se a velocidade média dos dois supera 2 m/s; caso contrário, uma
+ * colocalização. Os métodos init() e stop() seguem o mesmo padrão de GPSTrack.
+ */
+class ConvoyDetector {
+public:
+
+	using Sink = std::function<void(const ConvoyEvent&)>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores do detector.
+	 */
+	struct Stats {
+		uint64_t ticks;
+		uint64_t eventos;
+		uint64_t pares_ativos;  ///< Pares próximos acompanhados.
+		uint64_t ativos;        ///< Rastreadores com posição recente no último tick.
+		double   ultimo_tick_ms; ///< Duração do último tick.
+	};
+
+private:
+
+	struct Ponto {
+		uint64_t celula;
+		uint64_t tracker;
+		int64_t  t_ms;
+		int32_t  lat_e6, lon_e6;
+		float    vel;
+		float    cos_lat;
+	};
+
+	struct ChavePar {
+		uint64_t a, b;
+		bool operator==(const ChavePar& o) const { return a == o.a && b == o.b; }
+	};
+
+	struct HashPar {
+		std::size_t operator()(const ChavePar& k) const { return static_cast<std::size_t>((k.a * 0x9e3779b97f4a7c15ULL) ^ (k.b + (k.b << 17) + (k.b >> 13))); }
+	};
+
+	struct Par {
+		int64_t  t_ini;
+		int64_t  t_ultimo;
+		float    distancia;
+		float    vel;
+		int32_t  lat_e6, lon_e6;
+		bool     reportado;
+	};
+
+	TrackerTable<TrackerState>&              tabela;
+	double                              distancia_m;
+	int64_t                              duracao_ms;
+	int64_t                           atualidade_ms;
+	int64_t                              periodo_ms;
+
+	std::vector<Ponto>                       pontos;
+	std::vector<uint64_t>                   celulas; ///< Células distintas, ordenadas.
+	std::vector<uint32_t>                   inicios; ///< Início de cada célula em pontos.
+	std::unordered_map<ChavePar, Par, HashPar> pares;
+
+	Sink                                       sink;
+	std::thread                              worker;
+	std::atomic<bool>                is_exec{false};
+
+	std::atomic<uint64_t>                 n_ticks{0};
+	std::atomic<uint64_t>               n_eventos{0};
+	std::atomic<uint64_t>                n_ativos{0};
+	std::atomic<uint64_t>          n_pares_ativos{0};
+	std::atomic<double>            duracao_tick{0};
+
+	/// Coordenadas deslocadas de 2^31: a ordem das chaves é a ordem numérica de (cy, cx), inclusive
+	/// entre células de sinais opostos, dos dois lados do meridiano de Greenwich e do equador.
+	static uint64_t
+	pack(
+		int64_t cx,
+		int64_t cy
+	){ return (static_cast<uint64_t>(static_cast<uint32_t>(cy) ^ 0x80000000u) << 32) | (static_cast<uint32_t>(cx) ^ 0x80000000u); }
+
+	static int64_t unpack_x(uint64_t celula){ return static_cast<int32_t>(static_cast<uint32_t>(celula) ^ 0x80000000u); }
+	static int64_t unpack_y(uint64_t celula){ return static_cast<int32_t>(static_cast<uint32_t>(celula >> 32) ^ 0x80000000u); }
+
+	void
+	emit(
+		const ChavePar& k,
+		const Par& p,
+		ConvoyEvent::Fase fase
+	){
+
+		ConvoyEvent ev;
+		ev.tipo        = p.vel > 2 ? ConvoyEvent::Tipo::COMBOIO : ConvoyEvent::Tipo::COLOCALIZACAO;
+		ev.fase        = fase;
+		ev.a           = k.a;
+		ev.b           = k.b;
+		ev.t_ini       = p.t_ini;
+		ev.t_fim       = p.t_ultimo;
+		ev.distancia_m = p.distancia;
+		ev.lat_e6      = p.lat_e6;
+		ev.lon_e6      = p.lon_e6;
+
+		n_eventos.fetch_add(1, std::memory_order_relaxed);
+		if( sink ){ sink(ev); }
+	}
+
+	/**
+	 * @brief Loop da thread do detector.
+	 */
+	void
+	loop(){
+
+		using namespace std::chrono;
+
+		auto proximo = steady_clock::now() + milliseconds(periodo_ms);
+		while(
+			is_exec
+		){
+
+			if( steady_clock::now() < proximo ){ std::this_thread::sleep_for(milliseconds(100)); continue; }
+			proximo += milliseconds(periodo_ms);
+
+			tick(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param tabela_ TrackerTable com as posições atuais dos rastreadores.
+	 * @param distancia_m_ Distância máxima D entre os rastreadores do par.
+	 * @param duracao_ms_ Duração mínima T da proximidade.
+	 * @param atualidade_ms_ Idade máxima de uma posição, e tolerância entre observações do par.
+	 * @param periodo_ms_ Intervalo entre ticks da thread do detector.
+	 */
+	explicit ConvoyDetector(
+		TrackerTable<TrackerState>& tabela_,
+		double distancia_m_ = 30,
+		int64_t duracao_ms_ = 300000,
+		int64_t atualidade_ms_ = 60000,
+		int64_t periodo_ms_ = 10000
+	) : tabela(tabela_),
+		distancia_m(distancia_m_),
+		duracao_ms(duracao_ms_),
+		atualidade_ms(atualidade_ms_),
+		periodo_ms(periodo_ms_) {}
+
+	~ConvoyDetector(){ stop(); }
+
+	ConvoyDetector(const ConvoyDetector&)            = delete;
+	ConvoyDetector& operator=(const ConvoyDetector&) = delete;
+
+	/**
+	 * @brief Define a função que recebe os eventos. Deve ser chamado antes de init().
+	 */
+	void on_event(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Executa um tick da junção.
+	 * @param agora_ms Instante de referência para a atualidade das posições.
+	 * @return Quantidade de pares próximos observados neste tick.
+	 * @details
+	 *
+	 * Chamado pela thread do detector; pode ser chamado diretamente (benchmarks, reprocessamento)
+	 * desde que init() não esteja em execução.
+	 */
+	std::size_t
+	tick(
+		int64_t agora_ms
+	){
+
+		auto t0 = std::chrono::steady_clock::now();
+
+		// Posições recentes e a maior latitude, que define a largura das células em longitude
+		pontos.clear();
+		int32_t lat_abs_max = 0;
+		tabela.for_each([&](uint64_t tracker, const TrackerState& e){
+
+			if( e.n_fixes == 0 || agora_ms - e.t_ms > atualidade_ms ){ return; }
+			pontos.push_back({ 0, tracker, e.t_ms, e.lat_e6, e.lon_e6, e.vel_mps, 0 });
+			lat_abs_max = std::max(lat_abs_max, std::abs(e.lat_e6));
+		});
+
+		double passo_lat = distancia_m / 111320.0 * 1e6;
+		double passo_lon = distancia_m / (111320.0 * std::cos(std::min(85.0, lat_abs_max * 1e-6) * M_PI / 180.0)) * 1e6;
+		for(
+			Ponto& p : pontos
+		){
+
+			p.cos_lat = static_cast<float>(std::cos(p.lat_e6 * 1e-6 * M_PI / 180.0));
+			p.celula  = pack(static_cast<int64_t>(std::floor(p.lon_e6 / passo_lon)), static_cast<int64_t>(std::floor(p.lat_e6 / passo_lat)));
+		}
+		std::sort(pontos.begin(), pontos.end(), [](const Ponto& a, const Ponto& b){ return a.celula < b.celula; });
+
+		celulas.clear();
+		inicios.clear();
+		for(
+			uint32_t i = 0; i < pontos.size(); i++
+		){
+
+			if( i == 0 || pontos[i].celula != pontos[i - 1].celula ){ celulas.push_back(pontos[i].celula); inicios.push_back(i); }
+		}
+		inicios.push_back(static_cast<uint32_t>(pontos.size()));
+
+		// Junção: própria célula e metade da vizinhança (leste, nordeste, norte, noroeste)
+		std::size_t observados = 0;
+		double      limite2    = (distancia_m * 1.01 + 1) * (distancia_m * 1.01 + 1);
+		auto comparar = [&](const Ponto& p, const Ponto& q){
+
+			if( std::llabs(p.t_ms - q.t_ms) > atualidade_ms ){ return; }
+
+			// Aproximação plana, suficiente para descartar a maioria dos candidatos da vizinhança
+			double dy = (p.lat_e6 - q.lat_e6) * 0.11132, dx = (p.lon_e6 - q.lon_e6) * 0.11132 * p.cos_lat;
+			if( dx * dx + dy * dy > limite2 ){ return; }
+
+			double d = GPSFix::distance_m(p.lat_e6 * 1e-6, p.lon_e6 * 1e-6, q.lat_e6 * 1e-6, q.lon_e6 * 1e-6);
+			if( d > distancia_m ){ return; }
+
+			const Ponto& pa = (p.tracker < q.tracker) ? p : q;
+			ChavePar k{ std::min(p.tracker, q.tracker), std::max(p.tracker, q.tracker) };
+			int64_t  t = std::min(p.t_ms, q.t_ms);
+
+			auto it = pares.find(k);
+			if( it == pares.end() ){ it = pares.emplace(k, Par{ t, t, 0, 0, 0, 0, false }).first; }
+			Par& par      = it->second;
+			par.t_ultimo  = std::max(par.t_ultimo, t);
+			par.distancia = static_cast<float>(d);
+			par.vel       = (p.vel + q.vel) / 2;
+			par.lat_e6    = pa.lat_e6;
+			par.lon_e6    = pa.lon_e6;
+			observados++;
+		};
+
+		std::size_t acima = 0;
+		for(
+			std::size_t c = 0; c < celulas.size(); c++
+		){
+
+			int64_t cx = unpack_x(celulas[c]), cy = unpack_y(celulas[c]);
+			uint32_t ini = inicios[c], fim = inicios[c + 1];
+
+			for( uint32_t i = ini; i < fim; i++ ){ for( uint32_t j = i + 1; j < fim; j++ ){ comparar(pontos[i], pontos[j]); } }
+
+			// Leste é a célula seguinte, se existir
+			if(
+				c + 1 < celulas.size() && celulas[c + 1] == pack(cx + 1, cy)
+			){
+
+				for( uint32_t i = ini; i < fim; i++ ){ for( uint32_t j = fim; j < inicios[c + 2]; j++ ){ comparar(pontos[i], pontos[j]); } }
+			}
+
+			// Noroeste, norte e nordeste são consecutivas na linha de cima; como as células são
+			// visitadas em ordem, o cursor da linha de cima só avança
+			while( acima < celulas.size() && celulas[acima] < pack(cx - 1, cy + 1) ){ acima++; }
+			for(
+				std::size_t k = acima; k < celulas.size() && celulas[k] <= pack(cx + 1, cy + 1); k++
+			){
+
+				for( uint32_t i = ini; i < fim; i++ ){ for( uint32_t j = inicios[k]; j < inicios[k + 1]; j++ ){ comparar(pontos[i], pontos[j]); } }
+			}
+		}
+
+		// Janela deslizante dos pares
+		for(
+			auto it = pares.begin(); it != pares.end();
+		){
+
+			const ChavePar& k = it->first;
+			Par&            p = it->second;
+
+			if(
+				agora_ms - p.t_ultimo > atualidade_ms
+			){
+
+				if( p.reportado ){ emit(k, p, ConvoyEvent::Fase::FIM); }
+				it = pares.erase(it);
+				continue;
+			}
+
+			if(
+				!p.reportado && p.t_ultimo - p.t_ini >= duracao_ms
+			){
+
+				emit(k, p, ConvoyEvent::Fase::INICIO);
+				p.reportado = true;
+			}
+			++it;
+		}
+
+		n_ticks.fetch_add(1, std::memory_order_relaxed);
+		n_ativos.store(pontos.size(), std::memory_order_relaxed);
+		n_pares_ativos.store(pares.size(), std::memory_order_relaxed);
+		duracao_tick.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(), std::memory_order_relaxed);
+
+		return observados;
+	}
+
+	/**
+	 * @brief Inicializa a thread do detector.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		std::cout << "\033[1;32mIniciando Thread do Detector de Comboios...\033[0m" << std::endl;
+		worker = std::thread(
+							 [this]{ loop(); }
+							);
+	}
+
+	/**
+	 * @brief Finaliza a thread do detector de forma segura.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		std::cout << "\033[1;32mSaindo da thread do detector de comboios.\033[0m" << std::endl;
+		if( worker.joinable() ){ worker.join(); }
+	}
+
+	/**
+	 * @brief Obtém os contadores do detector.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.ticks          = n_ticks.load(std::memory_order_relaxed);
+		s.eventos        = n_eventos.load(std::memory_order_relaxed);
+		s.pares_ativos   = n_pares_ativos.load(std::memory_order_relaxed);
+		s.ativos         = n_ativos.load(std::memory_order_relaxed);
+		s.ultimo_tick_ms = duracao_tick.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // CONVOYDETECTOR_HPP
@@ -0,0 +1,326 @@
+/**
+ * @file CsvDecoder.hpp
+ * @brief Decodificação vetorial de lotes de linhas CSV de GPSTrack em colunas.
+ * @details
+ * CollectorFix::parse_csv interpreta cada campo com strtod, que aceita formatos genéricos
+ * (espaços, expoentes, hexadecimais) e domina o custo da recepção. As linhas de GPSTrack
+ * seguem sempre o esquema `hhmmss.ss,lat,lon,alt[,A]`: este decodificador localiza os
+ * separadores com máscaras de bits e converte os números diretamente para ponto fixo.
+ */
+#ifndef CSVDECODER_HPP
+#define CSVDECODER_HPP
+
+//-------------------------------------------------
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "CollectorFix.hpp"
+
+/**
+ * @struct FixColumns
+ * @brief Fixes de um lote em colunas (SoA), na ordem das linhas válidas.
+ * @details
+ *
+ * O rastreador não faz parte da linha; fix() o recebe à parte, a partir da linha de origem.
+ */
+struct FixColumns {
+	std::vector<uint32_t>  linha; ///< Índice da linha de origem no lote.
+	std::vector<int64_t>    t_ms;
+	std::vector<int32_t>  lat_e6;
+	std::vector<int32_t>  lon_e6;
+	std::vector<int32_t>  alt_dm;
+	std::vector<uint32_t>  flags;
+
+	std::size_t size() const { return linha.size(); }
+
+	void
+	resize(
+		std::size_t n
+	){
+
+		linha.resize(n);
+		t_ms.resize(n);
+		lat_e6.resize(n);
+		lon_e6.resize(n);
+		alt_dm.resize(n);
+		flags.resize(n);
+	}
+
+	/**
+	 * @brief Monta o CollectorFix da k-ésima linha válida.
+	 */
+	CollectorFix
+	fix(
+		std::size_t k,
+		uint64_t tracker
+	) const {
+
+		CollectorFix f;
+		f.tracker = tracker;
+		f.t_ms    = t_ms[k];
+		f.lat_e6  = lat_e6[k];
+		f.lon_e6  = lon_e6[k];
+		f.alt_dm  = alt_dm[k];
+		f.flags   = flags[k];
+		return f;
+	}
+};
+
+/**
+ * @class CsvDecoder
+ * @brief Decodifica lotes de linhas de GPSTrack, com o mesmo resultado de CollectorFix::parse_csv.
+ * @details
+ *
+ * Cada linha é copiada para 64 bytes e comparada, em 4 vetores de 16 bytes (extensões
+ * vetoriais do GCC: SSE2 ou NEON), com as classes de caracteres do esquema: dígitos, ',', '.'
+ * e '-'. Cada comparação vira uma máscara de 64 bits, uma por byte, e os campos são
+ * delimitados e validados com operações de bits (ctz, x & (x - 1)), sem percorrer a linha
+ * caractere a caractere. Os dígitos de cada parte (inteira e fracionária) são convertidos
+ * 8 de cada vez, em SWAR, e combinados em ponto fixo: milissegundos, micrograus e decímetros.
+ *
+ * Linhas fora do caso comum (mais de 56 bytes, espaços, '+', expoentes, mais casas do que o
+ * ponto fixo comporta ou campos após a altitude que não sejam `,A`) são entregues a
+ * parse_csv, de modo que o resultado é sempre idêntico ao dela.
+ */
+class CsvDecoder {
+public:
+
+	/// Tamanho máximo de uma linha decodificada sem parse_csv.
+	static constexpr std::size_t TAM_MAX = 56;
+
+private:
+
+	/// Vetor de 16 bytes: um registrador SSE2 ou NEON.
+	typedef uint8_t v16u __attribute__((vector_size(16)));
+
+	/**
+	 * @brief Máscaras de bits, uma por classe, dos 64 bytes de uma linha.
+	 */
+	struct Mascaras {
+		uint64_t digito  = 0;
+		uint64_t virgula = 0;
+		uint64_t ponto   = 0;
+		uint64_t menos   = 0;
+	};
+
+	/**
+	 * @brief Converte o resultado de uma comparação (bytes 0x00 ou 0xFF) em 16 bits.
+	 * @details
+	 *
+	 * Em x86, uma única instrução (pmovmskb); nas demais arquiteturas, como o alvo ARM, em SWAR.
+	 */
+	static uint64_t
+	movemask(
+		v16u comparacao
+	){
+
+#if defined(__SSE2__)
+		typedef char v16c __attribute__((vector_size(16)));
+		return static_cast<uint16_t>(__builtin_ia32_pmovmskb128(reinterpret_cast<v16c>(comparacao)));
+#else
+		uint64_t palavras[2];
+		std::memcpy(palavras, &comparacao, sizeof(palavras));
+
+		// Com um bit por byte, a multiplicação reúne o bit do byte i no bit 56 + i
+		const uint64_t UNS = 0x0101010101010101ULL, REUNIR = 0x0102040810204080ULL;
+		return (((palavras[0] & UNS) * REUNIR) >> 56) | ((((palavras[1] & UNS) * REUNIR) >> 56) << 8);
+#endif
+	}
+
+	static Mascaras
+	classify(
+		const char* texto
+	){
+
+		Mascaras m;
+		for(
+			int j = 0; j < 4; j++
+		){
+
+			v16u v;
+			std::memcpy(&v, texto + 16 * j, sizeof(v));
+
+			unsigned deslocamento = 16 * j;
+			m.digito  |= movemask(reinterpret_cast<v16u>((v - '0') < 10)) << deslocamento;
+			m.virgula |= movemask(reinterpret_cast<v16u>(v == ','))       << deslocamento;
+			m.ponto   |= movemask(reinterpret_cast<v16u>(v == '.'))       << deslocamento;
+			m.menos   |= movemask(reinterpret_cast<v16u>(v == '-'))       << deslocamento;
+		}
+		return m;
+	}
+
+	/**
+	 * @brief Converte até 8 dígitos ASCII em SWAR.
+	 * @param p Primeiro dígito; 8 bytes a partir dele devem ser legíveis.
+	 * @param n Quantidade de dígitos, de 0 a 8.
+	 */
+	static uint64_t
+	parse8(
+		const char* p,
+		unsigned n
+	){
+
+		if( n == 0 ){ return 0; }
+
+		// Os dígitos vão para os bytes mais altos; os bytes abaixo valem zero
+		uint64_t x;
+		std::memcpy(&x, p, sizeof(x));
+		x <<= 8 * (8 - n);
+
+		x = ((x & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;              // Pares de dígitos
+		x = ((x & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;          // Quádruplas
+		return ((x & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+	}
+
+	/**
+	 * @brief Converte o campo [ini, fim) para ponto fixo com `casas` decimais.
+	 * @return False caso o campo exija parse_csv.
+	 */
+	static bool
+	number(
+		const char* texto,
+		const Mascaras& m,
+		unsigned ini,
+		unsigned fim,
+		unsigned casas,
+		int64_t& valor
+	){
+
+		static const int64_t POTENCIAS[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+		uint64_t campo  = ((fim < 64 ? (1ULL << fim) : 0) - 1) & ~((1ULL << ini) - 1);
+		bool     nega   = (m.menos >> ini) & 1;
+		uint64_t pontos = m.ponto & campo;
+		if( (m.menos & campo) & ~(1ULL << ini) ){ return false; }
+		if( pontos & (pontos - 1) ){ return false; }
+
+		unsigned inicio  = ini + nega;
+		unsigned ponto   = pontos ? static_cast<unsigned>(__builtin_ctzll(pontos)) : fim;
+		unsigned n_int   = ponto - inicio;
+		unsigned n_frac  = pontos ? fim - ponto - 1 : 0;
+		if( n_int > 8 || n_frac > casas || n_int + n_frac == 0 ){ return false; }
+
+		valor = static_cast<int64_t>(parse8(texto + inicio, n_int)) * POTENCIAS[casas] +
+				static_cast<int64_t>(parse8(texto + ponto + 1, n_frac)) * POTENCIAS[casas - n_frac];
+		if( nega ){ valor = -valor; }
+		return true;
+	}
+
+	/**
+	 * @brief Decodifica uma linha do caso comum.
+	 * @param texto Linha copiada para 64 bytes, seguidos de mais 8 legíveis.
+	 * @return 1 se válida, 0 se inválida, -1 se exige parse_csv.
+	 */
+	static int
+	decode_line(
+		const char* texto,
+		unsigned tamanho,
+		int64_t recv_ms,
+		CollectorFix& fix
+	){
+
+		Mascaras m     = classify(texto);
+		uint64_t linha = (1ULL << tamanho) - 1;
+
+		// Campos: três vírgulas e o fim da altitude (fim da linha ou a quarta vírgula)
+		uint64_t virgulas = m.virgula & linha;
+		unsigned v[3];
+		for(
+			int j = 0; j < 3; j++
+		){
+
+			if( virgulas == 0 ){ return -1; }
+			v[j]      = __builtin_ctzll(virgulas);
+			virgulas &= virgulas - 1;
+		}
+		unsigned v1 = v[0], v2 = v[1], v3 = v[2];
+		unsigned v4 = virgulas ? static_cast<unsigned>(__builtin_ctzll(virgulas)) : tamanho;
+
+		// Depois da altitude, só o alerta `,A`; parse_csv decide sobre o restante
+		if( v4 < tamanho && (v4 + 1 >= tamanho || texto[v4 + 1] != 'A') ){ return -1; }
+		if( v4 < tamanho ){ fix.flags |= CollectorFix::FLAG_ALERTA; }
+
+		uint64_t campos = (v4 < 64 ? (1ULL << v4) - 1 : ~0ULL);
+		if( campos & ~(m.digito | m.virgula | m.ponto | m.menos) ){ return -1; }
+
+		int64_t hora, lat, lon, alt;
+		if(
+			(m.menos & 1) ||
+			!number(texto, m, 0, v1, 3, hora) ||
+			!number(texto, m, v1 + 1, v2, 6, lat) ||
+			!number(texto, m, v2 + 1, v3, 6, lon) ||
+			!number(texto, m, v3 + 1, v4, 1, alt)
+		){ return -1; }
+
+		if( lat < -90000000 || lat > 90000000 || lon < -180000000 || lon > 180000000 ){ return 0; }
+
+		// hhmmss em segundos: 3600h + 60m + s, como em parse_csv, e os milissegundos
+		int64_t hhmmss = hora / 1000;
+		int64_t utc_ms = (hhmmss - 40 * (hhmmss / 100) - 2400 * (hhmmss / 10000)) * 1000 + hora % 1000;
+
+		fix.t_ms   = CollectorFix::absolute_day_ms(utc_ms, recv_ms);
+		fix.lat_e6 = static_cast<int32_t>(lat);
+		fix.lon_e6 = static_cast<int32_t>(lon);
+		fix.alt_dm = static_cast<int32_t>(alt);
+		return 1;
+	}
+
+public:
+
+	/**
+	 * @brief Decodifica um lote de linhas em colunas.
+	 * @param linhas Linhas `hhmmss.ss,lat,lon,alt[,A]`, sem '\\n'.
+	 * @param n Quantidade de linhas.
+	 * @param recv_ms Instante de recepção, para compor a data.
+	 * @param[out] saida Colunas com as linhas válidas; linha[k] indica a origem.
+	 * @return Quantidade de linhas válidas.
+	 * @details
+	 *
+	 * As colunas são redimensionadas uma vez por lote; com capacidade suficiente, não há
+	 * alocações.
+	 */
+	static std::size_t
+	decode(
+		const std::string_view* linhas,
+		std::size_t n,
+		int64_t recv_ms,
+		FixColumns& saida
+	){
+
+		alignas(16) char texto[64 + 8] = {};
+
+		saida.resize(n);
+		std::size_t k = 0;
+		for(
+			std::size_t i = 0; i < n; i++
+		){
+
+			std::string_view linha = linhas[i];
+			CollectorFix     fix;
+			int              r     = -1;
+			if(
+				!linha.empty() && linha.size() <= TAM_MAX
+			){
+
+				std::memcpy(texto, linha.data(), linha.size());
+				r = decode_line(texto, static_cast<unsigned>(linha.size()), recv_ms, fix);
+			}
+			if( r < 0 ){ fix = CollectorFix(); r = CollectorFix::parse_csv(linha, recv_ms, fix) ? 1 : 0; }
+			if( r == 0 ){ continue; }
+
+			saida.linha[k]  = static_cast<uint32_t>(i);
+			saida.t_ms[k]   = fix.t_ms;
+			saida.lat_e6[k] = fix.lat_e6;
+			saida.lon_e6[k] = fix.lon_e6;
+			saida.alt_dm[k] = fix.alt_dm;
+			saida.flags[k]  = fix.flags;
+			k++;
+		}
+		saida.resize(k);
+		return k;
+	}
+};
+
+#endif // CSVDECODER_HPP
@@ -0,0 +1,571 @@
+/**
+ * @file FenceIndex.hpp
+ * @brief Índice de cercas geográficas por coberturas hierárquicas de células.
+ * @details
+ * No servidor, cada fix precisa ser avaliado contra as cercas de todos os clientes, que
+ * podem somar milhões. Testar ponto-em-polígono contra todas, ou mesmo contra todas as
+ * caixas envolventes próximas, não acompanha a taxa de ingestão; o índice resolve a maior
+ * parte dos fixes apenas com consultas a tabelas hash.
+ */
+#ifndef FENCEINDEX_HPP
+#define FENCEINDEX_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GPSFix.hpp"
+
+/**
+ * @struct Fence
+ * @brief Cerca circular ou poligonal, em graus decimais.
+ */
+struct Fence {
+	uint32_t                               id = 0;
+	double                                lat = 0; ///< Centro, para cercas circulares.
+	double                                lon = 0;
+	double                             raio_m = 0;
+	std::vector<std::pair<double, double>> vertices; ///< (lat, lon); vazio em cercas circulares.
+
+	static Fence
+	circle(
+		uint32_t id,
+		double lat,
+		double lon,
+		double raio_m
+	){
+
+		Fence f;
+		f.id = id; f.lat = lat; f.lon = lon; f.raio_m = raio_m;
+		return f;
+	}
+
+	static Fence
+	polygon(
+		uint32_t id,
+		std::vector<std::pair<double, double>> vertices
+	){
+
+		Fence f;
+		f.id       = id;
+		f.vertices = std::move(vertices);
+		return f;
+	}
+
+	/**
+	 * @brief Lê cercas de um arquivo.
+	 * @param caminho Arquivo com uma cerca por linha, sendo '#' comentário:
+	 *
+	 * ```
+	 * circulo  1 -22.9559 -43.1659 300
+	 * poligono 2 -22.90 -43.20 -22.90 -43.10 -22.95 -43.15
+	 * ```
+	 *
+	 * @details
+	 *
+	 * Lança std::runtime_error indicando a linha problemática, como GPSConfig::load().
+	 */
+	static std::vector<Fence>
+	load(
+		const std::string& caminho
+	){
+
+		std::ifstream arquivo(caminho);
+		if( !arquivo ){ throw std::runtime_error("\033[1;31mErro ao abrir cercas: " + caminho + "\033[0m"); }
+
+		auto erro = [&](int n_linha, const std::string& msg){
+
+			throw std::runtime_error("\033[1;31m" + caminho + ":" + std::to_string(n_linha) + ": " + msg + "\033[0m");
+		};
+
+		std::vector<Fence> cercas;
+		std::string linha;
+		int n_linha = 0;
+		while(
+			std::getline(arquivo, linha)
+		){
+
+			n_linha++;
+			std::istringstream valor(linha.substr(0, linha.find('#')));
+
+			std::string tipo;
+			if( !(valor >> tipo) ){ continue; }
+
+			Fence f;
+			if( !(valor >> f.id) ){ erro(n_linha, "cerca sem id"); }
+			if(
+				tipo == "circulo"
+			){
+
+				if( !(valor >> f.lat >> f.lon >> f.raio_m) || f.raio_m <= 0 ){ erro(n_linha, "circulo deve ser: id lat lon raio_m"); }
+			}
+			else if(
+				tipo == "poligono"
+			){
+
+				double lat, lon;
+				while( valor >> lat >> lon ){ f.vertices.emplace_back(lat, lon); }
+				if( f.vertices.size() < 3 ){ erro(n_linha, "poligono deve ter ao menos 3 vertices"); }
+			}
+			else{ erro(n_linha, "tipo desconhecido '" + tipo + "'"); }
+
+			cercas.push_back(std::move(f));
+		}
+		return cercas;
+	}
+};
+
+/**
+ * @class FenceIndex
+ * @brief Conjunto imutável de cercas indexado por uma quadtree de células em micrograus.
+ * @details
+ *
+ * O plano (lon, lat) em micrograus é dividido em células quadradas de lado 2^s, para
+ * s entre `nivel_min` e NIVEL_MAX. Cada cerca é coberta por até `max_celulas` células
+ * disjuntas, partindo das células do nível em que sua caixa envolvente cabe e subdividindo
+ * primeiro as maiores:
+ *
+ * - Interior: célula inteiramente dentro da cerca. Um fix nela pertence à cerca sem teste.
+ * - Fronteira: célula cruzada pelo contorno. Um fix nela exige o teste exato.
+ * - Exterior: descartada.
+ *
+ * A consulta calcula, para cada nível em uso, a célula do fix e a procura em uma tabela
+ * hash de endereçamento aberto; como as células de uma cerca são disjuntas, cada cerca
+ * aparece no máximo uma vez. O índice é imutável e deve ser trocado por inteiro (por
+ * exemplo, com RCUPtr) quando as cercas mudam.
+ */
+class FenceIndex {
+public:
+
+	static constexpr int NIVEL_MAX = 22; ///< Células de 2^22 µgraus, cerca de 4,2 graus.
+
+	/**
+	 * @struct Consulta
+	 * @brief Resultado de uma consulta.
+	 */
+	struct Consulta {
+		uint32_t cercas; ///< Cercas que contêm o ponto.
+		uint32_t testes; ///< Testes exatos realizados (entradas de fronteira).
+	};
+
+	/**
+	 * @struct Stats
+	 * @brief Tamanho do índice.
+	 */
+	struct Stats {
+		std::size_t cercas;
+		std::size_t celulas;    ///< Células distintas.
+		std::size_t entradas;   ///< Pares célula-cerca.
+		std::size_t interiores; ///< Entradas interiores.
+		std::size_t bytes;
+	};
+
+private:
+
+	static constexpr uint32_t INTERIOR = 0x80000000u;
+
+	/// Geometria para o teste exato. n == 0 indica círculo.
+	struct Geometria {
+		uint32_t id;
+		uint32_t inicio; ///< Primeiro vértice em lat/lon.
+		uint32_t n;
+		float    raio_m;
+		int32_t  lat_e6, lon_e6;
+	};
+
+	struct Slot {
+		uint64_t chave = 0; ///< 0 indica vazio.
+		uint32_t inicio = 0;
+		uint32_t n = 0;
+	};
+
+	/// Retângulo de uma célula, em coordenadas deslocadas (x = lon + 180°, y = lat + 90°).
+	struct Celula {
+		int      s;
+		uint32_t cx, cy;
+
+		int64_t x0() const { return int64_t(cx) << s; }
+		int64_t y0() const { return int64_t(cy) << s; }
+		int64_t x1() const { return (int64_t(cx) + 1) << s; }
+		int64_t y1() const { return (int64_t(cy) + 1) << s; }
+	};
+
+	enum Classe { EXTERIOR, FRONTEIRA, DENTRO };
+
+	int                     nivel_min;
+	uint32_t                   niveis = 0; ///< Bit s ligado: há células de lado 2^s.
+	std::vector<Geometria>   geometrias;
+	std::vector<int32_t>     lats, lons; ///< Vértices dos polígonos.
+	std::vector<uint32_t>      entradas; ///< Índice da geometria, com INTERIOR.
+	std::vector<Slot>             slots;
+	uint64_t                    mascara = 0;
+	std::size_t              n_celulas = 0;
+	std::size_t           n_interiores = 0;
+
+	static int64_t x_of(int32_t lon_e6){ return int64_t(lon_e6) + 180000000; }
+	static int64_t y_of(int32_t lat_e6){ return int64_t(lat_e6) + 90000000; }
+
+	static uint64_t
+	key(
+		int s,
+		uint64_t cx,
+		uint64_t cy
+	){ return (uint64_t(s) << 58) | (cx << 29) | cy; }
+
+	static uint64_t
+	hash(
+		uint64_t chave
+	){
+
+		chave ^= chave >> 33;
+		chave *= 0xff51afd7ed558ccdULL;
+		chave ^= chave >> 33;
+		return chave;
+	}
+
+	/**
+	 * @brief Indica se o segmento (xa, ya)-(xb, yb) toca o retângulo da célula.
+	 */
+	static bool
+	crosses(
+		int64_t xa, int64_t ya,
+		int64_t xb, int64_t yb,
+		const Celula& c
+	){
+
+		if( std::max(xa, xb) < c.x0() || std::min(xa, xb) > c.x1() || std::max(ya, yb) < c.y0() || std::min(ya, yb) > c.y1() ){ return false; }
+
+		// A reta do segmento separa os quatro cantos?
+		auto lado = [&](int64_t x, int64_t y){ int64_t v = (xb - xa) * (y - ya) - (yb - ya) * (x - xa); return (v > 0) - (v < 0); };
+		int a = lado(c.x0(), c.y0()), b = lado(c.x1(), c.y0()), d = lado(c.x0(), c.y1()), e = lado(c.x1(), c.y1());
+		return !((a > 0 && b > 0 && d > 0 && e > 0) || (a < 0 && b < 0 && d < 0 && e < 0));
+	}
+
+	/**
+	 * @brief Ponto-em-polígono por contagem de cruzamentos, em coordenadas deslocadas.
+	 */
+	bool
+	inside_polygon(
+		const Geometria& g,
+		int64_t x,
+		int64_t y
+	) const {
+
+		bool dentro = false;
+		for(
+			uint32_t i = 0, j = g.n - 1; i < g.n; j = i++
+		){
+
+			int64_t yi = y_of(lats[g.inicio + i]), yj = y_of(lats[g.inicio + j]);
+			if( (yi > y) == (yj > y) ){ continue; }
+
+			int64_t xi = x_of(lons[g.inicio + i]), xj = x_of(lons[g.inicio + j]);
+			// x < xi + (y - yi) * (xj - xi) / (yj - yi), sem divisão
+			__int128 esq = __int128(x - xi) * (yj - yi);
+			__int128 dir = __int128(y - yi) * (xj - xi);
+			if( (yj > yi) ? (esq < dir) : (esq > dir) ){ dentro = !dentro; }
+		}
+		return dentro;
+	}
+
+	bool
+	contains(
+		const Geometria& g,
+		int32_t lat_e6,
+		int32_t lon_e6
+	) const {
+
+		if( g.n == 0 ){ return GPSFix::distance_m(g.lat_e6 * 1e-6, g.lon_e6 * 1e-6, lat_e6 * 1e-6, lon_e6 * 1e-6) <= g.raio_m; }
+		return inside_polygon(g, x_of(lon_e6), y_of(lat_e6));
+	}
+
+	/**
+	 * @brief Distância plana, em metros, entre o centro do círculo e um ponto deslocado.
+	 */
+	static double
+	planar_m(
+		const Geometria& g,
+		int64_t x,
+		int64_t y
+	){
+
+		double lat = (y - 90000000) * 1e-6;
+		double dy  = (y - y_of(g.lat_e6)) * 0.11132;
+		double dx  = (x - x_of(g.lon_e6)) * 0.11132 * std::cos(lat * M_PI / 180.0);
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	Classe
+	classify_circle(
+		const Geometria& g,
+		const Celula& c
+	) const {
+
+		int64_t gx = x_of(g.lon_e6), gy = y_of(g.lat_e6);
+		int64_t px = std::clamp(gx, c.x0(), c.x1()), py = std::clamp(gy, c.y0(), c.y1());
+		double  perto = planar_m(g, px, py);
+		double  longe = 0;
+		for( int64_t x : { c.x0(), c.x1() } ){ for( int64_t y : { c.y0(), c.y1() } ){ longe = std::max(longe, planar_m(g, x, y)); } }
+
+		// Margem para a diferença entre a aproximação plana e o teste exato
+		if( perto > g.raio_m * 1.01 + 1 ){ return EXTERIOR; }
+		if( longe < g.raio_m * 0.99 - 1 ){ return DENTRO; }
+		return FRONTEIRA;
+	}
+
+	/**
+	 * @brief Classifica a célula e filtra as arestas que a cruzam.
+	 * @param arestas Arestas que cruzam a célula-mãe; ao retornar, as que cruzam esta.
+	 */
+	Classe
+	classify_polygon(
+		const Geometria& g,
+		const Celula& c,
+		const std::vector<uint32_t>& da_mae,
+		std::vector<uint32_t>& arestas
+	) const {
+
+		arestas.clear();
+		for(
+			uint32_t i : da_mae
+		){
+
+			uint32_t j = (i + 1 == g.n) ? 0 : i + 1;
+			if( crosses(x_of(lons[g.inicio + i]), y_of(lats[g.inicio + i]), x_of(lons[g.inicio + j]), y_of(lats[g.inicio + j]), c) ){ arestas.push_back(i); }
+		}
+		if( !arestas.empty() ){ return FRONTEIRA; }
+		return inside_polygon(g, (c.x0() + c.x1()) / 2, (c.y0() + c.y1()) / 2) ? DENTRO : EXTERIOR;
+	}
+
+	/**
+	 * @brief Cobre uma cerca com células, acrescentando pares (chave, entrada).
+	 */
+	void
+	cover(
+		uint32_t indice,
+		std::size_t max_celulas,
+		std::vector<std::pair<uint64_t, uint32_t>>& saida
+	){
+
+		const Geometria& g = geometrias[indice];
+
+		// Caixa envolvente em coordenadas deslocadas
+		int64_t xmin, xmax, ymin, ymax;
+		if(
+			g.n == 0
+		){
+
+			double dlat = g.raio_m / 111320.0;
+			double lat  = std::min(89.0, std::fabs(g.lat_e6 * 1e-6) + dlat);
+			double dlon = g.raio_m / (111320.0 * std::max(0.01, std::cos(lat * M_PI / 180.0)));
+			xmin = x_of(g.lon_e6) - static_cast<int64_t>(dlon * 1e6) - 1; xmax = x_of(g.lon_e6) + static_cast<int64_t>(dlon * 1e6) + 1;
+			ymin = y_of(g.lat_e6) - static_cast<int64_t>(dlat * 1e6) - 1; ymax = y_of(g.lat_e6) + static_cast<int64_t>(dlat * 1e6) + 1;
+		}
+		else{
+
+			xmin = ymin = INT64_MAX; xmax = ymax = INT64_MIN;
+			for(
+				uint32_t i = 0; i < g.n; i++
+			){
+
+				xmin = std::min(xmin, x_of(lons[g.inicio + i])); xmax = std::max(xmax, x_of(lons[g.inicio + i]));
+				ymin = std::min(ymin, y_of(lats[g.inicio + i])); ymax = std::max(ymax, y_of(lats[g.inicio + i]));
+			}
+		}
+		xmin = std::max<int64_t>(0, xmin); ymin = std::max<int64_t>(0, ymin);
+
+		// Nível em que a caixa ocupa até 2x2 células
+		int s = nivel_min;
+		while( s < NIVEL_MAX && (int64_t(1) << s) < std::max(xmax - xmin, ymax - ymin) ){ s++; }
+
+		struct Pendente { Celula c; std::vector<uint32_t> arestas; };
+		std::deque<Pendente> fila;
+		std::vector<uint32_t> todas(g.n);
+		for( uint32_t i = 0; i < g.n; i++ ){ todas[i] = i; }
+
+		std::size_t total = 0;
+		auto visitar = [&](const Celula& c, const std::vector<uint32_t>& da_mae){
+
+			std::vector<uint32_t> arestas;
+			Classe k = (g.n == 0) ? classify_circle(g, c) : classify_polygon(g, c, da_mae, arestas);
+			if( k == EXTERIOR ){ return; }
+			total++;
+			if( k == DENTRO ){ saida.emplace_back(key(c.s, c.cx, c.cy), indice | INTERIOR); }
+			else{ fila.push_back({ c, std::move(arestas) }); }
+		};
+
+		for( int64_t cy = ymin >> s; cy <= (ymax >> s); cy++ ){ for( int64_t cx = xmin >> s; cx <= (xmax >> s); cx++ ){ visitar({ s, uint32_t(cx), uint32_t(cy) }, todas); } }
+
+		// Subdivide as células de fronteira, das maiores para as menores, enquanto houver orçamento
+		while(
+			!fila.empty()
+		){
+
+			Pendente p = std::move(fila.front());
+			fila.pop_front();
+
+			if(
+				p.c.s <= nivel_min || total + 3 > max_celulas
+			){
+
+				saida.emplace_back(key(p.c.s, p.c.cx, p.c.cy), indice);
+				continue;
+			}
+
+			total--;
+			for( uint32_t f = 0; f < 4; f++ ){ visitar({ p.c.s - 1, p.c.cx * 2 + (f & 1), p.c.cy * 2 + (f >> 1) }, p.arestas); }
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Constrói o índice.
+	 * @param cercas Cercas a indexar.
+	 * @param max_celulas Orçamento de células por cerca.
+	 * @param nivel_min_ Menor nível de subdivisão; 2^8 µgraus são cerca de 28 m.
+	 */
+	explicit FenceIndex(
+		const std::vector<Fence>& cercas,
+		std::size_t max_celulas = 32,
+		int nivel_min_ = 8
+	) : nivel_min(nivel_min_) {
+
+		geometrias.reserve(cercas.size());
+		for(
+			const Fence& f : cercas
+		){
+
+			Geometria g{};
+			g.id     = f.id;
+			g.inicio = static_cast<uint32_t>(lats.size());
+			g.n      = static_cast<uint32_t>(f.vertices.size());
+			g.raio_m = static_cast<float>(f.raio_m);
+			g.lat_e6 = static_cast<int32_t>(std::lround(f.lat * 1e6));
+			g.lon_e6 = static_cast<int32_t>(std::lround(f.lon * 1e6));
+			for(
+				const auto& v : f.vertices
+			){
+
+				lats.push_back(static_cast<int32_t>(std::lround(v.first * 1e6)));
+				lons.push_back(static_cast<int32_t>(std::lround(v.second * 1e6)));
+			}
+			geometrias.push_back(g);
+		}
+
+		std::vector<std::pair<uint64_t, uint32_t>> pares;
+		pares.reserve(cercas.size() * 8);
+		for( uint32_t i = 0; i < geometrias.size(); i++ ){ cover(i, max_celulas, pares); }
+		std::sort(pares.begin(), pares.end());
+
+		// Tabela hash de células, com as entradas de cada célula contíguas
+		std::size_t distintas = 0;
+		for( std::size_t i = 0; i < pares.size(); i++ ){ if( i == 0 || pares[i].first != pares[i - 1].first ){ distintas++; } }
+
+		std::size_t capacidade = 16;
+		while( capacidade < distintas + distintas / 2 ){ capacidade <<= 1; }
+		slots.assign(capacidade, Slot());
+		mascara = capacidade - 1;
+		entradas.reserve(pares.size());
+
+		for(
+			std::size_t i = 0; i < pares.size();
+		){
+
+			std::size_t j = i;
+			while( j < pares.size() && pares[j].first == pares[i].first ){ entradas.push_back(pares[j].second); n_interiores += (pares[j].second & INTERIOR) != 0; j++; }
+
+			uint64_t h = hash(pares[i].first) & mascara;
+			while( slots[h].chave != 0 ){ h = (h + 1) & mascara; }
+			slots[h] = { pares[i].first, static_cast<uint32_t>(i), static_cast<uint32_t>(j - i) };
+			niveis |= uint32_t(1) << (pares[i].first >> 58);
+			n_celulas++;
+			i = j;
+		}
+	}
+
+	/**
+	 * @brief Visita as cercas que contêm um ponto.
+	 * @param lat_e6 Latitude em micrograus.
+	 * @param lon_e6 Longitude em micrograus.
+	 * @param visitar Função `void(uint32_t id)`.
+	 * @return Quantidade de cercas e de testes exatos.
+	 * @details
+	 *
+	 * Livre de locks e de alocações; pode ser chamado por várias threads.
+	 */
+	template <typename F>
+	Consulta
+	query(
+		int32_t lat_e6,
+		int32_t lon_e6,
+		F&& visitar
+	) const {
+
+		Consulta r{ 0, 0 };
+		uint64_t x = static_cast<uint64_t>(x_of(lon_e6)), y = static_cast<uint64_t>(y_of(lat_e6));
+
+		for(
+			uint32_t m = niveis; m; m &= m - 1
+		){
+
+			int      s     = __builtin_ctz(m);
+			uint64_t chave = key(s, x >> s, y >> s);
+			for(
+				uint64_t h = hash(chave) & mascara; slots[h].chave != 0; h = (h + 1) & mascara
+			){
+
+				if( slots[h].chave != chave ){ continue; }
+
+				for(
+					uint32_t k = slots[h].inicio; k < slots[h].inicio + slots[h].n; k++
+				){
+
+					const Geometria& g = geometrias[entradas[k] & ~INTERIOR];
+					if( !(entradas[k] & INTERIOR) ){ r.testes++; if( !contains(g, lat_e6, lon_e6) ){ continue; } }
+					r.cercas++;
+					visitar(g.id);
+				}
+				break;
+			}
+		}
+		return r;
+	}
+
+	/**
+	 * @brief Mesma consulta sem o índice, testando todas as cercas. Para verificação.
+	 */
+	template <typename F>
+	void
+	query_all(
+		int32_t lat_e6,
+		int32_t lon_e6,
+		F&& visitar
+	) const { for( const Geometria& g : geometrias ){ if( contains(g, lat_e6, lon_e6) ){ visitar(g.id); } } }
+
+	/**
+	 * @brief Obtém o tamanho do índice.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.cercas     = geometrias.size();
+		s.celulas    = n_celulas;
+		s.entradas   = entradas.size();
+		s.interiores = n_interiores;
+		s.bytes      = geometrias.capacity() * sizeof(Geometria) + (lats.capacity() + lons.capacity()) * 4
+					 + entradas.capacity() * 4 + slots.capacity() * sizeof(Slot);
+		return s;
+	}
+};
+
+#endif // FENCEINDEX_HPP
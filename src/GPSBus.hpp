@@ -0,0 +1,365 @@
+/**
+ * @file GPSBus.hpp
+ * @brief Distribuição de fixes para consumidores dentro do mesmo processo.
+ * @details
+ * Aplicações que embarcam GPSTrack podem reagir a cada nova posição sem precisar
+ * interpretar os datagramas UDP emitidos pelo próprio processo.
+ */
+#ifndef GPSBUS_HPP
+#define GPSBUS_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "GPSFix.hpp"
+#include "MpscRing.hpp"
+#include "RCU.hpp"
+#include "SeqLock.hpp"
+
+/**
+ * @class GPSBus
+ * @brief Registro de assinantes, fila de entrega e slot do último fix.
+ * @details
+ *
+ * Há duas formas de consumo:
+ *
+ * - Callbacks registrados por subscribe(), chamados pela thread de entrega a cada fix.
+ * - Consulta ativa por latest(), que lê um slot protegido por seqlock.
+ *
+ * publish() grava o slot e insere o fix em uma MpscRing limitada; uma thread de entrega,
+ * iniciada por init(), a esvazia e chama os callbacks. Assim, um callback lento atrasa
+ * apenas os demais assinantes, nunca a leitura da serial: com a fila cheia, o fix é
+ * descartado para os callbacks (dropped()), mas latest() o reflete. publish() só adquire
+ * um lock para acordar a thread de entrega quando ela está parada à espera de fixes.
+ *
+ * A lista de assinantes é imutável e publicada via RCUPtr. Como RCUPtr::update() aguarda o
+ * término da leitura em curso, subscribe() e unsubscribe() chamados de dentro de um callback
+ * não alteram a lista diretamente: a alteração é adiada até o fim da entrega do fix
+ * corrente. Um assinante removido assim não recebe mais callbacks; um novo passa a
+ * recebê-los a partir do fix seguinte.
+ *
+ * Os métodos init() e stop() seguem o mesmo padrão de GPSTrack.
+ */
+class GPSBus {
+public:
+
+	using Callback = std::function<void(const GPSFix&)>;
+
+private:
+
+	struct Assinante {
+		int          id;
+		Callback     cb;
+	};
+
+	struct Alteracao {
+		int          id;
+		Callback     cb; ///< Vazio para remoção.
+	};
+
+	mutable RCUPtr<std::vector<Assinante>> assinantes; ///< Ler apenas conta leitores.
+	SeqLock<GPSFix>                    ultimo;
+	std::atomic<int>             prox_id{1};
+
+	MpscRing<GPSFix>                     fila;
+	std::thread                        worker;
+	std::atomic<bool>          is_exec{false};
+	std::mutex                    mtx_espera;
+	std::condition_variable           espera;
+	std::atomic<bool>       aguardando{false}; ///< A thread de entrega está parada em `espera`.
+	std::atomic<uint64_t>     n_descartados{0};
+
+	std::mutex                 mtx_adiadas;
+	std::vector<Alteracao>         adiadas; ///< Feitas de dentro de callbacks.
+	std::atomic<bool>     ha_adiadas{false};
+
+	static inline thread_local const GPSBus* entregando = nullptr; ///< Barramento cujos callbacks executam nesta thread.
+
+	/**
+	 * @brief Indica se há remoção adiada do assinante.
+	 */
+	bool
+	removal_pending(
+		int id
+	){
+
+		std::lock_guard<std::mutex> lock(mtx_adiadas);
+		bool removido = false;
+		for( const Alteracao& a : adiadas ){ if( a.id == id ){ removido = !a.cb; } }
+		return removido;
+	}
+
+	/**
+	 * @brief Aplica as alterações adiadas durante a entrega de um fix.
+	 */
+	void
+	apply_deferred(){
+
+		std::vector<Alteracao> lote;
+		{
+			std::lock_guard<std::mutex> lock(mtx_adiadas);
+			lote.swap(adiadas);
+			ha_adiadas.store(false);
+		}
+
+		assinantes.update(
+						  [&](std::vector<Assinante>& lista){
+
+							for(
+								Alteracao& a : lote
+							){
+
+								if( a.cb ){ lista.push_back({a.id, std::move(a.cb)}); continue; }
+								for( auto it = lista.begin(); it != lista.end(); ++it ){ if( it->id == a.id ){ lista.erase(it); break; } }
+							}
+						  }
+						 );
+	}
+
+	/**
+	 * @brief Entrega um fix a todos os assinantes, na thread de entrega.
+	 * @details
+	 *
+	 * Exceções lançadas por callbacks são reportadas e descartadas, para que um
+	 * consumidor defeituoso não interrompa a entrega aos demais.
+	 */
+	void
+	deliver(
+		const GPSFix& fix
+	){
+
+		{
+			auto lista = assinantes.read();
+			if( !lista ){ return; }
+
+			for(
+				const auto& assinante : *lista
+			){
+
+				if( ha_adiadas.load() && removal_pending(assinante.id) ){ continue; }
+
+				try { assinante.cb(fix); }
+				catch (std::exception& e) {
+
+					std::cout << "\033[1;31mErro em assinante " << assinante.id << ": \033[0m"
+							  << e.what()
+							  << std::endl;
+				}
+			}
+		}
+
+		// Fora da leitura, que update() aguardaria
+		if( ha_adiadas.load() ){ apply_deferred(); }
+	}
+
+	/**
+	 * @brief Loop da thread de entrega. Ao encerrar, esvazia a fila.
+	 */
+	void
+	loop(){
+
+		entregando = this;
+
+		GPSFix fix;
+		while(
+			true
+		){
+
+			if( fila.pop(fix) ){ deliver(fix); continue; }
+			if( !is_exec ){ return; }
+
+			std::unique_lock<std::mutex> lock(mtx_espera);
+			aguardando.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			bool vazia = !fila.pop(fix);
+			if( vazia && is_exec ){ espera.wait_for(lock, std::chrono::milliseconds(100)); }
+			aguardando.store(false, std::memory_order_relaxed);
+			lock.unlock();
+
+			if( !vazia ){ deliver(fix); }
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade Fixes aguardando entrega, no máximo.
+	 */
+	explicit GPSBus(
+		std::size_t capacidade = 256
+	) : fila(capacidade) {}
+
+	~GPSBus(){ stop(); }
+
+	GPSBus(const GPSBus&)            = delete;
+	GPSBus& operator=(const GPSBus&) = delete;
+
+	/**
+	 * @brief Inicializa a thread de entrega.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		worker = std::thread(
+							 [this]{ loop(); }
+							);
+	}
+
+	/**
+	 * @brief Entrega os fixes ainda na fila e finaliza a thread de entrega.
+	 * @details
+	 *
+	 * Não pode ser chamado de dentro de um callback, que executa na própria thread.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		{
+			std::lock_guard<std::mutex> lock(mtx_espera);
+			espera.notify_one();
+		}
+		if( worker.joinable() ){ worker.join(); }
+	}
+
+	/**
+	 * @brief Registra um callback a ser chamado a cada novo fix.
+	 * @param cb Função chamada pela thread de entrega.
+	 * @return Identificador para posterior remoção.
+	 * @details
+	 *
+	 * De dentro de um callback, o registro vale a partir do fix seguinte.
+	 */
+	int
+	subscribe(
+		Callback cb
+	){
+
+		int id = prox_id.fetch_add(1);
+		if(
+			entregando == this
+		){
+
+			std::lock_guard<std::mutex> lock(mtx_adiadas);
+			adiadas.push_back({id, std::move(cb)});
+			ha_adiadas.store(true);
+			return id;
+		}
+
+		assinantes.update(
+						  [&](std::vector<Assinante>& lista){ lista.push_back({id, std::move(cb)}); }
+						 );
+		return id;
+	}
+
+	/**
+	 * @brief Remove um assinante.
+	 * @param id Identificador retornado por subscribe().
+	 * @return True caso o assinante existisse. False, caso contrário.
+	 * @details
+	 *
+	 * De dentro de um callback, a remoção é adiada, mas o assinante não é mais chamado.
+	 */
+	bool
+	unsubscribe(
+		int id
+	){
+
+		if(
+			entregando == this
+		){
+
+			bool existe = false;
+			{
+				auto lista = assinantes.read();
+				if( lista ){ for( const Assinante& a : *lista ){ existe |= a.id == id; } }
+			}
+
+			std::lock_guard<std::mutex> lock(mtx_adiadas);
+			for( const Alteracao& a : adiadas ){ if( a.id == id ){ existe = static_cast<bool>(a.cb); } }
+			if( existe ){ adiadas.push_back({id, nullptr}); ha_adiadas.store(true); }
+			return existe;
+		}
+
+		bool removido = false;
+		assinantes.update(
+						  [&](std::vector<Assinante>& lista){
+
+							for(
+								auto it = lista.begin(); it != lista.end(); ++it
+							){
+
+								if( it->id == id ){ lista.erase(it); removido = true; break; }
+							}
+						  }
+						 );
+		return removido;
+	}
+
+	/**
+	 * @brief Publica um novo fix no slot e o enfileira para os assinantes.
+	 * @param fix Fix recém interpretado.
+	 * @details
+	 *
+	 * Nunca espera pelos callbacks. De dentro de um callback, o fix entra na fila como
+	 * qualquer outro e é entregue depois do corrente.
+	 */
+	void
+	publish(
+		const GPSFix& fix
+	){
+
+		ultimo.store(fix);
+
+		if( !fila.push(fix) ){ n_descartados.fetch_add(1, std::memory_order_relaxed); return; }
+
+		// Pareia com a barreira de loop(): ou a espera é vista, ou o fix já está na fila
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(
+			aguardando.load(std::memory_order_relaxed)
+		){
+
+			std::lock_guard<std::mutex> lock(mtx_espera);
+			espera.notify_one();
+		}
+	}
+
+	/**
+	 * @brief Obtém o último fix publicado sem bloquear a thread worker.
+	 * @param[out] fix Último fix.
+	 * @return False caso nenhum fix tenha sido publicado. True, caso contrário.
+	 */
+	bool
+	latest(
+		GPSFix& fix
+	) const { return ultimo.load(fix); }
+
+	/**
+	 * @brief Fixes não entregues aos callbacks por estarem com a fila cheia.
+	 */
+	uint64_t dropped() const { return n_descartados.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Quantidade de assinantes registrados.
+	 */
+	std::size_t
+	subscribers() const {
+
+		auto lista = assinantes.read();
+		return lista ? lista->size() : 0;
+	}
+};
+
+#endif // GPSBUS_HPP
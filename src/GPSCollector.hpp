@@ -0,0 +1,1387 @@
+/**
+ * @file GPSCollector.hpp
+ * @brief Implementação do coletor que recebe os datagramas de uma frota de GPSTrack.
+ * @details
+ * Executa no servidor, não na placa. Recebe as linhas CSV enviadas por send(),
+ * interpreta-as e mantém o estado de cada rastreador.
+ */
+#ifndef GPSCOLLECTOR_HPP
+#define GPSCOLLECTOR_HPP
+
+//-------------------------------------------------
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+#include <chrono>
+#include <cmath>
+
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+#include <stdexcept>
+
+// Específicos de Sistemas Linux
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "AdmissionControl.hpp"
+#include "CollectorFix.hpp"
+#include "CollectorWAL.hpp"
+#include "ConvoyDetector.hpp"
+#include "CsvDecoder.hpp"
+#include "GPSFix.hpp"
+#include "GeofenceEvaluator.hpp"
+#include "HeatmapTiles.hpp"
+#include "HistoryCompactor.hpp"
+#include "HistoryStore.hpp"
+#include "MapMatcher.hpp"
+#include "NumaMemory.hpp"
+#include "ReorderBuffer.hpp"
+#include "RuleEngine.hpp"
+#include "ScanEngine.hpp"
+#include "Snapshot.hpp"
+#include "SpatioTemporalIndex.hpp"
+#include "SubscriptionServer.hpp"
+#include "TrackerState.hpp"
+#include "TrackerTable.hpp"
+#include "TripSegmenter.hpp"
+
+/**
+ * @class GPSCollector
+ * @brief Receptor UDP multithread de datagramas GPSTrack.
+ * @details
+ *
+ * Fluxo de funcionamento:
+ *
+ * - Cada thread de recepção possui seu próprio socket UDP na mesma porta, com SO_REUSEPORT,
+ *   de modo que o kernel distribui os rastreadores entre as threads.
+ * - Datagramas são lidos em lotes com recvmmsg().
+ * - As linhas de um lote são decodificadas em colunas por CsvDecoder, montadas em
+ *   CollectorFix e entregues a ingest_batch().
+ * - Com o controle de admissão habilitado (open_admission()), cada fix passa antes por um
+ *   AdmissionControl; alertas e fixes de spool são confirmados ao rastreador com a linha
+ *   `ACK,hhmmss.ss,aceito,pausa_ms`, enviada depois de o lote ser incorporado.
+ * - Com o WAL habilitado (open_wal()), o lote é gravado no log antes de atualizar a
+ *   TrackerTable; no modo SINCRONA, a thread aguarda o group commit antes de confirmar.
+ * - Com o WAL habilitado, write_snapshot() grava um snapshot consistente do estado em
+ *   memória, e open_wal() o carrega e reaplica apenas o final do log.
+ * - Com a reordenação habilitada (open_reorder()), os fixes de cada rastreador passam por
+ *   um ReorderBuffer antes das etapas seguintes: chegam em ordem, sem duplicatas e com
+ *   atraso limitado.
+ * - Com o histórico habilitado (open_history()), cada fix também é guardado comprimido.
+ * - Com a compactação habilitada (open_compaction()), uma thread de baixa prioridade
+ *   reescreve os blocos do histórico e aplica a retenção e a redução.
+ * - Com a varredura habilitada (open_scan()), os blocos do histórico são reorganizados em
+ *   segmentos colunares para consultas sobre toda a frota (scan()), refeitos após cada
+ *   passada do compactador e respondidos aos clientes das assinaturas com `consulta`.
+ * - Com o índice habilitado (open_index()), cada fix marca o rastreador em sua célula e janela.
+ * - Com a segmentação habilitada (open_trips()), viagens e paradas concluídas são gravadas
+ *   em um arquivo CSV.
+ * - Com a detecção de comboios habilitada (open_convoys()), uma thread cruza periodicamente
+ *   as posições atuais da TrackerTable e grava em CSV os pares que seguem juntos.
+ * - Com as cercas habilitadas (open_geofences()), cada fix é avaliado contra um FenceIndex
+ *   e as entradas e saídas são gravadas em CSV.
+ * - Com as regras de alerta habilitadas (open_rules()), os fixes são acumulados por thread
+ *   e avaliados em lotes por um RuleEngine; o início e o fim de cada alerta são gravados em CSV.
+ * - Com o casamento com o mapa habilitado (open_map_matching()), os fixes são casados com
+ *   as vias de um extrato OSM e gravados em CSV assim que decididos.
+ * - Com o mapa de calor habilitado (open_heatmap()), cada fix é acumulado nos ladrilhos de
+ *   densidade, gravados periodicamente por write().
+ * - Com as assinaturas habilitadas (open_subscriptions()), cada fix recebido é entregue aos
+ *   clientes TCP locais cujos filtros o aceitam.
+ * - Com NUMA habilitado no construtor, cada thread de recepção é presa a um nó, os shards da
+ *   TrackerTable ficam em memória local ao nó e em páginas enormes, e um programa BPF no
+ *   grupo SO_REUSEPORT entrega cada datagrama a uma thread do nó em que está o estado do
+ *   rastreador. Os acessos locais e remotos à tabela são contados em stats().
+ *
+ * Os métodos init() e stop() seguem o mesmo padrão de GPSTrack.
+ */
+class GPSCollector {
+public:
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de recepção.
+	 */
+	struct Stats {
+		uint64_t datagramas;
+		uint64_t fixes;
+		uint64_t invalidos;
+		uint64_t tabela_cheia;
+		std::size_t rastreadores;
+		uint64_t acessos_locais;  ///< Atualizações da tabela pelas threads de recepção no mesmo nó NUMA.
+		uint64_t acessos_remotos; ///< Atualizações em shards de outro nó.
+	};
+
+	/**
+	 * @struct SnapshotInfo
+	 * @brief Resultado de write_snapshot().
+	 */
+	struct SnapshotInfo {
+		uint64_t lsn;      ///< Os fixes anteriores a este LSN estão no snapshot.
+		uint64_t bytes;
+		uint64_t pausa_us; ///< Ingestão suspensa durante a cópia do estado.
+		uint64_t total_us; ///< Incluindo a gravação e o fsync.
+		std::size_t segmentos_removidos;
+	};
+
+private:
+
+	/// Seções opcionais do snapshot, conforme as etapas habilitadas.
+	static constexpr uint32_t SECAO_INDICE      = 1u << 0;
+	static constexpr uint32_t SECAO_HISTORICO   = 1u << 1;
+	static constexpr uint32_t SECAO_REORDENACAO = 1u << 2;
+
+	/**
+	 * @struct TrafegoNuma
+	 * @brief Acessos de uma thread de recepção à TrackerTable, por localidade.
+	 */
+	struct alignas(TAM_LINHA_CACHE) TrafegoNuma {
+		std::atomic<uint64_t>   locais{0};
+		std::atomic<uint64_t>  remotos{0};
+		int                          no = 0; ///< Nó em que a thread executou o último lote.
+	};
+
+	int                           porta;
+	int                       n_threads;
+	bool                           numa;
+
+	std::vector<int>            sockets;
+	std::vector<std::thread>    workers;
+	std::atomic<bool>    is_exec{false};
+
+	TrackerTable<TrackerState>   tabela;
+	std::unique_ptr<CollectorWAL>   wal;
+	std::unique_ptr<AdmissionControl> admissao;
+	std::unique_ptr<ReorderBuffer> reordenador;
+	std::unique_ptr<HistoryStore> historico;
+	std::unique_ptr<HistoryCompactor> compactador;
+	std::unique_ptr<ScanEngine>   varredura;
+	std::size_t        linhas_varredura = 1 << 16;
+	std::unique_ptr<SpatioTemporalIndex> indice;
+	std::unique_ptr<TripSegmenter> segmentador;
+	std::FILE*           arquivo_viagens = nullptr;
+	std::mutex               mtx_viagens;
+	std::unique_ptr<ConvoyDetector> comboios;
+	std::FILE*          arquivo_comboios = nullptr;
+	std::unique_ptr<GeofenceEvaluator> cercas;
+	std::string             caminho_cercas;
+	std::FILE*            arquivo_cercas = nullptr;
+	std::mutex                 mtx_cercas;
+	std::unique_ptr<RuleEngine>    regras;
+	std::string             caminho_regras;
+	std::string       caminho_zonas_regras;
+	std::FILE*           arquivo_alertas = nullptr;
+	std::mutex                mtx_alertas;
+	std::unique_ptr<RoadGraph>       mapa;
+	std::unique_ptr<MapMatcher>   casador;
+	std::FILE*          arquivo_casados = nullptr;
+	std::mutex                mtx_casados;
+	std::unique_ptr<HeatmapTiles>   calor;
+	std::unique_ptr<SubscriptionServer> assinaturas;
+	bool                 reproduzindo = false; ///< Reaplicando o WAL em open_wal().
+	std::string                  dir_wal;
+	std::shared_mutex          mtx_corte; ///< Exclusivo durante a cópia do snapshot.
+
+	std::atomic<uint64_t>     n_datagramas{0};
+	std::atomic<uint64_t>          n_fixes{0};
+	std::atomic<uint64_t>      n_invalidos{0};
+	std::atomic<uint64_t>   n_tabela_cheia{0};
+
+	std::vector<int>              no_shard; ///< Nó da memória de cada shard da tabela.
+	std::unique_ptr<TrafegoNuma[]> trafego; ///< Um por thread de recepção.
+	static inline thread_local TrafegoNuma* trafego_thread = nullptr;
+	static inline thread_local std::vector<CollectorFix> pendentes_regras; ///< Lote do RuleEngine em formação.
+
+	/**
+	 * @brief Instante atual em ms desde a época Unix.
+	 */
+	static int64_t
+	now_ms(){
+
+		using namespace std::chrono;
+		return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief Responde a `consulta t_ini t_fim lat_min lon_min lat_max lon_max` das assinaturas.
+	 * @return `#consulta,<linhas>,<rastreadores>[,id...]`; vazio para argumentos inválidos.
+	 */
+	std::string
+	answer_query(
+		const std::string& argumentos
+	){
+
+		std::istringstream in(argumentos);
+		long long t[2];
+		double    v[4];
+		if( !(in >> t[0] >> t[1] >> v[0] >> v[1] >> v[2] >> v[3]) ){ return ""; }
+		if( t[0] > t[1] || v[0] > v[2] || v[1] > v[3] || v[0] < -90 || v[2] > 90 || v[1] < -180 || v[3] > 180 ){ return ""; }
+
+		ScanQuery q;
+		q.t_ini   = t[0];
+		q.t_fim   = t[1];
+		q.lat_min = static_cast<int32_t>(std::llround(v[0] * 1e6));
+		q.lon_min = static_cast<int32_t>(std::llround(v[1] * 1e6));
+		q.lat_max = static_cast<int32_t>(std::llround(v[2] * 1e6));
+		q.lon_max = static_cast<int32_t>(std::llround(v[3] * 1e6));
+
+		ScanEngine::Resultado r = scan(q);
+		std::string resposta = "#consulta," + std::to_string(r.linhas) + "," + std::to_string(r.rastreadores.size());
+		for( uint64_t id : r.rastreadores ){ resposta += "," + std::to_string(id); }
+		return resposta + "\n";
+	}
+
+	/**
+	 * @brief Atualiza a TrackerTable com um fix, sem passar pelo WAL.
+	 */
+	void
+	apply(
+		const CollectorFix& fix
+	){
+
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+
+		bool ok = tabela.update(
+							   fix.tracker,
+							   [&](TrackerState& estado, bool novo){ estado.apply(fix, novo); }
+							   );
+		if( !ok ){ n_tabela_cheia.fetch_add(1, std::memory_order_relaxed); }
+
+		if(
+			TrafegoNuma* t = trafego_thread
+		){
+
+			// Contador exclusivo da thread: sem instrução atômica de leitura-escrita
+			std::atomic<uint64_t>& c = (no_shard[tabela.shard_of(fix.tracker)] == t->no) ? t->locais : t->remotos;
+			c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		if( historico ){ historico->append(fix); }
+		if( indice ){ indice->add(fix); }
+		if( segmentador ){ segmentador->apply(fix, !reproduzindo); }
+		if( cercas ){ cercas->apply(fix, !reproduzindo); }
+		if( regras ){ pendentes_regras.push_back(fix); if( pendentes_regras.size() >= RuleEngine::LOTE ){ flush_rules(); } }
+		if( casador ){ casador->apply(fix, !reproduzindo); }
+		if( calor ){ calor->apply(fix); }
+		if( assinaturas && !reproduzindo ){ assinaturas->publish(fix); }
+	}
+
+	/**
+	 * @brief Avalia as regras sobre os fixes acumulados pela thread desde o último lote.
+	 */
+	void
+	flush_rules(){
+
+		if( !regras || pendentes_regras.empty() ){ return; }
+		regras->apply(pendentes_regras.data(), pendentes_regras.size(), !reproduzindo);
+		pendentes_regras.clear();
+	}
+
+	/**
+	 * @brief Espera de um datagrama na fila do socket, pelo carimbo SO_TIMESTAMPNS.
+	 * @return Microssegundos; 0 caso o datagrama não traga o carimbo.
+	 */
+	static uint64_t
+	queue_delay_us(
+		msghdr& msg
+	){
+
+		for(
+			cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)
+		){
+
+			if( c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS ){ continue; }
+
+			timespec recebido, agora;
+			std::memcpy(&recebido, CMSG_DATA(c), sizeof(recebido));
+			::clock_gettime(CLOCK_REALTIME, &agora);
+			int64_t us = (agora.tv_sec - recebido.tv_sec) * 1000000LL + (agora.tv_nsec - recebido.tv_nsec) / 1000;
+			return us > 0 ? static_cast<uint64_t>(us) : 0;
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Quantidade de threads de recepção: com NUMA, o mesmo número por nó.
+	 */
+	static int
+	threads_for(
+		int n,
+		bool numa_
+	){
+
+		int n_nos = numa_ ? static_cast<int>(NumaTopology::system().nodes()) : 1;
+		n = std::max(n, 1);
+		return (n + n_nos - 1) / n_nos * n_nos;
+	}
+
+	/**
+	 * @brief Seções que um snapshot deve conter para as etapas habilitadas.
+	 */
+	uint32_t
+	snapshot_sections() const {
+
+		return (indice ? SECAO_INDICE : 0) | (historico ? SECAO_HISTORICO : 0) | (reordenador ? SECAO_REORDENACAO : 0);
+	}
+
+	/**
+	 * @brief Indica se o snapshot cobre todas as etapas habilitadas que o WAL reconstrói.
+	 * @details
+	 *
+	 * Viagens, cercas, casamento com o mapa e mapa de calor não são gravados no snapshot;
+	 * com eles habilitados, o WAL é mantido inteiro e reaplicado desde o início.
+	 */
+	bool snapshot_covers() const { return !segmentador && !cercas && !regras && !casador && !calor; }
+
+	static std::string
+	snapshot_name(
+		const std::string& dir,
+		uint64_t lsn
+	){
+
+		char nome[64];
+		std::snprintf(nome, sizeof(nome), "/snapshot-%020llu.snap", static_cast<unsigned long long>(lsn));
+		return dir + nome;
+	}
+
+	/**
+	 * @brief Lista os snapshots do diretório, do mais recente ao mais antigo.
+	 */
+	static std::vector<std::pair<uint64_t, std::string>>
+	list_snapshots(
+		const std::string& dir
+	){
+
+		std::vector<std::pair<uint64_t, std::string>> snapshots;
+
+		DIR* d = ::opendir(dir.c_str());
+		if( !d ){ return snapshots; }
+
+		while(
+			dirent* ent = ::readdir(d)
+		){
+
+			unsigned long long lsn = 0;
+			char sufixo[8] = {};
+			if( std::sscanf(ent->d_name, "snapshot-%20llu.%4s", &lsn, sufixo) == 2 && std::strcmp(sufixo, "snap") == 0 ){
+
+				snapshots.emplace_back(lsn, dir + "/" + ent->d_name);
+			}
+		}
+		::closedir(d);
+
+		std::sort(snapshots.rbegin(), snapshots.rend());
+		return snapshots;
+	}
+
+	/**
+	 * @brief Carrega o snapshot válido mais recente do diretório no estado, ainda vazio.
+	 * @return LSN a partir do qual o WAL deve ser reaplicado; 1 caso nenhum seja carregado.
+	 * @details
+	 *
+	 * Snapshots danificados (CRC de alguma seção incorreto, arquivo truncado) são rejeitados
+	 * por SnapshotReader antes de alterar o estado, e o anterior é tentado; o WAL é mantido
+	 * desde o LSN do anterior. Um snapshot gravado com outras etapas (ou outra grade do
+	 * índice) não é carregado, e o WAL é reaplicado por inteiro.
+	 */
+	uint64_t
+	load_snapshot(
+		const std::string& dir
+	){
+
+		for(
+			const auto& snap : list_snapshots(dir)
+		){
+
+			SnapshotReader r(snap.second);
+			uint64_t lsn = 0, capacidade = 0;
+			uint32_t secoes = 0;
+			int32_t  passo_e6 = 0;
+			int64_t  balde_ms = 0;
+			if(
+				!r.valid() || !r.get(lsn) || !r.get(secoes) || !r.get(passo_e6) || !r.get(balde_ms) || !r.get(capacidade)
+			){
+
+				std::cout << "\033[1;31mSnapshot inválido ignorado: " << snap.second << "\033[0m" << std::endl;
+				continue;
+			}
+
+			if(
+				secoes != snapshot_sections() ||
+				(indice && (passo_e6 != indice->grid_step_e6() || balde_ms != indice->bucket_ms() || capacidade != indice->capacity()))
+			){
+
+				std::cout << "\033[1;31mSnapshot gravado com outras etapas habilitadas; reaplicando o WAL inteiro.\033[0m" << std::endl;
+				return 1;
+			}
+
+			uint64_t fixes = 0, tabela_cheia = 0;
+			bool ok = r.get(fixes) && r.get(tabela_cheia) && tabela.load(r) &&
+					  (!indice || indice->load(r)) &&
+					  (!historico || historico->load(r)) &&
+					  (!reordenador || reordenador->load(r));
+
+			// Com os CRCs conferidos, só um erro de formato chega aqui; o estado já foi
+			// parcialmente alterado e não há como recorrer ao anterior
+			if( !ok ){ throw std::runtime_error("\033[1;31mSnapshot corrompido: " + snap.second + "\033[0m"); }
+
+			n_fixes.store(fixes);
+			n_tabela_cheia.store(tabela_cheia);
+			std::cout << "\033[1;32mSnapshot carregado: " << tabela.size() << " rastreadores, LSN " << lsn << ".\033[0m" << std::endl;
+			return lsn;
+		}
+		return 1;
+	}
+
+	/**
+	 * @brief Cria um socket UDP associado à porta com SO_REUSEPORT.
+	 */
+	int
+	open_socket(){
+
+		int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if( fd < 0 ){ throw std::runtime_error("\033[1;31mErro ao criar socket UDP do coletor\033[0m"); }
+
+		int um = 1;
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &um, sizeof(um));
+
+		int buffer = 4 << 20;
+		::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+
+		// Carimbo de recepção do kernel, para medir a espera na fila
+		if( admissao ){ ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &um, sizeof(um)); }
+
+		// Timeout para que a thread perceba stop()
+		timeval timeout{0, 200000};
+		::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		sockaddr_in addr{};
+		addr.sin_family      = AF_INET;
+		addr.sin_port        = ::htons(porta);
+		addr.sin_addr.s_addr = ::htonl(INADDR_ANY);
+		if( ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ){
+
+			::close(fd);
+			throw std::runtime_error("\033[1;31mErro ao associar o coletor à porta " + std::to_string(porta) + "\033[0m");
+		}
+
+		return fd;
+	}
+
+	/**
+	 * @brief Loop de recepção de uma thread.
+	 * @param fd Socket exclusivo da thread.
+	 * @param indice Índice da thread, igual à posição do socket no grupo SO_REUSEPORT.
+	 */
+	void
+	loop(
+		int fd,
+		int indice
+	){
+
+		constexpr int LOTE    = 64;
+		constexpr int TAM     = 256;
+		constexpr int TAM_ACK = 48;
+
+		static thread_local char buffers[LOTE][TAM];
+		static thread_local char confirmacoes[LOTE][TAM_ACK];
+		static thread_local char controles[LOTE][CMSG_SPACE(sizeof(timespec))];
+		CollectorFix     fixes[LOTE];
+		std::string_view linhas[LOTE];
+		FixColumns       colunas;
+		mmsghdr     msgs[LOTE];
+		iovec       iovs[LOTE];
+		sockaddr_in origens[LOTE];
+		mmsghdr     msgs_ack[LOTE];
+		iovec       iovs_ack[LOTE];
+
+		const NumaTopology& topologia = NumaTopology::system();
+		if(
+			numa
+		){
+
+			// Presa ao nó antes de tocar nos buffers, que também migram para ele
+			std::size_t no = static_cast<std::size_t>(indice) % topologia.nodes();
+			if( !topologia.pin_thread(no) ){ std::cout << "\033[1;31mErro ao prender a thread de recepção " << indice << " ao nó " << no << "\033[0m" << std::endl; }
+			NumaArena::bind(buffers, sizeof(buffers), no, true);
+			NumaArena::bind(confirmacoes, sizeof(confirmacoes), no, true);
+		}
+		trafego_thread = &trafego[indice];
+
+		while(
+			is_exec
+		){
+
+			for(
+				int i = 0; i < LOTE; i++
+			){
+
+				iovs[i] = { buffers[i], TAM };
+				std::memset(&msgs[i], 0, sizeof(mmsghdr));
+				msgs[i].msg_hdr.msg_iov     = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen  = 1;
+				msgs[i].msg_hdr.msg_name    = &origens[i];
+				msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				if(
+					admissao
+				){
+
+					msgs[i].msg_hdr.msg_control    = controles[i];
+					msgs[i].msg_hdr.msg_controllen = sizeof(controles[i]);
+				}
+			}
+
+			int n = ::recvmmsg(fd, msgs, LOTE, MSG_WAITFORONE, nullptr);
+			if(
+				reordenador
+			){
+
+				std::shared_lock<std::shared_mutex> corte(mtx_corte);
+				reordenador->expire(now_ms(), [this](const CollectorFix& f){ apply(f); });
+				flush_rules();
+			}
+			if( n <= 0 ){ if( admissao ){ admissao->report_batch(0, now_ms()); } continue; } // Timeout ou interrupção
+
+			int64_t agora = now_ms();
+			n_datagramas.fetch_add(n, std::memory_order_relaxed);
+			trafego_thread->no = topologia.current_node();
+			if( admissao ){ admissao->report_batch(queue_delay_us(msgs[0].msg_hdr), agora); }
+
+			for(
+				int i = 0; i < n; i++
+			){
+
+				linhas[i] = std::string_view(buffers[i], msgs[i].msg_len);
+				while( !linhas[i].empty() && (linhas[i].back() == '\n' || linhas[i].back() == '\r') ){ linhas[i].remove_suffix(1); }
+			}
+			std::size_t validos = CsvDecoder::decode(linhas, n, agora, colunas);
+			n_invalidos.fetch_add(n - validos, std::memory_order_relaxed);
+
+			std::size_t k = 0;
+			int         n_ack = 0;
+			for(
+				std::size_t j = 0; j < validos; j++
+			){
+
+				uint32_t         i     = colunas.linha[j];
+				std::string_view linha = linhas[i];
+				CollectorFix&    fix   = fixes[k];
+				fix = colunas.fix(j, CollectorFix::tracker_id(origens[i]));
+
+				if(
+					admissao
+				){
+
+					AdmissionControl::Decisao d = admissao->admit(fix, agora);
+					if(
+						d.confirmar
+					){
+
+						// O fix é identificado pelo horário, como enviado
+						std::string_view utc = linha.substr(0, std::min<std::size_t>(linha.find(','), 16));
+						int len = std::snprintf(confirmacoes[n_ack], TAM_ACK, "ACK,%.*s,%d,%u\n", static_cast<int>(utc.size()), utc.data(), d.aceito ? 1 : 0, d.pausa_ms);
+						iovs_ack[n_ack] = { confirmacoes[n_ack], static_cast<std::size_t>(len) };
+						std::memset(&msgs_ack[n_ack], 0, sizeof(mmsghdr));
+						msgs_ack[n_ack].msg_hdr.msg_iov     = &iovs_ack[n_ack];
+						msgs_ack[n_ack].msg_hdr.msg_iovlen  = 1;
+						msgs_ack[n_ack].msg_hdr.msg_name    = &origens[i];
+						msgs_ack[n_ack].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+						n_ack++;
+					}
+					if( !d.aceito ){ continue; }
+				}
+				k++;
+			}
+
+			bool duravel = ingest_batch(fixes, k);
+
+			// Confirma só depois do lote incorporado (e durável, no modo SINCRONA); sem
+			// confirmação, o rastreador mantém os fixes no spool e os reenvia
+			if( n_ack && duravel ){ ::sendmmsg(fd, msgs_ack, n_ack, MSG_DONTWAIT); }
+		}
+		trafego_thread = nullptr;
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param porta_ Porta UDP na qual os rastreadores enviam.
+	 * @param n_threads_ Quantidade de threads (e sockets) de recepção.
+	 * @param capacidade Quantidade de rastreadores esperada.
+	 * @param numa_ Prende as threads de recepção aos nós NUMA e aloca a tabela em memória
+	 * local a cada nó, em páginas enormes. A quantidade de threads é arredondada para um
+	 * múltiplo da quantidade de nós.
+	 */
+	GPSCollector(
+		int porta_,
+		int n_threads_ = 1,
+		std::size_t capacidade = 1 << 16,
+		bool numa_ = false
+	) : porta(porta_),
+		n_threads(threads_for(n_threads_, numa_)),
+		numa(numa_),
+		tabela(
+			   capacidade,
+			   numa_ ? std::max<std::size_t>(16, NumaTopology::system().nodes()) : 16,
+			   numa_ ? NumaArena::allocate : nullptr,
+			   numa_ ? NumaArena::release : nullptr,
+			   numa_ ? NumaTopology::shard_of_tracker : nullptr
+			  ) {}
+
+	/**
+	 * @brief Destrutor. Encerra as threads e fecha os sockets.
+	 */
+	~GPSCollector(){
+
+		stop();
+		comboios.reset();
+		if( arquivo_viagens ){ std::fclose(arquivo_viagens); }
+		if( arquivo_comboios ){ std::fclose(arquivo_comboios); }
+		if( arquivo_cercas ){ std::fclose(arquivo_cercas); }
+		if( arquivo_alertas ){ std::fclose(arquivo_alertas); }
+		if( arquivo_casados ){ std::fclose(arquivo_casados); }
+	}
+
+	/**
+	 * @brief Habilita o histórico comprimido de fixes.
+	 * @param fixes_por_bloco Fixes por bloco comprimido.
+	 * @param fator_lod Redução entre níveis das pirâmides de resolução; 0 as desabilita.
+	 * @details
+	 *
+	 * Deve ser chamado antes de open_wal() e de init(), para que o histórico também seja
+	 * reconstruído a partir do WAL.
+	 */
+	void
+	open_history(
+		std::size_t fixes_por_bloco = 1024,
+		std::size_t fator_lod = 8
+	){ historico = std::make_unique<HistoryStore>(fixes_por_bloco, 64, fator_lod); }
+
+	/**
+	 * @brief Acesso ao histórico, ou nullptr caso desabilitado.
+	 */
+	HistoryStore* history(){ return historico.get(); }
+
+	/**
+	 * @brief Habilita a compactação do histórico em segundo plano.
+	 * @param politica Retenção e redução.
+	 * @param taxa_fixes Fixes decodificados por segundo, no máximo.
+	 * @details
+	 *
+	 * Requer open_history(). Deve ser chamado antes de init(); a thread do compactador
+	 * acompanha as de recepção.
+	 */
+	void
+	open_compaction(
+		HistoryStore::Politica politica = HistoryStore::Politica(),
+		uint64_t taxa_fixes = 2000000
+	){
+
+		if( !historico ){ throw std::runtime_error("\033[1;31mA compactação requer o histórico habilitado\033[0m"); }
+		compactador = std::make_unique<HistoryCompactor>(*historico, politica, taxa_fixes);
+	}
+
+	/**
+	 * @brief Acesso ao compactador, ou nullptr caso desabilitado.
+	 */
+	HistoryCompactor* compaction(){ return compactador.get(); }
+
+	/**
+	 * @brief Habilita as consultas sobre o histórico de toda a frota.
+	 * @param linhas_por_segmento Tamanho máximo de cada segmento colunar.
+	 * @details
+	 *
+	 * Requer open_history(). Os segmentos acompanham o histórico sob demanda, em scan(); com
+	 * a compactação habilitada, também ao fim de cada passada, de modo que a reconstrução
+	 * após uma reescrita dos blocos não recai sobre as consultas.
+	 */
+	void
+	open_scan(
+		std::size_t linhas_por_segmento = 1 << 16
+	){
+
+		if( !historico ){ throw std::runtime_error("\033[1;31mA varredura requer o histórico habilitado\033[0m"); }
+		varredura        = std::make_unique<ScanEngine>();
+		linhas_varredura = linhas_por_segmento;
+	}
+
+	/**
+	 * @brief Acesso ao executor de varreduras, ou nullptr caso desabilitado.
+	 */
+	ScanEngine* scan_engine(){ return varredura.get(); }
+
+	/**
+	 * @brief Rastreadores com fixes selados no histórico que satisfazem a consulta.
+	 * @details
+	 *
+	 * Antes de varrer, acrescenta os blocos selados desde a consulta anterior; os fixes
+	 * ainda nos blocos abertos não são considerados. Sem open_scan(), retorna vazio.
+	 */
+	ScanEngine::Resultado
+	scan(
+		const ScanQuery& q
+	){
+
+		if( !varredura ){ return ScanEngine::Resultado(); }
+		varredura->refresh(*historico, linhas_varredura);
+		return varredura->scan(q);
+	}
+
+	/**
+	 * @brief Habilita o índice espaço-temporal.
+	 * @param passo_graus Lado da célula da grade.
+	 * @param balde_ms Duração de cada janela de tempo.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init().
+	 */
+	void
+	open_index(
+		double passo_graus = 0.01,
+		int64_t balde_ms = 3600000
+	){ indice = std::make_unique<SpatioTemporalIndex>(passo_graus, balde_ms, tabela.capacity() / 2); }
+
+	/**
+	 * @brief Acesso ao índice espaço-temporal, ou nullptr caso desabilitado.
+	 */
+	SpatioTemporalIndex* index(){ return indice.get(); }
+
+	/**
+	 * @brief Habilita a segmentação em viagens e paradas.
+	 * @param caminho Arquivo CSV onde os resumos são acrescentados.
+	 * @param raio_m Raio de permanência de uma parada.
+	 * @param parada_min_ms Permanência mínima de uma parada.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init(). Os resumos
+	 * de fixes reaplicados do WAL não são regravados, pois já o foram antes da interrupção.
+	 */
+	void
+	open_trips(
+		const std::string& caminho,
+		double raio_m = 50,
+		int64_t parada_min_ms = 180000
+	){
+
+		arquivo_viagens = std::fopen(caminho.c_str(), "a");
+		if( !arquivo_viagens ){ throw std::runtime_error("\033[1;31mErro ao abrir arquivo de viagens: " + caminho + "\033[0m"); }
+
+		segmentador = std::make_unique<TripSegmenter>(raio_m, parada_min_ms, 600000, tabela.capacity() / 2);
+		segmentador->on_summary([this](const TripSummary& r){
+
+			std::string linha = r.to_csv();
+			std::lock_guard<std::mutex> lock(mtx_viagens);
+			std::fwrite(linha.data(), 1, linha.size(), arquivo_viagens);
+			std::fflush(arquivo_viagens);
+		});
+	}
+
+	/**
+	 * @brief Acesso ao segmentador, ou nullptr caso desabilitado.
+	 */
+	TripSegmenter* trips(){ return segmentador.get(); }
+
+	/**
+	 * @brief Habilita a detecção de comboios e colocalizações.
+	 * @param caminho Arquivo CSV onde os eventos são acrescentados.
+	 * @param distancia_m Distância máxima entre os rastreadores do par.
+	 * @param duracao_ms Duração mínima da proximidade.
+	 * @details
+	 *
+	 * Deve ser chamado antes de init(); a thread do detector acompanha as de recepção.
+	 */
+	void
+	open_convoys(
+		const std::string& caminho,
+		double distancia_m = 30,
+		int64_t duracao_ms = 300000
+	){
+
+		arquivo_comboios = std::fopen(caminho.c_str(), "a");
+		if( !arquivo_comboios ){ throw std::runtime_error("\033[1;31mErro ao abrir arquivo de comboios: " + caminho + "\033[0m"); }
+
+		comboios = std::make_unique<ConvoyDetector>(tabela, distancia_m, duracao_ms);
+		comboios->on_event([this](const ConvoyEvent& ev){
+
+			std::string linha = ev.to_csv();
+			std::fwrite(linha.data(), 1, linha.size(), arquivo_comboios);
+			std::fflush(arquivo_comboios);
+		});
+	}
+
+	/**
+	 * @brief Acesso ao detector de comboios, ou nullptr caso desabilitado.
+	 */
+	ConvoyDetector* convoys(){ return comboios.get(); }
+
+	/**
+	 * @brief Habilita a avaliação de cercas.
+	 * @param caminho Arquivo de cercas, no formato de Fence::load().
+	 * @param caminho_eventos Arquivo CSV onde entradas e saídas são acrescentadas.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init().
+	 */
+	void
+	open_geofences(
+		const std::string& caminho,
+		const std::string& caminho_eventos
+	){
+
+		std::vector<Fence> lidas = Fence::load(caminho);
+
+		arquivo_cercas = std::fopen(caminho_eventos.c_str(), "a");
+		if( !arquivo_cercas ){ throw std::runtime_error("\033[1;31mErro ao abrir arquivo de eventos de cercas: " + caminho_eventos + "\033[0m"); }
+
+		caminho_cercas = caminho;
+		cercas = std::make_unique<GeofenceEvaluator>(tabela.capacity() / 2);
+		cercas->publish(std::make_unique<const FenceIndex>(lidas));
+		cercas->on_event([this](const GeofenceEvent& ev){
+
+			std::string linha = ev.to_csv();
+			std::lock_guard<std::mutex> lock(mtx_cercas);
+			std::fwrite(linha.data(), 1, linha.size(), arquivo_cercas);
+			std::fflush(arquivo_cercas);
+		});
+		std::cout << "\033[1;32mCercas carregadas: " << lidas.size() << ".\033[0m" << std::endl;
+	}
+
+	/**
+	 * @brief Relê o arquivo de cercas e publica o novo índice sem interromper a recepção.
+	 * @return False caso o arquivo seja inválido; as cercas anteriores são mantidas.
+	 */
+	bool
+	reload_geofences(){
+
+		if( !cercas ){ return false; }
+
+		try {
+
+			std::vector<Fence> lidas = Fence::load(caminho_cercas);
+			cercas->publish(std::make_unique<const FenceIndex>(lidas));
+			std::cout << "\033[1;32mCercas recarregadas: " << lidas.size() << ".\033[0m" << std::endl;
+			return true;
+		}
+		catch (std::exception& e) {
+
+			std::cout << e.what() << std::endl;
+			return false;
+		}
+	}
+
+	/**
+	 * @brief Acesso ao avaliador de cercas, ou nullptr caso desabilitado.
+	 */
+	GeofenceEvaluator* geofences(){ return cercas.get(); }
+
+	/**
+	 * @brief Habilita as regras de alerta.
+	 * @param caminho Arquivo de regras, no formato de RuleSet::compile().
+	 * @param caminho_alertas Arquivo CSV onde o início e o fim dos alertas são acrescentados.
+	 * @param caminho_zonas Arquivo de cercas referenciadas por `zona N`, no formato de Fence::load(); opcional.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init().
+	 */
+	void
+	open_rules(
+		const std::string& caminho,
+		const std::string& caminho_alertas,
+		const std::string& caminho_zonas = ""
+	){
+
+		std::unique_ptr<RuleSet> compiladas = RuleSet::load(caminho, caminho_zonas.empty() ? std::vector<Fence>() : Fence::load(caminho_zonas));
+
+		arquivo_alertas = std::fopen(caminho_alertas.c_str(), "a");
+		if( !arquivo_alertas ){ throw std::runtime_error("\033[1;31mErro ao abrir arquivo de alertas: " + caminho_alertas + "\033[0m"); }
+
+		std::size_t n = compiladas->regras.size();
+		caminho_regras       = caminho;
+		caminho_zonas_regras = caminho_zonas;
+		regras = std::make_unique<RuleEngine>(tabela.capacity() / 2);
+		regras->publish(std::move(compiladas));
+		regras->on_alert([this](const RuleAlert& a){
+
+			std::string linha = a.to_csv();
+			std::lock_guard<std::mutex> lock(mtx_alertas);
+			std::fwrite(linha.data(), 1, linha.size(), arquivo_alertas);
+			std::fflush(arquivo_alertas);
+		});
+		std::cout << "\033[1;32mRegras carregadas: " << n << ".\033[0m" << std::endl;
+	}
+
+	/**
+	 * @brief Relê as regras e suas cercas e as publica sem interromper a recepção.
+	 * @return False caso algum arquivo seja inválido; as regras anteriores são mantidas.
+	 */
+	bool
+	reload_rules(){
+
+		if( !regras ){ return false; }
+
+		try {
+
+			std::unique_ptr<RuleSet> compiladas = RuleSet::load(caminho_regras, caminho_zonas_regras.empty() ? std::vector<Fence>() : Fence::load(caminho_zonas_regras));
+			std::size_t n = compiladas->regras.size();
+			regras->publish(std::move(compiladas));
+			std::cout << "\033[1;32mRegras recarregadas: " << n << ".\033[0m" << std::endl;
+			return true;
+		}
+		catch (std::exception& e) {
+
+			std::cout << e.what() << std::endl;
+			return false;
+		}
+	}
+
+	/**
+	 * @brief Acesso ao avaliador de regras, ou nullptr caso desabilitado.
+	 */
+	RuleEngine* rules(){ return regras.get(); }
+
+	/**
+	 * @brief Habilita o casamento dos fixes com a malha viária.
+	 * @param caminho_osm Extrato OSM em XML.
+	 * @param caminho_saida Arquivo CSV onde os fixes casados são acrescentados.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init(). As cadeias
+	 * pendentes são emitidas em stop() e, para rastreadores silenciosos, em MapMatcher::expire().
+	 */
+	void
+	open_map_matching(
+		const std::string& caminho_osm,
+		const std::string& caminho_saida
+	){
+
+		mapa = std::make_unique<RoadGraph>(RoadGraph::load_osm(caminho_osm));
+
+		arquivo_casados = std::fopen(caminho_saida.c_str(), "a");
+		if( !arquivo_casados ){ throw std::runtime_error("\033[1;31mErro ao abrir arquivo de fixes casados: " + caminho_saida + "\033[0m"); }
+
+		casador = std::make_unique<MapMatcher>(*mapa);
+		casador->on_match([this](const MatchedFix& m){
+
+			std::string linha = m.to_csv();
+			std::lock_guard<std::mutex> lock(mtx_casados);
+			std::fwrite(linha.data(), 1, linha.size(), arquivo_casados);
+		});
+		std::cout << "\033[1;32mMalha viária: " << mapa->node_count() << " nós, " << mapa->edge_count() << " arestas.\033[0m" << std::endl;
+	}
+
+	/**
+	 * @brief Acesso ao casador, ou nullptr caso desabilitado.
+	 */
+	MapMatcher* map_matcher(){ return casador.get(); }
+
+	/**
+	 * @brief Habilita os ladrilhos de densidade (tempo de permanência) da frota.
+	 * @param zoom_min Menor nível de zoom.
+	 * @param zoom_max Maior nível de zoom.
+	 * @details
+	 *
+	 * Assim como open_history(), deve ser chamado antes de open_wal() e de init().
+	 */
+	void
+	open_heatmap(
+		int zoom_min = 4,
+		int zoom_max = 14
+	){ calor = std::make_unique<HeatmapTiles>(zoom_min, zoom_max, 64, HeatmapTiles::Peso::PERMANENCIA, 50, tabela.capacity() / 2); }
+
+	/**
+	 * @brief Acesso aos ladrilhos de densidade, ou nullptr caso desabilitados.
+	 */
+	HeatmapTiles* heatmap(){ return calor.get(); }
+
+	/**
+	 * @brief Habilita a reordenação e eliminação de duplicatas por rastreador.
+	 * @param atraso_ms Atraso máximo imposto a um fix.
+	 * @details
+	 *
+	 * Deve ser chamado antes de open_wal() e de init(). Os fixes retidos são emitidos em stop().
+	 */
+	void
+	open_reorder(
+		int64_t atraso_ms = 2000
+	){ reordenador = std::make_unique<ReorderBuffer>(atraso_ms); }
+
+	/**
+	 * @brief Acesso ao ReorderBuffer, ou nullptr caso desabilitado.
+	 */
+	ReorderBuffer* reorder(){ return reordenador.get(); }
+
+	/**
+	 * @brief Habilita o servidor de assinaturas ao vivo.
+	 * @param porta_assinaturas Porta TCP, apenas em 127.0.0.1.
+	 * @details
+	 *
+	 * Deve ser chamado antes de init(). Fixes reaplicados do WAL não são entregues.
+	 */
+	void
+	open_subscriptions(
+		int porta_assinaturas
+	){ assinaturas = std::make_unique<SubscriptionServer>(porta_assinaturas); }
+
+	/**
+	 * @brief Acesso ao servidor de assinaturas, ou nullptr caso desabilitado.
+	 */
+	SubscriptionServer* subscriptions(){ return assinaturas.get(); }
+
+	/**
+	 * @brief Habilita o controle de admissão e as confirmações aos rastreadores.
+	 * @param limite_vivo_ms Idade máxima de um fix ao vivo; os mais velhos vêm de spool.
+	 * @param taxa_max Teto de fixes de spool por segundo; 0 para apenas o limite da carga.
+	 * @details
+	 *
+	 * Deve ser chamado antes de init(). Afeta apenas os datagramas recebidos; ingest_batch()
+	 * admite tudo.
+	 */
+	void
+	open_admission(
+		int64_t limite_vivo_ms = 10000,
+		uint32_t taxa_max = 0
+	){ admissao = std::make_unique<AdmissionControl>(limite_vivo_ms, taxa_max); }
+
+	/**
+	 * @brief Acesso ao controle de admissão, ou nullptr caso desabilitado.
+	 */
+	AdmissionControl* admission(){ return admissao.get(); }
+
+	/**
+	 * @brief Habilita o write-ahead log, recuperando antes o estado nele gravado.
+	 * @param dir Diretório do WAL.
+	 * @param modo Nível de durabilidade.
+	 * @param janela Janela de agrupamento do group commit.
+	 * @return LSN seguinte ao último fix recuperado.
+	 * @details
+	 *
+	 * Deve ser chamado antes de init(). Os fixes recuperados são aplicados à TrackerTable
+	 * sem serem regravados; com reordenação, passam antes pelo ReorderBuffer.
+	 *
+	 * Havendo snapshot no diretório, ele é carregado e apenas os fixes posteriores são
+	 * reaplicados. Com etapas que o snapshot não cobre (snapshot_covers()), o WAL é
+	 * reaplicado por inteiro, a menos que já tenha sido truncado.
+	 */
+	uint64_t
+	open_wal(
+		const std::string& dir,
+		CollectorWAL::Durabilidade modo = CollectorWAL::Durabilidade::SINCRONA,
+		std::chrono::microseconds janela = std::chrono::microseconds(1000)
+	){
+
+		// Sem os instantes de chegada, a reordenação na recuperação usa o instante do fix
+		auto emitir = [this](const CollectorFix& f){ apply(f); };
+		reproduzindo = true;
+		dir_wal      = dir;
+
+		uint64_t desde   = 1;
+		uint64_t inicial = CollectorWAL::first_lsn(dir);
+		if(
+			snapshot_covers() || inicial > 1
+		){
+
+			desde = load_snapshot(dir);
+			if( !snapshot_covers() && desde > 1 ){ std::cout << "\033[1;31mWAL truncado: viagens, cercas, regras, casamento e mapa de calor reconstruídos a partir do LSN " << desde << ".\033[0m" << std::endl; }
+		}
+		if( desde < inicial ){ std::cout << "\033[1;31mWAL truncado sem snapshot correspondente: fixes anteriores ao LSN " << inicial << " perdidos.\033[0m" << std::endl; }
+
+		uint64_t proximo = CollectorWAL::replay(
+												dir,
+												desde,
+												[&](const CollectorFix* lote, std::size_t n, uint64_t){
+
+													for(
+														std::size_t i = 0; i < n; i++
+													){
+
+														if( reordenador ){ reordenador->push(lote[i], lote[i].t_ms, emitir); }
+														else{ apply(lote[i]); }
+													}
+												}
+											   );
+		if( reordenador ){ reordenador->flush_all(emitir); }
+		flush_rules();
+		reproduzindo = false;
+		std::cout << "\033[1;32mWAL recuperado: " << (proximo - std::min(proximo, std::max(desde, inicial))) << " fixes.\033[0m" << std::endl;
+
+		wal = std::make_unique<CollectorWAL>(dir, modo, janela);
+		return proximo;
+	}
+
+	/**
+	 * @brief Incorpora um lote de fixes já interpretados ao estado do coletor.
+	 * @param fixes Fixes com rastreador identificado.
+	 * @param n Quantidade de fixes.
+	 * @details
+	 *
+	 * Chamado pelas threads de recepção; pode ser chamado diretamente para injetar fixes
+	 * de outras fontes (replays, benchmarks). Com WAL, o lote é gravado primeiro; no modo
+	 * SINCRONA, retorna apenas depois de o lote estar durável.
+	 *
+	 * A gravação no WAL e a incorporação ocorrem sob o lock compartilhado do corte, de modo
+	 * que write_snapshot() vê cada lote inteiro ou nada dele. A espera pelo group commit
+	 * fica fora do lock, para não atrasar o snapshot.
+	 *
+	 * @return False caso, no modo SINCRONA, o WAL falhe ao gravar o lote; ele já foi
+	 * incorporado à memória, mas não deve ser confirmado ao rastreador.
+	 */
+	bool
+	ingest_batch(
+		const CollectorFix* fixes,
+		std::size_t n
+	){
+
+		if( n == 0 ){ return true; }
+
+		uint64_t lsn = 0;
+		{
+			std::shared_lock<std::shared_mutex> corte(mtx_corte, std::defer_lock);
+			if( wal ){ corte.lock(); lsn = wal->append(fixes, n); }
+
+			if(
+				reordenador
+			){
+
+				int64_t agora = now_ms();
+				for( std::size_t i = 0; i < n; i++ ){ reordenador->push(fixes[i], agora, [this](const CollectorFix& f){ apply(f); }); }
+			}
+			else{
+
+				for( std::size_t i = 0; i < n; i++ ){ apply(fixes[i]); }
+			}
+			flush_rules();
+		}
+
+		return !(wal && wal->synchronous()) || wal->wait_durable(lsn);
+	}
+
+	/**
+	 * @brief Incorpora um único fix ao estado do coletor.
+	 */
+	bool
+	ingest(
+		const CollectorFix& fix
+	){ return ingest_batch(&fix, 1); }
+
+	/**
+	 * @brief Acesso ao WAL, ou nullptr caso desabilitado.
+	 */
+	CollectorWAL* write_ahead_log(){ return wal.get(); }
+
+	/**
+	 * @brief Grava um snapshot consistente do estado em memória no diretório do WAL.
+	 * @param[out] info Medidas do snapshot, se informado.
+	 * @return False caso o WAL esteja desabilitado ou a gravação falhe.
+	 * @details
+	 *
+	 * Fluxo:
+	 *
+	 * - Sob o lock exclusivo do corte, a ingestão é suspensa; o estado (TrackerTable e,
+	 *   se habilitados, índice, histórico e janelas de reordenação) é copiado para um
+	 *   buffer junto do próximo LSN do WAL. É a única pausa da recepção.
+	 * - Fora do lock, aguarda que o WAL esteja durável até esse LSN, grava o buffer em
+	 *   `snapshot-<lsn>.snap` (temporário, fsync e rename) e o relê, conferindo os CRCs.
+	 * - Apenas o snapshot anterior é mantido, junto dos segmentos do WAL a partir do seu LSN:
+	 *   se o novo não puder ser carregado, load_snapshot() recorre ao anterior e ao WAL.
+	 *   Os demais snapshots e, se o snapshot cobre todas as etapas habilitadas, os segmentos
+	 *   anteriores ao LSN do snapshot anterior são removidos.
+	 *
+	 * Pode ser chamado de qualquer thread, com as de recepção em execução.
+	 */
+	bool
+	write_snapshot(
+		SnapshotInfo* info = nullptr
+	){
+
+		if( !wal ){ return false; }
+
+		using namespace std::chrono;
+		auto inicio = steady_clock::now();
+
+		SnapshotWriter w;
+		uint64_t       lsn;
+		steady_clock::time_point liberado;
+		{
+			std::unique_lock<std::shared_mutex> corte(mtx_corte);
+
+			lsn = wal->next_lsn();
+			w.put(lsn);
+			w.put(snapshot_sections());
+			w.put<int32_t>(indice ? indice->grid_step_e6() : 0);
+			w.put<int64_t>(indice ? indice->bucket_ms() : 0);
+			w.put<uint64_t>(indice ? indice->capacity() : 0);
+			w.put(n_fixes.load());
+			w.put(n_tabela_cheia.load());
+			w.section();
+
+			tabela.save(w);
+			w.section();
+			if( indice ){ indice->save(w); w.section(); }
+			if( historico ){ historico->save(w); w.section(); }
+			if( reordenador ){ reordenador->save(w); w.section(); }
+			liberado = steady_clock::now();
+		}
+
+		// O snapshot não pode cobrir fixes que uma queda ainda apagaria do WAL
+		if( !wal->wait_durable(lsn) ){ return false; }
+
+		std::size_t bytes   = w.size();
+		std::string caminho = snapshot_name(dir_wal, lsn);
+		if( !w.write(caminho) ){ return false; }
+
+		// Relê o arquivo gravado antes de abrir mão do anterior
+		if(
+			!SnapshotReader(caminho).valid()
+		){
+
+			::unlink(caminho.c_str());
+			std::cout << "\033[1;31mSnapshot gravado não confere: " << caminho << "\033[0m" << std::endl;
+			return false;
+		}
+
+		// Mantém o anterior e o WAL desde o seu LSN, para o caso de o novo não carregar
+		auto        snapshots = list_snapshots(dir_wal);
+		std::size_t removidos = 0;
+		for( std::size_t i = 2; i < snapshots.size(); i++ ){ ::unlink(snapshots[i].second.c_str()); }
+		if( snapshot_covers() && snapshots.size() >= 2 ){ removidos = wal->truncate_before(snapshots[1].first); }
+
+		if(
+			info
+		){
+
+			info->lsn                 = lsn;
+			info->bytes               = bytes;
+			info->pausa_us            = static_cast<uint64_t>(duration_cast<microseconds>(liberado - inicio).count());
+			info->total_us            = static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now() - inicio).count());
+			info->segmentos_removidos = removidos;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Consulta o estado de um rastreador sem bloquear a recepção.
+	 */
+	bool
+	tracker_state(
+		uint64_t tracker,
+		TrackerState& estado
+	){ return tabela.read(tracker, estado); }
+
+	/**
+	 * @brief Acesso à tabela de rastreadores, para varreduras.
+	 */
+	TrackerTable<TrackerState>& trackers(){ return tabela; }
+
+	/**
+	 * @brief Obtém os contadores de recepção.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.datagramas   = n_datagramas.load(std::memory_order_relaxed);
+		s.fixes        = n_fixes.load(std::memory_order_relaxed);
+		s.invalidos    = n_invalidos.load(std::memory_order_relaxed);
+		s.tabela_cheia = n_tabela_cheia.load(std::memory_order_relaxed);
+		s.rastreadores = tabela.size();
+		s.acessos_locais  = 0;
+		s.acessos_remotos = 0;
+		for(
+			int i = 0; trafego && i < n_threads; i++
+		){
+
+			s.acessos_locais  += trafego[i].locais.load(std::memory_order_relaxed);
+			s.acessos_remotos += trafego[i].remotos.load(std::memory_order_relaxed);
+		}
+		return s;
+	}
+
+	/**
+	 * @brief Abre os sockets e inicializa as threads de recepção.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		std::cout << "\033[1;32mIniciando " << n_threads << " Thread(s) de Recepção na porta " << porta << "...\033[0m" << std::endl;
+
+		// Nó em que a memória de cada shard reside de fato, para a contagem de acessos
+		const NumaTopology& topologia = NumaTopology::system();
+		no_shard.assign(tabela.shard_count(), 0);
+		for(
+			std::size_t i = 0; i < no_shard.size(); i++
+		){
+
+			int no = topologia.node_of_address(tabela.shard_memory(i));
+			no_shard[i] = no >= 0 ? no : (numa ? static_cast<int>(i % topologia.nodes()) : 0);
+		}
+		if( !trafego ){ trafego.reset(new TrafegoNuma[n_threads]); }
+
+		for(
+			int i = 0; i < n_threads; i++
+		){
+
+			int fd = open_socket();
+			sockets.push_back(fd);
+			workers.emplace_back(
+								 [this, fd, i]{ loop(fd, i); }
+								);
+		}
+
+		// O socket i pertence ao nó i % nodes(); o programa vale para todo o grupo
+		if(
+			numa && n_threads > 1
+		){
+
+			std::vector<sock_filter> programa = topologia.reuseport_program(static_cast<uint32_t>(n_threads / topologia.nodes()));
+			sock_fprog fprog{ static_cast<unsigned short>(programa.size()), programa.data() };
+			if( ::setsockopt(sockets[0], SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog)) != 0 ){
+
+				std::cout << "\033[1;31mErro ao instalar o programa SO_REUSEPORT; os datagramas serão distribuídos pelo kernel\033[0m" << std::endl;
+			}
+		}
+		if( comboios ){ comboios->init(); }
+		if( compactador && varredura ){ compactador->on_pass([this]{ varredura->refresh(*historico, linhas_varredura); }); }
+		if( compactador ){ compactador->init(); }
+		if( assinaturas && varredura ){ assinaturas->on_query([this](const std::string& a){ return answer_query(a); }); }
+		if( assinaturas ){ assinaturas->init(); }
+	}
+
+	/**
+	 * @brief Finaliza as threads de recepção de forma segura.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		std::cout << "\033[1;32mSaindo das threads de recepção.\033[0m" << std::endl;
+		if( comboios ){ comboios->stop(); }
+		if( compactador ){ compactador->stop(); }
+		for( auto& w : workers ){ if( w.joinable() ){ w.join(); } }
+		if( assinaturas ){ assinaturas->stop(); }
+		for( int fd : sockets ){ ::close(fd); }
+		workers.clear();
+		sockets.clear();
+
+		if( reordenador ){ reordenador->flush_all([this](const CollectorFix& f){ apply(f); }); }
+		flush_rules();
+		if( casador ){ casador->flush_all(); std::fflush(arquivo_casados); }
+	}
+};
+
+#endif // GPSCOLLECTOR_HPP
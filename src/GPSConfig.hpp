@@ -0,0 +1,205 @@
+/**
+ * @file GPSConfig.hpp
+ * @brief Configuração imutável do rastreador, recarregável em tempo de execução.
+ * @details
+ * Destinos, período de operação e cercas geográficas deixam de ser valores fixos no código.
+ * Cada recarga constrói um novo GPSConfig fora do caminho crítico, publicado por troca
+ * atômica de ponteiro (RCUPtr).
+ */
+#ifndef GPSCONFIG_HPP
+#define GPSCONFIG_HPP
+
+//-------------------------------------------------
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <stdexcept>
+
+// Específicos de Sistemas Linux
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "GPSFix.hpp"
+
+/**
+ * @struct Geofence
+ * @brief Cerca geográfica circular.
+ */
+struct Geofence {
+	std::string nome;
+	double      lat    = 0; ///< Centro em graus decimais.
+	double      lon    = 0; ///< Centro em graus decimais.
+	double      raio_m = 0; ///< Raio em metros.
+
+	/**
+	 * @brief Verifica se uma posição está dentro da cerca.
+	 */
+	bool
+	contains(
+		double lat_,
+		double lon_
+	) const { return GPSFix::distance_m(lat, lon, lat_, lon_) <= raio_m; }
+};
+
+/**
+ * @struct GPSConfig
+ * @brief Snapshot de configuração lido pela thread worker.
+ * @details
+ *
+ * O arquivo de configuração é composto por linhas `chave = valor`, sendo '#' comentário:
+ *
+ * ```
+ * serial     = /dev/ttySTM2
+ * destino    = 192.168.42.1:9000
+ * destino    = 192.168.42.3:9000
+ * periodo_ms = 1000
+ * cerca      = deposito -22.9559 -43.1659 300
+ * controle   = /tmp/gpstrack.sock
+ * ```
+ *
+ * `destino` e `cerca` podem se repetir. A porta serial e o socket de controle só são
+ * lidos na inicialização.
+ */
+struct GPSConfig {
+
+	/**
+	 * @struct Destino
+	 * @brief Endereço UDP de destino já resolvido.
+	 */
+	struct Destino {
+		std::string ip;
+		int         porta = 0;
+		sockaddr_in addr{};
+	};
+
+	std::string                    serial = "/dev/ttySTM2";
+	std::string                              controle; ///< Socket Unix de controle; vazio desabilita.
+	std::vector<Destino>                       destinos;
+	std::chrono::milliseconds        periodo{1000};
+	std::vector<Geofence>                         cercas;
+
+	/**
+	 * @brief Adiciona um destino, resolvendo o endereço.
+	 * @param ip Endereço IPv4.
+	 * @param porta Porta UDP, de 1 a 65535.
+	 */
+	void
+	add_destination(
+		const std::string& ip,
+		int porta
+	){
+
+		if( porta < 1 || porta > 65535 ){ throw std::runtime_error("\033[1;31mPorta de destino inválida: " + std::to_string(porta) + "\033[0m"); }
+
+		Destino d;
+		d.ip    = ip;
+		d.porta = porta;
+		d.addr.sin_family = AF_INET;
+		d.addr.sin_port   = ::htons(porta);
+		if( ::inet_pton(AF_INET, ip.c_str(), &d.addr.sin_addr) != 1 ){
+
+			throw std::runtime_error("\033[1;31mEndereço de destino inválido: " + ip + "\033[0m");
+		}
+		destinos.push_back(d);
+	}
+
+	/**
+	 * @brief Constrói uma configuração a partir de um arquivo.
+	 * @param caminho Caminho do arquivo de configuração.
+	 * @return Configuração lida.
+	 * @details
+	 *
+	 * Lança std::runtime_error indicando a linha problemática em caso de erro, de modo que
+	 * uma recarga malsucedida mantenha a configuração anterior.
+	 */
+	static GPSConfig
+	load(
+		const std::string& caminho
+	){
+
+		std::ifstream arquivo(caminho);
+		if( !arquivo ){ throw std::runtime_error("\033[1;31mErro ao abrir configuração: " + caminho + "\033[0m"); }
+
+		GPSConfig cfg;
+		std::string linha;
+		int n_linha = 0;
+		while(
+			std::getline(arquivo, linha)
+		){
+
+			n_linha++;
+			linha = linha.substr(0, linha.find('#'));
+
+			std::size_t igual = linha.find('=');
+			if( igual == std::string::npos ){
+
+				if( linha.find_first_not_of(" \t\r") != std::string::npos ){ erro(caminho, n_linha, "esperado chave = valor"); }
+				continue;
+			}
+
+			std::string chave = trim(linha.substr(0, igual));
+			std::istringstream valor(linha.substr(igual + 1));
+
+			if( chave == "serial" ){ valor >> cfg.serial; }
+			else if( chave == "controle" ){ valor >> cfg.controle; }
+			else if( chave == "destino" ){
+
+				std::string ip_porta;
+				valor >> ip_porta;
+				std::size_t dois_pontos = ip_porta.rfind(':');
+				if( dois_pontos == std::string::npos ){ erro(caminho, n_linha, "destino deve ser ip:porta"); }
+
+				int porta = 0;
+				try { porta = std::stoi(ip_porta.substr(dois_pontos + 1)); }
+				catch (std::exception&) { erro(caminho, n_linha, "destino inválido"); }
+				if( porta < 1 || porta > 65535 ){ erro(caminho, n_linha, "porta do destino deve estar entre 1 e 65535"); }
+
+				try { cfg.add_destination(ip_porta.substr(0, dois_pontos), porta); }
+				catch (std::exception&) { erro(caminho, n_linha, "destino inválido"); }
+			}
+			else if( chave == "periodo_ms" ){
+
+				long ms = 0;
+				if( !(valor >> ms) || ms <= 0 ){ erro(caminho, n_linha, "periodo_ms deve ser positivo"); }
+				cfg.periodo = std::chrono::milliseconds(ms);
+			}
+			else if( chave == "cerca" ){
+
+				Geofence c;
+				if( !(valor >> c.nome >> c.lat >> c.lon >> c.raio_m) ){ erro(caminho, n_linha, "cerca deve ser: nome lat lon raio_m"); }
+				cfg.cercas.push_back(c);
+			}
+			else{ erro(caminho, n_linha, "chave desconhecida '" + chave + "'"); }
+		}
+
+		if( cfg.destinos.empty() ){ throw std::runtime_error("\033[1;31mConfiguração sem destino: " + caminho + "\033[0m"); }
+
+		return cfg;
+	}
+
+private:
+
+	static std::string
+	trim(
+		const std::string& s
+	){
+
+		std::size_t ini = s.find_first_not_of(" \t\r");
+		std::size_t fim = s.find_last_not_of(" \t\r");
+		return ini == std::string::npos ? "" : s.substr(ini, fim - ini + 1);
+	}
+
+	[[noreturn]] static void
+	erro(
+		const std::string& caminho,
+		int n_linha,
+		const std::string& motivo
+	){
+
+		throw std::runtime_error("\033[1;31mErro em " + caminho + ":" + std::to_string(n_linha) + ": " + motivo + "\033[0m");
+	}
+};
+
+#endif // GPSCONFIG_HPP
@@ -0,0 +1,383 @@
+/**
+ * @file GPSControl.hpp
+ * @brief Socket Unix de controle para consultas e comandos a um GPSTrack em execução.
+ * @details
+ * Substitui a necessidade de acessar a placa por SSH e ler a saída padrão. O atendimento
+ * ocorre em thread própria, de baixa prioridade, que apenas lê estados publicados sem lock
+ * ou sinaliza a thread worker.
+ */
+#ifndef GPSCONTROL_HPP
+#define GPSCONTROL_HPP
+
+//-------------------------------------------------
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cstring>
+
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+// Específicos de Sistemas Linux
+#include <poll.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "GPSTrack.hpp"
+
+/**
+ * @class GPSHistory
+ * @brief Anel de fixes recentes, escrito pela worker e lido sem lock.
+ * @details
+ *
+ * Cada posição do anel é um SeqLock, de modo que a escrita nunca espera e a leitura
+ * apenas descarta posições sobrescritas durante a cópia.
+ */
+class GPSHistory {
+	std::unique_ptr<SeqLock<GPSFix>[]> slots;
+	std::size_t                     capacidade;
+	std::atomic<uint64_t>              total{0};
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade_ Quantidade de fixes mantidos.
+	 */
+	explicit GPSHistory(
+		std::size_t capacidade_
+	) : slots(new SeqLock<GPSFix>[capacidade_]),
+		capacidade(capacidade_) {}
+
+	/**
+	 * @brief Acrescenta um fix. Deve ser chamada por um único escritor.
+	 */
+	void
+	push(
+		const GPSFix& fix
+	){
+
+		uint64_t n = total.load(std::memory_order_relaxed);
+		slots[n % capacidade].store(fix);
+		total.store(n + 1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Quantidade de fixes atualmente retidos.
+	 */
+	std::size_t
+	size() const {
+
+		uint64_t n = total.load(std::memory_order_acquire);
+		return n < capacidade ? n : capacidade;
+	}
+
+	/**
+	 * @brief Obtém, em ordem de chegada, os fixes com horário UTC dentro do intervalo.
+	 * @param utc_ini Início do intervalo em segundos desde 00:00 UTC.
+	 * @param utc_fim Fim do intervalo em segundos desde 00:00 UTC.
+	 */
+	std::vector<GPSFix>
+	range(
+		double utc_ini,
+		double utc_fim
+	) const {
+
+		std::vector<GPSFix> saida;
+
+		uint64_t n   = total.load(std::memory_order_acquire);
+		uint64_t ini = n > capacidade ? n - capacidade : 0;
+		for(
+			uint64_t i = ini; i < n; i++
+		){
+
+			GPSFix fix;
+			if( !slots[i % capacidade].load(fix) ){ continue; }
+			if( fix.utc >= utc_ini && fix.utc <= utc_fim ){ saida.push_back(fix); }
+		}
+
+		return saida;
+	}
+};
+
+/**
+ * @class GPSControl
+ * @brief Servidor de controle local sobre socket Unix (SOCK_STREAM).
+ * @details
+ *
+ * Protocolo textual, uma requisição por linha, resposta terminada por uma linha "FIM":
+ *
+ * - `status`                  : estado, destinos, período e cercas
+ * - `metrics`                 : contadores de operação
+ * - `fix`                     : último fix
+ * - `spool`                   : profundidade da fila de envio
+ * - `history <hhmmss> <hhmmss>`: fixes retidos no intervalo de horário UTC
+ * - `flush`                   : reenvia imediatamente o último CSV
+ * - `rate <ms>`               : altera o período de operação
+ *
+ * Clientes são atendidos sequencialmente, com timeout de leitura, por uma thread com
+ * prioridade mínima (nice 19). Nenhuma operação adquire lock da thread worker.
+ *
+ * Exemplo: `echo status | socat - UNIX-CONNECT:/tmp/gpstrack.sock`.
+ */
+class GPSControl {
+private:
+
+	GPSTrack&                      track;
+	std::string                  caminho;
+	int                       fd_escuta = -1;
+	int                      id_assinante = 0;
+
+	GPSHistory                   historico;
+
+	std::thread                   worker;
+	std::atomic<bool>      is_exec{false};
+
+	/**
+	 * @brief Formata um fix em uma linha de resposta.
+	 */
+	static void
+	write_fix(
+		std::ostringstream& oss,
+		const GPSFix& fix
+	){
+
+		int hh = static_cast<int>(fix.utc / 3600);
+		int mm = static_cast<int>(fix.utc / 60) % 60;
+		double ss = fix.utc - hh * 3600 - mm * 60;
+
+		oss << fix.seq << ","
+			<< std::setw(2) << std::setfill('0') << hh
+			<< std::setw(2) << std::setfill('0') << mm
+			<< std::fixed << std::setprecision(2) << std::setw(5) << std::setfill('0') << ss << ","
+			<< std::setprecision(6) << fix.lat << "," << fix.lon << ","
+			<< std::setprecision(1) << fix.alt << "\n";
+	}
+
+	/**
+	 * @brief Interpreta uma requisição e produz a resposta.
+	 * @param requisicao Linha recebida, sem quebra de linha.
+	 * @return Resposta a ser enviada ao cliente.
+	 */
+	std::string
+	handle(
+		const std::string& requisicao
+	){
+
+		std::istringstream entrada(requisicao);
+		std::string comando;
+		entrada >> comando;
+
+		std::ostringstream oss;
+		if( comando == "status" ){
+
+			GPSConfig cfg = track.configuration();
+			GPSTrack::Metrics m = track.metrics();
+
+			oss << "executando " << (m.executando ? "sim" : "nao") << "\n"
+				<< "uptime_s "   << std::fixed << std::setprecision(1) << m.uptime_s << "\n"
+				<< "serial "     << cfg.serial << "\n"
+				<< "periodo_ms " << cfg.periodo.count() << "\n";
+			for( const auto& d : cfg.destinos ){ oss << "destino " << d.ip << ":" << d.porta << "\n"; }
+			for( const auto& c : cfg.cercas ){ oss << "cerca " << c.nome << " " << c.lat << " " << c.lon << " " << c.raio_m << "\n"; }
+		}
+		else if( comando == "metrics" ){
+
+			GPSTrack::Metrics m = track.metrics();
+			oss << "linhas "      << m.linhas      << "\n"
+				<< "fixes "       << m.fixes       << "\n"
+				<< "enviados "    << m.enviados    << "\n"
+				<< "erros_envio " << m.erros_envio << "\n"
+				<< "historico "   << historico.size() << "\n";
+		}
+		else if( comando == "fix" ){
+
+			GPSFix fix;
+			if( track.latest_fix(fix) ){ write_fix(oss, fix); }
+			else{ oss << "ERRO sem fix\n"; }
+		}
+		else if( comando == "spool" ){
+
+			// O envio UDP é imediato; não há fila de pendentes no dispositivo.
+			oss << "spool 0\n";
+		}
+		else if( comando == "history" ){
+
+			std::string ini, fim;
+			double t_ini, t_fim;
+			if( !(entrada >> ini >> fim) || !GPSFix::utc_to_seconds(ini, t_ini) || !GPSFix::utc_to_seconds(fim, t_fim) ){
+
+				oss << "ERRO uso: history <hhmmss> <hhmmss>\n";
+			}
+			else{
+
+				for( const auto& fix : historico.range(t_ini, t_fim) ){ write_fix(oss, fix); }
+			}
+		}
+		else if( comando == "flush" ){
+
+			track.flush();
+			oss << "OK\n";
+		}
+		else if( comando == "rate" ){
+
+			long ms = 0;
+			if( !(entrada >> ms) || ms <= 0 ){ oss << "ERRO uso: rate <ms>\n"; }
+			else{
+
+				track.set_period(std::chrono::milliseconds(ms));
+				oss << "OK\n";
+			}
+		}
+		else{ oss << "ERRO comando desconhecido: " << comando << "\n"; }
+
+		oss << "FIM\n";
+		return oss.str();
+	}
+
+	/**
+	 * @brief Atende um cliente até que ele encerre a conexão ou exceda o timeout.
+	 */
+	void
+	serve(
+		int fd_cliente
+	){
+
+		timeval timeout{2, 0};
+		::setsockopt(fd_cliente, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		::setsockopt(fd_cliente, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		std::string pendente;
+		char buffer[256];
+		while(
+			is_exec
+		){
+
+			ssize_t n = ::recv(fd_cliente, buffer, sizeof(buffer), 0);
+			if( n <= 0 ){ break; }
+
+			pendente.append(buffer, n);
+			if( pendente.size() > 4096 ){ break; } // Requisição absurda
+
+			std::size_t pos;
+			while( (pos = pendente.find('\n')) != std::string::npos ){
+
+				std::string linha = pendente.substr(0, pos);
+				pendente.erase(0, pos + 1);
+				if( !linha.empty() && linha.back() == '\r' ){ linha.pop_back(); }
+				if( linha.empty() ){ continue; }
+
+				std::string resposta = handle(linha);
+				if( ::send(fd_cliente, resposta.data(), resposta.size(), MSG_NOSIGNAL) < 0 ){ return; }
+			}
+		}
+	}
+
+	/**
+	 * @brief Loop de aceitação de clientes.
+	 * @details
+	 *
+	 * Reduz a própria prioridade antes de atender, para nunca competir com a aquisição.
+	 */
+	void
+	loop(){
+
+		::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+
+		while(
+			is_exec
+		){
+
+			pollfd pfd{fd_escuta, POLLIN, 0};
+			if( ::poll(&pfd, 1, 200) <= 0 ){ continue; }
+
+			int fd_cliente = ::accept(fd_escuta, nullptr, nullptr);
+			if( fd_cliente < 0 ){ continue; }
+
+			serve(fd_cliente);
+			::close(fd_cliente);
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param track_ Rastreador a ser observado e controlado.
+	 * @param caminho_ Caminho do socket Unix. Um arquivo antigo no mesmo caminho é removido.
+	 * @param capacidade_historico Quantidade de fixes retidos para consultas `history`.
+	 */
+	GPSControl(
+		GPSTrack& track_,
+		const std::string& caminho_,
+		std::size_t capacidade_historico = 3600
+	) : track(track_),
+		caminho(caminho_),
+		historico(capacidade_historico)
+	{
+
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		if( caminho.size() >= sizeof(addr.sun_path) ){ throw std::runtime_error("\033[1;31mCaminho do socket de controle muito longo\033[0m"); }
+		std::strncpy(addr.sun_path, caminho.c_str(), sizeof(addr.sun_path) - 1);
+
+		fd_escuta = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if( fd_escuta < 0 ){ throw std::runtime_error("\033[1;31mErro ao criar socket de controle\033[0m"); }
+
+		::unlink(caminho.c_str());
+		if(
+			::bind(fd_escuta, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+			::listen(fd_escuta, 4) != 0
+		){
+			::close(fd_escuta);
+			throw std::runtime_error("\033[1;31mErro ao associar socket de controle em " + caminho + "\033[0m");
+		}
+
+		id_assinante = track.subscribe([this](const GPSFix& fix){ historico.push(fix); });
+	}
+
+	/**
+	 * @brief Destrutor. Encerra a thread, remove o assinante e o arquivo do socket.
+	 */
+	~GPSControl(){
+
+		stop();
+		track.unsubscribe(id_assinante);
+		::close(fd_escuta);
+		::unlink(caminho.c_str());
+	}
+
+	/**
+	 * @brief Inicializa a thread de atendimento.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		std::cout << "\033[1;32mSocket de controle em " << caminho << "\033[0m" << std::endl;
+		worker = std::thread(
+							  [this]{ loop(); }
+							 );
+	}
+
+	/**
+	 * @brief Finaliza a thread de atendimento.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		if( worker.joinable() ){ worker.join(); }
+	}
+};
+
+#endif // GPSCONTROL_HPP
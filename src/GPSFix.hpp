@@ -0,0 +1,84 @@
+/**
+ * @file GPSFix.hpp
+ * @brief Representação numérica de uma posição obtida pelo GPS.
+ * @details
+ * Enquanto GPSTrack::GPSData mantém os campos como texto para gerar o CSV,
+ * consumidores internos precisam dos valores já convertidos. Esta estrutura
+ * é trivialmente copiável, podendo ser publicada sem alocações.
+ */
+#ifndef GPSFIX_HPP
+#define GPSFIX_HPP
+
+//-------------------------------------------------
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+
+/**
+ * @struct GPSFix
+ * @brief Posição interpretada de uma sentença GGA.
+ */
+struct GPSFix {
+	double   utc = 0; ///< Segundos desde 00:00 UTC.
+	double   lat = 0; ///< Latitude em graus decimais.
+	double   lon = 0; ///< Longitude em graus decimais.
+	double   alt = 0; ///< Altitude em metros.
+	uint64_t seq = 0; ///< Número sequencial do fix dentro do processo.
+
+	/**
+	 * @brief Converte o horário no formato hhmmss.ss para segundos desde 00:00 UTC.
+	 * @param hhmmss String no formato NMEA de horário.
+	 * @param[out] segundos Valor convertido.
+	 * @return False caso a string seja inválida. True, caso contrário.
+	 */
+	static bool
+	utc_to_seconds(
+		const std::string& hhmmss,
+		double& segundos
+	){
+
+		if( hhmmss.size() < 6 ){ return false; }
+
+		char* fim = nullptr;
+		double valor = std::strtod(hhmmss.c_str(), &fim);
+		if( fim == hhmmss.c_str() ){ return false; }
+
+		int hh = static_cast<int>(valor / 10000);
+		int mm = static_cast<int>(valor / 100) % 100;
+		double ss = valor - hh * 10000 - mm * 100;
+
+		segundos = hh * 3600.0 + mm * 60.0 + ss;
+		return true;
+	}
+
+	/**
+	 * @brief Distância sobre a superfície terrestre pela fórmula de haversine.
+	 * @param lat1 Latitude do primeiro ponto em graus decimais.
+	 * @param lon1 Longitude do primeiro ponto em graus decimais.
+	 * @param lat2 Latitude do segundo ponto em graus decimais.
+	 * @param lon2 Longitude do segundo ponto em graus decimais.
+	 * @return Distância em metros.
+	 */
+	static double
+	distance_m(
+		double lat1,
+		double lon1,
+		double lat2,
+		double lon2
+	){
+
+		constexpr double RAIO_TERRA = 6371000.0;
+		constexpr double RAD        = M_PI / 180.0;
+
+		double dlat = (lat2 - lat1) * RAD;
+		double dlon = (lon2 - lon1) * RAD;
+		double a = std::sin(dlat / 2) * std::sin(dlat / 2) +
+				   std::cos(lat1 * RAD) * std::cos(lat2 * RAD) * std::sin(dlon / 2) * std::sin(dlon / 2);
+
+		return 2 * RAIO_TERRA * std::asin(std::sqrt(std::min(1.0, a)));
+	}
+};
+
+#endif // GPSFIX_HPP
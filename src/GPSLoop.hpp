@@ -0,0 +1,475 @@
+/**
+ * @file GPSLoop.hpp
+ * @brief Executor de corrotinas C++20 sobre epoll, de thread única.
+ * @details
+ * Alternativa opcional ao desenho de uma thread bloqueante por atividade. Leitura serial,
+ * envio UDP e temporizadores tornam-se awaitables, permitindo que uma única thread conduza
+ * todas as atividades do rastreador.
+ *
+ * Só está disponível quando compilado com suporte a corrotinas (-std=c++20). Nesse caso,
+ * a macro GPSLOOP_DISPONIVEL é definida.
+ */
+#ifndef GPSLOOP_HPP
+#define GPSLOOP_HPP
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define GPSLOOP_DISPONIVEL 1
+
+//-------------------------------------------------
+#include <coroutine>
+#include <chrono>
+#include <queue>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <exception>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <stdexcept>
+
+// Específicos de Sistemas Linux
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/**
+ * @class GPSLoop
+ * @brief Laço de eventos que retoma corrotinas quando descritores ou temporizadores ficam prontos.
+ * @details
+ *
+ * Fluxo de funcionamento:
+ *
+ * - Corrotinas do tipo Task iniciam imediatamente e seguem até o primeiro co_await.
+ * - readable() e writable() registram o descritor no epoll em modo one-shot.
+ * - sleep_for() insere a corrotina em um heap de temporizadores.
+ * - run() arma um timerfd para o próximo prazo, aguarda no epoll_wait e retoma as
+ *   corrotinas prontas, até stop() ser chamado ou não haver mais nada a esperar.
+ *   O timerfd garante resolução abaixo do milissegundo do timeout do epoll_wait.
+ *
+ * Várias corrotinas podem aguardar o mesmo descritor (por exemplo, envios à espera de
+ * espaço no buffer do socket): o descritor é armado com a união dos eventos pedidos, e cada
+ * evento retoma todas as que o aguardavam, rearmando para as demais.
+ *
+ * stop() e cancel() podem ser chamados de outra thread; um eventfd acorda o epoll_wait.
+ */
+class GPSLoop {
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @class Task
+	 * @brief Corrotina destacada (fire-and-forget), liberada ao terminar.
+	 */
+	struct Task {
+		struct promise_type {
+			Task                get_return_object(){ return {}; }
+			std::suspend_never  initial_suspend() noexcept { return {}; }
+			std::suspend_never  final_suspend()   noexcept { return {}; }
+			void                return_void(){}
+			void
+			unhandled_exception(){
+
+				try { std::rethrow_exception(std::current_exception()); }
+				catch (std::exception& e) {
+
+					std::cout << "\033[1;31mErro em corrotina do GPSLoop: \033[0m"
+							  << e.what()
+							  << std::endl;
+				}
+			}
+		};
+	};
+
+private:
+
+	struct Temporizador {
+		Clock::time_point       prazo;
+		uint64_t                ordem;
+		std::coroutine_handle<> h;
+
+		bool operator>(const Temporizador& o) const { return prazo != o.prazo ? prazo > o.prazo : ordem > o.ordem; }
+	};
+
+	struct EsperaFd {
+		std::coroutine_handle<> h;
+		uint32_t                interesse; ///< Eventos pedidos.
+		uint32_t*               recebidos; ///< Eventos retornados pelo epoll, no awaitable.
+	};
+
+	int                    fd_epoll = -1;
+	int                    fd_acorda = -1;
+	int                    fd_tempo  = -1;
+	std::atomic<bool>      is_exec{false};
+
+	std::priority_queue<Temporizador, std::vector<Temporizador>, std::greater<Temporizador>> temporizadores;
+	uint64_t                                                   ordem_temporizador = 0;
+	std::unordered_map<int, std::vector<EsperaFd>>                          esperas;
+	std::deque<std::coroutine_handle<>>                                      prontos;
+
+	std::mutex             mtx_cancelados;
+	std::vector<int>       cancelados;         ///< Pedidos de cancel() de outras threads.
+	bool                   em_execucao = false; ///< run() em andamento; protegido por mtx_cancelados.
+	std::thread::id        dono;               ///< Thread de run().
+
+	/**
+	 * @brief Arma o descritor no epoll com a união dos eventos de suas corrotinas.
+	 */
+	void
+	arm(
+		int fd,
+		const std::vector<EsperaFd>& fila
+	){
+
+		epoll_event ev{};
+		ev.events  = EPOLLONESHOT;
+		ev.data.fd = fd;
+		for( const EsperaFd& e : fila ){ ev.events |= e.interesse; }
+
+		// Descritores já vistos permanecem no epoll, apenas desarmados pelo one-shot
+		if(
+			::epoll_ctl(fd_epoll, EPOLL_CTL_MOD, fd, &ev) != 0 &&
+			::epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev) != 0
+		){
+			throw std::runtime_error("\033[1;31mErro ao registrar descritor no epoll\033[0m");
+		}
+	}
+
+	/**
+	 * @brief Registra o interesse de uma corrotina em eventos de um descritor.
+	 */
+	void
+	watch(
+		int fd,
+		uint32_t eventos,
+		std::coroutine_handle<> h,
+		uint32_t* recebidos
+	){
+
+		std::vector<EsperaFd>& fila = esperas[fd];
+		fila.push_back(EsperaFd{h, eventos, recebidos});
+		try { arm(fd, fila); }
+		catch (...) {
+
+			fila.pop_back();
+			if( fila.empty() ){ esperas.erase(fd); }
+			throw;
+		}
+	}
+
+	/**
+	 * @brief Retoma as corrotinas que aguardam `fd` com os eventos informados.
+	 * @param todas Retoma todas, independentemente dos eventos pedidos.
+	 */
+	void
+	wake(
+		int fd,
+		uint32_t eventos,
+		bool todas
+	){
+
+		auto it = esperas.find(fd);
+		if( it == esperas.end() ){ return; }
+
+		std::vector<EsperaFd> restantes;
+		for(
+			EsperaFd& e : it->second
+		){
+
+			if( !todas && !(e.interesse & eventos) ){ restantes.push_back(e); continue; }
+			*e.recebidos = eventos;
+			prontos.push_back(e.h);
+		}
+
+		if( restantes.empty() ){ esperas.erase(it); }
+		else{ it->second.swap(restantes); arm(fd, it->second); }
+	}
+
+	/**
+	 * @brief Retoma as corrotinas prontas, inclusive as que ficarem prontas nesse meio tempo.
+	 */
+	void
+	resume_ready(){
+
+		while(
+			!prontos.empty()
+		){
+
+			auto h = prontos.front();
+			prontos.pop_front();
+			h.resume();
+		}
+	}
+
+	/**
+	 * @brief Atende os pedidos de cancel() feitos por outras threads.
+	 */
+	void
+	cancel_pending(){
+
+		std::vector<int> fds;
+		{
+			std::lock_guard<std::mutex> lock(mtx_cancelados);
+			fds.swap(cancelados);
+		}
+		for( int fd : fds ){ ::epoll_ctl(fd_epoll, EPOLL_CTL_DEL, fd, nullptr); wake(fd, EPOLLHUP, true); }
+	}
+
+	/**
+	 * @brief Awaitable de prontidão de descritor.
+	 */
+	struct AwaitFd {
+		GPSLoop& loop;
+		int      fd;
+		uint32_t eventos;
+		uint32_t recebidos = 0;
+
+		bool     await_ready() const noexcept { return false; }
+		void     await_suspend(std::coroutine_handle<> h){ loop.watch(fd, eventos, h, &recebidos); }
+		uint32_t await_resume() const noexcept { return recebidos; }
+	};
+
+	/**
+	 * @brief Awaitable de temporizador.
+	 */
+	struct AwaitTempo {
+		GPSLoop&          loop;
+		Clock::time_point prazo;
+
+		bool await_ready() const noexcept { return prazo <= Clock::now(); }
+		void
+		await_suspend(
+			std::coroutine_handle<> h
+		){ loop.temporizadores.push(Temporizador{prazo, loop.ordem_temporizador++, h}); }
+		void await_resume() const noexcept {}
+	};
+
+public:
+
+	/**
+	 * @brief Construtor. Cria a instância epoll e o eventfd de despertar.
+	 */
+	GPSLoop(){
+
+		fd_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if( fd_epoll < 0 ){ throw std::runtime_error("\033[1;31mErro ao criar epoll\033[0m"); }
+
+		fd_acorda = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if( fd_acorda < 0 ){ ::close(fd_epoll); throw std::runtime_error("\033[1;31mErro ao criar eventfd\033[0m"); }
+
+		fd_tempo = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if( fd_tempo < 0 ){ ::close(fd_acorda); ::close(fd_epoll); throw std::runtime_error("\033[1;31mErro ao criar timerfd\033[0m"); }
+
+		for(
+			int fd : {fd_acorda, fd_tempo}
+		){
+
+			epoll_event ev{};
+			ev.events  = EPOLLIN;
+			ev.data.fd = fd;
+			::epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev);
+		}
+	}
+
+	/**
+	 * @brief Destrutor. Libera corrotinas ainda suspensas e fecha os descritores.
+	 */
+	~GPSLoop(){
+
+		for( auto& [fd, fila] : esperas ){ for( EsperaFd& e : fila ){ e.h.destroy(); } }
+		while( !temporizadores.empty() ){ temporizadores.top().h.destroy(); temporizadores.pop(); }
+		for( auto h : prontos ){ h.destroy(); }
+
+		::close(fd_tempo);
+		::close(fd_acorda);
+		::close(fd_epoll);
+	}
+
+	GPSLoop(const GPSLoop&)            = delete;
+	GPSLoop& operator=(const GPSLoop&) = delete;
+
+	/**
+	 * @brief Aguarda o descritor ficar disponível para leitura.
+	 * @return Eventos reportados pelo epoll (EPOLLIN, EPOLLERR, EPOLLHUP...).
+	 */
+	AwaitFd readable(int fd){ return AwaitFd{*this, fd, EPOLLIN}; }
+
+	/**
+	 * @brief Aguarda o descritor ficar disponível para escrita.
+	 */
+	AwaitFd writable(int fd){ return AwaitFd{*this, fd, EPOLLOUT}; }
+
+	/**
+	 * @brief Suspende a corrotina pelo intervalo informado.
+	 */
+	template <typename Rep, typename Period>
+	AwaitTempo
+	sleep_for(
+		std::chrono::duration<Rep, Period> intervalo
+	){ return AwaitTempo{*this, Clock::now() + std::chrono::duration_cast<Clock::duration>(intervalo)}; }
+
+	/**
+	 * @brief Suspende a corrotina até o instante informado.
+	 */
+	AwaitTempo sleep_until(Clock::time_point prazo){ return AwaitTempo{*this, prazo}; }
+
+	/**
+	 * @brief Esquece um descritor, normalmente antes de fechá-lo.
+	 * @details
+	 *
+	 * Corrotinas que ainda o aguardem são destruídas sem serem retomadas.
+	 */
+	void
+	forget(
+		int fd
+	){
+
+		::epoll_ctl(fd_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		auto it = esperas.find(fd);
+		if( it != esperas.end() ){
+
+			std::vector<EsperaFd> fila;
+			fila.swap(it->second);
+			esperas.erase(it);
+			for( EsperaFd& e : fila ){ e.h.destroy(); }
+		}
+	}
+
+	/**
+	 * @brief Retoma todas as corrotinas que aguardam `fd`, com EPOLLHUP, e o retira do epoll.
+	 * @details
+	 *
+	 * Pode ser chamada de qualquer thread. Com run() em andamento em outra thread, o pedido
+	 * é atendido por ela; caso contrário, as corrotinas são retomadas antes do retorno. É o
+	 * meio de encerrar corrotinas suspensas antes de fechar o descritor ou liberar os objetos
+	 * que elas referenciam.
+	 */
+	void
+	cancel(
+		int fd
+	){
+
+		{
+			std::lock_guard<std::mutex> lock(mtx_cancelados);
+			if(
+				em_execucao && std::this_thread::get_id() != dono
+			){
+
+				cancelados.push_back(fd);
+				uint64_t um = 1;
+				(void)!::write(fd_acorda, &um, sizeof(um));
+				return;
+			}
+		}
+
+		::epoll_ctl(fd_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		wake(fd, EPOLLHUP, true);
+		resume_ready();
+	}
+
+	/**
+	 * @brief Indica se a thread chamadora é a que executa run().
+	 */
+	bool
+	in_loop_thread(){
+
+		std::lock_guard<std::mutex> lock(mtx_cancelados);
+		return em_execucao && std::this_thread::get_id() == dono;
+	}
+
+	/**
+	 * @brief Executa o laço de eventos na thread chamadora.
+	 * @details
+	 *
+	 * Retorna quando stop() é chamado ou quando não há corrotinas esperando.
+	 */
+	void
+	run(){
+
+		is_exec = true;
+		{
+			std::lock_guard<std::mutex> lock(mtx_cancelados);
+			em_execucao = true;
+			dono        = std::this_thread::get_id();
+		}
+
+		epoll_event eventos[32];
+		while(
+			is_exec
+		){
+
+			// Corrotinas prontas são retomadas primeiro
+			resume_ready();
+
+			auto agora = Clock::now();
+			while( !temporizadores.empty() && temporizadores.top().prazo <= agora ){
+
+				auto h = temporizadores.top().h;
+				temporizadores.pop();
+				h.resume();
+			}
+
+			if( !is_exec ){ break; }
+			if( temporizadores.empty() && esperas.empty() && prontos.empty() ){ break; }
+			if( !prontos.empty() ){ continue; }
+
+			// steady_clock corresponde ao CLOCK_MONOTONIC no Linux
+			itimerspec prazo{};
+			if( !temporizadores.empty() ){
+
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(temporizadores.top().prazo.time_since_epoch()).count();
+				prazo.it_value.tv_sec  = ns / 1000000000;
+				prazo.it_value.tv_nsec = ns % 1000000000;
+				if( prazo.it_value.tv_sec == 0 && prazo.it_value.tv_nsec == 0 ){ prazo.it_value.tv_nsec = 1; }
+			}
+			::timerfd_settime(fd_tempo, TFD_TIMER_ABSTIME, &prazo, nullptr);
+
+			int n = ::epoll_wait(fd_epoll, eventos, 32, -1);
+			for(
+				int i = 0; i < n; i++
+			){
+
+				int fd = eventos[i].data.fd;
+				if( fd == fd_acorda || fd == fd_tempo ){
+
+					uint64_t lixo;
+					(void)!::read(fd, &lixo, sizeof(lixo));
+					if( fd == fd_acorda ){ cancel_pending(); }
+					continue;
+				}
+
+				// Erros e desconexões interessam a todas as corrotinas do descritor
+				wake(fd, eventos[i].events, eventos[i].events & (EPOLLERR | EPOLLHUP));
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mtx_cancelados);
+			em_execucao = false;
+		}
+		is_exec = false;
+
+		// Pedidos que chegaram depois da última volta
+		cancel_pending();
+		resume_ready();
+	}
+
+	/**
+	 * @brief Solicita o término de run(). Pode ser chamada de qualquer thread.
+	 */
+	void
+	stop(){
+
+		is_exec = false;
+		uint64_t um = 1;
+		(void)!::write(fd_acorda, &um, sizeof(um));
+	}
+};
+
+#endif // __cpp_impl_coroutine
+#endif // GPSLOOP_HPP
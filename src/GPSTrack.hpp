@@ -8,7 +8,9 @@
 
 //-------------------------------------------------
 #include <string>
+#include <string_view>
 #include <vector>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -22,6 +24,7 @@
 #include <atomic>
  
 #include <stdexcept>
+#include <cerrno>
 
 // Específicos de Sistemas Linux
 #include <fcntl.h>
@@ -31,6 +34,11 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
+#include "Arena.hpp"
+#include "GPSBus.hpp"
+#include "GPSConfig.hpp"
+#include "GPSLoop.hpp"
+
 /**
  * @class GPSTrack
  * @brief Classe responsável por obter o tracking da carga.
@@ -49,6 +57,9 @@
  * Os quais estarão sendo repetidamente executados pela thread worker a fim de manter a
  * continuidade de informações. 
  * 
+ * Aplicações que embarcam a classe podem consumir os fixes diretamente por subscribe()
+ * ou latest_fix(), sem precisar interpretar os datagramas UDP.
+ * 
  * Não há necessidade de mais explicações, já que o fluxo de funcionamento é simples.
  */
 class GPSTrack {
@@ -108,35 +119,45 @@ public:
 		 * @brief Construtor Default
 		 * @details
 		 * 
-		 * Reserva no vetor de dados 4 strings, respectivamente para horário UTC, latitude,
-		 * longitude e altitude.	
+		 * Cria no vetor de dados 4 strings, respectivamente para horário UTC, latitude,
+		 * longitude e altitude. As strings são reaproveitadas a cada interpretação, de modo
+		 * que, após as primeiras sentenças, nenhuma memória nova é alocada.
 		 */
-		GPSData(){ data.reserve(4); }
+		GPSData() : data(4) {}
 
 		/**
-		 * @brief Função estática auxiliar para converter coordenadas NMEA (latitude/longitude) para graus decimais.
-		 * @param string_numerica  String com a coordenada em formato NMEA (ex: "2257.34613").
-		 * @param string_hemisf String com o hemisfério correspondente ("N", "S", "E", "W").
-		 * @return String coordenada em graus decimais (negativa para hemisférios Sul e Oeste).
+		 * @brief Converte coordenadas NMEA para graus decimais, escrevendo em uma string existente.
+		 * @param string_numerica  Coordenada em formato NMEA (ex: "2257.34613").
+		 * @param string_hemisf Hemisfério correspondente ("N", "S", "E", "W").
+		 * @param[out] saida Coordenada em graus decimais com 6 casas, como std::to_string.
+		 * @details
+		 * 
+		 * Não realiza alocações caso a capacidade de saida seja suficiente.
 		 */
-		static std::string 
+		static void
 		converter_lat_lon(
-			const std::string& string_numerica,
-			const std::string& string_hemisf
+			std::string_view string_numerica,
+			std::string_view string_hemisf,
+			std::string& saida
 		){
 
-			if( string_numerica.empty() ){ return ""; }
-			
-			double valor_cru = 0;
-			try {
+			saida.clear();
+			if( string_numerica.empty() ){ return; }
 
-				valor_cru = std::stod(string_numerica);
-			}
-			catch (std::invalid_argument&) {
+			// strtod exige terminação nula
+			char numero[32];
+			std::size_t n = std::min(string_numerica.size(), sizeof(numero) - 1);
+			std::memcpy(numero, string_numerica.data(), n);
+			numero[n] = '\0';
+
+			char* fim = nullptr;
+			double valor_cru = std::strtod(numero, &fim);
+			if( fim == numero ){
 
 				std::cout << "\033[1;31mErro dentro de converter_lat_lon, valor inválido para stod: \033[0m"
-						  << string_numerica
+						  << numero
 						  << std::endl;
+				valor_cru = 0;
 			}
 
 			// Parsing dos valores
@@ -144,13 +165,32 @@ public:
 			double minutos = valor_cru - graus * 100;
 			double coordenada = (graus + minutos / 60.0) * ( (string_hemisf == "S" || string_hemisf == "W" ) ? -1 : 1 );
 
-			return std::to_string(coordenada);
+			char texto[32];
+			int tam = std::snprintf(texto, sizeof(texto), "%f", coordenada);
+			saida.assign(texto, tam);
+		}
+
+		/**
+		 * @brief Função estática auxiliar para converter coordenadas NMEA (latitude/longitude) para graus decimais.
+		 * @param string_numerica  String com a coordenada em formato NMEA (ex: "2257.34613").
+		 * @param string_hemisf String com o hemisfério correspondente ("N", "S", "E", "W").
+		 * @return String coordenada em graus decimais (negativa para hemisférios Sul e Oeste).
+		 */
+		static std::string 
+		converter_lat_lon(
+			const std::string& string_numerica,
+			const std::string& string_hemisf
+		){
+
+			std::string saida;
+			converter_lat_lon(std::string_view(string_numerica), std::string_view(string_hemisf), saida);
+			return saida;
 		}
 
 		/**
 		 * @brief Setará os dados baseado no padrão de mensagem recebido.
 		 * @param code_pattern Código para informar que padrão de mensagem recebeu.
-		 * @param data_splitted Vetor de dados da mensagem recebida.
+		 * @param data_splitted Campos da mensagem recebida (std::string ou std::string_view).
 		 * @return Retornará true caso seja bem sucedido. False, caso contrário.
 		 * @details
 		 * 
@@ -159,14 +199,16 @@ public:
 		 * - 0 == GPGGA
 		 * 
 		 * A partir do padrão de mensagem recebida, organizaremos o vetor com dados relevantes.		
+		 * Aceita qualquer contêiner indexável, em especial os campos fatiados na Arena da época.
 		 */
+		template <typename Campos>
 		bool
 		parsing(
 			int code_pattern,
-			const std::vector<std::string>& data_splitted
+			const Campos& data_splitted
 		){
 
-			data.clear(); // Garantimos que está limpo.
+			for( auto& campo : data ){ campo.clear(); } // Garantimos que está limpo.
 
 			if(
 				code_pattern == 0
@@ -180,25 +222,26 @@ public:
 										9  // Altitude
 										};
 
+				if( data_splitted.size() < 10 ){ return false; } // Sentença incompleta
+
+				int pos = 0;
 				for(
 					const auto& idx : idx_data_useful
 				){
 
 					if( idx == 2 || idx == 4 ){
-						data.emplace_back(
-										 std::move(converter_lat_lon(
-										 							data_splitted[idx],
-										 							data_splitted[idx + 1]
-										 							))
+						converter_lat_lon(
+										 std::string_view(data_splitted[idx]),
+										 std::string_view(data_splitted[idx + 1]),
+										 data[pos]
 										 );
 					}
 					else{
-						// Então basta adicionar
-						data.emplace_back(
-										 // Método bizurado para não realizarmos cópias
-										 std::move(data_splitted[idx])
-										 );
+						// Então basta copiar, reaproveitando a capacidade da string
+						std::string_view campo(data_splitted[idx]);
+						data[pos].assign(campo.data(), campo.size());
 					}
+					pos++;
 				}
 
 				return true;
@@ -208,6 +251,60 @@ public:
 			return false;
 		}
 
+		/**
+		 * @brief Converte os dados armazenados para a representação numérica.
+		 * @param[out] fix Estrutura preenchida com horário, latitude, longitude e altitude.
+		 * @return False caso algum campo esteja vazio ou inválido. True, caso contrário.
+		 */
+		bool
+		to_fix(
+			GPSFix& fix
+		) const {
+
+			if( data.size() < 4 ){ return false; }
+
+			if( !GPSFix::utc_to_seconds(data[0], fix.utc) ){ return false; }
+
+			double* destinos[] = { &fix.lat, &fix.lon, &fix.alt };
+			for(
+				int i = 0; i < 3; i++
+			){
+
+				const std::string& campo = data[i + 1];
+				char* fim = nullptr;
+				*destinos[i] = std::strtod(campo.c_str(), &fim);
+				if( campo.empty() || fim == campo.c_str() ){ return false; }
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief Escreve os dados armazenados em formato CSV numa string existente.
+		 * @param[out] saida Linha CSV com os valores, terminada em '\\n'.
+		 * @details
+		 * 
+		 * Não realiza alocações caso a capacidade de saida seja suficiente.
+		 */
+		void
+		to_csv(
+			std::string& saida
+		) const {
+
+			saida.clear();
+			for (
+				int i = 0; 
+					i < 4; 
+					i++
+			){
+				if(i > 0){ saida += ','; }
+
+				saida += data[i];
+			}
+
+			saida += '\n';
+		}
+
 		/**
 		 * @brief Retorna os dados armazenados em formato CSV.
 		 * @return std::string Linha CSV com os valores.
@@ -215,20 +312,9 @@ public:
 		std::string 
 		to_csv() const {
 
-		    std::ostringstream oss;
-		    for (
-		    	int i = 0; 
-	    		    i < 4; 
-	    		    i++
-		    ){
-		        if(i > 0){ oss << ","; }
-
-		        oss << data[i];
-		    }
-
-		    oss << "\n";
-
-		    return oss.str();
+			std::string saida;
+			to_csv(saida);
+			return saida;
 		}
 	};
 
@@ -267,22 +353,98 @@ public:
 		return elementos;
 	}
 
+	/**
+	 * @brief Separa uma string em fatias, sem copiar os caracteres.
+	 * @param string_de_entrada String que será fatiada; deve sobreviver às fatias.
+	 * @param[out] elementos Vetor que receberá as fatias, normalmente alocado na Arena da época.
+	 * @param separador Caractere que será a flag de separação.
+	 * @details
+	 * Mesmo comportamento de split(): campos vazios são descartados.
+	 */
+	template <typename Alocador>
+	static void
+	split(
+		std::string_view string_de_entrada,
+		std::vector<std::string_view, Alocador>& elementos,
+		char separador=','
+	){
+
+		elementos.clear();
+		while(
+			!string_de_entrada.empty()
+		){
+
+			std::size_t pos = string_de_entrada.find(separador);
+			std::string_view elemento_individual = string_de_entrada.substr(0, pos);
+			if( !elemento_individual.empty() ){ elementos.push_back(elemento_individual); }
+
+			if( pos == std::string_view::npos ){ break; }
+			string_de_entrada.remove_prefix(pos + 1);
+		}
+	}
+
 private:
 	// Relacionadas ao Envio UDP
-	std::string ip_destino; 
-	int      porta_destino;
 	int             sockfd;
-	sockaddr_in  addr_dest{};
+
+	// Configuração recarregável: destinos, período e cercas
+	RCUPtr<GPSConfig>                          config;
+	std::atomic<uint64_t>             geracao_config{0}; ///< Incrementada por apply().
+	std::vector<std::pair<std::string, bool>> dentro_cercas; ///< Acessado apenas pela thread worker.
+	uint64_t                          geracao_cercas = 0; ///< Geração contra a qual dentro_cercas foi podado.
 
 	// Relacionados ao fluxo de funcionamento
 	std::thread                worker;
 	std::atomic<bool> is_exec{false};
+#ifdef GPSLOOP_DISPONIVEL
+	GPSLoop*                executor = nullptr; ///< Executor de init_async(), se houver.
+	std::atomic<uint32_t> n_corrotinas{0};      ///< Corrotinas do rastreador ainda vivas.
+
+	/// Conta uma corrotina do rastreador enquanto seu quadro existir.
+	struct Viva {
+		std::atomic<uint32_t>& n;
+		explicit Viva(std::atomic<uint32_t>& n_) : n(n_) { n++; }
+		~Viva(){ n--; }
+	};
+#endif // GPSLOOP_DISPONIVEL
 
 	// Relacionados à comunicação com o sensor
 	GPSData   last_data_given;
 	std::string  porta_serial;
 	int        fd_serial = -1;
+
+	// Relacionados aos consumidores internos
+	GPSBus                 bus;
+	uint64_t      seq_fix = 0;
+
+	// Relacionados à observação e ao controle externo
+	std::atomic<uint64_t>     n_linhas{0};
+	std::atomic<uint64_t>      n_fixes{0};
+	std::atomic<uint64_t>    n_enviados{0};
+	std::atomic<uint64_t>  n_erros_envio{0};
+	std::atomic<bool>  pedido_flush{false};
+	std::string                 ultimo_csv; ///< Acessado apenas pela thread worker.
+
+	// Memória temporária de cada época (uma sentença), descartada em bloco
+	Arena                    scratch{1024};
+	std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
 	
+	/**
+	 * @brief Monta a configuração equivalente aos argumentos de linha de comando.
+	 */
+	static GPSConfig
+	make_config(
+		const std::string& ip,
+		int porta,
+		const std::string& serial
+	){
+
+		GPSConfig cfg;
+		cfg.serial = serial;
+		cfg.add_destination(ip, porta);
+		return cfg;
+	}
+
 	/**
 	 * @brief Abre e configura a porta serial para comunicação o sensor.
 	 * @details
@@ -369,11 +531,15 @@ private:
 	 * - A função termina quando encontra '\\n' ou quando não há mais dados para ler.
 	 * - A leitura é feita caractere por caractere para garantir processamento correto
 	 * dos dados do GPS que seguem protocolo NMEA.
+	 * 
+	 * @param[out] buffer String reaproveitada entre chamadas, evitando realocações.
 	 */
-	std::string
-	read_serial(){
+	void
+	read_serial(
+		std::string& buffer
+	){
 
-		std::string buffer;
+		buffer.clear();
 		char caract = '\0';
 
 		while(
@@ -400,35 +566,152 @@ private:
 				throw std::runtime_error("\033[1;31mErro na leitura\033[0m");
 			}
 		}
-
-		return buffer;
 	}
 
 	/**
-	 * @brief Envia uma string via socket UDP para um servidor.
+	 * @brief Envia uma string via socket UDP para os destinos configurados.
 	 * @param mensagem String a ser enviada.
-	 * @return True se a mensagem foi enviada com sucesso. False, caso contrário.
+	 * @return True se a mensagem foi enviada com sucesso a todos. False, caso contrário.
 	 */
 	bool
 	send(
 		const std::string& mensagem
 	){
 
-		ssize_t bytes = ::sendto(
-								 sockfd,
-								 mensagem.c_str(),
-								 mensagem.size(),
-								 0,
-								 reinterpret_cast<struct sockaddr*>(&addr_dest),
-								 sizeof(addr_dest)
-			                     );
+		auto cfg = config.read();
 
-		if(bytes < 0){ std::cout << "Erro ao enviar" << std::endl; return false;}
+		bool sucesso = true;
+		for(
+			const auto& destino : cfg->destinos
+		){
 
-		return true;
+			ssize_t bytes = ::sendto(
+									 sockfd,
+									 mensagem.c_str(),
+									 mensagem.size(),
+									 0,
+									 reinterpret_cast<const struct sockaddr*>(&destino.addr),
+									 sizeof(destino.addr)
+				                     );
+
+			if(bytes < 0){ std::cout << "Erro ao enviar para " << destino.ip << ":" << destino.porta << std::endl; sucesso = false; n_erros_envio++; }
+			else{ n_enviados++; }
+		}
+
+		return sucesso;
+	}
+
+	/**
+	 * @brief Avalia as cercas da configuração atual e reporta entradas e saídas.
+	 * @param fix Fix recém interpretado.
+	 * @details
+	 * 
+	 * O estado anterior de cada cerca é mantido pelo nome, sobrevivendo a recargas
+	 * que apenas reordenem ou acrescentem cercas. Após uma recarga, o estado das cercas
+	 * removidas ou renomeadas é descartado: se uma cerca com o mesmo nome voltar, sua
+	 * primeira avaliação não gera evento.
+	 */
+	void
+	check_geofences(
+		const GPSFix& fix
+	){
+
+		uint64_t geracao = geracao_config.load(std::memory_order_acquire);
+		auto     cfg     = config.read();
+
+		if(
+			geracao != geracao_cercas
+		){
+
+			dentro_cercas.erase(
+								std::remove_if(
+											   dentro_cercas.begin(), dentro_cercas.end(),
+											   [&](const std::pair<std::string, bool>& e){
+
+												 for( const auto& cerca : cfg->cercas ){ if( cerca.nome == e.first ){ return false; } }
+												 return true;
+											   }
+											  ),
+								dentro_cercas.end()
+							   );
+			geracao_cercas = geracao;
+		}
+
+		for(
+			const auto& cerca : cfg->cercas
+		){
+
+			bool dentro = cerca.contains(fix.lat, fix.lon);
+
+			auto it = dentro_cercas.begin();
+			while( it != dentro_cercas.end() && it->first != cerca.nome ){ ++it; }
+
+			if( it == dentro_cercas.end() ){ dentro_cercas.emplace_back(cerca.nome, dentro); continue; }
+			if( it->second == dentro ){ continue; }
+
+			it->second = dentro;
+			std::cout << "\033[1;33m[CERCA] " << (dentro ? "Entrada em " : "Saída de ") << cerca.nome << "\033[0m" << std::endl;
+		}
 	}
 
 
+	/**
+	 * @brief Interpreta uma sentença lida da serial.
+	 * @param mensagem Sentença NMEA sem os caracteres de fim de linha.
+	 * @param[out] csv Linha CSV a ser enviada, caso haja interpretação.
+	 * @return True caso a sentença tenha gerado um fix. False, caso contrário.
+	 * @details
+	 * 
+	 * Cada fix válido é também entregue ao GPSBus, alimentando callbacks e o slot de último fix.
+	 * É compartilhada entre o loop em thread e o loop em corrotina.
+	 */
+	bool
+	interpret(
+		const std::string& mensagem,
+		std::string& csv
+	){
+
+		std::cout << "Recebendo: " << mensagem << std::endl;
+		n_linhas.fetch_add(1, std::memory_order_relaxed);
+
+		scratch.reset(); // Início de época: nada da sentença anterior sobrevive
+
+		bool parsed = false; // Apenas uma flag para sabermos se houve interpretação
+		if( mensagem.find("GGA") != std::string::npos ){
+
+			ArenaVector<std::string_view> campos{ArenaAllocator<std::string_view>(scratch)};
+			campos.reserve(16);
+			split(mensagem, campos);
+
+			parsed = last_data_given.parsing(0, campos);
+		}
+		// ... para escalarmos novos padrões de mensagem
+		else{
+
+		}
+
+		if( !parsed ){ return false; }
+
+		last_data_given.to_csv(csv);
+		ultimo_csv = csv;
+
+		std::cout << "Interpretando: \033[7m" 
+				  << csv
+				  << "\033[0m"
+				  << std::endl;
+
+		GPSFix fix;
+		if( last_data_given.to_fix(fix) ){
+
+			fix.seq = ++seq_fix;
+			n_fixes.fetch_add(1, std::memory_order_relaxed);
+			check_geofences(fix);
+			bus.publish(fix);
+		}
+
+		return true;
+	}
+
 	/**
 	 * @brief Executa o loop principal de leitura, interpretação e envio de dados via UDP.
 	 * @details 
@@ -436,76 +719,160 @@ private:
 	 * Esta função realiza continuamente a leitura de dados da porta serial, interpreta as mensagens
 	 * GPS no formato GPGGA, armazena os dados processados e, se desejado, os exibe em formato CSV.
 	 * 
-	 * O loop executa enquanto a flag de execução estiver ativa, com uma pausa de 1 segundo entre 
-	 * cada iteração para evitar consumo excessivo de CPU.
+	 * O loop executa enquanto a flag de execução estiver ativa, com uma pausa entre cada iteração
+	 * para evitar consumo excessivo de CPU. A pausa é o período da configuração atual, 1 segundo
+	 * por padrão.
 	 */
 	void
 	loop(){
 
-		bool parsed = false; // Apenas uma flag para sabermos se houve interpretação
+		// Reaproveitadas a cada iteração: em regime permanente a worker não aloca memória
+		std::string mensagem, csv;
 		while(
 			is_exec
 		){
 
-			std::string mensagem = read_serial();
+			read_serial(mensagem);
 
 			if(mensagem.empty()){ std::cout << "Nada a ser lido..." << std::endl; }
 			else{
 
-				std::cout << "Recebendo: " << mensagem << std::endl;
-
-				if( mensagem.find("GGA") != std::string::npos ){
+				if(
+					interpret(mensagem, csv)
+				){
 
-					last_data_given.parsing(0, split(mensagem));
-					parsed = true;
+					send(
+						csv
+					);
+					printf("\n");
 				}
-				// ... para escalarmos novos padrões de mensagem
-				else{
+			}
 
-				}
+			if( pedido_flush.exchange(false) && !ultimo_csv.empty() ){ send(ultimo_csv); }
 
-				if(
-					parsed
-				){
+			std::chrono::milliseconds periodo = config.read()->periodo;
+			std::this_thread::sleep_for(periodo);
+		}
+	}
+
+#ifdef GPSLOOP_DISPONIVEL
+	/**
+	 * @brief Envia uma string via UDP sem bloquear o GPSLoop.
+	 * @param ex Executor no qual a corrotina está sendo conduzida.
+	 * @param mensagem String a ser enviada.
+	 * @details
+	 * 
+	 * Utiliza MSG_DONTWAIT; caso o buffer do socket esteja cheio, aguarda o socket
+	 * ficar disponível para escrita antes de tentar novamente.
+	 * 
+	 * Os destinos são copiados da configuração antes de qualquer suspensão, para que
+	 * a leitura RCU não se estenda por um co_await.
+	 */
+	GPSLoop::Task
+	send_async(
+		GPSLoop& ex,
+		std::string mensagem
+	){
 
-					std::string mensagem = last_data_given.to_csv();
+		Viva viva(n_corrotinas);
+		std::vector<GPSConfig::Destino> destinos;
+		{
+			auto cfg = config.read();
+			destinos = cfg->destinos;
+		}
 
-					std::cout << "Interpretando: \033[7m" 
-							  << mensagem
-							  << "\033[0m"
-							  << std::endl;
+		for(
+			const auto& destino : destinos
+		){
 
-					send(
-						mensagem
-					);
-					parsed = false;
-					printf("\n");
+			while(
+				is_exec
+			){
+
+				ssize_t bytes = ::sendto(
+										 sockfd,
+										 mensagem.c_str(),
+										 mensagem.size(),
+										 MSG_DONTWAIT,
+										 reinterpret_cast<const struct sockaddr*>(&destino.addr),
+										 sizeof(destino.addr)
+										 );
+
+				if( bytes >= 0 ){ n_enviados++; break; }
+				if( errno != EAGAIN && errno != EWOULDBLOCK ){ std::cout << "Erro ao enviar para " << destino.ip << ":" << destino.porta << std::endl; n_erros_envio++; break; }
+
+				co_await ex.writable(sockfd);
+			}
+		}
+	}
+
+	/**
+	 * @brief Versão em corrotina do loop principal.
+	 * @param ex Executor no qual a corrotina será conduzida.
+	 * @details
+	 * 
+	 * Em vez de ler caractere por caractere com pausas, aguarda a serial ficar legível,
+	 * consome tudo que estiver disponível e interpreta cada linha completa.
+	 */
+	GPSLoop::Task
+	loop_async(
+		GPSLoop& ex
+	){
+
+		Viva viva(n_corrotinas);
+		std::string linha;
+		char buffer[256];
+
+		while(
+			is_exec
+		){
+
+			uint32_t eventos = co_await ex.readable(fd_serial);
+			if( !is_exec ){ break; } // Acordada por stop()
+			if( eventos & (EPOLLERR | EPOLLHUP) ){
+
+				std::cout << "\033[1;31mSerial encerrada\033[0m" << std::endl;
+				break;
+			}
+
+			ssize_t n;
+			while( (n = ::read(fd_serial, buffer, sizeof(buffer))) > 0 ){
+
+				for(
+					ssize_t i = 0; i < n; i++
+				){
+
+					if( buffer[i] == '\r' ){ continue; }
+					if( buffer[i] != '\n' ){ linha += buffer[i]; continue; }
+
+					std::string csv;
+					if( !linha.empty() && interpret(linha, csv) ){ send_async(ex, std::move(csv)); }
+					linha.clear();
 				}
 			}
 
-			std::this_thread::sleep_for(std::chrono::seconds(1));
+			if( pedido_flush.exchange(false) && !ultimo_csv.empty() ){ send_async(ex, ultimo_csv); }
+
+			if( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK ){ throw std::runtime_error("\033[1;31mErro na leitura\033[0m"); }
 		}
+
+		ex.forget(fd_serial);
 	}
+#endif // GPSLOOP_DISPONIVEL
 
 public:
 
 	/**
-	 * @brief Construtor da Classe 
-	 * @param ip_destino_ Endereço IP de destino.
-	 * @param porta_destino_ Porta UDP de destino
-	 * @param porta_serial_ Caminho da porta serial
+	 * @brief Construtor da Classe a partir de uma configuração
+	 * @param cfg Configuração inicial com destinos, período, cercas e porta serial.
 	 * @details
 	 * 
 	 * Inicializa a comunicação UDP e abre a comunicação serial.
 	 */
-	GPSTrack(
-		const std::string&   ip_destino_,
-		int               porta_destino_,
-		const std::string& porta_serial_
-
-	) : ip_destino(ip_destino_),
-		porta_destino(porta_destino_),
-		porta_serial(porta_serial_)
+	explicit GPSTrack(
+		const GPSConfig& cfg
+	) : config(std::unique_ptr<const GPSConfig>(new GPSConfig(cfg))),
+		porta_serial(cfg.serial)
 	{
 
 		// As seguintes definições existentes para a comunição UDP.
@@ -514,13 +881,25 @@ public:
 			throw std::runtime_error("Erro ao criar socket UDP");
 		}
 
-		addr_dest.sin_family = AF_INET;
-		addr_dest.sin_port = ::htons(porta_destino);
-		addr_dest.sin_addr.s_addr = ::inet_addr(ip_destino.c_str());
-
 		open_serial();
 	}
 
+	/**
+	 * @brief Construtor da Classe 
+	 * @param ip_destino_ Endereço IP de destino.
+	 * @param porta_destino_ Porta UDP de destino
+	 * @param porta_serial_ Caminho da porta serial
+	 * @details
+	 * 
+	 * Equivale a uma configuração com um único destino e período padrão.
+	 */
+	GPSTrack(
+		const std::string&   ip_destino_,
+		int               porta_destino_,
+		const std::string& porta_serial_
+
+	) : GPSTrack(make_config(ip_destino_, porta_destino_, porta_serial_)) {}
+
 	/**
 	 * @brief Destrutor da classe.
 	 * @details 
@@ -551,6 +930,7 @@ public:
 		if( is_exec.exchange(true) ){ return; }
 
 		std::cout << "\033[1;32mIniciando Thread de Leitura...\033[0m" << std::endl;
+		bus.init();
 		worker = std::thread(
 							  [this]{ loop(); }
 							 );
@@ -563,12 +943,33 @@ public:
 	 * Esta função realiza o desligamento controlado da thread de trabalho. Primeiro, altera o flag
 	 * de execução para falso usando operação atômica. Se a thread estiver joinable (executando), imprime uma mensagem de confirmação e
 	 * realiza a operação de join para aguardar a finalização segura da thread.
+	 *
+	 * Com init_async(), as corrotinas suspensas na serial ou no socket são acordadas por
+	 * GPSLoop::cancel() e a função aguarda que terminem, de modo que os descritores possam
+	 * ser fechados em seguida. Chamada de dentro de uma corrotina do próprio rastreador, não
+	 * há como aguardá-la; nesse caso o objeto não pode ser destruído antes de ela terminar.
 	 */
 	void
 	stop(){
 
 		if( !is_exec.exchange(false) ){ return; }
 
+#ifdef GPSLOOP_DISPONIVEL
+		if(
+			executor
+		){
+
+			executor->cancel(fd_serial);
+			executor->cancel(sockfd);
+			while( n_corrotinas.load() > 0 && !executor->in_loop_thread() ){ std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+
+			std::cout << "\033[1;32mSaindo da corrotina de leitura.\033[0m" << std::endl;
+			executor = nullptr;
+			bus.stop();
+			return;
+		}
+#endif // GPSLOOP_DISPONIVEL
+
 		if(
 			worker.joinable()
 		){
@@ -576,7 +977,165 @@ public:
 			std::cout << "\033[1;32mSaindo da thread de leitura.\033[0m" << std::endl;
 			worker.join();
 		}
+		bus.stop();
+	}
+
+#ifdef GPSLOOP_DISPONIVEL
+	/**
+	 * @brief Inicializa o rastreador como corrotina de um GPSLoop, sem criar thread.
+	 * @param ex Executor cuja thread conduzirá leitura, interpretação e envio.
+	 * @details
+	 * 
+	 * A serial passa a operar em modo não bloqueante. O chamador é responsável por
+	 * executar ex.run(); stop() acorda e encerra as corrotinas pendentes, e deve ser
+	 * chamado (ou o objeto destruído) antes de `ex`. Não pode ser combinada com init().
+	 */
+	void
+	init_async(
+		GPSLoop& ex
+	){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		int flags = ::fcntl(fd_serial, F_GETFL, 0);
+		::fcntl(fd_serial, F_SETFL, flags | O_NONBLOCK);
+
+		std::cout << "\033[1;32mIniciando Corrotina de Leitura...\033[0m" << std::endl;
+		bus.init();
+		executor = &ex;
+		loop_async(ex);
+	}
+#endif // GPSLOOP_DISPONIVEL
+
+	/**
+	 * @brief Publica uma nova configuração sem interromper a thread worker.
+	 * @param cfg Nova configuração. A porta serial não é reaberta.
+	 * @details
+	 * 
+	 * A worker nunca adquire lock: continua lendo o snapshot anterior até a troca
+	 * do ponteiro, e o antigo só é liberado após o término dessas leituras.
+	 */
+	void
+	apply(
+		const GPSConfig& cfg
+	){
+
+		if( cfg.serial != porta_serial ){
+
+			std::cout << "\033[1;33mAlteração de porta serial ignorada; requer reinício.\033[0m" << std::endl;
+		}
+		config.publish(std::unique_ptr<const GPSConfig>(new GPSConfig(cfg)));
+		geracao_config.fetch_add(1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Recarrega a configuração a partir de um arquivo.
+	 * @param caminho Caminho do arquivo de configuração.
+	 * @return True caso a nova configuração tenha sido publicada. False, caso contrário.
+	 * @details
+	 * 
+	 * A leitura e validação ocorrem na thread chamadora. Em caso de erro, a configuração
+	 * anterior permanece em vigor.
+	 */
+	bool
+	reload(
+		const std::string& caminho
+	){
+
+		try { apply(GPSConfig::load(caminho)); }
+		catch (std::exception& e) {
+
+			std::cout << e.what() << std::endl;
+			return false;
+		}
+
+		std::cout << "\033[1;32mConfiguração recarregada de " << caminho << "\033[0m" << std::endl;
+		return true;
+	}
+
+	/**
+	 * @struct Metrics
+	 * @brief Contadores de operação desde a construção.
+	 */
+	struct Metrics {
+		uint64_t linhas;      ///< Sentenças lidas da serial.
+		uint64_t fixes;       ///< Fixes válidos interpretados.
+		uint64_t enviados;    ///< Datagramas enviados com sucesso.
+		uint64_t erros_envio; ///< Falhas de envio.
+		double   uptime_s;    ///< Segundos desde a construção.
+		bool     executando;  ///< Estado da thread ou corrotina de leitura.
+	};
+
+	/**
+	 * @brief Obtém os contadores de operação sem interferir na thread worker.
+	 */
+	Metrics
+	metrics() const {
+
+		Metrics m;
+		m.linhas      = n_linhas.load(std::memory_order_relaxed);
+		m.fixes       = n_fixes.load(std::memory_order_relaxed);
+		m.enviados    = n_enviados.load(std::memory_order_relaxed);
+		m.erros_envio = n_erros_envio.load(std::memory_order_relaxed);
+		m.uptime_s    = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+		m.executando  = is_exec;
+		return m;
 	}
+
+	/**
+	 * @brief Obtém uma cópia da configuração em vigor.
+	 */
+	GPSConfig
+	configuration(){ return *config.read(); }
+
+	/**
+	 * @brief Altera apenas o período de operação, preservando o restante da configuração.
+	 * @param periodo Novo período.
+	 */
+	void
+	set_period(
+		std::chrono::milliseconds periodo
+	){ config.update([&](GPSConfig& cfg){ cfg.periodo = periodo; }); }
+
+	/**
+	 * @brief Solicita o reenvio imediato do último CSV.
+	 * @details
+	 * 
+	 * Apenas sinaliza a thread worker, que o atende na próxima iteração.
+	 */
+	void
+	flush(){ pedido_flush = true; }
+
+	/**
+	 * @brief Registra um callback chamado a cada fix válido, na thread de entrega do GPSBus.
+	 * @param cb Função que recebe o fix. Um callback lento não atrasa a leitura, mas os fixes
+	 * que excederem a fila do barramento não lhe são entregues.
+	 * @return Identificador do assinante.
+	 */
+	int
+	subscribe(
+		GPSBus::Callback cb
+	){ return bus.subscribe(std::move(cb)); }
+
+	/**
+	 * @brief Remove um assinante registrado por subscribe().
+	 * @param id Identificador do assinante.
+	 * @return True caso tenha sido removido. False, caso contrário.
+	 */
+	bool
+	unsubscribe(
+		int id
+	){ return bus.unsubscribe(id); }
+
+	/**
+	 * @brief Consulta o último fix sem bloquear a thread worker.
+	 * @param[out] fix Último fix interpretado.
+	 * @return False caso ainda não haja fix. True, caso contrário.
+	 */
+	bool
+	latest_fix(
+		GPSFix& fix
+	) const { return bus.latest(fix); }
 };
 
 #endif // GPSTRACK_HPP
\ No newline at end of file
@@ -0,0 +1,224 @@
+/**
+ * @file GeofenceEvaluator.hpp
+ * @brief Entradas e saídas de cercas, por rastreador, sobre o fluxo de fixes do coletor.
+ */
+#ifndef GEOFENCEEVALUATOR_HPP
+#define GEOFENCEEVALUATOR_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "CollectorFix.hpp"
+#include "FenceIndex.hpp"
+#include "RCU.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @struct GeofenceEvent
+ * @brief Entrada ou saída de um rastreador em uma cerca.
+ */
+struct GeofenceEvent {
+
+	enum class Tipo : uint32_t { ENTRADA, SAIDA };
+
+	Tipo     tipo    = Tipo::ENTRADA;
+	uint32_t cerca   = 0;
+	uint64_t tracker = 0;
+	int64_t  t_ms    = 0; ///< Fix que provocou o evento.
+	int32_t  lat_e6  = 0, lon_e6 = 0;
+
+	/**
+	 * @brief Linha CSV `tipo,rastreador,cerca,t_ms,lat,lon`.
+	 */
+	std::string
+	to_csv() const {
+
+		char linha[128];
+		std::snprintf(linha, sizeof(linha), "%s,%llu,%u,%lld,%.6f,%.6f\n",
+					  tipo == Tipo::ENTRADA ? "entrada" : "saida", static_cast<unsigned long long>(tracker), cerca,
+					  static_cast<long long>(t_ms), lat_e6 * 1e-6, lon_e6 * 1e-6);
+		return linha;
+	}
+};
+
+/**
+ * @class GeofenceEvaluator
+ * @brief Avalia cada fix contra um FenceIndex e mantém as cercas em que cada rastreador está.
+ * @details
+ *
+ * O índice é publicado por RCUPtr: as threads de recepção consultam-no sem locks, e um
+ * novo conjunto de cercas pode ser publicado a qualquer momento. Cercas removidas geram
+ * a saída dos rastreadores que estavam nelas no fix seguinte.
+ *
+ * O estado por rastreador cabe em uma entrada da TrackerTable e guarda até MAX_DENTRO
+ * cercas simultâneas, as de menor id; as demais são contadas em `excedentes`, sem gerar
+ * eventos. A escolha pelo id não depende da ordem em que o FenceIndex as visita, de modo
+ * que o subconjunto guardado é estável de um fix para o outro.
+ * Fixes mais antigos que o último são ignorados.
+ */
+class GeofenceEvaluator {
+public:
+
+	static constexpr uint32_t MAX_DENTRO = 9;
+
+	using Sink = std::function<void(const GeofenceEvent&)>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de avaliação.
+	 */
+	struct Stats {
+		uint64_t fixes;
+		uint64_t testes;     ///< Testes exatos de ponto-em-cerca.
+		uint64_t entradas;
+		uint64_t saidas;
+		uint64_t excedentes;
+	};
+
+private:
+
+	/// Estado por rastreador; 48 bytes.
+	struct Estado {
+		int64_t  t_ultimo;
+		uint32_t n;
+		uint32_t dentro[MAX_DENTRO]; ///< Ordenadas.
+	};
+
+	RCUPtr<FenceIndex>            indice;
+	TrackerTable<Estado>          tabela;
+	Sink                            sink;
+
+	std::atomic<uint64_t>      n_fixes{0};
+	std::atomic<uint64_t>     n_testes{0};
+	std::atomic<uint64_t>   n_entradas{0};
+	std::atomic<uint64_t>     n_saidas{0};
+	std::atomic<uint64_t> n_excedentes{0};
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade Quantidade de rastreadores esperada.
+	 */
+	explicit GeofenceEvaluator(
+		std::size_t capacidade = 1 << 16
+	) : indice(std::unique_ptr<const FenceIndex>(new FenceIndex({}))),
+		tabela(capacidade) {}
+
+	/**
+	 * @brief Define a função que recebe os eventos. Deve ser chamado antes da ingestão.
+	 * @details
+	 *
+	 * Chamada pelas threads de recepção, fora do lock do rastreador; deve ser thread-safe.
+	 */
+	void on_event(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Publica um novo conjunto de cercas.
+	 */
+	void publish(std::unique_ptr<const FenceIndex> novo){ indice.publish(std::move(novo)); }
+
+	/**
+	 * @brief Avalia um fix.
+	 * @param fix Fix do rastreador.
+	 * @param emitir False durante a reaplicação do WAL, cujos eventos já foram emitidos.
+	 */
+	void
+	apply(
+		const CollectorFix& fix,
+		bool emitir = true
+	){
+
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+
+		// Cercas que contêm o fix, consultadas fora do lock do rastreador
+		uint32_t atuais[MAX_DENTRO];
+		uint32_t n_atuais = 0;
+		{
+			auto leitura = indice.read();
+			FenceIndex::Consulta r = leitura->query(fix.lat_e6, fix.lon_e6, [&](uint32_t id){
+
+				// Cheia: a de maior id cede o lugar, se a nova for menor
+				if(
+					n_atuais == MAX_DENTRO
+				){
+
+					n_excedentes.fetch_add(1, std::memory_order_relaxed);
+					if( id >= atuais[n_atuais - 1] ){ return; }
+					n_atuais--;
+				}
+
+				// Inserção ordenada; são poucas cercas por fix
+				uint32_t k = n_atuais++;
+				for( ; k > 0 && atuais[k - 1] > id; k-- ){ atuais[k] = atuais[k - 1]; }
+				atuais[k] = id;
+			});
+			if( r.testes ){ n_testes.fetch_add(r.testes, std::memory_order_relaxed); }
+		}
+
+		GeofenceEvent eventos[2 * MAX_DENTRO];
+		uint32_t      n_eventos = 0;
+		tabela.update(
+					  fix.tracker,
+					  [&](Estado& e, bool novo){
+
+						  if( !novo && fix.t_ms < e.t_ultimo ){ return; }
+
+						  // Diferença entre as listas ordenadas
+						  uint32_t i = 0, j = 0;
+						  while(
+							  i < e.n || j < n_atuais
+						  ){
+
+							  GeofenceEvent& ev = eventos[n_eventos];
+							  if( j == n_atuais || (i < e.n && e.dentro[i] < atuais[j]) ){ ev.tipo = GeofenceEvent::Tipo::SAIDA; ev.cerca = e.dentro[i++]; }
+							  else if( i == e.n || atuais[j] < e.dentro[i] ){ ev.tipo = GeofenceEvent::Tipo::ENTRADA; ev.cerca = atuais[j++]; }
+							  else{ i++; j++; continue; }
+							  n_eventos++;
+						  }
+
+						  e.t_ultimo = fix.t_ms;
+						  e.n        = n_atuais;
+						  std::copy(atuais, atuais + n_atuais, e.dentro);
+					  }
+					 );
+
+		for(
+			uint32_t k = 0; k < n_eventos; k++
+		){
+
+			GeofenceEvent& ev = eventos[k];
+			(ev.tipo == GeofenceEvent::Tipo::ENTRADA ? n_entradas : n_saidas).fetch_add(1, std::memory_order_relaxed);
+			if( !emitir || !sink ){ continue; }
+
+			ev.tracker = fix.tracker;
+			ev.t_ms    = fix.t_ms;
+			ev.lat_e6  = fix.lat_e6;
+			ev.lon_e6  = fix.lon_e6;
+			sink(ev);
+		}
+	}
+
+	/**
+	 * @brief Obtém os contadores de avaliação.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.fixes      = n_fixes.load(std::memory_order_relaxed);
+		s.testes     = n_testes.load(std::memory_order_relaxed);
+		s.entradas   = n_entradas.load(std::memory_order_relaxed);
+		s.saidas     = n_saidas.load(std::memory_order_relaxed);
+		s.excedentes = n_excedentes.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // GEOFENCEEVALUATOR_HPP
@@ -0,0 +1,588 @@
+/**
+ * @file HeatmapTiles.hpp
+ * @brief Mapas de densidade da frota em ladrilhos (tiles) Web Mercator, em vários níveis de zoom.
+ * @details
+ * Mapas de onde as cargas permanecem eram produzidos exportando CSV para ferramentas
+ * externas. Aqui os fixes são acumulados diretamente em histogramas por ladrilho, tanto
+ * em lote a partir do HistoryStore quanto incrementalmente, fix a fix, durante a ingestão.
+ */
+#ifndef HEATMAPTILES_HPP
+#define HEATMAPTILES_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Específicos de Sistemas Linux
+#include <sys/stat.h>
+
+#include "CollectorFix.hpp"
+#include "HistoryStore.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @class HeatmapTiles
+ * @brief Histogramas de `bins` x `bins` células por ladrilho z/x/y, de zoom_min a zoom_max.
+ * @details
+ *
+ * Cada fix incrementa uma célula por nível de zoom. O peso é configurável:
+ * - FIXES: cada fix conta 1 na sua posição.
+ * - PERMANENCIA: o tempo (ms) entre fixes consecutivos de um rastreador que permanece a
+ *   menos de `raio_m` de uma âncora é somado na posição da âncora; a âncora passa ao fix
+ *   atual quando ele se afasta. Lacunas maiores que `lacuna_max_ms` não contam.
+ *
+ * Em apply(), o peso de permanência fica retido no estado do rastreador enquanto a âncora
+ * não muda, e é somado às células de uma só vez quando ela muda ou em flush(), chamado por
+ * write(); assim, um rastreador parado custa a atualização do seu estado, e não uma célula
+ * por nível de zoom a cada fix. build() faz a mesma soma dentro de cada thread.
+ *
+ * Os ladrilhos ficam em shards. A localização não adquire locks: cada shard publica um
+ * índice de endereçamento aberto, e o mutex do shard só é adquirido quando um ladrilho é
+ * criado, o que substitui o índice por um maior quando ele passa da metade da ocupação.
+ * Como ladrilhos nunca são removidos, índices substituídos são mantidos até a destruição,
+ * para leitores que ainda os percorram. As células são atômicas. build() distribui os shards do histórico
+ * entre threads, cada uma com histogramas parciais já particionados pelo shard de destino;
+ * na fusão, cada shard de destino é somado por uma única thread, sem disputa.
+ *
+ * Ladrilhos alterados desde a última gravação são marcados, e write() regrava apenas eles.
+ */
+class HeatmapTiles {
+public:
+
+	enum class Peso : uint32_t { FIXES, PERMANENCIA };
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de acumulação.
+	 */
+	struct Stats {
+		uint64_t    fixes;
+		std::size_t ladrilhos;
+		std::size_t bytes;
+	};
+
+private:
+
+	struct Ladrilho {
+		std::unique_ptr<std::atomic<uint64_t>[]> celulas;
+		std::atomic<bool>                        sujo{true};
+	};
+
+	/// Índice de leitura de um shard; inserções apenas sob o mutex do shard.
+	struct Indice {
+		static constexpr uint64_t VAZIO = ~0ULL; ///< Nenhum ladrilho tem zoom 63.
+
+		std::size_t                                 mascara;
+		std::unique_ptr<std::atomic<uint64_t>[]>     chaves;
+		std::unique_ptr<std::atomic<Ladrilho*>[]> ladrilhos;
+		std::size_t                                ocupados = 0;
+
+		explicit Indice(
+			std::size_t n
+		) : mascara(n - 1),
+			chaves(new std::atomic<uint64_t>[n]),
+			ladrilhos(new std::atomic<Ladrilho*>[n])
+		{
+
+			for( std::size_t i = 0; i < n; i++ ){ chaves[i].store(VAZIO, std::memory_order_relaxed); ladrilhos[i].store(nullptr, std::memory_order_relaxed); }
+		}
+
+		static std::size_t slot(uint64_t chave){ return static_cast<std::size_t>((chave * 0xff51afd7ed558ccdULL) >> 32); }
+
+		bool full() const { return 2 * (ocupados + 1) > mascara + 1; }
+
+		Ladrilho*
+		find(
+			uint64_t chave
+		) const {
+
+			for(
+				std::size_t i = slot(chave) & mascara; ; i = (i + 1) & mascara
+			){
+
+				uint64_t k = chaves[i].load(std::memory_order_acquire);
+				if( k == chave ){ return ladrilhos[i].load(std::memory_order_relaxed); }
+				if( k == VAZIO ){ return nullptr; }
+			}
+		}
+
+		/// O ponteiro é gravado antes da chave, que o publica.
+		void
+		insert(
+			uint64_t chave,
+			Ladrilho* l
+		){
+
+			std::size_t i = slot(chave) & mascara;
+			while( chaves[i].load(std::memory_order_relaxed) != VAZIO ){ i = (i + 1) & mascara; }
+			ladrilhos[i].store(l, std::memory_order_relaxed);
+			chaves[i].store(chave, std::memory_order_release);
+			ocupados++;
+		}
+	};
+
+	struct Shard {
+		std::mutex                                                  mtx;
+		std::unordered_map<uint64_t, std::unique_ptr<Ladrilho>> ladrilhos;
+		std::atomic<Indice*>                                  indice{nullptr};
+		std::vector<std::unique_ptr<Indice>>                         indices; ///< O atual e os substituídos.
+	};
+
+	/// Estado por rastreador no modo PERMANENCIA.
+	struct Estado {
+		int64_t  t_ms;
+		int32_t  lat_ancora, lon_ancora;
+		int32_t  lat_e6, lon_e6;
+		uint64_t retido; ///< Peso na âncora ainda não somado aos ladrilhos.
+	};
+
+	/// Histogramas parciais de uma thread em build(), um mapa por shard de destino.
+	using Parcial = std::vector<std::unordered_map<uint64_t, std::vector<uint64_t>>>;
+
+	int                            zoom_min;
+	int                            zoom_max;
+	uint32_t                           bins;
+	Peso                               peso;
+	double                           raio_m;
+	int64_t                   lacuna_max_ms;
+	std::unique_ptr<Shard[]>         shards;
+	std::size_t                    n_shards;
+	TrackerTable<Estado>             tabela;
+
+	std::atomic<uint64_t>        n_fixes{0};
+
+	static uint64_t key(int z, uint64_t x, uint64_t y){ return (uint64_t(z) << 58) | (x << 29) | y; }
+
+	std::size_t shard_of(uint64_t chave) const { return (chave * 0x9e3779b97f4a7c15ULL >> 32) % n_shards; }
+
+	/**
+	 * @brief Chama `visitar(chave, celula)` para o ladrilho e a célula de cada nível de zoom.
+	 */
+	template <typename F>
+	void
+	locate(
+		int32_t lat_e6,
+		int32_t lon_e6,
+		F&& visitar
+	) const {
+
+		double lat = std::clamp(lat_e6 * 1e-6, -85.05112878, 85.05112878) * M_PI / 180.0;
+		double mx  = (lon_e6 * 1e-6 + 180.0) / 360.0;
+		double my  = (1.0 - std::asinh(std::tan(lat)) / M_PI) / 2.0;
+
+		for(
+			int z = zoom_min; z <= zoom_max; z++
+		){
+
+			uint64_t n  = uint64_t(bins) << z;
+			uint64_t px = std::min<uint64_t>(n - 1, static_cast<uint64_t>(std::max(0.0, mx * n)));
+			uint64_t py = std::min<uint64_t>(n - 1, static_cast<uint64_t>(std::max(0.0, my * n)));
+			visitar(key(z, px / bins, py / bins), static_cast<uint32_t>((py % bins) * bins + px % bins));
+		}
+	}
+
+	/**
+	 * @brief Localiza ou cria um ladrilho. Os ladrilhos nunca são removidos.
+	 * @details
+	 *
+	 * Sem lock quando o ladrilho já existe; o mutex do shard é adquirido apenas para criá-lo.
+	 */
+	Ladrilho&
+	tile_of(
+		uint64_t chave
+	){
+
+		Shard& s = shards[shard_of(chave)];
+		if( const Indice* indice = s.indice.load(std::memory_order_acquire) ){ if( Ladrilho* l = indice->find(chave) ){ return *l; } }
+
+		std::lock_guard<std::mutex> lock(s.mtx);
+		std::unique_ptr<Ladrilho>& l = s.ladrilhos[chave];
+		if(
+			!l
+		){
+
+			l = std::make_unique<Ladrilho>();
+			l->celulas.reset(new std::atomic<uint64_t>[std::size_t(bins) * bins]());
+
+			Indice* atual = s.indice.load(std::memory_order_relaxed);
+			if(
+				!atual || atual->full()
+			){
+
+				auto novo = std::make_unique<Indice>(atual ? 2 * (atual->mascara + 1) : 64);
+				for( auto& par : s.ladrilhos ){ novo->insert(par.first, par.second.get()); }
+				s.indice.store(novo.get(), std::memory_order_release);
+				s.indices.push_back(std::move(novo));
+			}
+			else{ atual->insert(chave, l.get()); }
+		}
+		return *l;
+	}
+
+	void
+	add(
+		int32_t lat_e6,
+		int32_t lon_e6,
+		uint64_t valor
+	){
+
+		locate(lat_e6, lon_e6, [&](uint64_t chave, uint32_t celula){
+
+			Ladrilho& l = tile_of(chave);
+			l.celulas[celula].fetch_add(valor, std::memory_order_relaxed);
+			if( !l.sujo.load(std::memory_order_relaxed) ){ l.sujo.store(true, std::memory_order_relaxed); }
+		});
+	}
+
+	/**
+	 * @brief Avança o estado de permanência de um rastreador com um fix.
+	 * @param e Estado, com o fix anterior.
+	 * @param[out] lat_e6, lon_e6 Posição que recebe o peso.
+	 * @return Peso em ms, ou 0.
+	 */
+	uint64_t
+	dwell(
+		Estado& e,
+		const CollectorFix& fix,
+		int32_t& lat_e6,
+		int32_t& lon_e6
+	) const {
+
+		int64_t dt = fix.t_ms - e.t_ms;
+		double  dx = (fix.lon_e6 - e.lon_ancora) * 0.11132 * std::cos(fix.lat_e6 * 1e-6 * M_PI / 180.0);
+		double  dy = (fix.lat_e6 - e.lat_ancora) * 0.11132;
+
+		lat_e6 = e.lat_ancora;
+		lon_e6 = e.lon_ancora;
+		bool perto = dx * dx + dy * dy <= raio_m * raio_m;
+		if( !perto ){ e.lat_ancora = fix.lat_e6; e.lon_ancora = fix.lon_e6; }
+
+		e.t_ms   = fix.t_ms;
+		e.lat_e6 = fix.lat_e6;
+		e.lon_e6 = fix.lon_e6;
+		return perto && dt <= lacuna_max_ms ? static_cast<uint64_t>(dt) : 0;
+	}
+
+	static void make_dir(const std::string& dir){ ::mkdir(dir.c_str(), 0755); }
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param zoom_min_ Menor nível de zoom.
+	 * @param zoom_max_ Maior nível de zoom, até 20.
+	 * @param bins_ Células por lado de cada ladrilho.
+	 * @param peso_ Contagem de fixes ou tempo de permanência.
+	 * @param raio_m_ Raio de permanência em torno da âncora (modo PERMANENCIA).
+	 * @param capacidade Quantidade de rastreadores esperada (modo PERMANENCIA).
+	 */
+	explicit HeatmapTiles(
+		int zoom_min_ = 4,
+		int zoom_max_ = 14,
+		uint32_t bins_ = 64,
+		Peso peso_ = Peso::PERMANENCIA,
+		double raio_m_ = 50,
+		std::size_t capacidade = 1 << 16
+	) : zoom_min(std::clamp(zoom_min_, 0, 20)),
+		zoom_max(std::clamp(zoom_max_, zoom_min, 20)),
+		bins(std::clamp<uint32_t>(bins_, 1, 1024)),
+		peso(peso_),
+		raio_m(raio_m_),
+		lacuna_max_ms(600000),
+		shards(new Shard[64]),
+		n_shards(64),
+		tabela(peso_ == Peso::PERMANENCIA ? capacidade : 16) {}
+
+	HeatmapTiles(const HeatmapTiles&)            = delete;
+	HeatmapTiles& operator=(const HeatmapTiles&) = delete;
+
+	/**
+	 * @brief Acumula um fix recebido. Fixes mais antigos que o último do rastreador são ignorados.
+	 * @details
+	 *
+	 * No modo PERMANENCIA, o peso só aparece nos ladrilhos quando a âncora muda ou após flush().
+	 */
+	void
+	apply(
+		const CollectorFix& fix
+	){
+
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+		if( peso == Peso::FIXES ){ add(fix.lat_e6, fix.lon_e6, 1); return; }
+
+		uint64_t valor  = 0;
+		int32_t  lat_e6 = 0, lon_e6 = 0;
+		tabela.update(
+					  fix.tracker,
+					  [&](Estado& e, bool novo){
+
+						  if( novo ){ e = { fix.t_ms, fix.lat_e6, fix.lon_e6, fix.lat_e6, fix.lon_e6, 0 }; return; }
+						  if( fix.t_ms <= e.t_ms ){ return; }
+						  e.retido += dwell(e, fix, lat_e6, lon_e6);
+						  if( e.lat_ancora != lat_e6 || e.lon_ancora != lon_e6 ){ valor = e.retido; e.retido = 0; }
+					  }
+					 );
+		if( valor ){ add(lat_e6, lon_e6, valor); }
+	}
+
+	/**
+	 * @brief Soma aos ladrilhos o peso de permanência retido por rastreador em apply().
+	 */
+	void
+	flush(){
+
+		if( peso != Peso::PERMANENCIA ){ return; }
+
+		std::vector<uint64_t> retidos;
+		tabela.for_each([&](uint64_t chave, const Estado& e){ if( e.retido ){ retidos.push_back(chave); } });
+		for(
+			uint64_t chave : retidos
+		){
+
+			uint64_t valor  = 0;
+			int32_t  lat_e6 = 0, lon_e6 = 0;
+			tabela.update(chave, [&](Estado& e, bool){ valor = e.retido; lat_e6 = e.lat_ancora; lon_e6 = e.lon_ancora; e.retido = 0; });
+			if( valor ){ add(lat_e6, lon_e6, valor); }
+		}
+	}
+
+	/**
+	 * @brief Acumula todos os blocos selados de um histórico, em paralelo.
+	 * @param historico Histórico que não passou por apply().
+	 * @param n_threads Threads de trabalho; 0 usa hardware_concurrency().
+	 * @return Quantidade de fixes acumulados.
+	 */
+	uint64_t
+	build(
+		HistoryStore& historico,
+		int n_threads = 0
+	){
+
+		if( n_threads <= 0 ){ n_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); }
+
+		std::vector<Parcial>  parciais(n_threads, Parcial(n_shards));
+		std::vector<uint64_t> contagens(n_threads, 0);
+		std::atomic<std::size_t> proximo{0};
+
+		// Fase 1: cada thread acumula shards inteiros do histórico em seus parciais
+		auto acumular = [&](int t){
+
+			Parcial& parcial = parciais[t];
+			auto somar = [&](int32_t lat_e6, int32_t lon_e6, uint64_t valor){
+
+				locate(lat_e6, lon_e6, [&](uint64_t chave, uint32_t celula){
+
+					std::vector<uint64_t>& v = parcial[shard_of(chave)][chave];
+					if( v.empty() ){ v.assign(std::size_t(bins) * bins, 0); }
+					v[celula] += valor;
+				});
+			};
+
+			// Os blocos de um rastreador chegam consecutivos e em ordem. Pesos seguidos na mesma
+			// âncora são somados antes de localizar as células
+			uint64_t tracker = 0;
+			Estado   e{};
+			int32_t  lat_p = 0, lon_p = 0;
+			uint64_t pendente = 0;
+			for(
+				std::size_t i = proximo.fetch_add(1, std::memory_order_relaxed); i < historico.shard_count();
+				i = proximo.fetch_add(1, std::memory_order_relaxed)
+			){
+
+				historico.for_each_block_in_shard(i, [&](const HistoryStore::Bloco& b){
+
+					b->decode([&](const CollectorFix& fix){
+
+						contagens[t]++;
+						if( peso == Peso::FIXES ){ somar(fix.lat_e6, fix.lon_e6, 1); return; }
+
+						if( fix.tracker != tracker ){ tracker = fix.tracker; e = { fix.t_ms, fix.lat_e6, fix.lon_e6, fix.lat_e6, fix.lon_e6, 0 }; return; }
+						if( fix.t_ms <= e.t_ms ){ return; }
+
+						int32_t  lat_e6 = 0, lon_e6 = 0;
+						uint64_t valor  = dwell(e, fix, lat_e6, lon_e6);
+						if( !valor ){ return; }
+						if( pendente && (lat_e6 != lat_p || lon_e6 != lon_p) ){ somar(lat_p, lon_p, pendente); pendente = 0; }
+						lat_p     = lat_e6;
+						lon_p     = lon_e6;
+						pendente += valor;
+					});
+				});
+			}
+			if( pendente ){ somar(lat_p, lon_p, pendente); }
+		};
+
+		// Fase 2: cada shard de destino é somado por uma única thread
+		auto fundir = [&](int){
+
+			for(
+				std::size_t p = proximo.fetch_add(1, std::memory_order_relaxed); p < n_shards;
+				p = proximo.fetch_add(1, std::memory_order_relaxed)
+			){
+
+				for(
+					Parcial& parcial : parciais
+				){
+
+					for(
+						auto& par : parcial[p]
+					){
+
+						Ladrilho& l = tile_of(par.first);
+						for( std::size_t c = 0; c < par.second.size(); c++ ){ if( par.second[c] ){ l.celulas[c].fetch_add(par.second[c], std::memory_order_relaxed); } }
+						l.sujo.store(true, std::memory_order_relaxed);
+					}
+					std::unordered_map<uint64_t, std::vector<uint64_t>>().swap(parcial[p]);
+				}
+			}
+		};
+
+		auto executar = [&](auto& fn){
+
+			proximo.store(0);
+			std::vector<std::thread> threads;
+			for( int t = 1; t < n_threads; t++ ){ threads.emplace_back([&fn, t]{ fn(t); }); }
+			fn(0);
+			for( auto& th : threads ){ th.join(); }
+		};
+		executar(acumular);
+		executar(fundir);
+
+		uint64_t n = 0;
+		for( uint64_t c : contagens ){ n += c; }
+		n_fixes.fetch_add(n, std::memory_order_relaxed);
+		return n;
+	}
+
+	/**
+	 * @brief Copia as células de um ladrilho, linha a linha a partir do norte.
+	 * @return False caso o ladrilho não tenha recebido nenhum fix.
+	 */
+	bool
+	tile(
+		int z,
+		uint32_t x,
+		uint32_t y,
+		std::vector<uint64_t>& celulas
+	){
+
+		uint64_t  chave = key(z, x, y);
+		Shard&    s     = shards[shard_of(chave)];
+		Ladrilho* l     = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(s.mtx);
+			auto it = s.ladrilhos.find(chave);
+			if( it == s.ladrilhos.end() ){ return false; }
+			l = it->second.get();
+		}
+
+		celulas.resize(std::size_t(bins) * bins);
+		for( std::size_t c = 0; c < celulas.size(); c++ ){ celulas[c] = l->celulas[c].load(std::memory_order_relaxed); }
+		return true;
+	}
+
+	/**
+	 * @brief Grava os ladrilhos alterados como `dir/z/x/y.pgm`, em tons de cinza.
+	 * @return Quantidade de ladrilhos gravados.
+	 * @details
+	 *
+	 * A escala é logarítmica e fixa, 8 tons por duplicação do peso (em segundos no modo
+	 * PERMANENCIA), de modo que ladrilhos gravados em momentos distintos são comparáveis.
+	 * Cada arquivo é substituído atomicamente por rename(). Chama flush() antes, para que o
+	 * peso retido por rastreador seja incluído.
+	 */
+	std::size_t
+	write(
+		const std::string& dir
+	){
+
+		flush();
+
+		double escala = peso == Peso::PERMANENCIA ? 1e-3 : 1;
+		std::vector<uint8_t> pixels(std::size_t(bins) * bins);
+		std::size_t gravados = 0;
+
+		make_dir(dir);
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::vector<std::pair<uint64_t, Ladrilho*>> sujos;
+			{
+				std::lock_guard<std::mutex> lock(shards[i].mtx);
+				for( auto& par : shards[i].ladrilhos ){ if( par.second->sujo.exchange(false, std::memory_order_relaxed) ){ sujos.emplace_back(par.first, par.second.get()); } }
+			}
+
+			for(
+				const auto& par : sujos
+			){
+
+				int      z = static_cast<int>(par.first >> 58);
+				uint64_t x = (par.first >> 29) & ((1u << 29) - 1);
+				uint64_t y = par.first & ((1u << 29) - 1);
+
+				for(
+					std::size_t c = 0; c < pixels.size(); c++
+				){
+
+					double v  = par.second->celulas[c].load(std::memory_order_relaxed) * escala;
+					pixels[c] = static_cast<uint8_t>(std::min(255.0, std::round(8 * std::log2(1 + v))));
+				}
+
+				std::string pasta = dir + "/" + std::to_string(z) + "/" + std::to_string(x);
+				make_dir(dir + "/" + std::to_string(z));
+				make_dir(pasta);
+
+				std::string caminho = pasta + "/" + std::to_string(y) + ".pgm";
+				std::FILE*  f       = std::fopen((caminho + ".tmp").c_str(), "wb");
+				bool        ok      = f != nullptr;
+				if(
+					f
+				){
+
+					std::fprintf(f, "P5\n%u %u\n255\n", bins, bins);
+					ok = std::fwrite(pixels.data(), 1, pixels.size(), f) == pixels.size();
+					ok = (std::fclose(f) == 0) && ok;
+					ok = ok && std::rename((caminho + ".tmp").c_str(), caminho.c_str()) == 0;
+				}
+				if( !ok ){ std::cout << "\033[1;31mErro ao gravar ladrilho: " << caminho << "\033[0m" << std::endl; par.second->sujo.store(true); continue; }
+				gravados++;
+			}
+		}
+		return gravados;
+	}
+
+	uint32_t bins_per_side() const { return bins; }
+
+	/**
+	 * @brief Obtém os contadores de acumulação.
+	 */
+	Stats
+	stats(){
+
+		Stats s;
+		s.fixes     = n_fixes.load(std::memory_order_relaxed);
+		s.ladrilhos = 0;
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			s.ladrilhos += shards[i].ladrilhos.size();
+		}
+		s.bytes = s.ladrilhos * (sizeof(Ladrilho) + std::size_t(bins) * bins * sizeof(uint64_t));
+		return s;
+	}
+};
+
+#endif // HEATMAPTILES_HPP
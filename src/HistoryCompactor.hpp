@@ -0,0 +1,251 @@
+/**
+ * @file HistoryCompactor.hpp
+ * @brief Compactação, retenção e redução do histórico em segundo plano.
+ * @details
+ * Blocos pequenos (selados por seal_all() ou em reinícios) e sobrepostos (fixes fora de
+ * ordem) se acumulam, e o histórico cresce indefinidamente. O compactador percorre os
+ * rastreadores periodicamente e aplica HistoryStore::compact(), sem competir com a recepção.
+ */
+#ifndef HISTORYCOMPACTOR_HPP
+#define HISTORYCOMPACTOR_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Específicos de Sistemas Linux
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "HistoryStore.hpp"
+
+/**
+ * @class HistoryCompactor
+ * @brief Thread que compacta o histórico e aplica a política de retenção e redução.
+ * @details
+ *
+ * A cada `periodo_ms`, uma passada percorre os shards do histórico e compacta cada
+ * rastreador. Para não afetar a latência da ingestão:
+ *
+ * - a thread roda com prioridade mínima (nice 19), como a de GPSControl;
+ * - os fixes decodificados por segundo são limitados a `taxa_fixes`: ao adiantar-se,
+ *   a passada dorme;
+ * - o lock de cada shard é mantido apenas para copiar e trocar a lista de blocos.
+ *
+ * Ao fim de cada passada da thread, a função registrada em on_pass() é chamada, para que
+ * estruturas derivadas dos blocos (ScanEngine) sejam refeitas fora das consultas.
+ *
+ * Os métodos init() e stop() seguem o mesmo padrão de GPSTrack.
+ */
+class HistoryCompactor {
+public:
+
+	using Sink = std::function<void()>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores acumulados do compactador.
+	 */
+	struct Stats {
+		uint64_t                  passadas;
+		uint64_t                  compactados; ///< Rastreadores com blocos reescritos ou removidos.
+		HistoryStore::Compactacao trabalho;
+		double                    ocupado_s;   ///< Tempo das passadas, sem as pausas do limite de taxa.
+		double                    fixes_s;     ///< Vazão: fixes decodificados por segundo ocupado.
+	};
+
+private:
+
+	HistoryStore&                 historico;
+	HistoryStore::Politica         politica;
+	uint64_t                     taxa_fixes;
+	int64_t                      periodo_ms;
+	Sink                               sink;
+
+	std::thread                      worker;
+	std::atomic<bool>        is_exec{false};
+
+	mutable std::mutex            mtx_stats;
+	HistoryStore::Compactacao      trabalho;
+	uint64_t                     passadas = 0;
+	uint64_t                  compactados = 0;
+	double                      ocupado_s = 0;
+
+	static int64_t
+	now_ms(){
+
+		using namespace std::chrono;
+		return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * @brief Loop da thread do compactador.
+	 */
+	void
+	loop(){
+
+		using namespace std::chrono;
+
+		::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+
+		auto proximo = steady_clock::now();
+		while(
+			is_exec
+		){
+
+			if( steady_clock::now() < proximo ){ std::this_thread::sleep_for(milliseconds(100)); continue; }
+
+			run(now_ms());
+			if( sink && is_exec ){ sink(); }
+			proximo = steady_clock::now() + milliseconds(periodo_ms);
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param historico_ Histórico a compactar.
+	 * @param politica_ Retenção e redução.
+	 * @param taxa_fixes_ Fixes decodificados por segundo, no máximo; 0 sem limite.
+	 * @param periodo_ms_ Intervalo entre o fim de uma passada e o início da seguinte.
+	 */
+	explicit HistoryCompactor(
+		HistoryStore& historico_,
+		HistoryStore::Politica politica_ = HistoryStore::Politica(),
+		uint64_t taxa_fixes_ = 2000000,
+		int64_t periodo_ms_ = 60000
+	) : historico(historico_),
+		politica(politica_),
+		taxa_fixes(taxa_fixes_),
+		periodo_ms(periodo_ms_) {}
+
+	~HistoryCompactor(){ stop(); }
+
+	HistoryCompactor(const HistoryCompactor&)            = delete;
+	HistoryCompactor& operator=(const HistoryCompactor&) = delete;
+
+	/**
+	 * @brief Executa uma passada por todo o histórico.
+	 * @param agora_ms Instante de referência da política.
+	 * @return Quantidade de rastreadores compactados.
+	 * @details
+	 *
+	 * Chamado pela thread do compactador; pode ser chamado diretamente (benchmarks,
+	 * manutenção) desde que init() não esteja em execução. Com a thread em execução, a
+	 * passada é interrompida por stop().
+	 */
+	std::size_t
+	run(
+		int64_t agora_ms
+	){
+
+		using namespace std::chrono;
+
+		auto     inicio  = steady_clock::now();
+		double   pausado = 0;
+		uint64_t lidos   = 0;
+		std::size_t n    = 0;
+
+		HistoryStore::Compactacao c;
+		bool thread = is_exec;
+		for(
+			std::size_t i = 0; i < historico.shard_count() && (!thread || is_exec); i++
+		){
+
+			for(
+				uint64_t tracker : historico.trackers_in_shard(i)
+			){
+
+				if( thread && !is_exec ){ break; }
+				if( historico.compact(tracker, politica, agora_ms, c) ){ n++; }
+
+				// Limite de taxa: dorme o quanto a passada se adiantou
+				if( taxa_fixes == 0 || c.fixes_lidos == lidos ){ continue; }
+				lidos = c.fixes_lidos;
+				double adiantado = double(lidos) / taxa_fixes - duration<double>(steady_clock::now() - inicio).count();
+				if(
+					adiantado > 0.001
+				){
+
+					std::this_thread::sleep_for(duration<double>(adiantado));
+					pausado += adiantado;
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mtx_stats);
+		trabalho.blocos_lidos    += c.blocos_lidos;
+		trabalho.blocos_gravados += c.blocos_gravados;
+		trabalho.fixes_lidos     += c.fixes_lidos;
+		trabalho.fixes_gravados  += c.fixes_gravados;
+		trabalho.expirados       += c.expirados;
+		trabalho.reduzidos       += c.reduzidos;
+		trabalho.bytes_lidos     += c.bytes_lidos;
+		trabalho.bytes_gravados  += c.bytes_gravados;
+		passadas++;
+		compactados += n;
+		ocupado_s   += std::max(0.0, duration<double>(steady_clock::now() - inicio).count() - pausado);
+		return n;
+	}
+
+	/**
+	 * @brief Registra a função chamada pela thread ao fim de cada passada.
+	 * @details
+	 *
+	 * Deve ser chamado antes de init(). A função roda na thread do compactador, com a
+	 * mesma prioridade mínima.
+	 */
+	void on_pass(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Inicializa a thread do compactador.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		std::cout << "\033[1;32mIniciando Thread do Compactador do Histórico...\033[0m" << std::endl;
+		worker = std::thread(
+							 [this]{ loop(); }
+							);
+	}
+
+	/**
+	 * @brief Finaliza a thread do compactador de forma segura.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		std::cout << "\033[1;32mSaindo da thread do compactador do histórico.\033[0m" << std::endl;
+		if( worker.joinable() ){ worker.join(); }
+	}
+
+	/**
+	 * @brief Obtém os contadores do compactador.
+	 */
+	Stats
+	stats() const {
+
+		std::lock_guard<std::mutex> lock(mtx_stats);
+		Stats s;
+		s.passadas    = passadas;
+		s.compactados = compactados;
+		s.trabalho    = trabalho;
+		s.ocupado_s   = ocupado_s;
+		s.fixes_s     = ocupado_s > 0 ? trabalho.fixes_lidos / ocupado_s : 0;
+		return s;
+	}
+};
+
+#endif // HISTORYCOMPACTOR_HPP
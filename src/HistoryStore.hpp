@@ -0,0 +1,995 @@
+/**
+ * @file HistoryStore.hpp
+ * @brief Histórico de fixes do coletor, comprimido em blocos por rastreador.
+ * @details
+ * Como texto CSV, cada fix ocupa cerca de 40 bytes; como CollectorFix, 32. Fixes consecutivos
+ * de um rastreador variam pouco, de modo que o histórico é guardado à maneira do Gorilla:
+ * instantes e coordenadas em ponto fixo são codificados por delta-de-delta e empacotados em
+ * poucos bits. Cada bloco é independente, permitindo acesso aleatório.
+ */
+#ifndef HISTORYSTORE_HPP
+#define HISTORYSTORE_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "Snapshot.hpp"
+#include "TrackPyramid.hpp"
+
+/**
+ * @class BitWriter
+ * @brief Escrita sequencial de campos de até 64 bits, do bit menos significativo ao mais.
+ */
+class BitWriter {
+private:
+
+	std::vector<uint64_t>& palavras;
+	uint64_t&                n_bits;
+
+public:
+
+	BitWriter(
+		std::vector<uint64_t>& palavras_,
+		uint64_t& n_bits_
+	) : palavras(palavras_),
+		n_bits(n_bits_) {}
+
+	void
+	write(
+		uint64_t valor,
+		unsigned n
+	){
+
+		if( n == 0 ){ return; }
+		if( n < 64 ){ valor &= (uint64_t(1) << n) - 1; }
+
+		unsigned deslocamento = n_bits & 63;
+		if( deslocamento == 0 ){ palavras.push_back(0); }
+		palavras.back() |= valor << deslocamento;
+		if( deslocamento + n > 64 ){ palavras.push_back(valor >> (64 - deslocamento)); }
+
+		n_bits += n;
+	}
+};
+
+/**
+ * @class BitReader
+ * @brief Leitura dos campos gravados por BitWriter.
+ */
+class BitReader {
+private:
+
+	const uint64_t* palavras;
+	uint64_t           pos = 0;
+
+public:
+
+	explicit BitReader(const uint64_t* palavras_) : palavras(palavras_) {}
+
+	uint64_t
+	read(
+		unsigned n
+	){
+
+		if( n == 0 ){ return 0; }
+
+		uint64_t indice       = pos >> 6;
+		unsigned deslocamento = pos & 63;
+		uint64_t valor        = palavras[indice] >> deslocamento;
+		if( deslocamento + n > 64 ){ valor |= palavras[indice + 1] << (64 - deslocamento); }
+
+		pos += n;
+		return (n < 64) ? (valor & ((uint64_t(1) << n) - 1)) : valor;
+	}
+
+	bool bit(){ return read(1) != 0; }
+
+	uint64_t position() const { return pos; }
+};
+
+/**
+ * @struct FixBlock
+ * @brief Bloco comprimido de fixes consecutivos de um rastreador.
+ * @details
+ *
+ * O primeiro fix fica em claro no cabeçalho; os seguintes, como delta-de-delta de cada
+ * campo (instante, latitude, longitude, altitude) em zigzag, com prefixo de tamanho:
+ *
+ * | Prefixo | Bits do valor |
+ * |---------|---------------|
+ * | 0       | 0             |
+ * | 10      | 7             |
+ * | 110     | 12            |
+ * | 1110    | 20            |
+ * | 11110   | 32            |
+ * | 11111   | 64            |
+ *
+ * Um rastreador parado ou a velocidade constante, com período fixo, custa 4 bits por fix.
+ * O campo flags não é armazenado. Intervalos de tempo e a caixa envolvente das posições
+ * ficam no cabeçalho, para que consultas descartem blocos sem decodificá-los.
+ */
+struct FixBlock {
+	uint64_t tracker = 0;
+	uint32_t n       = 0; ///< Quantidade de fixes.
+	uint32_t intervalo_ms = 0; ///< Redução aplicada pela compactação: no máximo um fix por intervalo.
+
+	int64_t  t_min   = 0;
+	int64_t  t_max   = 0;
+	int32_t  lat_min = 0, lat_max = 0;
+	int32_t  lon_min = 0, lon_max = 0;
+
+	CollectorFix           primeiro; ///< Primeiro fix, em claro.
+	std::vector<uint64_t>      bits;
+	uint64_t             n_bits = 0;
+
+	static constexpr unsigned LARGURAS[6] = { 0, 7, 12, 20, 32, 64 };
+
+	static uint64_t zigzag(int64_t v){ return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+	static int64_t  unzigzag(uint64_t z){ return static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1); }
+
+	static void
+	put(
+		BitWriter& w,
+		int64_t valor
+	){
+
+		uint64_t z = zigzag(valor);
+		if( z == 0 )                  { w.write(0, 1); }
+		else if( z < (1ULL << 7) )    { w.write(0x1, 2);  w.write(z, 7);  }
+		else if( z < (1ULL << 12) )   { w.write(0x3, 3);  w.write(z, 12); }
+		else if( z < (1ULL << 20) )   { w.write(0x7, 4);  w.write(z, 20); }
+		else if( z < (1ULL << 32) )   { w.write(0xF, 5);  w.write(z, 32); }
+		else                          { w.write(0x1F, 5); w.write(z, 64); }
+	}
+
+	static int64_t
+	get(
+		BitReader& r
+	){
+
+		unsigned k = 0;
+		while( k < 5 && r.bit() ){ k++; }
+		return unzigzag(r.read(LARGURAS[k]));
+	}
+
+	/**
+	 * @brief Bytes ocupados pelo bloco (cabeçalho e bits).
+	 */
+	std::size_t bytes() const { return sizeof(FixBlock) + bits.size() * sizeof(uint64_t); }
+
+	/**
+	 * @brief Indica se o bloco pode conter fixes no intervalo [t_ini, t_fim].
+	 */
+	bool overlaps(int64_t t_ini, int64_t t_fim) const { return n > 0 && t_max >= t_ini && t_min <= t_fim; }
+
+	/**
+	 * @brief Decodifica o bloco, entregando os fixes em ordem de chegada (ou de instante,
+	 * depois de compactado).
+	 * @param visitar Função `void(const CollectorFix&)`.
+	 */
+	template <typename F>
+	void
+	decode(
+		F&& visitar
+	) const {
+
+		if( n == 0 ){ return; }
+
+		CollectorFix fix = primeiro;
+		visitar(fix);
+
+		BitReader r(bits.data());
+		int64_t d_t = 0, d_lat = 0, d_lon = 0, d_alt = 0;
+		for(
+			uint32_t i = 1; i < n; i++
+		){
+
+			d_t   += get(r);
+			d_lat += get(r);
+			d_lon += get(r);
+			d_alt += get(r);
+
+			fix.t_ms   += d_t;
+			fix.lat_e6 += static_cast<int32_t>(d_lat);
+			fix.lon_e6 += static_cast<int32_t>(d_lon);
+			fix.alt_dm += static_cast<int32_t>(d_alt);
+			visitar(fix);
+		}
+	}
+
+	/**
+	 * @brief Decodifica o bloco acrescentando os fixes a um vetor.
+	 */
+	void
+	decode(
+		std::vector<CollectorFix>& saida
+	) const {
+
+		saida.reserve(saida.size() + n);
+		decode([&](const CollectorFix& fix){ saida.push_back(fix); });
+	}
+
+	/**
+	 * @brief Grava o bloco no snapshot, como está.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	) const {
+
+		w.put(tracker); w.put(n); w.put(intervalo_ms);
+		w.put(t_min);   w.put(t_max);
+		w.put(lat_min); w.put(lat_max);
+		w.put(lon_min); w.put(lon_max);
+		w.put(primeiro);
+		w.put(n_bits);
+		w.put_vector(bits);
+	}
+
+	/**
+	 * @brief Substitui o bloco pelo que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		bool ok = r.get(tracker) && r.get(n) && r.get(intervalo_ms) && r.get(t_min) && r.get(t_max) &&
+				  r.get(lat_min) && r.get(lat_max) && r.get(lon_min) && r.get(lon_max) &&
+				  r.get(primeiro) && r.get(n_bits) && r.get_vector(bits);
+		return ok && valid();
+	}
+
+	/**
+	 * @brief Confere que os n - 1 fixes codificados ocupam exatamente os n_bits gravados,
+	 * para que decode() nunca leia além de bits.
+	 */
+	bool
+	valid() const {
+
+		if( bits.size() != (n_bits + 63) / 64 ){ return false; }
+		if( n == 0 ){ return n_bits == 0; }
+
+		BitReader r(bits.data());
+		for(
+			uint64_t v = 0; v < 4 * static_cast<uint64_t>(n - 1); v++
+		){
+
+			unsigned k = 0;
+			while(
+				k < 5
+			){
+
+				if( r.position() >= n_bits ){ return false; }
+				if( !r.bit() ){ break; }
+				k++;
+			}
+			if( LARGURAS[k] > n_bits - r.position() ){ return false; }
+			r.read(LARGURAS[k]);
+		}
+		return r.position() == n_bits;
+	}
+};
+
+/**
+ * @class FixBlockEncoder
+ * @brief Acrescenta fixes a um FixBlock aberto.
+ */
+class FixBlockEncoder {
+private:
+
+	FixBlock   bloco;
+	CollectorFix ant;
+	int64_t d_t = 0, d_lat = 0, d_lon = 0, d_alt = 0;
+
+public:
+
+	/**
+	 * @brief Acrescenta um fix do rastreador ao bloco.
+	 */
+	void
+	append(
+		const CollectorFix& fix
+	){
+
+		if(
+			bloco.n == 0
+		){
+
+			bloco.tracker  = fix.tracker;
+			bloco.primeiro = fix;
+			bloco.primeiro.flags = 0;
+			bloco.t_min   = bloco.t_max   = fix.t_ms;
+			bloco.lat_min = bloco.lat_max = fix.lat_e6;
+			bloco.lon_min = bloco.lon_max = fix.lon_e6;
+		}
+		else{
+
+			BitWriter w(bloco.bits, bloco.n_bits);
+
+			int64_t nd_t   = fix.t_ms - ant.t_ms;
+			int64_t nd_lat = int64_t(fix.lat_e6) - ant.lat_e6;
+			int64_t nd_lon = int64_t(fix.lon_e6) - ant.lon_e6;
+			int64_t nd_alt = int64_t(fix.alt_dm) - ant.alt_dm;
+
+			FixBlock::put(w, nd_t   - d_t);
+			FixBlock::put(w, nd_lat - d_lat);
+			FixBlock::put(w, nd_lon - d_lon);
+			FixBlock::put(w, nd_alt - d_alt);
+
+			d_t = nd_t; d_lat = nd_lat; d_lon = nd_lon; d_alt = nd_alt;
+
+			bloco.t_min   = std::min(bloco.t_min, fix.t_ms);
+			bloco.t_max   = std::max(bloco.t_max, fix.t_ms);
+			bloco.lat_min = std::min(bloco.lat_min, fix.lat_e6);
+			bloco.lat_max = std::max(bloco.lat_max, fix.lat_e6);
+			bloco.lon_min = std::min(bloco.lon_min, fix.lon_e6);
+			bloco.lon_max = std::max(bloco.lon_max, fix.lon_e6);
+		}
+
+		ant = fix;
+		bloco.n++;
+	}
+
+	const FixBlock& block() const { return bloco; }
+	uint32_t size() const { return bloco.n; }
+
+	/**
+	 * @brief Grava o bloco aberto e os deltas correntes no snapshot.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	) const {
+
+		bloco.save(w);
+		w.put(ant);
+		w.put(d_t); w.put(d_lat); w.put(d_lon); w.put(d_alt);
+	}
+
+	/**
+	 * @brief Retoma a codificação do ponto gravado por save().
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){ return bloco.load(r) && r.get(ant) && r.get(d_t) && r.get(d_lat) && r.get(d_lon) && r.get(d_alt); }
+
+	/**
+	 * @brief Entrega o bloco atual e reinicia o codificador.
+	 * @param intervalo_ms Redução aplicada aos fixes do bloco, se houver.
+	 */
+	std::shared_ptr<const FixBlock>
+	seal(
+		uint32_t intervalo_ms = 0
+	){
+
+		bloco.intervalo_ms = intervalo_ms;
+		bloco.bits.shrink_to_fit();
+		auto selado = std::make_shared<const FixBlock>(std::move(bloco));
+		*this = FixBlockEncoder();
+		return selado;
+	}
+};
+
+/**
+ * @class HistoryStore
+ * @brief Histórico comprimido de toda a frota, particionado por rastreador.
+ * @details
+ *
+ * Cada rastreador possui um bloco aberto e uma lista de blocos selados. Ao atingir
+ * `fixes_por_bloco`, o bloco é selado e torna-se imutável, compartilhado por shared_ptr
+ * com consultas em andamento. Os rastreadores são distribuídos em shards com mutex próprio,
+ * de modo que threads de recepção distintas raramente disputam o mesmo lock.
+ *
+ * Com `fator_lod` > 0, cada rastreador mantém também uma TrackPyramid, e query_lod()
+ * responde com no máximo a quantidade de pontos pedida, seja o intervalo de uma hora
+ * ou de um mês, sem decodificar os blocos.
+ *
+ * compact() reescreve os blocos selados de um rastreador: junta blocos pequenos (de
+ * seal_all() ou de reinícios) e blocos com intervalos sobrepostos (fixes fora de ordem),
+ * ordena os fixes por instante e aplica a Politica de retenção e redução. A decodificação
+ * e a recodificação ocorrem fora do lock; sob o lock, apenas os blocos são trocados.
+ */
+class HistoryStore {
+public:
+
+	using Bloco = std::shared_ptr<const FixBlock>;
+
+	/**
+	 * @struct Stats
+	 * @brief Ocupação do histórico.
+	 */
+	struct Stats {
+		uint64_t    fixes;
+		uint64_t    blocos;        ///< Blocos selados.
+		uint64_t    bytes;         ///< Bytes dos blocos selados.
+		uint64_t    bytes_lod;     ///< Bytes das pirâmides de resolução.
+		std::size_t rastreadores;
+	};
+
+	using Ponto = TrackPyramid::Ponto;
+
+	/**
+	 * @struct Politica
+	 * @brief Retenção e redução aplicadas por compact().
+	 */
+	struct Politica {
+		int64_t  retencao_ms  = 0;     ///< Fixes mais velhos são removidos; 0 mantém tudo.
+		int64_t  reducao_ms   = 0;     ///< Blocos inteiramente mais velhos são reduzidos; 0 desabilita.
+		uint32_t intervalo_ms = 60000; ///< Na redução, mantém o primeiro fix de cada intervalo.
+	};
+
+	/**
+	 * @struct Compactacao
+	 * @brief Trabalho realizado por compact(), acumulado.
+	 */
+	struct Compactacao {
+		uint64_t blocos_lidos    = 0;
+		uint64_t blocos_gravados = 0;
+		uint64_t fixes_lidos     = 0; ///< Decodificados para reescrita.
+		uint64_t fixes_gravados  = 0;
+		uint64_t expirados       = 0; ///< Removidos pela retenção.
+		uint64_t reduzidos       = 0; ///< Removidos pela redução ou como duplicatas.
+		uint64_t bytes_lidos     = 0; ///< Bytes dos blocos substituídos ou removidos.
+		uint64_t bytes_gravados  = 0;
+	};
+
+private:
+
+	struct Serie {
+		FixBlockEncoder       aberto;
+		std::vector<Bloco>   selados;
+		TrackPyramid        piramide;
+
+		explicit Serie(std::size_t fator_lod) : piramide(fator_lod) {}
+	};
+
+	struct Shard {
+		std::mutex                             mtx;
+		std::unordered_map<uint64_t, Serie> series;
+	};
+
+	std::size_t                     fixes_por_bloco;
+	std::size_t                           fator_lod;
+	std::unique_ptr<Shard[]>                 shards;
+	std::size_t                            n_shards;
+
+	std::atomic<uint64_t>              n_fixes{0};
+	std::atomic<uint64_t>             n_blocos{0};
+	std::atomic<uint64_t>              n_bytes{0};
+	std::atomic<uint64_t>            n_geracao{0}; ///< Alterações das listas de blocos selados.
+
+	Shard& shard_of(uint64_t tracker){ return shards[(tracker * 0x9e3779b97f4a7c15ULL >> 32) % n_shards]; }
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param fixes_por_bloco_ Fixes por bloco; a unidade de acesso aleatório.
+	 * @param n_shards_ Quantidade de partições com lock próprio.
+	 * @param fator_lod_ Redução entre níveis das pirâmides de resolução; 0 as desabilita.
+	 */
+	explicit HistoryStore(
+		std::size_t fixes_por_bloco_ = 1024,
+		std::size_t n_shards_ = 64,
+		std::size_t fator_lod_ = 8
+	) : fixes_por_bloco(std::max<std::size_t>(fixes_por_bloco_, 2)),
+		fator_lod(fator_lod_),
+		shards(new Shard[n_shards_ > 0 ? n_shards_ : 1]),
+		n_shards(n_shards_ > 0 ? n_shards_ : 1) {}
+
+	HistoryStore(const HistoryStore&)            = delete;
+	HistoryStore& operator=(const HistoryStore&) = delete;
+
+	/**
+	 * @brief Acrescenta um fix ao histórico do seu rastreador.
+	 */
+	void
+	append(
+		const CollectorFix& fix
+	){
+
+		Shard& s = shard_of(fix.tracker);
+		std::lock_guard<std::mutex> lock(s.mtx);
+
+		Serie& serie = s.series.try_emplace(fix.tracker, fator_lod).first->second;
+		serie.aberto.append(fix);
+		serie.piramide.append(fix);
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+
+		if(
+			serie.aberto.size() >= fixes_por_bloco
+		){
+
+			serie.selados.push_back(serie.aberto.seal());
+			n_blocos.fetch_add(1, std::memory_order_relaxed);
+			n_bytes.fetch_add(serie.selados.back()->bytes(), std::memory_order_relaxed);
+			n_geracao.fetch_add(1, std::memory_order_release);
+		}
+	}
+
+	/**
+	 * @brief Sela os blocos abertos de todos os rastreadores.
+	 */
+	void
+	seal_all(){
+
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			for(
+				auto& par : shards[i].series
+			){
+
+				if( par.second.aberto.size() == 0 ){ continue; }
+				par.second.selados.push_back(par.second.aberto.seal());
+				n_blocos.fetch_add(1, std::memory_order_relaxed);
+				n_bytes.fetch_add(par.second.selados.back()->bytes(), std::memory_order_relaxed);
+				n_geracao.fetch_add(1, std::memory_order_release);
+			}
+		}
+	}
+
+	/**
+	 * @brief Blocos de um rastreador, incluindo uma cópia do bloco aberto.
+	 * @param tracker Identificador do rastreador.
+	 * @return Blocos em ordem de chegada; vazio caso o rastreador não exista.
+	 */
+	std::vector<Bloco>
+	blocks(
+		uint64_t tracker
+	){
+
+		Shard& s = shard_of(tracker);
+		std::lock_guard<std::mutex> lock(s.mtx);
+
+		auto it = s.series.find(tracker);
+		if( it == s.series.end() ){ return {}; }
+
+		std::vector<Bloco> blocos = it->second.selados;
+		if( it->second.aberto.size() > 0 ){ blocos.push_back(std::make_shared<const FixBlock>(it->second.aberto.block())); }
+		return blocos;
+	}
+
+	/**
+	 * @brief Entrega os fixes de um rastreador no intervalo [t_ini, t_fim].
+	 * @param visitar Função `void(const CollectorFix&)`.
+	 * @return Quantidade de fixes entregues.
+	 * @details
+	 *
+	 * Apenas os blocos cujo intervalo de tempo intersecta a consulta são decodificados.
+	 */
+	template <typename F>
+	std::size_t
+	query(
+		uint64_t tracker,
+		int64_t t_ini,
+		int64_t t_fim,
+		F&& visitar
+	){
+
+		std::size_t n = 0;
+		for(
+			const Bloco& b : blocks(tracker)
+		){
+
+			if( !b->overlaps(t_ini, t_fim) ){ continue; }
+			b->decode([&](const CollectorFix& fix){
+
+				if( fix.t_ms < t_ini || fix.t_ms > t_fim ){ return; }
+				visitar(fix);
+				n++;
+			});
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Entrega a trajetória de um rastreador em [t_ini, t_fim] com até `max_pontos` pontos.
+	 * @param visitar Função `void(const Ponto&)`, chamada fora do lock.
+	 * @return Nível usado: 0 para os próprios fixes, k para a redução de 1/fator^k.
+	 * @details
+	 *
+	 * O nível é o mais fino que cabe no limite, escolhido por busca binária nos níveis
+	 * da pirâmide; a latência e o tamanho da resposta não dependem do intervalo. Quando
+	 * os fixes cabem no limite, ou sem pirâmide, a consulta recai em query().
+	 */
+	template <typename F>
+	std::size_t
+	query_lod(
+		uint64_t tracker,
+		int64_t t_ini,
+		int64_t t_fim,
+		std::size_t max_pontos,
+		F&& visitar
+	){
+
+		std::vector<Ponto> pontos;
+		std::size_t        nivel = 0;
+		{
+			Shard& s = shard_of(tracker);
+			std::lock_guard<std::mutex> lock(s.mtx);
+
+			auto it = s.series.find(tracker);
+			if( it == s.series.end() ){ return 0; }
+
+			nivel = it->second.piramide.level_for(t_ini, t_fim, max_pontos);
+			if( nivel > 0 ){ it->second.piramide.copy(nivel, t_ini, t_fim, pontos); }
+		}
+
+		if(
+			nivel == 0
+		){
+
+			query(tracker, t_ini, t_fim, [&](const CollectorFix& fix){ visitar(Ponto{ fix.t_ms, fix.lat_e6, fix.lon_e6 }); });
+			return 0;
+		}
+		for( const Ponto& p : pontos ){ visitar(p); }
+		return nivel;
+	}
+
+	/**
+	 * @brief Percorre os blocos selados de todos os rastreadores de um shard.
+	 * @param indice Índice do shard, em [0, shard_count()).
+	 * @param visitar Função `void(const Bloco&)`, chamada fora do lock.
+	 */
+	template <typename F>
+	void
+	for_each_block_in_shard(
+		std::size_t indice,
+		F&& visitar
+	){
+
+		std::vector<Bloco> blocos;
+		{
+			std::lock_guard<std::mutex> lock(shards[indice].mtx);
+			for( const auto& par : shards[indice].series ){ blocos.insert(blocos.end(), par.second.selados.begin(), par.second.selados.end()); }
+		}
+		for( const Bloco& b : blocos ){ visitar(b); }
+	}
+
+	/**
+	 * @brief Percorre os blocos selados de todo o histórico.
+	 */
+	template <typename F>
+	void
+	for_each_block(
+		F&& visitar
+	){ for( std::size_t i = 0; i < n_shards; i++ ){ for_each_block_in_shard(i, visitar); } }
+
+	std::size_t shard_count() const { return n_shards; }
+
+	/**
+	 * @brief Contador de alterações dos blocos selados: selos, compactações e carga do snapshot.
+	 * @details
+	 *
+	 * Quem deriva estruturas dos blocos selados (ScanEngine) compara o valor lido antes de
+	 * percorrê-los com o corrente para saber se precisa refazê-las.
+	 */
+	uint64_t generation() const { return n_geracao.load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Rastreadores de um shard, para percorrê-los com compact().
+	 */
+	std::vector<uint64_t>
+	trackers_in_shard(
+		std::size_t indice
+	){
+
+		std::lock_guard<std::mutex> lock(shards[indice].mtx);
+		std::vector<uint64_t> trackers;
+		trackers.reserve(shards[indice].series.size());
+		for( const auto& par : shards[indice].series ){ trackers.push_back(par.first); }
+		return trackers;
+	}
+
+	/**
+	 * @brief Compacta os blocos selados de um rastreador e aplica a política.
+	 * @param tracker Identificador do rastreador.
+	 * @param politica Retenção e redução.
+	 * @param agora_ms Instante de referência da política, no relógio dos fixes.
+	 * @param[in,out] c Trabalho realizado, acumulado.
+	 * @return True caso algum bloco tenha sido reescrito ou removido.
+	 * @details
+	 *
+	 * Cada bloco selado é:
+	 *
+	 * - removido, se todos os seus fixes excedem a retenção;
+	 * - reescrito, se parte deles a excede, se deve ser reduzido, se seu intervalo de tempo
+	 *   se sobrepõe ao do vizinho ou se é pequeno (menos de metade de `fixes_por_bloco`)
+	 *   ao lado de outro pequeno;
+	 * - mantido, caso contrário.
+	 *
+	 * Cada sequência de blocos reescritos é decodificada, ordenada por instante, sem
+	 * duplicatas, filtrada pela política e recodificada em blocos cheios, com novas caixas
+	 * envolventes. Enquanto isso, append() continua; os blocos só são trocados se o
+	 * início da lista não mudou. O bloco aberto e a pirâmide perdem apenas o que excede
+	 * a retenção, e o rastreador sem fixes restantes é esquecido.
+	 */
+	bool
+	compact(
+		uint64_t tracker,
+		const Politica& politica,
+		int64_t agora_ms,
+		Compactacao& c
+	){
+
+		int64_t limite_ret = politica.retencao_ms > 0 ? agora_ms - politica.retencao_ms : INT64_MIN;
+		int64_t limite_red = politica.reducao_ms > 0 && politica.intervalo_ms > 0 ? agora_ms - politica.reducao_ms : INT64_MIN;
+
+		Shard& s = shard_of(tracker);
+		std::vector<Bloco> selados;
+		{
+			std::lock_guard<std::mutex> lock(s.mtx);
+			auto it = s.series.find(tracker);
+			if( it == s.series.end() ){ return false; }
+			selados = it->second.selados;
+		}
+
+		// Classificação
+		enum Destino : uint8_t { MANTER, REESCREVER, REMOVER };
+		std::size_t          n       = selados.size();
+		std::size_t          pequeno = fixes_por_bloco / 2;
+		std::vector<Destino> destino(n, MANTER);
+		bool                 mudou   = false;
+		for(
+			std::size_t i = 0; i < n; i++
+		){
+
+			const FixBlock& b = *selados[i];
+			if( b.t_max < limite_ret ){ destino[i] = REMOVER; mudou = true; continue; }
+
+			bool reescrever = b.t_min < limite_ret || (b.t_max < limite_red && b.intervalo_ms != politica.intervalo_ms);
+			if(
+				i > 0 && destino[i - 1] != REMOVER
+			){
+
+				const FixBlock& a = *selados[i - 1];
+				if( b.t_min <= a.t_max || (a.n < pequeno && b.n < pequeno) ){ reescrever = true; destino[i - 1] = REESCREVER; }
+			}
+			if( reescrever ){ destino[i] = REESCREVER; }
+			mudou = mudou || reescrever;
+		}
+
+		// Reescrita, fora do lock
+		Compactacao               feito;
+		std::vector<Bloco>        novos;
+		std::vector<CollectorFix> fixes;
+		uint64_t                  removidos = 0; ///< Fixes dos blocos substituídos ou removidos.
+		for(
+			std::size_t i = 0; mudou && i < n;
+		){
+
+			if( destino[i] == MANTER ){ novos.push_back(selados[i++]); continue; }
+
+			fixes.clear();
+			Destino d = destino[i];
+			for(
+				; i < n && destino[i] == d; i++
+			){
+
+				feito.blocos_lidos++;
+				feito.bytes_lidos += selados[i]->bytes();
+				removidos         += selados[i]->n;
+				if( d == REMOVER ){ feito.expirados += selados[i]->n; }
+				else{ selados[i]->decode(fixes); }
+			}
+			if( d == REMOVER ){ continue; }
+			feito.fixes_lidos += fixes.size();
+
+			std::stable_sort(fixes.begin(), fixes.end(), [](const CollectorFix& a, const CollectorFix& b){ return a.t_ms < b.t_ms; });
+
+			FixBlockEncoder enc;
+			auto selar = [&]{
+
+				bool reduzido = enc.block().t_max < limite_red;
+				novos.push_back(enc.seal(reduzido ? politica.intervalo_ms : 0));
+				feito.blocos_gravados++;
+				feito.bytes_gravados += novos.back()->bytes();
+			};
+
+			// Continua do bloco anterior: um intervalo já representado nele não se repete
+			int64_t ultimo_t = INT64_MIN, ultimo_intervalo = INT64_MIN;
+			if(
+				!novos.empty()
+			){
+
+				ultimo_t = novos.back()->t_max;
+				if( ultimo_t < limite_red ){ ultimo_intervalo = ultimo_t / politica.intervalo_ms; }
+			}
+			for(
+				const CollectorFix& f : fixes
+			){
+
+				if( f.t_ms < limite_ret ){ feito.expirados++; continue; }
+				if( f.t_ms == ultimo_t ){ feito.reduzidos++; continue; }
+				if(
+					f.t_ms < limite_red
+				){
+
+					int64_t k = f.t_ms / politica.intervalo_ms;
+					if( k == ultimo_intervalo ){ feito.reduzidos++; continue; }
+					ultimo_intervalo = k;
+				}
+				ultimo_t = f.t_ms;
+				enc.append(f);
+				feito.fixes_gravados++;
+				if( enc.size() >= fixes_por_bloco ){ selar(); }
+			}
+			if( enc.size() > 0 ){ selar(); }
+		}
+		c.fixes_lidos += feito.fixes_lidos;
+
+		std::lock_guard<std::mutex> lock(s.mtx);
+		auto it = s.series.find(tracker);
+		if( it == s.series.end() ){ return false; }
+		Serie& serie = it->second;
+
+		if(
+			mudou
+		){
+
+			// Só a compactação remove blocos; se o início da lista mudou, outra a antecedeu
+			if( serie.selados.size() < n || !std::equal(selados.begin(), selados.end(), serie.selados.begin()) ){ return false; }
+
+			serie.selados.erase(serie.selados.begin(), serie.selados.begin() + n);
+			serie.selados.insert(serie.selados.begin(), novos.begin(), novos.end());
+
+			n_fixes.fetch_sub(removidos - feito.fixes_gravados, std::memory_order_relaxed);
+			n_blocos.fetch_sub(feito.blocos_lidos - feito.blocos_gravados, std::memory_order_relaxed);
+			n_bytes.fetch_add(feito.bytes_gravados - feito.bytes_lidos, std::memory_order_relaxed); // Módulo 2^64
+			n_geracao.fetch_add(1, std::memory_order_release);
+
+			c.blocos_lidos    += feito.blocos_lidos;
+			c.blocos_gravados += feito.blocos_gravados;
+			c.fixes_gravados  += feito.fixes_gravados;
+			c.expirados       += feito.expirados;
+			c.reduzidos       += feito.reduzidos;
+			c.bytes_lidos     += feito.bytes_lidos;
+			c.bytes_gravados  += feito.bytes_gravados;
+		}
+
+		// O bloco aberto e a pirâmide perdem apenas o que excede a retenção
+		if(
+			serie.aberto.size() > 0 && serie.aberto.block().t_max < limite_ret
+		){
+
+			c.expirados += serie.aberto.size();
+			n_fixes.fetch_sub(serie.aberto.size(), std::memory_order_relaxed);
+			serie.aberto = FixBlockEncoder();
+			mudou = true;
+		}
+		serie.piramide.drop_before(limite_ret);
+		if( serie.selados.empty() && serie.aberto.size() == 0 ){ s.series.erase(it); }
+
+		return mudou;
+	}
+
+	/**
+	 * @brief Grava o histórico no snapshot: contadores e, por rastreador, os blocos
+	 * selados, o bloco aberto e a pirâmide.
+	 * @details
+	 *
+	 * Adquire o lock de cada shard; não pode haver escritores concorrentes, para que o
+	 * snapshot corresponda a um único instante.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	){
+
+		w.put(n_fixes.load());
+		w.put(n_blocos.load());
+		w.put(n_bytes.load());
+
+		uint64_t n_series = 0;
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			n_series += shards[i].series.size();
+		}
+		w.put(n_series);
+
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			for(
+				const auto& par : shards[i].series
+			){
+
+				w.put(par.first);
+				w.put<uint64_t>(par.second.selados.size());
+				for( const Bloco& b : par.second.selados ){ b->save(w); }
+				par.second.aberto.save(w);
+				par.second.piramide.save(w);
+			}
+		}
+	}
+
+	/**
+	 * @brief Carrega em um histórico vazio o que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 * @details
+	 *
+	 * Os rastreadores são redistribuídos pelos shards deste histórico, de modo que a
+	 * quantidade de shards pode diferir da do snapshot.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		uint64_t fixes = 0, blocos = 0, bytes = 0, n_series = 0;
+		if( !r.get(fixes) || !r.get(blocos) || !r.get(bytes) || !r.get(n_series) ){ return false; }
+
+		for(
+			uint64_t i = 0; i < n_series; i++
+		){
+
+			uint64_t tracker = 0, n_selados = 0;
+			if( !r.get(tracker) || !r.get(n_selados) ){ return false; }
+
+			Shard& s = shard_of(tracker);
+			std::lock_guard<std::mutex> lock(s.mtx);
+			Serie& serie = s.series.try_emplace(tracker, fator_lod).first->second;
+
+			serie.selados.reserve(n_selados);
+			for(
+				uint64_t k = 0; k < n_selados; k++
+			){
+
+				auto b = std::make_shared<FixBlock>();
+				if( !b->load(r) ){ return false; }
+				serie.selados.push_back(std::move(b));
+			}
+			if( !serie.aberto.load(r) || !serie.piramide.load(r) ){ return false; }
+		}
+
+		n_fixes.store(fixes);
+		n_blocos.store(blocos);
+		n_bytes.store(bytes);
+		n_geracao.fetch_add(1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Obtém a ocupação do histórico.
+	 */
+	Stats
+	stats(){
+
+		Stats s;
+		s.fixes        = n_fixes.load(std::memory_order_relaxed);
+		s.blocos       = n_blocos.load(std::memory_order_relaxed);
+		s.bytes        = n_bytes.load(std::memory_order_relaxed);
+		s.bytes_lod    = 0;
+		s.rastreadores = 0;
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			s.rastreadores += shards[i].series.size();
+			for( const auto& par : shards[i].series ){ s.bytes_lod += par.second.piramide.bytes(); }
+		}
+		return s;
+	}
+};
+
+#endif // HISTORYSTORE_HPP
@@ -0,0 +1,439 @@
+/**
+ * @file MapMatcher.hpp
+ * @brief Casamento online de fixes com o grafo viário, por HMM e Viterbi.
+ * @details
+ * O ruído do NEO-6M desloca os fixes para fora das vias, o que torna ruidosas as
+ * verificações de conformidade de rota. O casamento escolhe, para cada fix, a posição
+ * na via que melhor explica a sequência inteira de fixes, e não apenas a aresta mais
+ * próxima de cada um.
+ */
+#ifndef MAPMATCHER_HPP
+#define MAPMATCHER_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "GPSFix.hpp"
+#include "RoadGraph.hpp"
+
+/**
+ * @struct MatchedFix
+ * @brief Fix casado com uma posição na malha viária.
+ */
+struct MatchedFix {
+	uint64_t tracker     = 0;
+	int64_t  t_ms        = 0;
+	int32_t  lat_e6      = 0, lon_e6 = 0;         ///< Fix original.
+	int32_t  lat_via     = 0, lon_via = 0;        ///< Posição casada.
+	uint32_t aresta      = 0;
+	float    distancia_m = 0;                     ///< Entre o fix e a posição casada.
+
+	/**
+	 * @brief Linha CSV `rastreador,t_ms,lat,lon,lat_via,lon_via,aresta,distancia_m`.
+	 */
+	std::string
+	to_csv() const {
+
+		char linha[192];
+		std::snprintf(linha, sizeof(linha), "%llu,%lld,%.6f,%.6f,%.6f,%.6f,%u,%.1f\n",
+					  static_cast<unsigned long long>(tracker), static_cast<long long>(t_ms),
+					  lat_e6 * 1e-6, lon_e6 * 1e-6, lat_via * 1e-6, lon_via * 1e-6, aresta, distancia_m);
+		return linha;
+	}
+};
+
+/**
+ * @class MapMatcher
+ * @brief Viterbi incremental por rastreador, no modelo de Newson e Krumm.
+ * @details
+ *
+ * Cada fix gera uma coluna de até MAX_CANDIDATOS arestas a até `raio_m`:
+ *
+ * - Emissão: gaussiana da distância entre o fix e a projeção na aresta, com desvio `sigma_m`.
+ * - Transição: exponencial da diferença entre a distância pela malha e a distância em linha
+ *   reta entre fixes consecutivos, com escala `beta_m`. Caminhos pela malha muito mais longos
+ *   que o deslocamento são implausíveis.
+ *
+ * O casamento é online: uma coluna é emitida assim que todos os caminhos sobreviventes
+ * passam pelo mesmo candidato nela (convergência), ou quando a janela atinge `janela_max`
+ * colunas, seguindo o melhor caminho. Lacunas de tempo, fixes sem candidatos e quebras de
+ * conectividade encerram a cadeia atual, emitindo-a pelo melhor caminho. O estado de
+ * rastreadores que silenciam é emitido e descartado por expire().
+ *
+ * O estado de cada rastreador tem tamanho variável e fica em shards protegidos por mutex,
+ * como no HistoryStore; fixes de um mesmo rastreador chegam sempre pela mesma thread de
+ * recepção, então a disputa é rara.
+ */
+class MapMatcher {
+public:
+
+	static constexpr std::size_t MAX_CANDIDATOS = 8;
+
+	using Sink = std::function<void(const MatchedFix&)>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de casamento.
+	 */
+	struct Stats {
+		uint64_t fixes;
+		uint64_t casados;
+		uint64_t sem_candidato;
+		uint64_t quebras;      ///< Cadeias encerradas por lacuna ou falta de conectividade.
+	};
+
+private:
+
+	struct Coluna {
+		CollectorFix                        fix;
+		uint32_t                              n;
+		RoadGraph::Candidate c[MAX_CANDIDATOS];
+		double           score[MAX_CANDIDATOS];
+		int8_t             pai[MAX_CANDIDATOS]; ///< Candidato da coluna anterior; -1 na primeira.
+	};
+
+	struct Trilha {
+		std::deque<Coluna> colunas;
+	};
+
+	struct Shard {
+		std::mutex                            mtx;
+		std::unordered_map<uint64_t, Trilha> trilhas;
+	};
+
+	const RoadGraph&                grafo;
+	double                         sigma_m;
+	double                          beta_m;
+	double                          raio_m;
+	std::size_t                 janela_max;
+	int64_t                     lacuna_ms = 60000;
+
+	std::vector<Shard>              shards;
+	Sink                              sink;
+
+	std::atomic<uint64_t>          n_fixes{0};
+	std::atomic<uint64_t>        n_casados{0};
+	std::atomic<uint64_t>  n_sem_candidato{0};
+	std::atomic<uint64_t>        n_quebras{0};
+
+	Shard& shard_of(uint64_t tracker){ return shards[(tracker * 0x9e3779b97f4a7c15ULL) >> 58 & (shards.size() - 1)]; }
+
+	/**
+	 * @brief Emite as `n` primeiras colunas, seguindo o caminho que chega a `indice` na coluna n - 1.
+	 */
+	void
+	emit(
+		std::deque<Coluna>& colunas,
+		std::size_t n,
+		int indice,
+		bool emitir
+	){
+
+		std::vector<int> caminho(n);
+		for( std::size_t k = n; k-- > 0; ){ caminho[k] = indice; indice = colunas[k].pai[indice]; }
+
+		for(
+			std::size_t k = 0; k < n; k++
+		){
+
+			const Coluna&               col = colunas[k];
+			const RoadGraph::Candidate& c   = col.c[caminho[k]];
+
+			n_casados.fetch_add(1, std::memory_order_relaxed);
+			if(
+				emitir && sink
+			){
+
+				MatchedFix m;
+				m.tracker     = col.fix.tracker;
+				m.t_ms        = col.fix.t_ms;
+				m.lat_e6      = col.fix.lat_e6; m.lon_e6  = col.fix.lon_e6;
+				m.lat_via     = c.lat_e6;       m.lon_via = c.lon_e6;
+				m.aresta      = c.aresta;
+				m.distancia_m = c.distancia_m;
+				sink(m);
+			}
+		}
+		colunas.erase(colunas.begin(), colunas.begin() + static_cast<std::ptrdiff_t>(n));
+		if( !colunas.empty() ){ for( uint32_t i = 0; i < colunas.front().n; i++ ){ colunas.front().pai[i] = -1; } }
+	}
+
+	/**
+	 * @brief Emite toda a cadeia pelo melhor caminho.
+	 */
+	void
+	flush_chain(
+		std::deque<Coluna>& colunas,
+		bool emitir
+	){
+
+		if( colunas.empty() ){ return; }
+		const Coluna& ultima = colunas.back();
+		int melhor = 0;
+		for( uint32_t i = 1; i < ultima.n; i++ ){ if( ultima.score[i] > ultima.score[melhor] ){ melhor = static_cast<int>(i); } }
+		emit(colunas, colunas.size(), melhor, emitir);
+	}
+
+	/**
+	 * @brief Emite as colunas já decididas: as anteriores à última convergência dos caminhos.
+	 */
+	void
+	emit_converged(
+		std::deque<Coluna>& colunas,
+		bool emitir
+	){
+
+		// Conjunto de candidatos vivos, da última coluna para trás
+		uint32_t vivos = 0;
+		const Coluna& ultima = colunas.back();
+		for( uint32_t i = 0; i < ultima.n; i++ ){ if( std::isfinite(ultima.score[i]) ){ vivos |= 1u << i; } }
+
+		for(
+			std::size_t k = colunas.size() - 1; k > 0; k--
+		){
+
+			uint32_t pais = 0;
+			for( uint32_t i = 0; i < colunas[k].n; i++ ){ if( vivos >> i & 1 ){ pais |= 1u << colunas[k].pai[i]; } }
+			vivos = pais;
+
+			if( __builtin_popcount(vivos) == 1 ){ emit(colunas, k, __builtin_ctz(vivos), emitir); return; }
+		}
+
+		if( colunas.size() >= janela_max ){ flush_window(colunas, emitir); }
+	}
+
+	/**
+	 * @brief Emite a metade mais antiga da janela pelo melhor caminho atual.
+	 */
+	void
+	flush_window(
+		std::deque<Coluna>& colunas,
+		bool emitir
+	){
+
+		const Coluna& ultima = colunas.back();
+		int melhor = 0;
+		for( uint32_t i = 1; i < ultima.n; i++ ){ if( ultima.score[i] > ultima.score[melhor] ){ melhor = static_cast<int>(i); } }
+
+		std::size_t n = colunas.size() / 2;
+		for( std::size_t k = colunas.size() - 1; k >= n; k-- ){ melhor = colunas[k].pai[melhor]; }
+		emit(colunas, n, melhor, emitir);
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param grafo_ Grafo viário; deve sobreviver ao casador.
+	 * @param sigma_m_ Desvio do erro de posição dos fixes.
+	 * @param beta_m_ Escala da diferença entre distância pela malha e em linha reta.
+	 * @param raio_m_ Distância máxima entre o fix e as arestas candidatas.
+	 * @param janela_max_ Colunas pendentes a partir das quais o casamento é forçado.
+	 */
+	explicit MapMatcher(
+		const RoadGraph& grafo_,
+		double sigma_m_ = 10,
+		double beta_m_ = 10,
+		double raio_m_ = 50,
+		std::size_t janela_max_ = 30
+	) : grafo(grafo_),
+		sigma_m(sigma_m_),
+		beta_m(beta_m_),
+		raio_m(raio_m_),
+		janela_max(janela_max_ < 2 ? 2 : janela_max_),
+		shards(64) {}
+
+	/**
+	 * @brief Define a função que recebe os fixes casados. Deve ser chamado antes da ingestão.
+	 * @details
+	 *
+	 * Chamada pelas threads de recepção, sob o lock do shard do rastreador; deve ser thread-safe.
+	 */
+	void on_match(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Incorpora um fix à cadeia do rastreador.
+	 * @param fix Fix do rastreador.
+	 * @param emitir False durante a reaplicação do WAL, cujos casamentos já foram emitidos.
+	 */
+	void
+	apply(
+		const CollectorFix& fix,
+		bool emitir = true
+	){
+
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+
+		Coluna col;
+		col.fix = fix;
+		col.n   = static_cast<uint32_t>(grafo.candidates(fix.lat_e6, fix.lon_e6, raio_m, col.c, MAX_CANDIDATOS));
+		if( col.n == 0 ){ n_sem_candidato.fetch_add(1, std::memory_order_relaxed); }
+
+		for(
+			uint32_t i = 0; i < col.n; i++
+		){
+
+			double z = col.c[i].distancia_m / sigma_m;
+			col.score[i] = -0.5 * z * z;
+			col.pai[i]   = -1;
+		}
+
+		Shard& s = shard_of(fix.tracker);
+		std::lock_guard<std::mutex> lock(s.mtx);
+		std::deque<Coluna>& colunas = s.trilhas[fix.tracker].colunas;
+
+		if( !colunas.empty() && fix.t_ms <= colunas.back().fix.t_ms ){ return; }
+		if( col.n == 0 ){ flush_chain(colunas, emitir); return; }
+
+		if(
+			!colunas.empty()
+		){
+
+			const Coluna& ant = colunas.back();
+			double reta = GPSFix::distance_m(ant.fix.lat(), ant.fix.lon(), fix.lat(), fix.lon());
+
+			bool conectado = false;
+			if(
+				fix.t_ms - ant.fix.t_ms <= lacuna_ms
+			){
+
+				// Distâncias pela malha entre cada candidato anterior e os atuais
+				uint32_t alvos[MAX_CANDIDATOS];
+				for( uint32_t j = 0; j < col.n; j++ ){ alvos[j] = grafo.edge(col.c[j].aresta).de; }
+				double melhor[MAX_CANDIDATOS];
+				for( uint32_t j = 0; j < col.n; j++ ){ melhor[j] = -INFINITY; }
+
+				for(
+					uint32_t i = 0; i < ant.n; i++
+				){
+
+					if( !std::isfinite(ant.score[i]) ){ continue; }
+
+					const RoadGraph::Candidate& a  = ant.c[i];
+					const RoadGraph::Edge&      ea = grafo.edge(a.aresta);
+					double pela_malha[MAX_CANDIDATOS];
+					grafo.route_distances(ea.para, alvos, col.n, 2 * reta + 2 * raio_m + 100, pela_malha);
+
+					for(
+						uint32_t j = 0; j < col.n; j++
+					){
+
+						const RoadGraph::Candidate& b = col.c[j];
+						// Na mesma aresta, recuos de até 2 sigma são tratados como ruído e não como volta na quadra
+						double rota = (b.aresta == a.aresta && b.deslocamento_m >= a.deslocamento_m - 2 * sigma_m)
+									? std::fabs(b.deslocamento_m - a.deslocamento_m)
+									: (ea.comprimento_m - a.deslocamento_m) + pela_malha[j] + b.deslocamento_m;
+						if( !std::isfinite(rota) ){ continue; }
+
+						double v = ant.score[i] - std::fabs(rota - reta) / beta_m;
+						if( v > melhor[j] ){ melhor[j] = v; col.pai[j] = static_cast<int8_t>(i); }
+					}
+				}
+
+				for(
+					uint32_t j = 0; j < col.n; j++
+				){
+
+					col.score[j] = std::isfinite(melhor[j]) ? col.score[j] + melhor[j] : -INFINITY;
+					conectado   |= std::isfinite(col.score[j]);
+				}
+			}
+
+			if(
+				!conectado
+			){
+
+				n_quebras.fetch_add(1, std::memory_order_relaxed);
+				flush_chain(colunas, emitir);
+				for( uint32_t j = 0; j < col.n; j++ ){ double z = col.c[j].distancia_m / sigma_m; col.score[j] = -0.5 * z * z; col.pai[j] = -1; }
+			}
+			else{
+
+				// Renormaliza para evitar que os scores cresçam sem limite
+				double topo = -INFINITY;
+				for( uint32_t j = 0; j < col.n; j++ ){ topo = std::max(topo, col.score[j]); }
+				for( uint32_t j = 0; j < col.n; j++ ){ col.score[j] -= topo; }
+			}
+		}
+
+		colunas.push_back(col);
+		emit_converged(colunas, emitir);
+	}
+
+	/**
+	 * @brief Emite as cadeias pendentes de todos os rastreadores.
+	 */
+	void
+	flush_all(
+		bool emitir = true
+	){
+
+		for(
+			Shard& s : shards
+		){
+
+			std::lock_guard<std::mutex> lock(s.mtx);
+			for( auto& [tracker, trilha] : s.trilhas ){ flush_chain(trilha.colunas, emitir); }
+			s.trilhas.clear();
+		}
+	}
+
+	/**
+	 * @brief Emite e descarta as cadeias de rastreadores sem fixes há mais de `ocioso_ms`.
+	 * @param agora_ms Instante atual, no relógio dos fixes.
+	 * @param ocioso_ms Intervalo sem fixes; a partir de `lacuna_ms` o próximo fix já encerraria a cadeia.
+	 * @return Quantidade de rastreadores descartados.
+	 */
+	std::size_t
+	expire(
+		int64_t agora_ms,
+		int64_t ocioso_ms
+	){
+
+		std::size_t n = 0;
+		for(
+			Shard& s : shards
+		){
+
+			std::lock_guard<std::mutex> lock(s.mtx);
+			for(
+				auto it = s.trilhas.begin(); it != s.trilhas.end();
+			){
+
+				std::deque<Coluna>& colunas = it->second.colunas;
+				if( !colunas.empty() && agora_ms - colunas.back().fix.t_ms <= ocioso_ms ){ ++it; continue; }
+
+				flush_chain(colunas, true);
+				it = s.trilhas.erase(it);
+				n++;
+			}
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Obtém os contadores de casamento.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.fixes         = n_fixes.load(std::memory_order_relaxed);
+		s.casados       = n_casados.load(std::memory_order_relaxed);
+		s.sem_candidato = n_sem_candidato.load(std::memory_order_relaxed);
+		s.quebras       = n_quebras.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // MAPMATCHER_HPP
@@ -0,0 +1,105 @@
+/**
+ * @file MpscRing.hpp
+ * @brief Fila circular limitada, com vários produtores e um consumidor, sem locks.
+ * @details
+ * Entrega valores de threads que não podem esperar (recepção, leitura da serial) a uma
+ * única thread consumidora. Com a fila cheia, o produtor descarta o valor em vez de esperar.
+ */
+#ifndef MPSCRING_HPP
+#define MPSCRING_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @class MpscRing
+ * @brief Fila circular limitada de vários produtores e um consumidor.
+ * @tparam T Tipo armazenado, copiável.
+ * @details
+ *
+ * Cada posição carrega um número de sequência (à maneira de Vyukov): o produtor reserva
+ * a posição com um CAS no índice de escrita e a publica ao gravar a sequência seguinte.
+ * push() nunca espera; com a fila cheia, retorna false.
+ */
+template <typename T>
+class MpscRing {
+private:
+
+	struct Posicao {
+		std::atomic<uint64_t> seq;
+		T                     valor;
+	};
+
+	std::unique_ptr<Posicao[]>         posicoes;
+	uint64_t                            mascara;
+	alignas(64) std::atomic<uint64_t> escrita{0};
+	alignas(64) uint64_t                leitura = 0; ///< Apenas o consumidor.
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade Arredondada para a potência de 2 seguinte.
+	 */
+	explicit MpscRing(
+		std::size_t capacidade
+	){
+
+		std::size_t n = 2;
+		while( n < capacidade ){ n <<= 1; }
+		posicoes.reset(new Posicao[n]);
+		mascara = n - 1;
+		for( std::size_t i = 0; i < n; i++ ){ posicoes[i].seq.store(i, std::memory_order_relaxed); }
+	}
+
+	bool
+	push(
+		const T& valor
+	){
+
+		uint64_t pos = escrita.load(std::memory_order_relaxed);
+		while(
+			true
+		){
+
+			Posicao& p   = posicoes[pos & mascara];
+			int64_t  dif = static_cast<int64_t>(p.seq.load(std::memory_order_acquire) - pos);
+			if(
+				dif == 0
+			){
+
+				if(
+					escrita.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)
+				){
+
+					p.valor = valor;
+					p.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if( dif < 0 ){ return false; }
+			else{ pos = escrita.load(std::memory_order_relaxed); }
+		}
+	}
+
+	/**
+	 * @brief Retira o valor mais antigo. Apenas o consumidor.
+	 */
+	bool
+	pop(
+		T& valor
+	){
+
+		Posicao& p = posicoes[leitura & mascara];
+		if( p.seq.load(std::memory_order_acquire) != leitura + 1 ){ return false; }
+
+		valor = p.valor;
+		p.seq.store(leitura + mascara + 1, std::memory_order_release);
+		leitura++;
+		return true;
+	}
+};
+
+#endif // MPSCRING_HPP
@@ -0,0 +1,421 @@
+/**
+ * @file NumaMemory.hpp
+ * @brief Topologia NUMA, afinidade de threads e memória local ao nó em páginas enormes.
+ * @details
+ * Em servidores com dois ou mais soquetes, uma thread que atualiza memória de outro nó paga
+ * a travessia da interconexão a cada linha de cache. Este arquivo reúne o necessário para
+ * manter a recepção e o estado de cada rastreador no mesmo nó, sem depender de libnuma:
+ * a topologia é lida de /sys e as políticas de memória são aplicadas com syscalls.
+ */
+#ifndef NUMAMEMORY_HPP
+#define NUMAMEMORY_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Específicos de Sistemas Linux
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/filter.h>
+#include <linux/mempolicy.h>
+
+/**
+ * @class NumaTopology
+ * @brief Nós NUMA da máquina e suas CPUs.
+ * @details
+ *
+ * Lida uma única vez de /sys/devices/system/node. Sem NUMA (ou sem /sys), há um único nó
+ * com todas as CPUs.
+ *
+ * Também define a distribuição dos rastreadores entre os nós: steer_hash() combina o
+ * endereço IPv4 e a porta de origem, as mesmas metades do identificador de
+ * CollectorFix::tracker_id(), com operações que o BPF clássico reproduz no kernel
+ * (reuseport_program()). Assim, o datagrama de um rastreador chega a uma thread do mesmo
+ * nó em que está o seu estado.
+ */
+class NumaTopology {
+private:
+
+	std::vector<std::vector<int>>        cpus; ///< CPUs de cada nó.
+	std::vector<int>                      ids; ///< Número do nó no kernel (nodeN).
+	std::vector<int>               no_da_cpu;
+
+	/**
+	 * @brief Interpreta uma lista de CPUs de /sys, como `0-3,8-11`.
+	 */
+	static std::vector<int>
+	parse_cpulist(
+		const char* texto
+	){
+
+		std::vector<int> lista;
+		const char* p = texto;
+		while(
+			*p >= '0' && *p <= '9'
+		){
+
+			char* fim = nullptr;
+			int a = static_cast<int>(std::strtol(p, &fim, 10)), b = a;
+			if( *fim == '-' ){ b = static_cast<int>(std::strtol(fim + 1, &fim, 10)); }
+			for( int c = a; c <= b; c++ ){ lista.push_back(c); }
+			p = (*fim == ',') ? fim + 1 : fim;
+		}
+		return lista;
+	}
+
+	NumaTopology(){
+
+		if(
+			DIR* dir = ::opendir("/sys/devices/system/node")
+		){
+
+			std::vector<int> nos;
+			while(
+				dirent* e = ::readdir(dir)
+			){
+
+				int no;
+				if( std::sscanf(e->d_name, "node%d", &no) == 1 ){ nos.push_back(no); }
+			}
+			::closedir(dir);
+			std::sort(nos.begin(), nos.end());
+
+			for(
+				int no : nos
+			){
+
+				char caminho[96], texto[4096] = {};
+				std::snprintf(caminho, sizeof(caminho), "/sys/devices/system/node/node%d/cpulist", no);
+				std::FILE* f = std::fopen(caminho, "r");
+				if( !f ){ continue; }
+				std::size_t n = std::fread(texto, 1, sizeof(texto) - 1, f);
+				std::fclose(f);
+				texto[n] = '\0';
+
+				// Nós apenas com memória (sem CPUs) não recebem threads
+				std::vector<int> lista = parse_cpulist(texto);
+				if( !lista.empty() ){ cpus.push_back(lista); ids.push_back(no); }
+			}
+		}
+
+		if(
+			cpus.empty()
+		){
+
+			cpus.emplace_back();
+			ids.assign(1, 0);
+			for( unsigned c = 0; c < std::max(1u, std::thread::hardware_concurrency()); c++ ){ cpus.back().push_back(static_cast<int>(c)); }
+		}
+
+		for(
+			std::size_t no = 0; no < cpus.size(); no++
+		){
+
+			for(
+				int c : cpus[no]
+			){
+
+				if( c >= static_cast<int>(no_da_cpu.size()) ){ no_da_cpu.resize(c + 1, 0); }
+				no_da_cpu[c] = static_cast<int>(no);
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Topologia da máquina, lida na primeira chamada.
+	 */
+	static const NumaTopology&
+	system(){
+
+		static const NumaTopology topologia;
+		return topologia;
+	}
+
+	std::size_t nodes() const { return cpus.size(); }
+
+	const std::vector<int>& cpus_of(std::size_t no) const { return cpus[no]; }
+
+	/**
+	 * @brief Número no kernel do nó de índice `no`; os índices ignoram nós sem CPUs.
+	 */
+	int node_id(std::size_t no) const { return ids[no % ids.size()]; }
+
+	int
+	node_of_cpu(
+		int cpu
+	) const { return (cpu >= 0 && cpu < static_cast<int>(no_da_cpu.size())) ? no_da_cpu[cpu] : 0; }
+
+	/**
+	 * @brief Nó da CPU em que a thread está executando agora.
+	 */
+	int current_node() const { return node_of_cpu(::sched_getcpu()); }
+
+	/**
+	 * @brief Restringe a thread atual às CPUs de um nó.
+	 * @return False caso a afinidade não possa ser aplicada.
+	 */
+	bool
+	pin_thread(
+		std::size_t no
+	) const {
+
+		cpu_set_t conjunto;
+		CPU_ZERO(&conjunto);
+		for( int c : cpus[no % cpus.size()] ){ if( c < CPU_SETSIZE ){ CPU_SET(c, &conjunto); } }
+		return ::pthread_setaffinity_np(::pthread_self(), sizeof(conjunto), &conjunto) == 0;
+	}
+
+	/**
+	 * @brief Índice do nó em que reside a página de um endereço já tocado.
+	 * @return -1 caso o kernel não informe (sem NUMA ou página ausente).
+	 */
+	int
+	node_of_address(
+		const void* p
+	) const {
+
+		int id = -1;
+		if( ::syscall(SYS_get_mempolicy, &id, nullptr, 0, const_cast<void*>(p), MPOL_F_NODE | MPOL_F_ADDR) != 0 ){ return -1; }
+		for( std::size_t no = 0; no < ids.size(); no++ ){ if( ids[no] == id ){ return static_cast<int>(no); } }
+		return -1;
+	}
+
+	/**
+	 * @brief Hash de 32 bits da origem do datagrama, igual ao de reuseport_program().
+	 * @param tracker Identificador de CollectorFix::tracker_id(): IPv4 << 16 | porta.
+	 */
+	static uint32_t
+	steer_hash(
+		uint64_t tracker
+	){ return (static_cast<uint32_t>(tracker >> 16) ^ static_cast<uint32_t>(tracker & 0xFFFF)) * 0x9E3779B1u >> 8; }
+
+	/**
+	 * @brief Nó ao qual o rastreador pertence.
+	 */
+	std::size_t
+	node_of_tracker(
+		uint64_t tracker
+	) const { return steer_hash(tracker) % cpus.size(); }
+
+	/**
+	 * @brief Função de partição da TrackerTable: os shards são intercalados entre os nós
+	 * (shard i no nó i % nodes()) e cada rastreador cai em um shard do seu nó.
+	 */
+	static std::size_t
+	shard_of_tracker(
+		uint64_t tracker,
+		uint64_t h,
+		std::size_t n_shards
+	){
+
+		// No caminho de cada atualização: com potências de 2 (o caso comum), sem divisões
+		static const std::size_t n_nos    = system().nodes();
+		static const bool        potencia = (n_nos & (n_nos - 1)) == 0;
+
+		uint32_t g = steer_hash(tracker);
+		if(
+			potencia && n_shards >= n_nos && (n_shards & (n_shards - 1)) == 0
+		){
+
+			return (g & (n_nos - 1)) + n_nos * ((h >> 32) & (n_shards / n_nos - 1));
+		}
+
+		std::size_t no = g % n_nos;
+		if( n_shards < n_nos ){ return no % n_shards; }
+		return no + n_nos * ((h >> 32) % (n_shards / n_nos));
+	}
+
+	/**
+	 * @brief Programa de BPF clássico que escolhe, no grupo SO_REUSEPORT, o socket de um
+	 * datagrama.
+	 * @param sockets_por_no Sockets de cada nó; o socket i (ordem do bind) pertence ao nó
+	 * i % nodes().
+	 * @details
+	 *
+	 * Para UDP, o programa executa com os dados posicionados na carga útil; o endereço e a
+	 * porta de origem são lidos relativos ao cabeçalho IP (SKF_NET_OFF), supondo cabeçalho
+	 * sem opções. O índice devolvido é `no + nodes() * ((h / nodes()) % sockets_por_no)`.
+	 */
+	std::vector<sock_filter>
+	reuseport_program(
+		uint32_t sockets_por_no
+	) const {
+
+		uint32_t n_nos = static_cast<uint32_t>(cpus.size());
+		return {
+			BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF + 12)), // A = IPv4 de origem
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),                                                 // X = A
+			BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, static_cast<uint32_t>(SKF_NET_OFF + 20)), // A = porta de origem
+			BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+			BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9E3779B1u),
+			BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 8),                                          // A = h
+			BPF_STMT(BPF_ST, 0),                                                             // M[0] = h
+			BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, n_nos),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),                                                 // X = nó
+			BPF_STMT(BPF_LD  | BPF_MEM, 0),
+			BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, n_nos),
+			BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, sockets_por_no),
+			BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, n_nos),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+		};
+	}
+};
+
+/**
+ * @class NumaArena
+ * @brief Regiões de memória presas a um nó NUMA e em páginas enormes.
+ * @details
+ *
+ * allocate() tenta primeiro páginas enormes explícitas (MAP_HUGETLB, do pool de
+ * /proc/sys/vm/nr_hugepages); sem elas, mapeia a região alinhada a 2 MiB e a marca com
+ * MADV_HUGEPAGE para as páginas enormes transparentes. Antes do primeiro acesso, a região
+ * é associada ao nó com mbind (MPOL_PREFERRED: com o nó sem memória livre, o kernel recorre
+ * aos demais em vez de falhar).
+ *
+ * allocate() e release() têm a assinatura dos ganchos de TrackerTable. O índice do nó é
+ * tomado módulo nodes(), de modo que o shard i vai para o nó i % nodes(), a mesma
+ * intercalação de NumaTopology::shard_of_tracker().
+ */
+class NumaArena {
+public:
+
+	/// Tamanho de uma página enorme em x86-64 e ARM64 (com páginas base de 4 KiB).
+	static constexpr std::size_t TAM_PAGINA_ENORME = 2u << 20;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores globais das regiões alocadas.
+	 */
+	struct Stats {
+		uint64_t regioes;
+		uint64_t bytes;
+		uint64_t bytes_hugetlb; ///< Em páginas enormes explícitas; o restante depende do THP.
+	};
+
+private:
+
+	struct Contadores {
+		std::atomic<uint64_t> regioes{0}, bytes{0}, bytes_hugetlb{0};
+	};
+
+	static Contadores& contadores(){ static Contadores c; return c; }
+
+	static std::size_t rounded(std::size_t bytes){ return (bytes + TAM_PAGINA_ENORME - 1) / TAM_PAGINA_ENORME * TAM_PAGINA_ENORME; }
+
+public:
+
+	/**
+	 * @brief Associa uma região ao nó de índice `no`, migrando as páginas já presentes se `mover`.
+	 * @return False caso o kernel recuse (por exemplo, sem suporte a NUMA).
+	 */
+	static bool
+	bind(
+		void* p,
+		std::size_t bytes,
+		std::size_t no,
+		bool mover = false
+	){
+
+		unsigned long mascara[16] = {};
+		std::size_t   id = static_cast<std::size_t>(NumaTopology::system().node_id(no));
+		if( id >= sizeof(mascara) * 8 ){ return false; }
+		mascara[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+
+		// mbind exige início alinhado à página
+		uintptr_t pagina = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+		uintptr_t inicio = reinterpret_cast<uintptr_t>(p) & ~(pagina - 1);
+		std::size_t tamanho = reinterpret_cast<uintptr_t>(p) + bytes - inicio;
+
+		return ::syscall(SYS_mbind, inicio, tamanho, MPOL_PREFERRED, mascara, sizeof(mascara) * 8, mover ? MPOL_MF_MOVE : 0) == 0;
+	}
+
+	/**
+	 * @brief Mapeia uma região local ao nó, em páginas enormes sempre que possível.
+	 * @param bytes Tamanho pedido, arredondado para páginas enormes.
+	 * @param no Índice do nó, módulo nodes(); como gancho de TrackerTable, o índice do shard.
+	 * @return nullptr caso o mapeamento falhe.
+	 */
+	static void*
+	allocate(
+		std::size_t bytes,
+		std::size_t no
+	){
+
+		std::size_t tamanho = rounded(bytes);
+		bool        hugetlb = true;
+		void*       p       = ::mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(
+			p == MAP_FAILED
+		){
+
+			// Sem o pool: alinha a 2 MiB para que o THP cubra a região inteira
+			hugetlb = false;
+			void* bruto = ::mmap(nullptr, tamanho + TAM_PAGINA_ENORME, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if( bruto == MAP_FAILED ){ return nullptr; }
+
+			uintptr_t b = reinterpret_cast<uintptr_t>(bruto);
+			uintptr_t a = (b + TAM_PAGINA_ENORME - 1) & ~(uintptr_t)(TAM_PAGINA_ENORME - 1);
+			if( a > b ){ ::munmap(bruto, a - b); }
+			::munmap(reinterpret_cast<void*>(a + tamanho), b + TAM_PAGINA_ENORME - a);
+			p = reinterpret_cast<void*>(a);
+			::madvise(p, tamanho, MADV_HUGEPAGE);
+		}
+
+		bind(p, tamanho, no);
+
+		Contadores& c = contadores();
+		c.regioes.fetch_add(1, std::memory_order_relaxed);
+		c.bytes.fetch_add(tamanho, std::memory_order_relaxed);
+		if( hugetlb ){ c.bytes_hugetlb.fetch_add(tamanho, std::memory_order_relaxed); }
+		return p;
+	}
+
+	/**
+	 * @brief Desfaz uma região de allocate(); `bytes` é o tamanho pedido.
+	 */
+	static void
+	release(
+		void* p,
+		std::size_t bytes
+	){ if( p ){ ::munmap(p, rounded(bytes)); } }
+
+	static Stats
+	stats(){
+
+		Contadores& c = contadores();
+		return { c.regioes.load(), c.bytes.load(), c.bytes_hugetlb.load() };
+	}
+
+	/**
+	 * @brief Memória anônima do processo em páginas enormes transparentes, segundo o kernel.
+	 */
+	static uint64_t
+	process_thp_bytes(){
+
+		std::FILE* f = std::fopen("/proc/self/smaps_rollup", "r");
+		if( !f ){ return 0; }
+
+		char linha[256];
+		unsigned long kb = 0;
+		while( std::fgets(linha, sizeof(linha), f) ){ if( std::sscanf(linha, "AnonHugePages: %lu kB", &kb) == 1 ){ break; } }
+		std::fclose(f);
+		return static_cast<uint64_t>(kb) << 10;
+	}
+};
+
+#endif // NUMAMEMORY_HPP
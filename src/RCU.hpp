@@ -0,0 +1,147 @@
+/**
+ * @file RCU.hpp
+ * @brief Ponteiro publicado no estilo RCU (Read-Copy-Update).
+ * @details
+ * Estruturas que mudam raramente, mas são lidas a todo ciclo pela thread worker,
+ * são publicadas como objetos imutáveis. Leitores nunca adquirem locks; apenas o
+ * escritor espera o término das leituras antigas antes de liberar a versão anterior.
+ */
+#ifndef RCU_HPP
+#define RCU_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class RCUPtr
+ * @brief Ponteiro para objeto imutável trocado atomicamente.
+ * @tparam T Tipo do objeto publicado.
+ * @details
+ *
+ * Utiliza o esquema de dois contadores de leitores indexados pela paridade de uma época:
+ *
+ * - Leitor: lê a época, incrementa o contador da paridade e confirma que a época não mudou,
+ *   só então lê o ponteiro. Ao terminar, decrementa o mesmo contador.
+ * - Escritor: troca o ponteiro, avança a época e espera que o contador da paridade antiga
+ *   zere, momento a partir do qual ninguém mais pode enxergar o objeto antigo.
+ *
+ * A leitura é livre de locks e de alocações. A escrita é serializada por um mutex e pode
+ * esperar leitores, o que é aceitável por ocorrer fora do caminho crítico.
+ */
+template <typename T>
+class RCUPtr {
+	std::atomic<const T*>          atual{nullptr};
+	std::atomic<unsigned long>        epoca{0};
+	std::atomic<long>            leitores[2]{};
+	std::mutex                        mtx_escrita;
+
+public:
+
+	/**
+	 * @class Leitura
+	 * @brief Guarda RAII que mantém o objeto lido vivo enquanto existir.
+	 */
+	class Leitura {
+		RCUPtr*            dono;
+		unsigned long paridade;
+		const T*           obj;
+
+	public:
+
+		explicit Leitura(RCUPtr* dono_) : dono(dono_) {
+
+			while(
+				true
+			){
+
+				unsigned long e = dono->epoca.load();
+				paridade = e & 1;
+				dono->leitores[paridade].fetch_add(1);
+				if( dono->epoca.load() == e ){ break; }
+				dono->leitores[paridade].fetch_sub(1);
+			}
+			obj = dono->atual.load();
+		}
+
+		~Leitura(){ dono->leitores[paridade].fetch_sub(1); }
+
+		Leitura(const Leitura&)            = delete;
+		Leitura& operator=(const Leitura&) = delete;
+
+		const T* get()        const { return obj; }
+		const T* operator->() const { return obj; }
+		const T& operator*()  const { return *obj; }
+		explicit operator bool() const { return obj != nullptr; }
+	};
+
+	RCUPtr() = default;
+
+	/**
+	 * @brief Construtor com valor inicial.
+	 * @param inicial Objeto inicial, cuja posse é transferida.
+	 */
+	explicit RCUPtr(std::unique_ptr<const T> inicial) : atual(inicial.release()) {}
+
+	~RCUPtr(){ delete atual.load(); }
+
+	RCUPtr(const RCUPtr&)            = delete;
+	RCUPtr& operator=(const RCUPtr&) = delete;
+
+	/**
+	 * @brief Inicia uma leitura. O objeto permanece válido durante a vida da guarda.
+	 */
+	Leitura
+	read(){ return Leitura(this); }
+
+	/**
+	 * @brief Publica um novo objeto e libera o antigo após o período de graça.
+	 * @param novo Novo objeto, cuja posse é transferida.
+	 */
+	void
+	publish(
+		std::unique_ptr<const T> novo
+	){
+
+		std::lock_guard<std::mutex> lock(mtx_escrita);
+
+		const T* antigo = atual.exchange(novo.release());
+
+		unsigned long e = epoca.fetch_add(1);
+		while( leitores[e & 1].load() != 0 ){ std::this_thread::yield(); }
+
+		delete antigo;
+	}
+
+	/**
+	 * @brief Copia o objeto atual, aplica uma modificação e publica o resultado.
+	 * @param modificar Função que recebe a cópia mutável.
+	 * @details
+	 *
+	 * Útil para alterações incrementais, já que a leitura da versão atual e a publicação
+	 * da nova ocorrem sob o mesmo mutex do escritor.
+	 */
+	template <typename F>
+	void
+	update(
+		F&& modificar
+	){
+
+		std::unique_lock<std::mutex> lock(mtx_escrita);
+
+		const T* antigo = atual.load();
+		std::unique_ptr<T> copia = antigo ? std::unique_ptr<T>(new T(*antigo)) : std::unique_ptr<T>(new T());
+		modificar(*copia);
+
+		atual.store(copia.release());
+
+		unsigned long e = epoca.fetch_add(1);
+		while( leitores[e & 1].load() != 0 ){ std::this_thread::yield(); }
+
+		delete antigo;
+	}
+};
+
+#endif // RCU_HPP
@@ -0,0 +1,370 @@
+/**
+ * @file ReorderBuffer.hpp
+ * @brief Reordenação e eliminação de duplicatas dos fixes de cada rastreador.
+ * @details
+ * Datagramas UDP podem chegar fora de ordem ou repetidos, em especial com retransmissões
+ * e esvaziamento de spool. Viagens, cercas e filtros assumem fixes em ordem, de modo que
+ * cada rastreador passa por uma pequena janela que os devolve ordenados, com atraso limitado.
+ */
+#ifndef REORDERBUFFER_HPP
+#define REORDERBUFFER_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "CollectorFix.hpp"
+#include "Snapshot.hpp"
+
+/**
+ * @class ReorderBuffer
+ * @brief Janela de até MAX_JANELA fixes por rastreador, ordenada pelo instante do fix.
+ * @details
+ *
+ * Não há número de sequência no datagrama; a ordem é a do instante do fix. Um fix recebido
+ * entra ordenado na janela do seu rastreador e sai quando:
+ * - a janela excede `janela` fixes;
+ * - um fix da janela é `atraso_ms` mais novo que ele (tempo do fix); ou
+ * - ele está na janela há `atraso_ms` (tempo de chegada), verificado por expire().
+ * Os fixes anteriores ao que sai saem junto, de modo que a saída é sempre crescente.
+ *
+ * Fixes com instante igual ao de um fix na janela ou já emitido são duplicatas e são
+ * descartados; fixes anteriores ao último emitido chegaram tarde demais e também são
+ * descartados (contados em `atrasados`).
+ *
+ * Os rastreadores ficam em shards com mutex próprio. A emissão ocorre sob o lock do shard,
+ * preservando a ordem por rastreador entre threads; a função de saída não deve chamar
+ * métodos deste objeto. Cada shard mantém uma fila de prazos em ordem de chegada, de modo
+ * que expire() só visita fixes vencidos.
+ */
+class ReorderBuffer {
+public:
+
+	static constexpr uint32_t MAX_JANELA = 8;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de reordenação.
+	 */
+	struct Stats {
+		uint64_t fixes;
+		uint64_t emitidos;
+		uint64_t reordenados; ///< Chegaram antes de um fix mais novo já na janela.
+		uint64_t duplicados;
+		uint64_t atrasados;   ///< Anteriores ao último emitido.
+	};
+
+private:
+
+	struct Janela {
+		int64_t      ultimo_t = INT64_MIN; ///< Instante do último fix emitido.
+		uint32_t     n        = 0;
+		CollectorFix fixes[MAX_JANELA];
+		int64_t      chegada[MAX_JANELA];
+	};
+
+	struct Shard {
+		std::mutex                                   mtx;
+		std::unordered_map<uint64_t, Janela>     janelas;
+		std::deque<std::pair<int64_t, uint64_t>>  prazos; ///< (prazo, rastreador), em ordem de chegada.
+		std::atomic<int64_t>          proximo{INT64_MAX}; ///< Prazo da frente de `prazos`.
+	};
+
+	uint32_t                          janela;
+	int64_t                        atraso_ms;
+	std::unique_ptr<Shard[]>          shards;
+	std::size_t                     n_shards;
+
+	std::atomic<uint64_t>          n_fixes{0};
+	std::atomic<uint64_t>       n_emitidos{0};
+	std::atomic<uint64_t>    n_reordenados{0};
+	std::atomic<uint64_t>     n_duplicados{0};
+	std::atomic<uint64_t>      n_atrasados{0};
+
+	Shard& shard_of(uint64_t tracker){ return shards[(tracker * 0x9e3779b97f4a7c15ULL >> 32) % n_shards]; }
+
+	/**
+	 * @brief Emite os k primeiros fixes da janela.
+	 */
+	template <typename F>
+	void
+	emit(
+		Janela& j,
+		uint32_t k,
+		F& emitir
+	){
+
+		for( uint32_t i = 0; i < k; i++ ){ emitir(j.fixes[i]); }
+		j.ultimo_t = j.fixes[k - 1].t_ms;
+		std::move(j.fixes + k, j.fixes + j.n, j.fixes);
+		std::move(j.chegada + k, j.chegada + j.n, j.chegada);
+		j.n -= k;
+		n_emitidos.fetch_add(k, std::memory_order_relaxed);
+	}
+
+	void
+	update_next(
+		Shard& s
+	){ s.proximo.store(s.prazos.empty() ? INT64_MAX : s.prazos.front().first, std::memory_order_relaxed); }
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param atraso_ms_ Atraso máximo imposto a um fix; 0 apenas descarta duplicatas e atrasados.
+	 * @param janela_ Fixes retidos por rastreador, até MAX_JANELA.
+	 * @param n_shards_ Quantidade de partições com lock próprio.
+	 */
+	explicit ReorderBuffer(
+		int64_t atraso_ms_ = 2000,
+		uint32_t janela_ = MAX_JANELA,
+		std::size_t n_shards_ = 256
+	) : janela(std::clamp<uint32_t>(janela_, 1, MAX_JANELA)),
+		atraso_ms(std::max<int64_t>(atraso_ms_, 0)),
+		shards(new Shard[n_shards_ > 0 ? n_shards_ : 1]),
+		n_shards(n_shards_ > 0 ? n_shards_ : 1) {}
+
+	ReorderBuffer(const ReorderBuffer&)            = delete;
+	ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+	/**
+	 * @brief Recebe um fix e emite os que ficaram prontos, em ordem.
+	 * @param fix Fix recebido.
+	 * @param chegada_ms Instante de chegada, no mesmo relógio de expire().
+	 * @param emitir Função `void(const CollectorFix&)`, chamada sob o lock do shard.
+	 */
+	template <typename F>
+	void
+	push(
+		const CollectorFix& fix,
+		int64_t chegada_ms,
+		F&& emitir
+	){
+
+		n_fixes.fetch_add(1, std::memory_order_relaxed);
+
+		Shard& s = shard_of(fix.tracker);
+		std::lock_guard<std::mutex> lock(s.mtx);
+		Janela& j = s.janelas[fix.tracker];
+
+		if(
+			fix.t_ms <= j.ultimo_t
+		){
+
+			(fix.t_ms == j.ultimo_t ? n_duplicados : n_atrasados).fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// Inserção ordenada; a janela é pequena e quase sempre o fix vai ao final
+		uint32_t k = j.n;
+		while( k > 0 && j.fixes[k - 1].t_ms > fix.t_ms ){ k--; }
+		if( k > 0 && j.fixes[k - 1].t_ms == fix.t_ms ){ n_duplicados.fetch_add(1, std::memory_order_relaxed); return; }
+		if( k < j.n ){ n_reordenados.fetch_add(1, std::memory_order_relaxed); }
+
+		if(
+			j.n == MAX_JANELA
+		){
+
+			// Janela cheia: o mais velho sai, e um fix ainda mais velho chegou tarde demais
+			if( k == 0 ){ n_atrasados.fetch_add(1, std::memory_order_relaxed); return; }
+			emit(j, 1, emitir);
+			k--;
+		}
+		std::move_backward(j.fixes + k, j.fixes + j.n, j.fixes + j.n + 1);
+		std::move_backward(j.chegada + k, j.chegada + j.n, j.chegada + j.n + 1);
+		j.fixes[k]   = fix;
+		j.chegada[k] = chegada_ms;
+		j.n++;
+
+		// Prontos: excedentes da janela e fixes `atraso_ms` mais velhos que o mais novo
+		uint32_t prontos = j.n > janela ? j.n - janela : 0;
+		int64_t  limite  = j.fixes[j.n - 1].t_ms - atraso_ms;
+		while( prontos < j.n && j.fixes[prontos].t_ms <= limite ){ prontos++; }
+		if( prontos ){ emit(j, prontos, emitir); }
+
+		// Retido: expire() o emite no prazo
+		if(
+			k >= prontos
+		){
+
+			s.prazos.emplace_back(chegada_ms + atraso_ms, fix.tracker);
+			if( s.prazos.size() == 1 ){ update_next(s); }
+		}
+	}
+
+	/**
+	 * @brief Emite os fixes retidos há `atraso_ms` ou mais.
+	 * @param agora_ms Instante atual, no relógio de chegada.
+	 * @param emitir Função `void(const CollectorFix&)`, chamada sob o lock do shard.
+	 * @return Quantidade de fixes emitidos.
+	 */
+	template <typename F>
+	std::size_t
+	expire(
+		int64_t agora_ms,
+		F&& emitir
+	){
+
+		std::size_t n = 0;
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			Shard& s = shards[i];
+			if( s.proximo.load(std::memory_order_relaxed) > agora_ms ){ continue; }
+
+			std::lock_guard<std::mutex> lock(s.mtx);
+			while(
+				!s.prazos.empty() && s.prazos.front().first <= agora_ms
+			){
+
+				uint64_t tracker = s.prazos.front().second;
+				s.prazos.pop_front();
+
+				// O prazo pode estar obsoleto: o fix já saiu da janela
+				auto it = s.janelas.find(tracker);
+				if( it == s.janelas.end() ){ continue; }
+
+				Janela&  j       = it->second;
+				uint32_t prontos = 0;
+				for( uint32_t k = 0; k < j.n; k++ ){ if( j.chegada[k] + atraso_ms <= agora_ms ){ prontos = k + 1; } }
+				if( prontos ){ emit(j, prontos, emitir); n += prontos; }
+			}
+			update_next(s);
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Emite todos os fixes retidos, por exemplo ao encerrar o coletor.
+	 */
+	template <typename F>
+	std::size_t
+	flush_all(
+		F&& emitir
+	){
+
+		std::size_t n = 0;
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			for(
+				auto& par : shards[i].janelas
+			){
+
+				if( par.second.n == 0 ){ continue; }
+				n += par.second.n;
+				emit(par.second, par.second.n, emitir);
+			}
+			shards[i].prazos.clear();
+			update_next(shards[i]);
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Grava as janelas de todos os rastreadores no snapshot.
+	 * @details
+	 *
+	 * Inclui as janelas vazias: o instante do último fix emitido continua descartando
+	 * duplicatas e atrasados depois da recuperação.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	){
+
+		Stats st = stats();
+		w.put(st);
+		w.put<uint64_t>(n_shards);
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			w.put<uint64_t>(shards[i].janelas.size());
+			for( const auto& par : shards[i].janelas ){ w.put(par.first); w.put(par.second); }
+		}
+	}
+
+	/**
+	 * @brief Carrega em um ReorderBuffer vazio o que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 * @details
+	 *
+	 * Os fixes retidos recebem novo prazo a partir do instante de chegada gravado.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		Stats    st;
+		uint64_t gravados = 0;
+		if( !r.get(st) || !r.get(gravados) ){ return false; }
+
+		// Os rastreadores são redistribuídos pelos shards deste objeto
+		for(
+			uint64_t i = 0; i < gravados; i++
+		){
+
+			uint64_t n = 0;
+			if( !r.get(n) ){ return false; }
+			for(
+				uint64_t j = 0; j < n; j++
+			){
+
+				uint64_t tracker = 0;
+				Janela   jan;
+				if( !r.get(tracker) || !r.get(jan) || jan.n > MAX_JANELA ){ return false; }
+
+				Shard& s = shard_of(tracker);
+				std::lock_guard<std::mutex> lock(s.mtx);
+				s.janelas[tracker] = jan;
+				if( jan.n ){ s.prazos.emplace_back(jan.chegada[0] + atraso_ms, tracker); }
+			}
+		}
+
+		for(
+			std::size_t i = 0; i < n_shards; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			std::sort(shards[i].prazos.begin(), shards[i].prazos.end());
+			update_next(shards[i]);
+		}
+
+		n_fixes.store(st.fixes);
+		n_emitidos.store(st.emitidos);
+		n_reordenados.store(st.reordenados);
+		n_duplicados.store(st.duplicados);
+		n_atrasados.store(st.atrasados);
+		return true;
+	}
+
+	/**
+	 * @brief Obtém os contadores de reordenação.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.fixes       = n_fixes.load(std::memory_order_relaxed);
+		s.emitidos    = n_emitidos.load(std::memory_order_relaxed);
+		s.reordenados = n_reordenados.load(std::memory_order_relaxed);
+		s.duplicados  = n_duplicados.load(std::memory_order_relaxed);
+		s.atrasados   = n_atrasados.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // REORDERBUFFER_HPP
@@ -0,0 +1,451 @@
+/**
+ * @file RoadGraph.hpp
+ * @brief Grafo viário carregado de um extrato OSM local, com índice espacial de arestas.
+ * @details
+ * Base do casamento com o mapa: as arestas próximas de um fix são os candidatos de
+ * posição real do veículo, e as distâncias pela malha entre candidatos indicam quais
+ * sequências são plausíveis.
+ */
+#ifndef ROADGRAPH_HPP
+#define ROADGRAPH_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @class RoadGraph
+ * @brief Grafo dirigido de trechos de via, em micrograus.
+ * @details
+ *
+ * Cada par de nós consecutivos de uma via vira uma aresta; vias de mão dupla geram as
+ * duas direções. Após finalize(), as arestas ficam agrupadas por nó de origem (CSR) e
+ * indexadas em uma grade de células de PASSO_E6 micrograus, de modo que os candidatos
+ * de um fix saem das poucas células ao seu redor.
+ */
+class RoadGraph {
+public:
+
+	static constexpr int32_t PASSO_E6 = 1000; ///< Lado da célula da grade, cerca de 110 m.
+
+	struct Edge {
+		uint32_t de;
+		uint32_t para;
+		float    comprimento_m;
+	};
+
+	/**
+	 * @struct Candidate
+	 * @brief Projeção de um ponto sobre uma aresta.
+	 */
+	struct Candidate {
+		uint32_t aresta;
+		float    deslocamento_m; ///< Distância da origem da aresta até a projeção.
+		float    distancia_m;    ///< Distância do ponto até a projeção.
+		int32_t  lat_e6, lon_e6; ///< Projeção.
+	};
+
+private:
+
+	std::vector<int32_t>        lats, lons;
+	std::vector<Edge>              arestas;
+	std::vector<uint32_t>        saidas_de; ///< CSR: arestas de cada nó, em inicio_saidas.
+	std::vector<uint32_t>    inicio_saidas;
+	std::vector<uint64_t>          celulas; ///< Células ocupadas, ordenadas.
+	std::vector<uint32_t>   inicio_celulas;
+	std::vector<uint32_t> arestas_celulas;
+
+	static uint64_t
+	cell_key(
+		int64_t cx,
+		int64_t cy
+	){ return (static_cast<uint64_t>(cy + (1 << 20)) << 32) | static_cast<uint64_t>(cx + (1 << 20)); }
+
+	static int64_t cell_of(int32_t e6){ return e6 >= 0 ? e6 / PASSO_E6 : -((-int64_t(e6) + PASSO_E6 - 1) / PASSO_E6); }
+
+	/**
+	 * @brief Lê os atributos de um elemento XML `<nome a="x" b="y">`.
+	 */
+	static void
+	attributes(
+		const std::string& elemento,
+		std::unordered_map<std::string, std::string>& atributos
+	){
+
+		atributos.clear();
+		std::size_t i = elemento.find_first_of(" \t\r\n");
+		while(
+			i != std::string::npos
+		){
+
+			std::size_t igual = elemento.find('=', i);
+			if( igual == std::string::npos ){ break; }
+			std::size_t aspas = elemento.find_first_of("\"'", igual);
+			if( aspas == std::string::npos ){ break; }
+			std::size_t fim = elemento.find(elemento[aspas], aspas + 1);
+			if( fim == std::string::npos ){ break; }
+
+			std::size_t ini = elemento.find_first_not_of(" \t\r\n", i);
+			atributos[elemento.substr(ini, elemento.find_last_not_of(" \t\r\n=", igual) + 1 - ini)] = elemento.substr(aspas + 1, fim - aspas - 1);
+			i = fim + 1;
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Acrescenta um nó.
+	 * @return Índice do nó.
+	 */
+	uint32_t
+	add_node(
+		int32_t lat_e6,
+		int32_t lon_e6
+	){
+
+		lats.push_back(lat_e6);
+		lons.push_back(lon_e6);
+		return static_cast<uint32_t>(lats.size() - 1);
+	}
+
+	/**
+	 * @brief Acrescenta um trecho entre dois nós.
+	 * @param ida Gera a aresta a -> b.
+	 * @param volta Gera a aresta b -> a.
+	 */
+	void
+	add_edge(
+		uint32_t a,
+		uint32_t b,
+		bool ida = true,
+		bool volta = true
+	){
+
+		float comprimento = static_cast<float>(distance_m(lats[a], lons[a], lats[b], lons[b]));
+		if( ida ){ arestas.push_back({ a, b, comprimento }); }
+		if( volta ){ arestas.push_back({ b, a, comprimento }); }
+	}
+
+	/**
+	 * @brief Constrói a adjacência e a grade. Deve ser chamado após acrescentar os trechos.
+	 */
+	void
+	finalize(){
+
+		inicio_saidas.assign(lats.size() + 1, 0);
+		for( const Edge& e : arestas ){ inicio_saidas[e.de + 1]++; }
+		for( std::size_t i = 1; i < inicio_saidas.size(); i++ ){ inicio_saidas[i] += inicio_saidas[i - 1]; }
+		saidas_de.assign(arestas.size(), 0);
+		std::vector<uint32_t> cursor(inicio_saidas.begin(), inicio_saidas.end() - 1);
+		for( uint32_t i = 0; i < arestas.size(); i++ ){ saidas_de[cursor[arestas[i].de]++] = i; }
+
+		// Cada aresta entra nas células de sua caixa envolvente
+		std::vector<std::pair<uint64_t, uint32_t>> pares;
+		for(
+			uint32_t i = 0; i < arestas.size(); i++
+		){
+
+			const Edge& e = arestas[i];
+			int64_t cy0 = cell_of(std::min(lats[e.de], lats[e.para])), cy1 = cell_of(std::max(lats[e.de], lats[e.para]));
+			int64_t cx0 = cell_of(std::min(lons[e.de], lons[e.para])), cx1 = cell_of(std::max(lons[e.de], lons[e.para]));
+			for( int64_t cy = cy0; cy <= cy1; cy++ ){ for( int64_t cx = cx0; cx <= cx1; cx++ ){ pares.emplace_back(cell_key(cx, cy), i); } }
+		}
+		std::sort(pares.begin(), pares.end());
+
+		celulas.clear(); inicio_celulas.clear(); arestas_celulas.clear();
+		for(
+			std::size_t i = 0; i < pares.size(); i++
+		){
+
+			if( i == 0 || pares[i].first != pares[i - 1].first ){ celulas.push_back(pares[i].first); inicio_celulas.push_back(static_cast<uint32_t>(i)); }
+			arestas_celulas.push_back(pares[i].second);
+		}
+		inicio_celulas.push_back(static_cast<uint32_t>(pares.size()));
+	}
+
+	/**
+	 * @brief Carrega as vias trafegáveis de um extrato OSM em XML.
+	 * @param caminho Arquivo `.osm`, como exportado pelo osmium ou pela Overpass API.
+	 * @details
+	 *
+	 * Considera as vias com `highway` de tráfego de veículos e respeita `oneway` (incluindo
+	 * `-1`), rotatórias e autoestradas. O arquivo é lido em blocos, sem carregá-lo inteiro.
+	 * Lança std::runtime_error caso não possa ser aberto ou não contenha vias.
+	 */
+	static RoadGraph
+	load_osm(
+		const std::string& caminho
+	){
+
+		std::FILE* f = std::fopen(caminho.c_str(), "rb");
+		if( !f ){ throw std::runtime_error("\033[1;31mErro ao abrir extrato OSM: " + caminho + "\033[0m"); }
+
+		static const char* trafegaveis[] = {
+			"motorway", "trunk", "primary", "secondary", "tertiary", "unclassified", "residential",
+			"service", "living_street", "motorway_link", "trunk_link", "primary_link",
+			"secondary_link", "tertiary_link", "road"
+		};
+
+		RoadGraph g;
+		std::unordered_map<int64_t, std::pair<int32_t, int32_t>> nos_osm;
+		std::unordered_map<int64_t, uint32_t> indices;
+		std::unordered_map<std::string, std::string> atributos;
+
+		std::vector<int64_t> via;
+		std::string highway, oneway, junction;
+		bool        em_via = false;
+
+		auto fechar_via = [&](){
+
+			bool trafegavel = false;
+			for( const char* t : trafegaveis ){ if( highway == t ){ trafegavel = true; } }
+			if( !trafegavel || via.size() < 2 ){ return; }
+
+			bool unica   = oneway == "yes" || oneway == "1" || oneway == "true" || junction == "roundabout" || (highway == "motorway" && oneway != "no");
+			bool inversa = oneway == "-1";
+
+			uint32_t anterior = UINT32_MAX;
+			for(
+				int64_t ref : via
+			){
+
+				auto no = nos_osm.find(ref);
+				if( no == nos_osm.end() ){ anterior = UINT32_MAX; continue; }
+
+				auto it = indices.find(ref);
+				if( it == indices.end() ){ it = indices.emplace(ref, g.add_node(no->second.first, no->second.second)).first; }
+				if( anterior != UINT32_MAX && anterior != it->second ){ g.add_edge(anterior, it->second, !inversa, !unica || inversa); }
+				anterior = it->second;
+			}
+		};
+
+		auto elemento = [&](const std::string& e){
+
+			if(
+				e.compare(0, 5, "node ") == 0
+			){
+
+				attributes(e, atributos);
+				nos_osm[std::stoll(atributos["id"])] = { static_cast<int32_t>(std::lround(std::stod(atributos["lat"]) * 1e6)),
+														 static_cast<int32_t>(std::lround(std::stod(atributos["lon"]) * 1e6)) };
+			}
+			else if( e.compare(0, 4, "way ") == 0 || e == "way" ){ em_via = true; via.clear(); highway.clear(); oneway.clear(); junction.clear(); }
+			else if( e.compare(0, 4, "/way") == 0 ){ fechar_via(); em_via = false; }
+			else if(
+				em_via && e.compare(0, 3, "nd ") == 0
+			){
+
+				attributes(e, atributos);
+				via.push_back(std::stoll(atributos["ref"]));
+			}
+			else if(
+				em_via && e.compare(0, 4, "tag ") == 0
+			){
+
+				attributes(e, atributos);
+				const std::string& k = atributos["k"];
+				if( k == "highway" ){ highway = atributos["v"]; }
+				else if( k == "oneway" ){ oneway = atributos["v"]; }
+				else if( k == "junction" ){ junction = atributos["v"]; }
+			}
+		};
+
+		// Varredura em blocos: acumula o texto entre '<' e '>'
+		char        bloco[1 << 16];
+		std::string atual;
+		bool        dentro = false;
+		std::size_t n;
+		try {
+
+			while(
+				(n = std::fread(bloco, 1, sizeof(bloco), f)) > 0
+			){
+
+				for(
+					std::size_t i = 0; i < n; i++
+				){
+
+					char c = bloco[i];
+					if( !dentro ){ if( c == '<' ){ dentro = true; atual.clear(); } continue; }
+					if( c != '>' ){ atual.push_back(c); continue; }
+
+					dentro = false;
+					if( !atual.empty() && atual.back() == '/' ){ atual.pop_back(); if( atual.compare(0, 3, "way") == 0 ){ elemento(atual); atual = "/way"; } }
+					elemento(atual);
+				}
+			}
+		}
+		catch (std::exception&) {
+
+			std::fclose(f);
+			throw std::runtime_error("\033[1;31mExtrato OSM inválido: " + caminho + "\033[0m");
+		}
+		std::fclose(f);
+
+		if( g.arestas.empty() ){ throw std::runtime_error("\033[1;31mExtrato OSM sem vias trafegáveis: " + caminho + "\033[0m"); }
+
+		g.finalize();
+		return g;
+	}
+
+	/**
+	 * @brief Distância aproximada, em metros, entre dois pontos próximos em micrograus.
+	 */
+	static double
+	distance_m(
+		int32_t lat_a, int32_t lon_a,
+		int32_t lat_b, int32_t lon_b
+	){
+
+		double dy = (lat_b - lat_a) * 0.11132;
+		double dx = (lon_b - lon_a) * 0.11132 * std::cos((lat_a + lat_b) * 0.5e-6 * M_PI / 180.0);
+		return std::sqrt(dx * dx + dy * dy);
+	}
+
+	/**
+	 * @brief Arestas até `raio_m` do ponto, das mais próximas para as mais distantes.
+	 * @param saida Vetor com capacidade para `max` candidatos.
+	 * @return Quantidade de candidatos.
+	 */
+	std::size_t
+	candidates(
+		int32_t lat_e6,
+		int32_t lon_e6,
+		double raio_m,
+		Candidate* saida,
+		std::size_t max
+	) const {
+
+		double  escala_lon = std::cos(lat_e6 * 1e-6 * M_PI / 180.0);
+		int32_t r_lat      = static_cast<int32_t>(raio_m / 0.11132) + 1;
+		int32_t r_lon      = static_cast<int32_t>(raio_m / (0.11132 * std::max(0.01, escala_lon))) + 1;
+
+		std::size_t n = 0;
+		for(
+			int64_t cy = cell_of(lat_e6 - r_lat); cy <= cell_of(lat_e6 + r_lat); cy++
+		){
+
+			for(
+				int64_t cx = cell_of(lon_e6 - r_lon); cx <= cell_of(lon_e6 + r_lon); cx++
+			){
+
+				auto it = std::lower_bound(celulas.begin(), celulas.end(), cell_key(cx, cy));
+				if( it == celulas.end() || *it != cell_key(cx, cy) ){ continue; }
+				std::size_t k = static_cast<std::size_t>(it - celulas.begin());
+
+				for(
+					uint32_t j = inicio_celulas[k]; j < inicio_celulas[k + 1]; j++
+				){
+
+					uint32_t    a = arestas_celulas[j];
+					const Edge& e = arestas[a];
+
+					// Projeção no plano local, em metros a partir da origem da aresta
+					double bx = (lons[e.para] - lons[e.de]) * 0.11132 * escala_lon, by = (lats[e.para] - lats[e.de]) * 0.11132;
+					double px = (lon_e6 - lons[e.de]) * 0.11132 * escala_lon,       py = (lat_e6 - lats[e.de]) * 0.11132;
+					double l2 = bx * bx + by * by;
+					double t  = l2 > 0 ? std::clamp((px * bx + py * by) / l2, 0.0, 1.0) : 0.0;
+					double d  = std::hypot(px - t * bx, py - t * by);
+					if( d > raio_m ){ continue; }
+
+					// Uma aresta longa aparece em várias células
+					bool repetida = false;
+					for( std::size_t m = 0; m < n; m++ ){ if( saida[m].aresta == a ){ repetida = true; break; } }
+					if( repetida ){ continue; }
+
+					Candidate c{ a, static_cast<float>(t * e.comprimento_m), static_cast<float>(d),
+								 lats[e.de] + static_cast<int32_t>(std::lround(t * (lats[e.para] - lats[e.de]))),
+								 lons[e.de] + static_cast<int32_t>(std::lround(t * (lons[e.para] - lons[e.de]))) };
+
+					// Inserção ordenada por distância, mantendo os `max` mais próximos
+					if( n == max && c.distancia_m >= saida[n - 1].distancia_m ){ continue; }
+					std::size_t m = (n < max) ? n++ : n - 1;
+					for( ; m > 0 && saida[m - 1].distancia_m > c.distancia_m; m-- ){ saida[m] = saida[m - 1]; }
+					saida[m] = c;
+				}
+			}
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Distâncias pela malha de um nó até vários nós, limitadas a `limite_m`.
+	 * @param saida Distância até cada alvo; infinita se além do limite.
+	 * @details
+	 *
+	 * Dijkstra interrompido ao alcançar todos os alvos ou o limite. Usa memória de trabalho
+	 * por thread, reaproveitada entre chamadas.
+	 */
+	void
+	route_distances(
+		uint32_t origem,
+		const uint32_t* alvos,
+		std::size_t n_alvos,
+		double limite_m,
+		double* saida
+	) const {
+
+		thread_local std::vector<float>    dist;
+		thread_local std::vector<uint32_t> marca;
+		thread_local uint32_t              geracao = 0;
+
+		if( dist.size() < lats.size() ){ dist.assign(lats.size(), 0); marca.assign(lats.size(), 0); }
+		if( ++geracao == 0 ){ std::fill(marca.begin(), marca.end(), 0); geracao = 1; }
+
+		for( std::size_t i = 0; i < n_alvos; i++ ){ saida[i] = INFINITY; }
+		std::size_t pendentes = n_alvos;
+
+		// Heap mínimo sobre um vetor reaproveitado, sem alocar a cada chamada
+		using Item = std::pair<float, uint32_t>;
+		thread_local std::vector<Item> fila;
+		fila.clear();
+		dist[origem] = 0; marca[origem] = geracao;
+		fila.push_back({ 0.0f, origem });
+
+		while(
+			!fila.empty() && pendentes > 0
+		){
+
+			std::pop_heap(fila.begin(), fila.end(), std::greater<Item>());
+			auto [d, no] = fila.back();
+			fila.pop_back();
+			if( d > dist[no] ){ continue; }
+			if( d > limite_m ){ break; }
+
+			for( std::size_t i = 0; i < n_alvos; i++ ){ if( alvos[i] == no && std::isinf(saida[i]) ){ saida[i] = d; pendentes--; } }
+
+			for(
+				uint32_t k = inicio_saidas[no]; k < inicio_saidas[no + 1]; k++
+			){
+
+				const Edge& e  = arestas[saidas_de[k]];
+				float       nd = d + e.comprimento_m;
+				if( marca[e.para] != geracao || nd < dist[e.para] ){ marca[e.para] = geracao; dist[e.para] = nd; fila.push_back({ nd, e.para }); std::push_heap(fila.begin(), fila.end(), std::greater<Item>()); }
+			}
+		}
+	}
+
+	const Edge& edge(uint32_t i) const { return arestas[i]; }
+	int32_t node_lat(uint32_t i) const { return lats[i]; }
+	int32_t node_lon(uint32_t i) const { return lons[i]; }
+
+	/**
+	 * @brief Arestas que saem de um nó, como intervalo [ini, fim) em edge_from().
+	 */
+	std::pair<uint32_t, uint32_t> out_range(uint32_t no) const { return { inicio_saidas[no], inicio_saidas[no + 1] }; }
+	uint32_t edge_from(uint32_t k) const { return saidas_de[k]; }
+
+	std::size_t node_count() const { return lats.size(); }
+	std::size_t edge_count() const { return arestas.size(); }
+};
+
+#endif // ROADGRAPH_HPP
@@ -0,0 +1,935 @@
+/**
+ * @file RuleEngine.hpp
+ * @brief Regras de alerta compiladas para bytecode e avaliadas em lotes de fixes em colunas.
+ * @details
+ * Clientes definem condições de alerta como "velocidade acima de X na zona Y" ou "parado há
+ * mais de T à noite". Percorrer a árvore de cada regra a cada fix não acompanha a ingestão
+ * com milhares de regras: cada regra é compilada para um bytecode de pilha cujos operandos
+ * são máscaras de 64 bits, um bit por fix de um lote de até 64 fixes em colunas (SoA), e
+ * cada comparação é avaliada sobre a coluna inteira com as extensões vetoriais do GCC/Clang.
+ */
+#ifndef RULEENGINE_HPP
+#define RULEENGINE_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "FenceIndex.hpp"
+#include "GPSFix.hpp"
+#include "RCU.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @struct RuleAlert
+ * @brief Início (disparo) ou fim de um alerta de uma regra para um rastreador.
+ */
+struct RuleAlert {
+
+	enum class Tipo : uint32_t { DISPARO, FIM };
+
+	Tipo     tipo    = Tipo::DISPARO;
+	uint32_t regra   = 0;
+	uint64_t tracker = 0;
+	int64_t  t_ms    = 0; ///< Fix que provocou o evento.
+	int32_t  lat_e6  = 0, lon_e6 = 0;
+
+	/**
+	 * @brief Linha CSV `tipo,regra,rastreador,t_ms,lat,lon`.
+	 */
+	std::string
+	to_csv() const {
+
+		char linha[128];
+		std::snprintf(linha, sizeof(linha), "%s,%u,%llu,%lld,%.6f,%.6f\n",
+					  tipo == Tipo::DISPARO ? "disparo" : "fim", regra, static_cast<unsigned long long>(tracker),
+					  static_cast<long long>(t_ms), lat_e6 * 1e-6, lon_e6 * 1e-6);
+		return linha;
+	}
+};
+
+/**
+ * @struct RuleSet
+ * @brief Conjunto imutável de regras compiladas, com as zonas que elas referenciam.
+ * @details
+ *
+ * Cada regra é uma sequência de instruções em notação pós-fixa. Comparações iguais em
+ * regras distintas (`hora >= 22` em centenas de regras noturnas) viram um único Predicado,
+ * avaliado no máximo uma vez por lote. Uma regra cuja conjunção de topo contém `zona N`
+ * é guardada por N: só é avaliada em lotes com algum fix dentro da cerca N, de modo que
+ * milhares de regras de zonas distintas custam, por lote, apenas as das zonas visitadas.
+ *
+ * Como o FenceIndex, o conjunto é imutável e trocado por inteiro (RCUPtr) quando as regras
+ * ou as cercas mudam.
+ */
+struct RuleSet {
+
+	/// Colunas de um lote, todas em inteiros de 32 bits.
+	enum Coluna : uint8_t {
+		LAT,       ///< Micrograus.
+		LON,       ///< Micrograus.
+		ALT,       ///< Decímetros.
+		VEL,       ///< Décimos de km/h, entre o fix e o anterior.
+		PARADO,    ///< Segundos dentro do raio de parada.
+		INTERVALO, ///< Segundos desde o fix anterior.
+		HORA,      ///< Minutos desde a meia-noite, no fuso do conjunto.
+		ALERTA,    ///< 1 com CollectorFix::FLAG_ALERTA.
+		N_COLUNAS
+	};
+
+	enum class Comparacao : uint8_t { MAIOR, MAIOR_IGUAL, MENOR, MENOR_IGUAL, IGUAL, DIFERENTE };
+
+	enum class Op : uint8_t {
+		PREDICADO, ///< Empilha a máscara do predicado `arg`.
+		ZONA,      ///< Empilha a máscara dos fixes dentro da cerca `arg`.
+		E,
+		OU,
+		NAO
+	};
+
+	struct Predicado {
+		Coluna     coluna;
+		Comparacao comparacao;
+		int32_t    valor;
+	};
+
+	struct Instrucao {
+		Op       op;
+		uint32_t arg;
+	};
+
+	struct Regra {
+		uint32_t id;
+		uint32_t ini, fim; ///< Instruções em [ini, fim).
+		int64_t  guarda;   ///< Cerca exigida pela regra; -1 se nenhuma.
+	};
+
+	static constexpr uint32_t PILHA_MAX = 32;
+
+	std::vector<Predicado>                                  predicados;
+	std::vector<Instrucao>                                      codigo;
+	std::vector<Regra>                                          regras;
+	std::vector<uint32_t>                                       livres; ///< Regras sem guarda.
+	std::unordered_map<uint32_t, std::vector<uint32_t>>       por_zona; ///< Regras guardadas, por cerca.
+	std::unique_ptr<const FenceIndex>                            zonas; ///< Nulo se nenhuma regra usa zonas.
+	int32_t                                                 fuso_min = 0;
+	double                                             raio_parado_m = 50;
+
+	/**
+	 * @brief Compila regras de um texto.
+	 * @param texto Uma diretiva por linha, sendo '#' comentário:
+	 *
+	 * ```
+	 * fuso     -3                       # horas em relação ao UTC, para a coluna hora
+	 * parado_m 50                       # raio de permanência da coluna parado
+	 * regra 1  vel > 80 e zona 12
+	 * regra 2  parado > 1800 e (hora >= 22 ou hora < 6)
+	 * regra 3  alerta e nao zona 7
+	 * ```
+	 *
+	 * Colunas: `lat` e `lon` (graus), `alt` (m), `vel` (km/h), `parado` e `intervalo` (s),
+	 * `hora` (horas, fracionárias) e `alerta`; comparações `> >= < <= == !=`; conectivos
+	 * `e`, `ou`, `nao` e parênteses; `zona N` para as cercas de `cercas`.
+	 * @param cercas Cercas referenciadas por `zona N`.
+	 * @param origem Nome usado nas mensagens de erro.
+	 * @details
+	 *
+	 * Lança std::runtime_error indicando a linha problemática, como Fence::load().
+	 */
+	static std::unique_ptr<RuleSet>
+	compile(
+		const std::string& texto,
+		const std::vector<Fence>& cercas,
+		const std::string& origem = "regras"
+	){
+
+		std::unique_ptr<RuleSet> s(new RuleSet());
+
+		std::vector<uint32_t> ids_cercas;
+		for( const Fence& f : cercas ){ ids_cercas.push_back(f.id); }
+		std::sort(ids_cercas.begin(), ids_cercas.end());
+
+		std::unordered_map<uint64_t, uint32_t> unicos; // Predicado -> índice
+		std::vector<uint32_t>                  ids_regras;
+		bool                                   usa_zonas = false;
+
+		std::istringstream entrada(texto);
+		std::string        linha;
+		int                n_linha = 0;
+		while(
+			std::getline(entrada, linha)
+		){
+
+			n_linha++;
+			auto erro = [&](const std::string& msg){
+
+				throw std::runtime_error("\033[1;31m" + origem + ":" + std::to_string(n_linha) + ": " + msg + "\033[0m");
+			};
+
+			std::vector<std::string> tk = tokenize(linha.substr(0, linha.find('#')), erro);
+			if( tk.empty() ){ continue; }
+
+			if(
+				tk[0] == "fuso" || tk[0] == "parado_m"
+			){
+
+				double v = 0;
+				if( tk.size() != 2 || !number(tk[1], v) ){ erro(tk[0] + " deve ser seguido de um número"); }
+				if( tk[0] == "fuso" ){ s->fuso_min = static_cast<int32_t>(std::lround(v * 60)); }
+				else{ s->raio_parado_m = v; }
+				continue;
+			}
+			if( tk[0] != "regra" ){ erro("diretiva desconhecida '" + tk[0] + "'"); }
+
+			double id = -1;
+			if( tk.size() < 3 || !number(tk[1], id) || id < 0 || id != std::floor(id) || id > UINT32_MAX ){ erro("regra deve ser: regra id condição"); }
+
+			Regra r;
+			r.id  = static_cast<uint32_t>(id);
+			r.ini = static_cast<uint32_t>(s->codigo.size());
+
+			// Descida recursiva, emitindo as instruções em pós-fixa
+			std::size_t p = 2;
+			uint32_t    profundidade = 0;
+			auto emitir = [&](Op op, uint32_t arg){
+
+				if( op == Op::PREDICADO || op == Op::ZONA ){ profundidade++; }
+				else if( op != Op::NAO ){ profundidade--; }
+				if( profundidade > PILHA_MAX ){ erro("condição muito aninhada"); }
+				s->codigo.push_back({ op, arg });
+			};
+			auto proximo = [&]{ return p < tk.size() ? tk[p] : std::string(); };
+
+			std::function<int64_t()> ou;
+			std::function<int64_t()> primario = [&]() -> int64_t {
+
+				std::string t = proximo();
+				p++;
+				if(
+					t == "("
+				){
+
+					int64_t g = ou();
+					if( proximo() != ")" ){ erro("')' esperado"); }
+					p++;
+					return g;
+				}
+				if(
+					t == "nao"
+				){
+
+					primario();
+					emitir(Op::NAO, 0);
+					return -1;
+				}
+				if(
+					t == "zona"
+				){
+
+					double z = -1;
+					if( !number(proximo(), z) || z < 0 || z != std::floor(z) ){ erro("zona deve ser seguida do id de uma cerca"); }
+					p++;
+					if( !std::binary_search(ids_cercas.begin(), ids_cercas.end(), static_cast<uint32_t>(z)) ){ erro("cerca " + std::to_string(static_cast<uint32_t>(z)) + " inexistente"); }
+					emitir(Op::ZONA, static_cast<uint32_t>(z));
+					usa_zonas = true;
+					return static_cast<int64_t>(z);
+				}
+
+				Predicado pr{ LAT, Comparacao::IGUAL, 0 };
+				double    escala = 1;
+				if( t == "lat" ){ pr.coluna = LAT; escala = 1e6; }
+				else if( t == "lon" ){ pr.coluna = LON; escala = 1e6; }
+				else if( t == "alt" ){ pr.coluna = ALT; escala = 10; }
+				else if( t == "vel" ){ pr.coluna = VEL; escala = 10; }
+				else if( t == "parado" ){ pr.coluna = PARADO; }
+				else if( t == "intervalo" ){ pr.coluna = INTERVALO; }
+				else if( t == "hora" ){ pr.coluna = HORA; escala = 60; }
+				else if( t == "alerta" ){ pr.coluna = ALERTA; }
+				else{ erro("coluna desconhecida '" + t + "'"); }
+
+				double v = 0;
+				if(
+					pr.coluna == ALERTA
+				){
+
+					pr.comparacao = Comparacao::DIFERENTE;
+				}
+				else{
+
+					std::string c = proximo();
+					p++;
+					if( c == ">" ){ pr.comparacao = Comparacao::MAIOR; }
+					else if( c == ">=" ){ pr.comparacao = Comparacao::MAIOR_IGUAL; }
+					else if( c == "<" ){ pr.comparacao = Comparacao::MENOR; }
+					else if( c == "<=" ){ pr.comparacao = Comparacao::MENOR_IGUAL; }
+					else if( c == "==" ){ pr.comparacao = Comparacao::IGUAL; }
+					else if( c == "!=" ){ pr.comparacao = Comparacao::DIFERENTE; }
+					else{ erro("comparação esperada depois de '" + t + "'"); }
+
+					if( !number(proximo(), v) ){ erro("número esperado depois de '" + c + "'"); }
+					p++;
+				}
+				pr.valor = static_cast<int32_t>(std::max<double>(INT32_MIN, std::min<double>(INT32_MAX, std::llround(v * escala))));
+
+				uint64_t chave = (uint64_t(pr.coluna) << 40) | (uint64_t(pr.comparacao) << 32) | static_cast<uint32_t>(pr.valor);
+				auto it = unicos.try_emplace(chave, static_cast<uint32_t>(s->predicados.size())).first;
+				if( it->second == s->predicados.size() ){ s->predicados.push_back(pr); }
+				emitir(Op::PREDICADO, it->second);
+				return -1;
+			};
+			auto e = [&]() -> int64_t {
+
+				int64_t g = primario();
+				while(
+					proximo() == "e"
+				){
+
+					p++;
+					int64_t h = primario();
+					emitir(Op::E, 0);
+					if( g < 0 ){ g = h; }
+				}
+				return g;
+			};
+			ou = [&]() -> int64_t {
+
+				int64_t g = e();
+				while( proximo() == "ou" ){ p++; e(); emitir(Op::OU, 0); g = -1; }
+				return g;
+			};
+
+			r.guarda = ou();
+			if( p != tk.size() ){ erro("'" + tk[p] + "' inesperado"); }
+			r.fim = static_cast<uint32_t>(s->codigo.size());
+
+			if( std::find(ids_regras.begin(), ids_regras.end(), r.id) != ids_regras.end() ){ erro("regra " + std::to_string(r.id) + " repetida"); }
+			ids_regras.push_back(r.id);
+
+			uint32_t indice = static_cast<uint32_t>(s->regras.size());
+			if( r.guarda < 0 ){ s->livres.push_back(indice); }
+			else{ s->por_zona[static_cast<uint32_t>(r.guarda)].push_back(indice); }
+			s->regras.push_back(r);
+		}
+
+		if( usa_zonas ){ s->zonas = std::make_unique<const FenceIndex>(cercas); }
+		return s;
+	}
+
+	/**
+	 * @brief Compila as regras de um arquivo, no formato de compile().
+	 */
+	static std::unique_ptr<RuleSet>
+	load(
+		const std::string& caminho,
+		const std::vector<Fence>& cercas
+	){
+
+		std::ifstream arquivo(caminho);
+		if( !arquivo ){ throw std::runtime_error("\033[1;31mErro ao abrir regras: " + caminho + "\033[0m"); }
+
+		std::stringstream texto;
+		texto << arquivo.rdbuf();
+		return compile(texto.str(), cercas, caminho);
+	}
+
+private:
+
+	static bool
+	number(
+		const std::string& t,
+		double& v
+	){
+
+		if( t.empty() ){ return false; }
+		char* fim = nullptr;
+		v = std::strtod(t.c_str(), &fim);
+		return *fim == '\0';
+	}
+
+	template <typename E>
+	static std::vector<std::string>
+	tokenize(
+		const std::string& texto,
+		E&& erro
+	){
+
+		std::vector<std::string> tk;
+		for(
+			std::size_t i = 0; i < texto.size();
+		){
+
+			unsigned char c = static_cast<unsigned char>(texto[i]);
+			std::size_t   j = i + 1;
+			if( std::isspace(c) ){ i++; continue; }
+
+			if( std::isalpha(c) || c == '_' ){ while( j < texto.size() && (std::isalnum(static_cast<unsigned char>(texto[j])) || texto[j] == '_') ){ j++; } }
+			else if( std::isdigit(c) || c == '-' || c == '+' || c == '.' ){ while( j < texto.size() && (std::isdigit(static_cast<unsigned char>(texto[j])) || texto[j] == '.') ){ j++; } }
+			else if( c == '<' || c == '>' || c == '=' || c == '!' ){ if( j < texto.size() && texto[j] == '=' ){ j++; } }
+			else if( c != '(' && c != ')' ){ erro(std::string("caractere inesperado '") + texto[i] + "'"); }
+
+			tk.push_back(texto.substr(i, j - i));
+			i = j;
+		}
+		return tk;
+	}
+};
+
+/**
+ * @class RuleEngine
+ * @brief Avalia um RuleSet sobre os fixes do coletor e emite o início e o fim dos alertas.
+ * @details
+ *
+ * Os fixes são processados em lotes de até LOTE. Para cada lote:
+ *
+ * 1. o estado de cada rastreador é atualizado e as colunas derivadas (velocidade, tempo
+ *    parado, intervalo, hora local) são gravadas ao lado das do fix;
+ * 2. cada fix é consultado no FenceIndex das zonas, montando uma máscara por cerca visitada;
+ * 3. são avaliadas as regras livres e as guardadas pelas cercas visitadas, cada instrução
+ *    sobre as 64 linhas de uma vez, e cada Predicado no máximo uma vez;
+ * 4. as regras satisfeitas por fix são comparadas com as ativas do rastreador: as que
+ *    passam a valer geram DISPARO, e as que deixam de valer, FIM.
+ *
+ * Como em GeofenceEvaluator, o estado por rastreador cabe em uma entrada da TrackerTable.
+ * As regras ativas ficam em uma segunda tabela, consultada apenas para fixes que satisfazem
+ * alguma regra ou de rastreadores com alertas ativos; até MAX_ATIVAS por rastreador, as
+ * demais contadas em `excedentes`. Fixes mais antigos que o último são ignorados. As duas
+ * tabelas têm a mesma capacidade, já que a TrackerTable não remove entradas e todo
+ * rastreador que já disparou um alerta mantém a sua; fixes que não cabem em uma delas são
+ * contados em `tabela_cheia`.
+ */
+class RuleEngine {
+public:
+
+	static constexpr std::size_t LOTE       = 64;
+	static constexpr uint32_t    MAX_ATIVAS = 11;
+
+	using Sink = std::function<void(const RuleAlert&)>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de avaliação.
+	 */
+	struct Stats {
+		uint64_t fixes;
+		uint64_t lotes;
+		uint64_t avaliadas;  ///< Regras avaliadas, somadas por lote.
+		uint64_t puladas;    ///< Regras guardadas por cercas não visitadas no lote.
+		uint64_t disparos;
+		uint64_t fins;
+		uint64_t excedentes;
+		uint64_t tabela_cheia; ///< Fixes não avaliados ou alertas perdidos por tabela cheia.
+	};
+
+private:
+
+	/// Estado por rastreador; 40 bytes.
+	struct Estado {
+		int64_t  t_ms;
+		int64_t  ancora_ms; ///< Chegada ao raio de parada atual.
+		int32_t  lat_e6, lon_e6;
+		int32_t  anc_lat, anc_lon;
+		float    vel_kmh;
+		uint32_t n_ativas;
+	};
+
+	/// Regras ativas de um rastreador, por id; 48 bytes.
+	struct Ativas {
+		uint32_t n;
+		uint32_t ids[MAX_ATIVAS]; ///< Ordenados.
+	};
+
+	/// Vetor de 16 inteiros de 32 bits: 4 registradores SSE2 ou NEON, 1 AVX-512.
+	typedef int32_t v16i __attribute__((vector_size(64)));
+	typedef char    v16c __attribute__((vector_size(16)));
+
+	/**
+	 * @struct Lote
+	 * @brief Colunas e memória de trabalho de um lote, reaproveitadas pela thread.
+	 */
+	struct Lote {
+		alignas(64) int32_t colunas[RuleSet::N_COLUNAS][LOTE];
+
+		uint64_t valido = 0; ///< Fixes avaliados (não atrasados).
+		uint64_t tinha  = 0; ///< Fixes de rastreadores com alertas ativos.
+
+		// Tabela de cercas visitadas no lote, com endereçamento aberto; dobra ao passar de
+		// metade da ocupação, de modo que cercas aninhadas ou sobrepostas não se perdem
+		uint32_t              bits = 8;
+		std::vector<uint32_t> zona_id;
+		std::vector<uint64_t> zona_mascara;
+		std::vector<uint32_t> zonas_usadas; ///< Slots ocupados, na ordem de inserção.
+		uint32_t              n_zonas = 0;
+
+		std::vector<uint64_t> cache;    ///< Máscara de cada Predicado.
+		std::vector<uint64_t> geracao;  ///< Lote em que cada entrada de `cache` foi calculada.
+		uint64_t              lote = 0;
+
+		std::vector<uint32_t> candidatas;
+		std::vector<uint64_t> ativados; ///< Rastreadores com alertas ativos já neste lote.
+
+		uint32_t satisfeitas[LOTE][MAX_ATIVAS]; ///< Menores ids satisfeitos por fix, ordenados.
+		uint32_t n_satisfeitas[LOTE];           ///< Regras satisfeitas por fix, inclusive as excedentes.
+
+		/// Guarda `id` entre as MAX_ATIVAS menores do fix `j`, sem ordenar o lote inteiro.
+		void
+		satisfy(
+			unsigned j,
+			uint32_t id
+		){
+
+			uint32_t* v = satisfeitas[j];
+			uint32_t  n = std::min(n_satisfeitas[j]++, MAX_ATIVAS);
+			if( n == MAX_ATIVAS && id >= v[n - 1] ){ return; }
+
+			uint32_t k = n < MAX_ATIVAS ? n : n - 1;
+			for( ; k > 0 && v[k - 1] > id; k-- ){ v[k] = v[k - 1]; }
+			v[k] = id;
+		}
+
+		uint32_t slot(uint32_t id) const { return (id * 0x9E3779B1u) >> (32 - bits); }
+
+		/**
+		 * @brief Máscara dos fixes do lote dentro da cerca `id`.
+		 * @param criar Insere a cerca caso ausente; sem `criar`, retorna nullptr.
+		 */
+		uint64_t*
+		zone(
+			uint32_t id,
+			bool criar
+		){
+
+			const uint32_t mascara = (1u << bits) - 1;
+			for(
+				uint32_t s = slot(id); ; s = (s + 1) & mascara
+			){
+
+				if( zona_mascara[s] != 0 && zona_id[s] == id ){ return &zona_mascara[s]; }
+				if( zona_mascara[s] != 0 ){ continue; }
+				if( !criar ){ return nullptr; }
+				if( n_zonas == (1u << bits) / 2 ){ grow(); return zone(id, true); }
+
+				zona_id[s]              = id;
+				zonas_usadas[n_zonas++] = s;
+				return &zona_mascara[s];
+			}
+		}
+
+		void
+		grow(){
+
+			std::vector<uint32_t> ids(n_zonas);
+			std::vector<uint64_t> mascaras(n_zonas);
+			for( uint32_t k = 0; k < n_zonas; k++ ){ ids[k] = zona_id[zonas_usadas[k]]; mascaras[k] = zona_mascara[zonas_usadas[k]]; }
+
+			bits++;
+			zona_id.assign(std::size_t(1) << bits, 0);
+			zona_mascara.assign(std::size_t(1) << bits, 0);
+			zonas_usadas.resize(std::size_t(1) << bits);
+			n_zonas = 0;
+			for( uint32_t k = 0; k < ids.size(); k++ ){ *zone(ids[k], true) = mascaras[k]; }
+		}
+
+		void
+		clear_zones(){
+
+			for( uint32_t k = 0; k < n_zonas; k++ ){ zona_mascara[zonas_usadas[k]] = 0; }
+			n_zonas = 0;
+		}
+
+		Lote() : zona_id(std::size_t(1) << bits, 0), zona_mascara(std::size_t(1) << bits, 0), zonas_usadas(std::size_t(1) << bits) {}
+	};
+
+	RCUPtr<RuleSet>        regras;
+	TrackerTable<Estado>   tabela;
+	TrackerTable<Ativas>   ativas;
+	Sink                     sink;
+
+	std::atomic<uint64_t>      n_fixes{0};
+	std::atomic<uint64_t>      n_lotes{0};
+	std::atomic<uint64_t>  n_avaliadas{0};
+	std::atomic<uint64_t>    n_puladas{0};
+	std::atomic<uint64_t>   n_disparos{0};
+	std::atomic<uint64_t>       n_fins{0};
+	std::atomic<uint64_t> n_excedentes{0};
+	std::atomic<uint64_t> n_tabela_cheia{0};
+
+	/**
+	 * @brief Converte o resultado de uma comparação (bytes 0x00 ou 0xFF) em 16 bits, como em CsvDecoder.
+	 */
+	static uint64_t
+	movemask(
+		v16c comparacao
+	){
+
+#if defined(__SSE2__)
+		return static_cast<uint16_t>(__builtin_ia32_pmovmskb128(comparacao));
+#else
+		uint64_t palavras[2];
+		std::memcpy(palavras, &comparacao, sizeof(palavras));
+
+		const uint64_t UNS = 0x0101010101010101ULL, REUNIR = 0x0102040810204080ULL;
+		return (((palavras[0] & UNS) * REUNIR) >> 56) | ((((palavras[1] & UNS) * REUNIR) >> 56) << 8);
+#endif
+	}
+
+	/**
+	 * @brief Avalia um predicado sobre as LOTE linhas de uma coluna.
+	 */
+	static uint64_t
+	compare(
+		const int32_t* coluna,
+		RuleSet::Comparacao c,
+		int32_t valor
+	){
+
+		const v16i v = v16i{} + valor;
+		uint64_t   m = 0;
+		for(
+			std::size_t b = 0; b < LOTE; b += 16
+		){
+
+			v16i x, r;
+			std::memcpy(&x, coluna + b, sizeof(x));
+			switch(
+				c
+			){
+
+				case RuleSet::Comparacao::MAIOR       : r = x >  v; break;
+				case RuleSet::Comparacao::MAIOR_IGUAL : r = x >= v; break;
+				case RuleSet::Comparacao::MENOR       : r = x <  v; break;
+				case RuleSet::Comparacao::MENOR_IGUAL : r = x <= v; break;
+				case RuleSet::Comparacao::IGUAL       : r = x == v; break;
+				default                               : r = x != v; break;
+			}
+			m |= movemask(__builtin_convertvector(r, v16c)) << b;
+		}
+		return m;
+	}
+
+	/**
+	 * @brief Executa o bytecode de uma regra sobre o lote.
+	 */
+	static uint64_t
+	evaluate(
+		const RuleSet& s,
+		const RuleSet::Regra& r,
+		Lote& l
+	){
+
+		uint64_t pilha[RuleSet::PILHA_MAX];
+		uint32_t topo = 0;
+		for(
+			uint32_t k = r.ini; k < r.fim; k++
+		){
+
+			const RuleSet::Instrucao& in = s.codigo[k];
+			switch(
+				in.op
+			){
+
+				case RuleSet::Op::PREDICADO:
+				{
+					if(
+						l.geracao[in.arg] != l.lote
+					){
+
+						const RuleSet::Predicado& p = s.predicados[in.arg];
+						l.cache[in.arg]   = compare(l.colunas[p.coluna], p.comparacao, p.valor);
+						l.geracao[in.arg] = l.lote;
+					}
+					pilha[topo++] = l.cache[in.arg];
+					break;
+				}
+				case RuleSet::Op::ZONA:
+				{
+					uint64_t* m = l.zone(in.arg, false);
+					pilha[topo++] = m ? *m : 0;
+					break;
+				}
+				case RuleSet::Op::E  : topo--; pilha[topo - 1] &= pilha[topo]; break;
+				case RuleSet::Op::OU : topo--; pilha[topo - 1] |= pilha[topo]; break;
+				case RuleSet::Op::NAO: pilha[topo - 1] = ~pilha[topo - 1];     break;
+			}
+		}
+		return topo ? pilha[0] & l.valido : 0;
+	}
+
+	/**
+	 * @brief Passos 1 a 3: colunas, cercas e regras satisfeitas, em `l.satisfeitas`.
+	 */
+	void
+	evaluate_batch(
+		const CollectorFix* fixes,
+		std::size_t n,
+		Lote& l
+	){
+
+		auto leitura = regras.read();
+		const RuleSet& s = *leitura;
+
+		l.valido = 0;
+		l.tinha  = 0;
+		std::fill(l.n_satisfeitas, l.n_satisfeitas + n, 0);
+
+		// 1. Estado por rastreador e colunas derivadas
+		for(
+			std::size_t j = 0; j < n; j++
+		){
+
+			const CollectorFix& f = fixes[j];
+			bool    valido = false, tinha = false;
+			int32_t vel = 0, parado = 0, intervalo = 0;
+			bool ok = tabela.update(
+						  f.tracker,
+						  [&](Estado& e, bool novo){
+
+							  if(
+								  novo
+							  ){
+
+								  e = Estado{ f.t_ms, f.t_ms, f.lat_e6, f.lon_e6, f.lat_e6, f.lon_e6, 0, 0 };
+								  valido = true;
+								  return;
+							  }
+							  if( f.t_ms < e.t_ms ){ return; }
+
+							  int64_t dt = f.t_ms - e.t_ms;
+							  if( dt > 0 ){ e.vel_kmh = static_cast<float>(GPSFix::distance_m(e.lat_e6 * 1e-6, e.lon_e6 * 1e-6, f.lat(), f.lon()) / dt * 3600.0); }
+							  if(
+								  GPSFix::distance_m(e.anc_lat * 1e-6, e.anc_lon * 1e-6, f.lat(), f.lon()) > s.raio_parado_m
+							  ){
+
+								  e.anc_lat = f.lat_e6; e.anc_lon = f.lon_e6;
+								  e.ancora_ms = f.t_ms;
+							  }
+
+							  vel       = static_cast<int32_t>(std::min(e.vel_kmh * 10.0f, 2e9f));
+							  parado    = static_cast<int32_t>(std::min<int64_t>((f.t_ms - e.ancora_ms) / 1000, INT32_MAX));
+							  intervalo = static_cast<int32_t>(std::min<int64_t>(dt / 1000, INT32_MAX));
+							  e.t_ms    = f.t_ms;
+							  e.lat_e6  = f.lat_e6; e.lon_e6 = f.lon_e6;
+							  valido    = true;
+							  tinha     = e.n_ativas > 0;
+						  }
+						 );
+			if( !ok ){ n_tabela_cheia.fetch_add(1, std::memory_order_relaxed); }
+
+			int64_t minutos = (f.t_ms / 60000 + s.fuso_min) % 1440;
+			l.colunas[RuleSet::LAT][j]       = f.lat_e6;
+			l.colunas[RuleSet::LON][j]       = f.lon_e6;
+			l.colunas[RuleSet::ALT][j]       = f.alt_dm;
+			l.colunas[RuleSet::VEL][j]       = vel;
+			l.colunas[RuleSet::PARADO][j]    = parado;
+			l.colunas[RuleSet::INTERVALO][j] = intervalo;
+			l.colunas[RuleSet::HORA][j]      = static_cast<int32_t>(minutos < 0 ? minutos + 1440 : minutos);
+			l.colunas[RuleSet::ALERTA][j]    = (f.flags & CollectorFix::FLAG_ALERTA) ? 1 : 0;
+			l.valido |= uint64_t(valido) << j;
+			l.tinha  |= uint64_t(tinha) << j;
+		}
+
+		// 2. Cercas visitadas pelo lote
+		l.clear_zones();
+		if(
+			s.zonas
+		){
+
+			for(
+				uint64_t m = l.valido; m; m &= m - 1
+			){
+
+				unsigned j = static_cast<unsigned>(__builtin_ctzll(m));
+				s.zonas->query(fixes[j].lat_e6, fixes[j].lon_e6, [&](uint32_t id){
+
+					if( uint64_t* z = l.zone(id, true) ){ *z |= uint64_t(1) << j; }
+				});
+			}
+		}
+
+		// 3. Regras livres e guardadas pelas cercas visitadas
+		l.candidatas.assign(s.livres.begin(), s.livres.end());
+		for(
+			uint32_t k = 0; k < l.n_zonas; k++
+		){
+
+			auto it = s.por_zona.find(l.zona_id[l.zonas_usadas[k]]);
+			if( it != s.por_zona.end() ){ l.candidatas.insert(l.candidatas.end(), it->second.begin(), it->second.end()); }
+		}
+
+		if( l.cache.size() < s.predicados.size() ){ l.cache.resize(s.predicados.size()); l.geracao.resize(s.predicados.size(), 0); }
+		l.lote++;
+
+		for(
+			uint32_t indice : l.candidatas
+		){
+
+			const RuleSet::Regra& r = s.regras[indice];
+			for( uint64_t m = evaluate(s, r, l); m; m &= m - 1 ){ l.satisfy(static_cast<unsigned>(__builtin_ctzll(m)), r.id); }
+		}
+
+		n_lotes.fetch_add(1, std::memory_order_relaxed);
+		n_avaliadas.fetch_add(l.candidatas.size(), std::memory_order_relaxed);
+		n_puladas.fetch_add(s.regras.size() - l.candidatas.size(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Passo 4: compara as regras satisfeitas com as ativas e emite os eventos.
+	 */
+	void
+	update_alerts(
+		const CollectorFix* fixes,
+		std::size_t n,
+		Lote& l,
+		bool emitir
+	){
+
+		l.ativados.clear();
+
+		for(
+			std::size_t j = 0; j < n; j++
+		){
+
+			const CollectorFix& f = fixes[j];
+			bool relevante = l.n_satisfeitas[j] > 0 || ((l.tinha >> j) & 1) ||
+							 std::find(l.ativados.begin(), l.ativados.end(), f.tracker) != l.ativados.end();
+			if( !((l.valido >> j) & 1) || !relevante ){ continue; }
+
+			const uint32_t* atuais   = l.satisfeitas[j];
+			uint32_t        n_atuais = std::min(l.n_satisfeitas[j], MAX_ATIVAS);
+			if( l.n_satisfeitas[j] > MAX_ATIVAS ){ n_excedentes.fetch_add(l.n_satisfeitas[j] - MAX_ATIVAS, std::memory_order_relaxed); }
+
+			RuleAlert eventos[2 * MAX_ATIVAS];
+			uint32_t  n_eventos = 0, antes = 0;
+			bool ok = ativas.update(
+						  f.tracker,
+						  [&](Ativas& a, bool novo){
+
+							  if( novo ){ a.n = 0; }
+							  antes = a.n;
+
+							  // Diferença entre as listas ordenadas
+							  uint32_t i = 0, k = 0;
+							  while(
+								  i < a.n || k < n_atuais
+							  ){
+
+								  RuleAlert& ev = eventos[n_eventos];
+								  if( k == n_atuais || (i < a.n && a.ids[i] < atuais[k]) ){ ev.tipo = RuleAlert::Tipo::FIM; ev.regra = a.ids[i++]; }
+								  else if( i == a.n || atuais[k] < a.ids[i] ){ ev.tipo = RuleAlert::Tipo::DISPARO; ev.regra = atuais[k++]; }
+								  else{ i++; k++; continue; }
+								  n_eventos++;
+							  }
+
+							  a.n = n_atuais;
+							  std::copy(atuais, atuais + n_atuais, a.ids);
+						  }
+						 );
+			if( !ok ){ n_tabela_cheia.fetch_add(1, std::memory_order_relaxed); continue; }
+
+			if( n_atuais != antes ){ tabela.update(f.tracker, [&](Estado& e, bool){ e.n_ativas = n_atuais; }); }
+			if( n_atuais > 0 ){ l.ativados.push_back(f.tracker); }
+
+			for(
+				uint32_t k = 0; k < n_eventos; k++
+			){
+
+				RuleAlert& ev = eventos[k];
+				(ev.tipo == RuleAlert::Tipo::DISPARO ? n_disparos : n_fins).fetch_add(1, std::memory_order_relaxed);
+				if( !emitir || !sink ){ continue; }
+
+				ev.tracker = f.tracker;
+				ev.t_ms    = f.t_ms;
+				ev.lat_e6  = f.lat_e6;
+				ev.lon_e6  = f.lon_e6;
+				sink(ev);
+			}
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade Quantidade de rastreadores esperada.
+	 */
+	explicit RuleEngine(
+		std::size_t capacidade = 1 << 16
+	) : regras(std::unique_ptr<const RuleSet>(new RuleSet())),
+		tabela(capacidade),
+		ativas(capacidade) {}
+
+	/**
+	 * @brief Define a função que recebe os alertas. Deve ser chamado antes da ingestão.
+	 * @details
+	 *
+	 * Chamada pelas threads de recepção, fora dos locks dos rastreadores; deve ser thread-safe.
+	 */
+	void on_alert(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Publica um novo conjunto de regras.
+	 * @details
+	 *
+	 * Alertas de regras removidas terminam no fix seguinte de cada rastreador.
+	 */
+	void publish(std::unique_ptr<const RuleSet> novo){ regras.publish(std::move(novo)); }
+
+	/**
+	 * @brief Avalia um lote de fixes, em ordem.
+	 * @param fixes Fixes com rastreador identificado.
+	 * @param n Quantidade de fixes; lotes maiores que LOTE são divididos.
+	 * @param emitir False durante a reaplicação do WAL, cujos alertas já foram emitidos.
+	 */
+	void
+	apply(
+		const CollectorFix* fixes,
+		std::size_t n,
+		bool emitir = true
+	){
+
+		static thread_local Lote l;
+
+		n_fixes.fetch_add(n, std::memory_order_relaxed);
+		for(
+			std::size_t i = 0; i < n; i += LOTE
+		){
+
+			std::size_t k = std::min(LOTE, n - i);
+			evaluate_batch(fixes + i, k, l);
+			update_alerts(fixes + i, k, l, emitir);
+		}
+	}
+
+	/**
+	 * @brief Obtém os contadores de avaliação.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.fixes        = n_fixes.load(std::memory_order_relaxed);
+		s.lotes        = n_lotes.load(std::memory_order_relaxed);
+		s.avaliadas    = n_avaliadas.load(std::memory_order_relaxed);
+		s.puladas      = n_puladas.load(std::memory_order_relaxed);
+		s.disparos     = n_disparos.load(std::memory_order_relaxed);
+		s.fins         = n_fins.load(std::memory_order_relaxed);
+		s.excedentes   = n_excedentes.load(std::memory_order_relaxed);
+		s.tabela_cheia = n_tabela_cheia.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // RULEENGINE_HPP
@@ -0,0 +1,661 @@
+/**
+ * @file ScanEngine.hpp
+ * @brief Varredura paralela e vetorizada de fixes armazenados em colunas.
+ * @details
+ * Perguntas como "quais rastreadores estiveram nesta caixa entre T1 e T2" não devem exigir
+ * a decodificação de todo o histórico. Os fixes são reorganizados em segmentos colunares
+ * de inteiros de 32 bits, com zone maps (mínimos e máximos) por segmento e por página,
+ * e os predicados são avaliados com as extensões vetoriais do GCC/Clang, que geram SSE/AVX
+ * no servidor e NEON na placa, sem intrínsecos específicos de arquitetura.
+ */
+#ifndef SCANENGINE_HPP
+#define SCANENGINE_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "HistoryStore.hpp"
+#include "RCU.hpp"
+
+/**
+ * @struct ScanQuery
+ * @brief Predicado de varredura: intervalo de tempo e caixa envolvente, inclusivos.
+ */
+struct ScanQuery {
+	int64_t t_ini   = INT64_MIN;
+	int64_t t_fim   = INT64_MAX;
+	int32_t lat_min = INT32_MIN, lat_max = INT32_MAX; ///< Micrograus.
+	int32_t lon_min = INT32_MIN, lon_max = INT32_MAX; ///< Micrograus.
+};
+
+/**
+ * @struct ZoneMap
+ * @brief Mínimos e máximos de um trecho de coluna.
+ */
+struct ZoneMap {
+	int64_t t_min   = INT64_MAX, t_max   = INT64_MIN;
+	int32_t lat_min = INT32_MAX, lat_max = INT32_MIN;
+	int32_t lon_min = INT32_MAX, lon_max = INT32_MIN;
+
+	void
+	extend(
+		int64_t t,
+		int32_t lat,
+		int32_t lon
+	){
+
+		t_min   = std::min(t_min, t);     t_max   = std::max(t_max, t);
+		lat_min = std::min(lat_min, lat); lat_max = std::max(lat_max, lat);
+		lon_min = std::min(lon_min, lon); lon_max = std::max(lon_max, lon);
+	}
+
+	/// Nenhuma linha do trecho pode satisfazer a consulta.
+	bool
+	disjoint(
+		const ScanQuery& q
+	) const {
+
+		return t_max < q.t_ini || t_min > q.t_fim || lat_max < q.lat_min || lat_min > q.lat_max ||
+			   lon_max < q.lon_min || lon_min > q.lon_max;
+	}
+
+	/// Todas as linhas do trecho satisfazem a consulta.
+	bool
+	inside(
+		const ScanQuery& q
+	) const {
+
+		return t_min >= q.t_ini && t_max <= q.t_fim && lat_min >= q.lat_min && lat_max <= q.lat_max &&
+			   lon_min >= q.lon_min && lon_max <= q.lon_max;
+	}
+};
+
+/**
+ * @struct FixSegment
+ * @brief Segmento imutável de fixes em colunas.
+ * @details
+ *
+ * - `t_rel` : instante em ms relativo a `t_base`, em 32 bits (segmentos cobrem menos de 24 dias).
+ * - `lat`, `lon`, `alt` : ponto fixo, como em CollectorFix.
+ * - `rastreador` : índice local em `dicionario`, que guarda os identificadores reais.
+ *
+ * Cada página de PAGINA linhas possui seu próprio ZoneMap.
+ */
+struct FixSegment {
+	static constexpr std::size_t PAGINA = 1024;
+
+	int64_t                     t_base = 0;
+	std::vector<int32_t>             t_rel;
+	std::vector<int32_t>               lat;
+	std::vector<int32_t>               lon;
+	std::vector<int32_t>               alt;
+	std::vector<uint32_t>       rastreador;
+	std::vector<uint64_t>       dicionario;
+
+	ZoneMap                           zona;
+	std::vector<ZoneMap>           paginas;
+
+	std::size_t size() const { return t_rel.size(); }
+	std::size_t bytes() const { return size() * 5 * sizeof(int32_t) + dicionario.size() * sizeof(uint64_t) + paginas.size() * sizeof(ZoneMap); }
+};
+
+/**
+ * @class SegmentBuilder
+ * @brief Acumula fixes e os sela em FixSegment de tamanho limitado.
+ */
+class SegmentBuilder {
+private:
+
+	std::size_t                        linhas_por_segmento;
+	std::unique_ptr<FixSegment>                      atual;
+	std::unordered_map<uint64_t, uint32_t>             ids;
+	std::vector<std::shared_ptr<const FixSegment>> prontos;
+
+public:
+
+	explicit SegmentBuilder(
+		std::size_t linhas_por_segmento_ = 1 << 16
+	) : linhas_por_segmento(std::max(linhas_por_segmento_, FixSegment::PAGINA)) {}
+
+	/**
+	 * @brief Acrescenta um fix ao segmento em construção.
+	 * @details
+	 *
+	 * O segmento é selado ao atingir o limite de linhas ou quando o instante não couber
+	 * em 32 bits relativos ao início do segmento.
+	 */
+	void
+	append(
+		const CollectorFix& fix
+	){
+
+		if(
+			atual && (atual->size() >= linhas_por_segmento ||
+					  fix.t_ms - atual->t_base > INT32_MAX || fix.t_ms - atual->t_base < INT32_MIN)
+		){
+
+			seal();
+		}
+
+		if(
+			!atual
+		){
+
+			atual.reset(new FixSegment());
+			atual->t_base = fix.t_ms;
+			for( auto* c : { &atual->t_rel, &atual->lat, &atual->lon, &atual->alt } ){ c->reserve(linhas_por_segmento); }
+			atual->rastreador.reserve(linhas_por_segmento);
+		}
+
+		FixSegment& s = *atual;
+
+		auto it = ids.find(fix.tracker);
+		if(
+			it == ids.end()
+		){
+
+			it = ids.emplace(fix.tracker, static_cast<uint32_t>(s.dicionario.size())).first;
+			s.dicionario.push_back(fix.tracker);
+		}
+
+		if( s.size() % FixSegment::PAGINA == 0 ){ s.paginas.emplace_back(); }
+
+		s.t_rel.push_back(static_cast<int32_t>(fix.t_ms - s.t_base));
+		s.lat.push_back(fix.lat_e6);
+		s.lon.push_back(fix.lon_e6);
+		s.alt.push_back(fix.alt_dm);
+		s.rastreador.push_back(it->second);
+
+		s.paginas.back().extend(fix.t_ms, fix.lat_e6, fix.lon_e6);
+		s.zona.extend(fix.t_ms, fix.lat_e6, fix.lon_e6);
+	}
+
+	/**
+	 * @brief Sela o segmento em construção, se houver.
+	 */
+	void
+	seal(){
+
+		if( !atual || atual->size() == 0 ){ return; }
+
+		prontos.push_back(std::shared_ptr<const FixSegment>(atual.release()));
+		ids.clear();
+	}
+
+	/**
+	 * @brief Entrega os segmentos selados até o momento.
+	 */
+	std::vector<std::shared_ptr<const FixSegment>>
+	take(){
+
+		std::vector<std::shared_ptr<const FixSegment>> saida;
+		saida.swap(prontos);
+		return saida;
+	}
+};
+
+/**
+ * @class ScanEngine
+ * @brief Executor de varreduras sobre um conjunto de FixSegment.
+ * @details
+ *
+ * Fluxo de uma varredura:
+ *
+ * - Os segmentos são distribuídos dinamicamente entre as threads (contador atômico).
+ * - Segmentos e páginas disjuntos da consulta, segundo o ZoneMap, são descartados sem leitura;
+ *   páginas inteiramente contidas são aceitas sem avaliar o predicado.
+ * - As demais páginas são avaliadas 8 linhas por vez, com as colunas de tempo, latitude e
+ *   longitude comparadas em vetores de inteiros de 32 bits; apenas grupos com alguma linha
+ *   aceita passam pela compactação dos índices.
+ * - Cada thread marca os rastreadores encontrados; os resultados são unidos ao final.
+ *
+ * O conjunto de segmentos é publicado por RCUPtr, de modo que acrescentar segmentos não
+ * interrompe varreduras em andamento.
+ *
+ * Sobre um HistoryStore, load() reconstrói o conjunto inteiro e refresh() o acompanha:
+ * acrescenta apenas os blocos selados desde a carga anterior e reconstrói tudo quando a
+ * compactação reescreveu ou removeu algum bloco já carregado.
+ */
+class ScanEngine {
+public:
+
+	using Segmento = std::shared_ptr<const FixSegment>;
+
+	/**
+	 * @struct Opcoes
+	 * @brief Parâmetros de execução de uma varredura.
+	 */
+	struct Opcoes {
+		int  threads   = 0;    ///< 0 usa hardware_concurrency().
+		bool zonas     = true; ///< Usa os zone maps para descartar dados.
+		bool vetorial  = true; ///< Avalia o predicado com vetores; false usa o laço escalar.
+	};
+
+	/**
+	 * @struct Resultado
+	 * @brief Resultado e custo de uma varredura.
+	 */
+	struct Resultado {
+		uint64_t              linhas              = 0; ///< Linhas que satisfazem a consulta.
+		uint64_t              linhas_avaliadas    = 0; ///< Linhas cujo predicado foi avaliado.
+		uint64_t              segmentos_pulados   = 0;
+		uint64_t              paginas_puladas     = 0;
+		std::vector<uint64_t> rastreadores;            ///< Rastreadores encontrados, ordenados.
+	};
+
+private:
+
+	RCUPtr<std::vector<Segmento>> segmentos{std::unique_ptr<const std::vector<Segmento>>(new std::vector<Segmento>())};
+
+	// Carga a partir do histórico, serializada por mtx_carga
+	std::mutex                                 mtx_carga;
+	std::unordered_set<HistoryStore::Bloco>   carregados; ///< Blocos já reorganizados; mantê-los evita o reuso dos endereços.
+	uint64_t                            geracao_carregada = UINT64_MAX;
+
+	/// Vetor de 4 inteiros de 32 bits: um registrador SSE2 ou NEON.
+	typedef int32_t v4i __attribute__((vector_size(16)));
+
+	/**
+	 * @brief Limites da consulta convertidos para as colunas de 32 bits de um segmento.
+	 */
+	struct Limites {
+		int32_t t_lo, t_hi, lat_lo, lat_hi, lon_lo, lon_hi;
+	};
+
+	static Limites
+	bounds(
+		const FixSegment& s,
+		const ScanQuery& q
+	){
+
+		auto relativo = [&](int64_t t){
+
+			if( t == INT64_MIN || t - s.t_base < INT32_MIN ){ return INT32_MIN; }
+			if( t == INT64_MAX || t - s.t_base > INT32_MAX ){ return INT32_MAX; }
+			return static_cast<int32_t>(t - s.t_base);
+		};
+
+		return { relativo(q.t_ini), relativo(q.t_fim), q.lat_min, q.lat_max, q.lon_min, q.lon_max };
+	}
+
+	/**
+	 * @brief Avalia o predicado em [ini, fim) com vetores, gravando as linhas aceitas.
+	 * @return Quantidade de linhas aceitas.
+	 */
+	static std::size_t
+	match_vector(
+		const FixSegment& s,
+		std::size_t ini,
+		std::size_t fim,
+		const Limites& l,
+		uint32_t* selecao
+	){
+
+		const v4i t_lo   = v4i{} + l.t_lo,   t_hi   = v4i{} + l.t_hi;
+		const v4i lat_lo = v4i{} + l.lat_lo, lat_hi = v4i{} + l.lat_hi;
+		const v4i lon_lo = v4i{} + l.lon_lo, lon_hi = v4i{} + l.lon_hi;
+
+		auto tempo = [&](std::size_t j){
+
+			v4i t;
+			std::memcpy(&t, &s.t_rel[j], sizeof(v4i));
+			return (t >= t_lo) & (t <= t_hi);
+		};
+
+		auto posicao = [&](std::size_t j){
+
+			v4i la, lo;
+			std::memcpy(&la, &s.lat[j], sizeof(v4i));
+			std::memcpy(&lo, &s.lon[j], sizeof(v4i));
+			return (la >= lat_lo) & (la <= lat_hi) & (lo >= lon_lo) & (lo <= lon_hi);
+		};
+
+		auto nenhum = [](v4i a, v4i b){
+
+			uint64_t palavras[2];
+			v4i m = a | b;
+			std::memcpy(palavras, &m, sizeof(m));
+			return (palavras[0] | palavras[1]) == 0;
+		};
+
+		std::size_t k = 0, i = ini;
+		for(
+			; i + 8 <= fim; i += 8
+		){
+
+			// Caso comum em consultas seletivas: nenhuma das 8 linhas é aceita. O tempo é
+			// avaliado primeiro, para que as colunas de posição só sejam lidas quando necessário.
+			v4i m0 = tempo(i), m1 = tempo(i + 4);
+			if( nenhum(m0, m1) ){ continue; }
+
+			m0 &= posicao(i);
+			m1 &= posicao(i + 4);
+			if( nenhum(m0, m1) ){ continue; }
+
+			int32_t mascara[8];
+			std::memcpy(mascara,     &m0, sizeof(m0));
+			std::memcpy(mascara + 4, &m1, sizeof(m1));
+			for( int j = 0; j < 8; j++ ){ selecao[k] = static_cast<uint32_t>(i + j); k += mascara[j] & 1; }
+		}
+
+		for(
+			; i < fim; i++
+		){
+
+			selecao[k] = static_cast<uint32_t>(i);
+			k += (s.t_rel[i] >= l.t_lo) & (s.t_rel[i] <= l.t_hi) & (s.lat[i] >= l.lat_lo) & (s.lat[i] <= l.lat_hi) &
+				 (s.lon[i] >= l.lon_lo) & (s.lon[i] <= l.lon_hi);
+		}
+
+		return k;
+	}
+
+	/**
+	 * @brief Avalia o predicado linha a linha, com desvios; referência para comparação.
+	 */
+	static std::size_t
+	match_scalar(
+		const FixSegment& s,
+		std::size_t ini,
+		std::size_t fim,
+		const Limites& l,
+		uint32_t* selecao
+	){
+
+		std::size_t k = 0;
+		for(
+			std::size_t i = ini; i < fim; i++
+		){
+
+			if( s.t_rel[i] < l.t_lo || s.t_rel[i] > l.t_hi ){ continue; }
+			if( s.lat[i] < l.lat_lo || s.lat[i] > l.lat_hi ){ continue; }
+			if( s.lon[i] < l.lon_lo || s.lon[i] > l.lon_hi ){ continue; }
+			selecao[k++] = static_cast<uint32_t>(i);
+		}
+		return k;
+	}
+
+	/**
+	 * @brief Varre um segmento, acumulando o resultado parcial de uma thread.
+	 */
+	static void
+	scan_segment(
+		const FixSegment& s,
+		const ScanQuery& q,
+		const Opcoes& op,
+		Resultado& r,
+		std::vector<uint8_t>& presentes,
+		std::vector<uint32_t>& selecao
+	){
+
+		if( op.zonas && s.zona.disjoint(q) ){ r.segmentos_pulados++; return; }
+
+		Limites l = bounds(s, q);
+		presentes.assign(s.dicionario.size(), 0);
+		selecao.resize(FixSegment::PAGINA);
+
+		for(
+			std::size_t p = 0; p < s.paginas.size(); p++
+		){
+
+			std::size_t ini = p * FixSegment::PAGINA;
+			std::size_t fim = std::min(ini + FixSegment::PAGINA, s.size());
+
+			if( op.zonas && s.paginas[p].disjoint(q) ){ r.paginas_puladas++; continue; }
+			if(
+				op.zonas && s.paginas[p].inside(q)
+			){
+
+				for( std::size_t i = ini; i < fim; i++ ){ presentes[s.rastreador[i]] = 1; }
+				r.linhas += fim - ini;
+				continue;
+			}
+
+			std::size_t k = op.vetorial ? match_vector(s, ini, fim, l, selecao.data()) : match_scalar(s, ini, fim, l, selecao.data());
+			for( std::size_t j = 0; j < k; j++ ){ presentes[s.rastreador[selecao[j]]] = 1; }
+
+			r.linhas           += k;
+			r.linhas_avaliadas += fim - ini;
+		}
+
+		for( std::size_t i = 0; i < presentes.size(); i++ ){ if( presentes[i] ){ r.rastreadores.push_back(s.dicionario[i]); } }
+	}
+
+	/**
+	 * @brief Ordena os blocos e os reorganiza em segmentos, acrescentados ao conjunto.
+	 * @return Quantidade de linhas.
+	 */
+	std::size_t
+	build(
+		const std::vector<HistoryStore::Bloco>& blocos,
+		std::size_t linhas_por_segmento,
+		bool substituir = false
+	){
+
+		auto morton = [](const FixBlock& b){
+
+			uint32_t y = static_cast<uint32_t>((int64_t(b.lat_min) + b.lat_max) / 2 + 90000000) >> 12;
+			uint32_t x = static_cast<uint32_t>((int64_t(b.lon_min) + b.lon_max) / 2 + 180000000) >> 13;
+			uint64_t m = 0;
+			for( int i = 0; i < 16; i++ ){ m |= (uint64_t((x >> i) & 1) << (2 * i)) | (uint64_t((y >> i) & 1) << (2 * i + 1)); }
+			return m;
+		};
+
+		const int64_t JANELA_MS = 6 * 3600000LL;
+		std::vector<std::pair<std::pair<int64_t, uint64_t>, std::size_t>> ordem(blocos.size());
+		for( std::size_t i = 0; i < blocos.size(); i++ ){ ordem[i] = { { blocos[i]->t_min / JANELA_MS, morton(*blocos[i]) }, i }; }
+		std::sort(ordem.begin(), ordem.end());
+
+		SegmentBuilder construtor(linhas_por_segmento);
+		std::size_t n = 0;
+		for(
+			const auto& o : ordem
+		){
+
+			blocos[o.second]->decode([&](const CollectorFix& fix){ construtor.append(fix); });
+			n += blocos[o.second]->n;
+		}
+		construtor.seal();
+
+		if( substituir ){ segmentos.publish(std::make_unique<const std::vector<Segmento>>(construtor.take())); }
+		else{ add(construtor.take()); }
+		return n;
+	}
+
+	/**
+	 * @brief Substitui o conjunto pelos segmentos dos blocos. Requer mtx_carga.
+	 */
+	std::size_t
+	rebuild(
+		const std::vector<HistoryStore::Bloco>& blocos,
+		uint64_t geracao,
+		std::size_t linhas_por_segmento
+	){
+
+		std::size_t n = build(blocos, linhas_por_segmento, true);
+		carregados.clear();
+		carregados.insert(blocos.begin(), blocos.end());
+		geracao_carregada = geracao;
+		return n;
+	}
+
+public:
+
+	ScanEngine() = default;
+
+	ScanEngine(const ScanEngine&)            = delete;
+	ScanEngine& operator=(const ScanEngine&) = delete;
+
+	/**
+	 * @brief Acrescenta segmentos ao conjunto varrido.
+	 */
+	void
+	add(
+		const std::vector<Segmento>& novos
+	){ segmentos.update([&](std::vector<Segmento>& v){ v.insert(v.end(), novos.begin(), novos.end()); }); }
+
+	/**
+	 * @brief Reorganiza os blocos selados de um HistoryStore em segmentos colunares,
+	 * substituindo o conjunto varrido.
+	 * @param historico Histórico de origem.
+	 * @param linhas_por_segmento Tamanho máximo de cada segmento.
+	 * @return Quantidade de linhas carregadas.
+	 * @details
+	 *
+	 * Os blocos são ordenados por janela de 6 horas e, dentro dela, pela ordem de Morton do
+	 * centro da caixa envolvente. Assim, cada segmento cobre pouco tempo e as páginas agrupam
+	 * rastreadores próximos, o que torna os zone maps seletivos. Segmentos acrescentados por
+	 * add() são descartados.
+	 */
+	std::size_t
+	load(
+		HistoryStore& historico,
+		std::size_t linhas_por_segmento = 1 << 16
+	){
+
+		std::lock_guard<std::mutex> lock(mtx_carga);
+
+		uint64_t geracao = historico.generation();
+		std::vector<HistoryStore::Bloco> blocos;
+		historico.for_each_block([&](const HistoryStore::Bloco& b){ blocos.push_back(b); });
+
+		return rebuild(blocos, geracao, linhas_por_segmento);
+	}
+
+	/**
+	 * @brief Acompanha o histórico desde a última carga.
+	 * @param historico O mesmo histórico de load().
+	 * @param linhas_por_segmento Tamanho máximo de cada segmento.
+	 * @return Quantidade de linhas carregadas; 0 caso o histórico não tenha mudado.
+	 * @details
+	 *
+	 * Sem alteração no histórico (HistoryStore::generation()), retorna sem percorrê-lo.
+	 * Se todos os blocos carregados continuam no histórico, apenas os novos são
+	 * reorganizados em segmentos e acrescentados; se a compactação reescreveu ou removeu
+	 * algum deles, o conjunto é reconstruído como em load().
+	 */
+	std::size_t
+	refresh(
+		HistoryStore& historico,
+		std::size_t linhas_por_segmento = 1 << 16
+	){
+
+		std::lock_guard<std::mutex> lock(mtx_carga);
+
+		uint64_t geracao = historico.generation();
+		if( geracao == geracao_carregada ){ return 0; }
+
+		std::vector<HistoryStore::Bloco> blocos, novos;
+		historico.for_each_block([&](const HistoryStore::Bloco& b){ blocos.push_back(b); });
+
+		std::size_t mantidos = 0;
+		for( const HistoryStore::Bloco& b : blocos ){ if( carregados.count(b) ){ mantidos++; } else{ novos.push_back(b); } }
+		if( mantidos < carregados.size() ){ return rebuild(blocos, geracao, linhas_por_segmento); }
+
+		std::size_t n = 0;
+		if(
+			!novos.empty()
+		){
+
+			n = build(novos, linhas_por_segmento);
+			carregados.insert(novos.begin(), novos.end());
+		}
+		geracao_carregada = geracao;
+		return n;
+	}
+
+	/**
+	 * @brief Executa uma varredura.
+	 * @param q Predicado.
+	 * @param op Parâmetros de execução.
+	 */
+	Resultado
+	scan(
+		const ScanQuery& q,
+		const Opcoes& op
+	){
+
+		auto leitura = segmentos.read();
+		const std::vector<Segmento>& segs = *leitura;
+
+		int n_threads = op.threads > 0 ? op.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+		n_threads = std::max(1, std::min<int>(n_threads, static_cast<int>(segs.size())));
+
+		std::vector<Resultado> parciais(n_threads);
+		std::atomic<std::size_t> proximo{0};
+
+		auto trabalhar = [&](int t){
+
+			std::vector<uint8_t>  presentes;
+			std::vector<uint32_t> selecao;
+			for(
+				std::size_t i = proximo.fetch_add(1, std::memory_order_relaxed); i < segs.size();
+				i = proximo.fetch_add(1, std::memory_order_relaxed)
+			){
+
+				scan_segment(*segs[i], q, op, parciais[t], presentes, selecao);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for( int t = 1; t < n_threads; t++ ){ threads.emplace_back(trabalhar, t); }
+		trabalhar(0);
+		for( auto& th : threads ){ th.join(); }
+
+		Resultado r;
+		for(
+			auto& p : parciais
+		){
+
+			r.linhas            += p.linhas;
+			r.linhas_avaliadas  += p.linhas_avaliadas;
+			r.segmentos_pulados += p.segmentos_pulados;
+			r.paginas_puladas   += p.paginas_puladas;
+			r.rastreadores.insert(r.rastreadores.end(), p.rastreadores.begin(), p.rastreadores.end());
+		}
+		std::sort(r.rastreadores.begin(), r.rastreadores.end());
+		r.rastreadores.erase(std::unique(r.rastreadores.begin(), r.rastreadores.end()), r.rastreadores.end());
+
+		return r;
+	}
+
+	/**
+	 * @brief Executa uma varredura com os parâmetros padrão.
+	 */
+	Resultado scan(const ScanQuery& q){ return scan(q, Opcoes()); }
+
+	/**
+	 * @brief Quantidade de segmentos.
+	 */
+	std::size_t
+	segment_count(){
+
+		auto leitura = segmentos.read();
+		return leitura->size();
+	}
+
+	/**
+	 * @brief Quantidade total de linhas e bytes ocupados.
+	 */
+	std::pair<std::size_t, std::size_t>
+	size(){
+
+		auto leitura = segmentos.read();
+		std::size_t linhas = 0, bytes = 0;
+		for( const auto& s : *leitura ){ linhas += s->size(); bytes += s->bytes(); }
+		return { linhas, bytes };
+	}
+};
+
+#endif // SCANENGINE_HPP
@@ -0,0 +1,99 @@
+/**
+ * @file SeqLock.hpp
+ * @brief Implementação de um slot de valor único protegido por seqlock.
+ * @details
+ * Permite que um único escritor publique valores pequenos e trivialmente copiáveis
+ * enquanto diversos leitores os consultam sem jamais bloquear o escritor.
+ */
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @class SeqLock
+ * @brief Slot lock-free de escritor único e múltiplos leitores.
+ * @tparam T Tipo armazenado, obrigatoriamente trivialmente copiável.
+ * @details
+ *
+ * O escritor incrementa o contador de sequência antes e depois de cada escrita,
+ * de modo que o valor é ímpar durante a escrita. O leitor copia o conteúdo e
+ * repete a leitura caso a sequência tenha mudado ou esteja ímpar.
+ *
+ * O conteúdo é guardado em palavras atômicas de 64 bits com ordem relaxada,
+ * evitando condições de corrida formais sem custo adicional nas arquiteturas
+ * que nos interessam (ARMv7 e x86_64).
+ *
+ * O escritor nunca espera. Leitores apenas repetem em caso de concorrência.
+ */
+template <typename T>
+class SeqLock {
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock exige tipo trivialmente copiável");
+
+	static constexpr std::size_t N_PALAVRAS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<uint64_t>                 seq{0};
+	std::atomic<uint64_t> palavras[N_PALAVRAS]{};
+
+public:
+
+	/**
+	 * @brief Publica um novo valor. Deve ser chamada por um único escritor.
+	 * @param valor Valor a ser publicado.
+	 */
+	void
+	store(
+		const T& valor
+	){
+
+		uint64_t buffer[N_PALAVRAS] = {};
+		std::memcpy(buffer, &valor, sizeof(T));
+
+		uint64_t s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for( std::size_t i = 0; i < N_PALAVRAS; i++ ){ palavras[i].store(buffer[i], std::memory_order_relaxed); }
+
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Obtém uma cópia consistente do último valor publicado.
+	 * @param[out] saida Valor lido.
+	 * @return False caso nada tenha sido publicado ainda. True, caso contrário.
+	 */
+	bool
+	load(
+		T& saida
+	) const {
+
+		uint64_t buffer[N_PALAVRAS];
+		uint64_t s0, s1;
+		do {
+
+			s0 = seq.load(std::memory_order_acquire);
+			for( std::size_t i = 0; i < N_PALAVRAS; i++ ){ buffer[i] = palavras[i].load(std::memory_order_relaxed); }
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s1 = seq.load(std::memory_order_relaxed);
+
+		} while( (s0 & 1) || s0 != s1 );
+
+		if( s0 == 0 ){ return false; }
+
+		std::memcpy(&saida, buffer, sizeof(T));
+		return true;
+	}
+
+	/**
+	 * @brief Quantidade de publicações realizadas até o momento.
+	 */
+	uint64_t
+	version() const { return seq.load(std::memory_order_acquire) / 2; }
+};
+
+#endif // SEQLOCK_HPP
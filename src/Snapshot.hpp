@@ -0,0 +1,335 @@
+/**
+ * @file Snapshot.hpp
+ * @brief Gravação e leitura do snapshot binário do estado em memória do coletor.
+ * @details
+ * Reconstruir tabelas e índices reaplicando todo o WAL leva minutos com a frota inteira.
+ * O snapshot guarda as estruturas em um layout binário, com as seções grandes alinhadas a
+ * páginas, de modo que o arquivo é mapeado com mmap e copiado diretamente para a memória.
+ */
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Específicos de Sistemas Linux
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Crc32.hpp"
+
+/// Alinhamento das seções copiadas em bloco.
+constexpr std::size_t TAM_PAGINA_SNAPSHOT = 4096;
+
+/**
+ * @class SnapshotWriter
+ * @brief Serializa o snapshot em memória e o grava de forma atômica.
+ * @details
+ *
+ * Formato: mágica e versão, o conteúdo gravado pelas estruturas e, ao final, a tabela de
+ * seções (fim e CRC32 de cada uma), a quantidade de seções, a mágica de término e o tamanho
+ * total. As seções são delimitadas por section(), em geral uma por estrutura, e cobrem o
+ * arquivo do início até a tabela. Um arquivo interrompido no meio da gravação não tem o
+ * final, e um bit trocado em qualquer seção altera seu CRC; em ambos os casos o arquivo é
+ * rejeitado por SnapshotReader antes de qualquer estrutura ser carregada.
+ */
+class SnapshotWriter {
+public:
+
+	static constexpr uint64_t MAGICA     = 0x3150414e53535047ULL; // "GPSSNAP1"
+	static constexpr uint64_t MAGICA_FIM = 0x444e454e53535047ULL; // "GPSSNEND"
+	static constexpr uint32_t VERSAO     = 3;
+
+	/// Entrada da tabela de seções.
+	struct Secao {
+		uint64_t fim;
+		uint32_t crc;
+		uint32_t reservado;
+	};
+
+private:
+
+	std::vector<char>     dados;
+	std::vector<uint64_t> fins; ///< Fim de cada seção; os CRCs são calculados em write().
+
+public:
+
+	SnapshotWriter(){
+
+		dados.reserve(1 << 20);
+		put(MAGICA);
+		put(VERSAO);
+	}
+
+	/**
+	 * @brief Acrescenta bytes brutos.
+	 */
+	void
+	put_bytes(
+		const void* p,
+		std::size_t n
+	){
+
+		const char* c = static_cast<const char*>(p);
+		dados.insert(dados.end(), c, c + n);
+	}
+
+	/**
+	 * @brief Acrescenta um valor trivialmente copiável.
+	 */
+	template <typename T>
+	void
+	put(
+		const T& v
+	){
+
+		static_assert(std::is_trivially_copyable<T>::value, "Valor do snapshot deve ser trivialmente copiável");
+		put_bytes(&v, sizeof(T));
+	}
+
+	/**
+	 * @brief Acrescenta a quantidade de elementos seguida dos elementos.
+	 */
+	template <typename T>
+	void
+	put_vector(
+		const std::vector<T>& v
+	){
+
+		static_assert(std::is_trivially_copyable<T>::value, "Valor do snapshot deve ser trivialmente copiável");
+		put<uint64_t>(v.size());
+		put_bytes(v.data(), v.size() * sizeof(T));
+	}
+
+	/**
+	 * @brief Completa com zeros até o próximo múltiplo de `alinhamento`.
+	 */
+	void
+	align(
+		std::size_t alinhamento = TAM_PAGINA_SNAPSHOT
+	){ dados.resize((dados.size() + alinhamento - 1) / alinhamento * alinhamento, 0); }
+
+	/**
+	 * @brief Encerra a seção atual no fim do conteúdo gravado até aqui.
+	 * @details
+	 *
+	 * Apenas registra a posição: o CRC é calculado em write(), fora da pausa da recepção.
+	 */
+	void
+	section(){ if( fins.empty() || fins.back() != dados.size() ){ fins.push_back(dados.size()); } }
+
+	std::size_t size() const { return dados.size(); }
+
+	/**
+	 * @brief Grava o snapshot em `caminho`, via arquivo temporário, fsync e rename.
+	 * @return False caso a gravação falhe; o arquivo anterior, se houver, é preservado.
+	 */
+	bool
+	write(
+		const std::string& caminho
+	){
+
+		section();
+		std::vector<Secao> tabela;
+		for(
+			std::size_t i = 0, ini = 0; i < fins.size(); ini = fins[i++]
+		){
+
+			tabela.push_back(Secao{ fins[i], crc32(dados.data() + ini, fins[i] - ini), 0 });
+		}
+		for( const Secao& sec : tabela ){ put(sec); }
+		put<uint64_t>(tabela.size());
+		put(MAGICA_FIM);
+		put<uint64_t>(dados.size() + sizeof(uint64_t));
+
+		std::string temporario = caminho + ".tmp";
+		int fd = ::open(temporario.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if( fd < 0 ){ std::cout << "\033[1;31mErro ao criar snapshot: " << temporario << "\033[0m" << std::endl; return false; }
+
+		const char* p = dados.data();
+		std::size_t n = dados.size();
+		while(
+			n > 0
+		){
+
+			ssize_t k = ::write(fd, p, n);
+			if( k < 0 && errno == EINTR ){ continue; }
+			if( k <= 0 ){ break; }
+			p += k; n -= static_cast<std::size_t>(k);
+		}
+
+		bool ok = (n == 0) && ::fsync(fd) == 0;
+		::close(fd);
+		if( ok ){ ok = ::rename(temporario.c_str(), caminho.c_str()) == 0; }
+		if(
+			!ok
+		){
+
+			::unlink(temporario.c_str());
+			std::cout << "\033[1;31mErro ao gravar snapshot: " << caminho << "\033[0m" << std::endl;
+			return false;
+		}
+
+		// Garante que o rename também seja durável
+		std::size_t barra = caminho.find_last_of('/');
+		std::string dir   = (barra == std::string::npos) ? "." : caminho.substr(0, std::max<std::size_t>(barra, 1));
+		int fd_dir = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if( fd_dir >= 0 ){ ::fsync(fd_dir); ::close(fd_dir); }
+		return true;
+	}
+};
+
+/**
+ * @class SnapshotReader
+ * @brief Leitura sequencial de um snapshot mapeado com mmap.
+ * @details
+ *
+ * O arquivo é validado na abertura (mágicas, versão, tamanho e CRC de cada seção). As
+ * leituras não copiam nada além do pedido: view() devolve um ponteiro para dentro do mapeamento. Uma leitura
+ * além do fim invalida o leitor, e as seguintes falham.
+ */
+class SnapshotReader {
+private:
+
+	int                   fd = -1;
+	const char*         base = nullptr;
+	std::size_t      tamanho = 0; ///< Tamanho do mapeamento.
+	std::size_t          fim = 0; ///< Fim do conteúdo, antes do final.
+	std::size_t          pos = 0;
+	bool                  ok = false;
+
+public:
+
+	/**
+	 * @brief Construtor. Mapeia e valida o arquivo; consulte valid().
+	 */
+	explicit SnapshotReader(
+		const std::string& caminho
+	){
+
+		fd = ::open(caminho.c_str(), O_RDONLY | O_CLOEXEC);
+		if( fd < 0 ){ return; }
+
+		struct stat st;
+		if( ::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(5 * sizeof(uint64_t)) ){ return; }
+		tamanho = static_cast<std::size_t>(st.st_size);
+
+		void* m = ::mmap(nullptr, tamanho, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		if( m == MAP_FAILED ){ tamanho = 0; return; }
+		base = static_cast<const char*>(m);
+		::madvise(m, tamanho, MADV_SEQUENTIAL);
+
+		uint64_t magica, magica_fim, total, n_secoes;
+		uint32_t versao;
+		std::memcpy(&magica, base, sizeof(magica));
+		std::memcpy(&versao, base + sizeof(magica), sizeof(versao));
+		std::memcpy(&n_secoes, base + tamanho - 3 * sizeof(uint64_t), sizeof(n_secoes));
+		std::memcpy(&magica_fim, base + tamanho - 2 * sizeof(uint64_t), sizeof(magica_fim));
+		std::memcpy(&total, base + tamanho - sizeof(uint64_t), sizeof(total));
+
+		ok  = magica == SnapshotWriter::MAGICA && versao == SnapshotWriter::VERSAO &&
+			  magica_fim == SnapshotWriter::MAGICA_FIM && total == tamanho &&
+			  n_secoes > 0 && n_secoes <= (tamanho - 3 * sizeof(uint64_t)) / sizeof(SnapshotWriter::Secao);
+		if( !ok ){ return; }
+
+		fim = tamanho - 3 * sizeof(uint64_t) - n_secoes * sizeof(SnapshotWriter::Secao);
+		pos = sizeof(magica) + sizeof(versao);
+
+		// Seções contíguas, do início do arquivo até a tabela, cada uma com seu CRC
+		std::size_t ini = 0;
+		for(
+			uint64_t i = 0; ok && i < n_secoes; i++
+		){
+
+			SnapshotWriter::Secao sec;
+			std::memcpy(&sec, base + fim + i * sizeof(sec), sizeof(sec));
+			ok  = sec.fim > ini && sec.fim <= fim && (i + 1 < n_secoes || sec.fim == fim) &&
+				  crc32(base + ini, sec.fim - ini) == sec.crc;
+			ini = sec.fim;
+		}
+	}
+
+	~SnapshotReader(){
+
+		if( base ){ ::munmap(const_cast<char*>(base), tamanho); }
+		if( fd >= 0 ){ ::close(fd); }
+	}
+
+	SnapshotReader(const SnapshotReader&)            = delete;
+	SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+	/**
+	 * @brief Indica se o arquivo é válido e nenhuma leitura excedeu o conteúdo.
+	 */
+	bool valid() const { return ok; }
+
+	/**
+	 * @brief Ponteiro para os próximos n bytes, avançando a leitura.
+	 * @return nullptr caso excedam o conteúdo.
+	 */
+	const void*
+	view(
+		std::size_t n
+	){
+
+		if( !ok || n > fim - pos ){ ok = false; return nullptr; }
+		const char* p = base + pos;
+		pos += n;
+		return p;
+	}
+
+	bool
+	get_bytes(
+		void* destino,
+		std::size_t n
+	){
+
+		const void* p = view(n);
+		if( p ){ std::memcpy(destino, p, n); }
+		return p != nullptr;
+	}
+
+	template <typename T>
+	bool
+	get(
+		T& v
+	){
+
+		static_assert(std::is_trivially_copyable<T>::value, "Valor do snapshot deve ser trivialmente copiável");
+		return get_bytes(&v, sizeof(T));
+	}
+
+	/**
+	 * @brief Lê um vetor gravado por SnapshotWriter::put_vector().
+	 */
+	template <typename T>
+	bool
+	get_vector(
+		std::vector<T>& v
+	){
+
+		uint64_t n = 0;
+		if( !get(n) || n > (fim - pos) / sizeof(T) ){ ok = false; return false; }
+		v.resize(n);
+		return n == 0 || get_bytes(v.data(), n * sizeof(T));
+	}
+
+	/**
+	 * @brief Avança até o próximo múltiplo de `alinhamento`, como SnapshotWriter::align().
+	 */
+	bool
+	align(
+		std::size_t alinhamento = TAM_PAGINA_SNAPSHOT
+	){ return view((pos + alinhamento - 1) / alinhamento * alinhamento - pos) != nullptr; }
+};
+
+#endif // SNAPSHOT_HPP
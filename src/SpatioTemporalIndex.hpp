@@ -0,0 +1,544 @@
+/**
+ * @file SpatioTemporalIndex.hpp
+ * @brief Índice espaço-temporal de rastreadores: (célula, janela de tempo) para Bitmap.
+ * @details
+ * As investigações mais frequentes perguntam quais rastreadores passaram por uma região
+ * em um período. O índice é mantido durante a ingestão e responde com uniões de bitmaps,
+ * recorrendo ao histórico apenas nas células e janelas da borda da consulta.
+ */
+#ifndef SPATIOTEMPORALINDEX_HPP
+#define SPATIOTEMPORALINDEX_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Bitmap.hpp"
+#include "CollectorFix.hpp"
+#include "GPSFix.hpp"
+#include "HistoryStore.hpp"
+#include "Snapshot.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @struct IndexRegion
+ * @brief Região de consulta: caixa ou círculo.
+ */
+struct IndexRegion {
+
+	/**
+	 * @struct Celula
+	 * @brief Célula da grade coberta pela região.
+	 */
+	struct Celula {
+		int32_t lat_i;
+		int32_t lon_i;
+		bool    interior; ///< Inteiramente contida na região.
+	};
+
+	enum class Tipo { CAIXA, CIRCULO };
+
+	Tipo    tipo    = Tipo::CAIXA;
+	int32_t lat_min = 0, lat_max = 0; ///< Caixa, em micrograus.
+	int32_t lon_min = 0, lon_max = 0;
+	double  lat = 0, lon = 0, raio_m = 0; ///< Círculo.
+
+	static IndexRegion
+	box(
+		int32_t lat_min,
+		int32_t lat_max,
+		int32_t lon_min,
+		int32_t lon_max
+	){
+
+		IndexRegion r;
+		r.lat_min = lat_min; r.lat_max = lat_max;
+		r.lon_min = lon_min; r.lon_max = lon_max;
+		return r;
+	}
+
+	static IndexRegion
+	circle(
+		double lat,
+		double lon,
+		double raio_m
+	){
+
+		IndexRegion r;
+		r.tipo = Tipo::CIRCULO;
+		r.lat = lat; r.lon = lon; r.raio_m = raio_m;
+
+		double dlat = raio_m / 111320.0;
+		double dlon = raio_m / (111320.0 * std::max(0.01, std::cos(lat * M_PI / 180.0)));
+		r.lat_min = static_cast<int32_t>(std::floor((lat - dlat) * 1e6));
+		r.lat_max = static_cast<int32_t>(std::ceil((lat + dlat) * 1e6));
+		r.lon_min = static_cast<int32_t>(std::floor((lon - dlon) * 1e6));
+		r.lon_max = static_cast<int32_t>(std::ceil((lon + dlon) * 1e6));
+		return r;
+	}
+
+	/**
+	 * @brief Indica se o ponto pertence à região.
+	 */
+	bool
+	contains(
+		int32_t lat_e6,
+		int32_t lon_e6
+	) const {
+
+		if( lat_e6 < lat_min || lat_e6 > lat_max || lon_e6 < lon_min || lon_e6 > lon_max ){ return false; }
+		if( tipo == Tipo::CAIXA ){ return true; }
+		return GPSFix::distance_m(lat, lon, lat_e6 * 1e-6, lon_e6 * 1e-6) <= raio_m;
+	}
+
+	/**
+	 * @brief Células de uma grade de lado `passo_e6` micrograus que intersectam a região.
+	 */
+	std::vector<Celula>
+	cells(
+		int32_t passo_e6
+	) const {
+
+		auto indice = [&](int32_t v, int64_t deslocamento){ return static_cast<int32_t>((int64_t(v) + deslocamento) / passo_e6); };
+
+		std::vector<Celula> celulas;
+		for(
+			int32_t i = indice(lat_min, 90000000); i <= indice(lat_max, 90000000); i++
+		){
+
+			int64_t c_lat_min = int64_t(i) * passo_e6 - 90000000, c_lat_max = c_lat_min + passo_e6 - 1;
+			for(
+				int32_t j = indice(lon_min, 180000000); j <= indice(lon_max, 180000000); j++
+			){
+
+				int64_t c_lon_min = int64_t(j) * passo_e6 - 180000000, c_lon_max = c_lon_min + passo_e6 - 1;
+
+				if(
+					tipo == Tipo::CAIXA
+				){
+
+					bool interior = c_lat_min >= lat_min && c_lat_max <= lat_max && c_lon_min >= lon_min && c_lon_max <= lon_max;
+					celulas.push_back({ i, j, interior });
+					continue;
+				}
+
+				// Ponto da célula mais próximo do centro e vértice mais distante
+				double p_lat = std::min(std::max(lat, c_lat_min * 1e-6), c_lat_max * 1e-6);
+				double p_lon = std::min(std::max(lon, c_lon_min * 1e-6), c_lon_max * 1e-6);
+				if( GPSFix::distance_m(lat, lon, p_lat, p_lon) > raio_m ){ continue; }
+
+				double longe = 0;
+				for( int64_t a : { c_lat_min, c_lat_max } ){ for( int64_t b : { c_lon_min, c_lon_max } ){ longe = std::max(longe, GPSFix::distance_m(lat, lon, a * 1e-6, b * 1e-6)); } }
+				celulas.push_back({ i, j, longe <= raio_m });
+			}
+		}
+		return celulas;
+	}
+};
+
+/**
+ * @class SpatioTemporalIndex
+ * @brief Mapa de (célula da grade, janela de tempo) para o Bitmap dos rastreadores presentes.
+ * @details
+ *
+ * - Cada rastreador recebe um identificador denso (0, 1, 2, ...), atribuído na primeira
+ *   ocorrência por uma TrackerTable, que também guarda a última chave indexada: fixes
+ *   seguidos na mesma célula e janela não tocam os bitmaps.
+ * - Os bitmaps ficam em shards com mutex próprio, escolhidos pelo hash da chave.
+ * - Uma consulta une os bitmaps das células e janelas cobertas. O que vem de células e
+ *   janelas interiores é certo; o que vem da borda é verificado no HistoryStore, se
+ *   informado, ou devolvido como candidato.
+ */
+class SpatioTemporalIndex {
+public:
+
+	/**
+	 * @struct Resultado
+	 * @brief Rastreadores (identificadores densos) encontrados por lookup().
+	 */
+	struct Resultado {
+		Bitmap certos; ///< Presentes em célula e janela interiores à consulta.
+		Bitmap limite; ///< Presentes apenas em células ou janelas da borda.
+	};
+
+	/**
+	 * @struct Stats
+	 * @brief Ocupação do índice.
+	 */
+	struct Stats {
+		uint64_t    adicoes;      ///< Fixes que alteraram algum bitmap.
+		uint64_t    repetidos;    ///< Fixes na mesma célula e janela do anterior.
+		uint64_t    chaves;       ///< Pares (célula, janela).
+		uint64_t    bytes;        ///< Memória dos bitmaps.
+		uint32_t    rastreadores;
+	};
+
+private:
+
+	struct Chave {
+		int64_t balde;
+		int32_t lat_i;
+		int32_t lon_i;
+
+		bool operator==(const Chave& o) const { return balde == o.balde && lat_i == o.lat_i && lon_i == o.lon_i; }
+	};
+
+	struct HashChave {
+		std::size_t
+		operator()(
+			const Chave& k
+		) const {
+
+			uint64_t h = uint64_t(k.balde) * 0x9e3779b97f4a7c15ULL ^ (uint64_t(uint32_t(k.lat_i)) << 32 | uint32_t(k.lon_i));
+			h ^= h >> 29; h *= 0xbf58476d1ce4e5b9ULL; h ^= h >> 32;
+			return static_cast<std::size_t>(h);
+		}
+	};
+
+	struct Shard {
+		std::mutex                                  mtx;
+		std::unordered_map<Chave, Bitmap, HashChave> mapa;
+	};
+
+	/// Estado por rastreador na TrackerTable.
+	struct Rastreador {
+		uint32_t id;
+		uint32_t reservado;
+		uint64_t ultima_chave; ///< Última chave indexada, compactada; 0 se nenhuma.
+	};
+
+	static constexpr std::size_t N_SHARDS = 64;
+
+	int32_t                                   passo_e6;
+	int64_t                                   balde_ms;
+	std::size_t                             capacidade;
+
+	TrackerTable<Rastreador>                       ids;
+	std::unique_ptr<std::atomic<uint64_t>[]>  reverso; ///< Identificador denso para rastreador.
+	std::atomic<uint32_t>                proximo_id{0};
+	std::unique_ptr<Shard[]>                    shards;
+
+	std::atomic<int64_t>        balde_min{INT64_MAX};
+	std::atomic<int64_t>        balde_max{INT64_MIN};
+	std::atomic<uint64_t>               n_adicoes{0};
+	std::atomic<uint64_t>             n_repetidos{0};
+
+	static int64_t floor_div(int64_t a, int64_t b){ return a / b - ((a % b != 0) && ((a < 0) != (b < 0))); }
+
+	Chave
+	key_of(
+		const CollectorFix& fix
+	) const {
+
+		return { floor_div(fix.t_ms, balde_ms),
+				 static_cast<int32_t>((int64_t(fix.lat_e6) + 90000000) / passo_e6),
+				 static_cast<int32_t>((int64_t(fix.lon_e6) + 180000000) / passo_e6) };
+	}
+
+	/// Chave em 64 bits para a comparação com a anterior: 24 bits de janela e 20 por eixo.
+	static uint64_t
+	pack(
+		const Chave& k
+	){ return ((uint64_t(k.balde) & 0xFFFFFF) << 40 | (uint64_t(k.lat_i) & 0xFFFFF) << 20 | (uint64_t(k.lon_i) & 0xFFFFF)) + 1; }
+
+	Shard& shard_of(const Chave& k){ return shards[HashChave()(k) % N_SHARDS]; }
+
+	static void
+	update_min(
+		std::atomic<int64_t>& a,
+		int64_t v
+	){ for( int64_t atual = a.load(); v < atual && !a.compare_exchange_weak(atual, v); ){} }
+
+	static void
+	update_max(
+		std::atomic<int64_t>& a,
+		int64_t v
+	){ for( int64_t atual = a.load(); v > atual && !a.compare_exchange_weak(atual, v); ){} }
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param passo_graus Lado da célula da grade, no mínimo 0.001 grau.
+	 * @param balde_ms_ Duração de cada janela de tempo.
+	 * @param capacidade_ Quantidade máxima de rastreadores.
+	 */
+	explicit SpatioTemporalIndex(
+		double passo_graus = 0.01,
+		int64_t balde_ms_ = 3600000,
+		std::size_t capacidade_ = 1 << 16
+	) : passo_e6(std::max(1000, static_cast<int32_t>(std::lround(passo_graus * 1e6)))),
+		balde_ms(std::max<int64_t>(balde_ms_, 1000)),
+		capacidade(capacidade_),
+		ids(capacidade_),
+		reverso(new std::atomic<uint64_t>[capacidade_]()),
+		shards(new Shard[N_SHARDS]) {}
+
+	SpatioTemporalIndex(const SpatioTemporalIndex&)            = delete;
+	SpatioTemporalIndex& operator=(const SpatioTemporalIndex&) = delete;
+
+	/**
+	 * @brief Indexa um fix.
+	 * @return False caso a capacidade de rastreadores tenha se esgotado. True, caso contrário.
+	 */
+	bool
+	add(
+		const CollectorFix& fix
+	){
+
+		Chave    k      = key_of(fix);
+		uint64_t compac = pack(k);
+		uint32_t id     = 0;
+		bool     mudou  = false;
+
+		bool ok = ids.update(
+							 fix.tracker,
+							 [&](Rastreador& r, bool novo){
+
+								 if( novo ){ r.id = proximo_id.fetch_add(1); r.ultima_chave = 0; }
+								 if( r.id < capacidade && novo ){ reverso[r.id].store(fix.tracker, std::memory_order_release); }
+								 id    = r.id;
+								 mudou = (r.ultima_chave != compac);
+								 r.ultima_chave = compac;
+							 }
+							);
+		if( !ok || id >= capacidade ){ return false; }
+		if( !mudou ){ n_repetidos.fetch_add(1, std::memory_order_relaxed); return true; }
+
+		{
+			Shard& s = shard_of(k);
+			std::lock_guard<std::mutex> lock(s.mtx);
+			s.mapa[k].add(id);
+		}
+
+		update_min(balde_min, k.balde);
+		update_max(balde_max, k.balde);
+		n_adicoes.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/**
+	 * @brief Une os bitmaps das células e janelas cobertas pela consulta.
+	 * @param regiao Região da consulta.
+	 * @param t_ini Início do período, em ms desde a época Unix.
+	 * @param t_fim Fim do período, inclusivo.
+	 */
+	Resultado
+	lookup(
+		const IndexRegion& regiao,
+		int64_t t_ini,
+		int64_t t_fim
+	){
+
+		Resultado r;
+
+		int64_t b_ini = std::max(floor_div(t_ini, balde_ms), balde_min.load());
+		int64_t b_fim = std::min(floor_div(t_fim, balde_ms), balde_max.load());
+		if( b_ini > b_fim ){ return r; }
+
+		std::vector<IndexRegion::Celula> celulas = regiao.cells(passo_e6);
+		for(
+			int64_t b = b_ini; b <= b_fim; b++
+		){
+
+			bool tempo_interior = b * balde_ms >= t_ini && (b + 1) * balde_ms - 1 <= t_fim;
+			for(
+				const auto& c : celulas
+			){
+
+				Chave k{ b, c.lat_i, c.lon_i };
+				Shard& s = shard_of(k);
+				std::lock_guard<std::mutex> lock(s.mtx);
+
+				auto it = s.mapa.find(k);
+				if( it == s.mapa.end() ){ continue; }
+				(tempo_interior && c.interior ? r.certos : r.limite) |= it->second;
+			}
+		}
+		return r;
+	}
+
+	/**
+	 * @brief Rastreadores presentes na região durante o período.
+	 * @param historico Histórico para verificar os candidatos da borda. nullptr devolve
+	 * todos os candidatos (superconjunto da resposta exata).
+	 * @return Identificadores de rastreador, ordenados.
+	 */
+	std::vector<uint64_t>
+	query(
+		const IndexRegion& regiao,
+		int64_t t_ini,
+		int64_t t_fim,
+		HistoryStore* historico = nullptr
+	){
+
+		Resultado r = lookup(regiao, t_ini, t_fim);
+
+		std::vector<uint64_t> saida;
+		r.certos.for_each([&](uint32_t id){ saida.push_back(tracker_of(id)); });
+		r.limite.for_each([&](uint32_t id){
+
+			if( r.certos.contains(id) ){ return; }
+
+			uint64_t tracker = tracker_of(id);
+			if( !historico ){ saida.push_back(tracker); return; }
+
+			bool presente = false;
+			for(
+				const auto& b : historico->blocks(tracker)
+			){
+
+				if( presente ){ break; }
+				if( !b->overlaps(t_ini, t_fim) || b->lat_max < regiao.lat_min || b->lat_min > regiao.lat_max ||
+					b->lon_max < regiao.lon_min || b->lon_min > regiao.lon_max ){ continue; }
+
+				b->decode([&](const CollectorFix& fix){
+
+					presente = presente || (fix.t_ms >= t_ini && fix.t_ms <= t_fim && regiao.contains(fix.lat_e6, fix.lon_e6));
+				});
+			}
+			if( presente ){ saida.push_back(tracker); }
+		});
+
+		std::sort(saida.begin(), saida.end());
+		return saida;
+	}
+
+	/**
+	 * @brief Rastreador correspondente a um identificador denso.
+	 */
+	uint64_t tracker_of(uint32_t id) const { return reverso[id].load(std::memory_order_acquire); }
+
+	/**
+	 * @brief Identificador denso de um rastreador.
+	 * @return False caso o rastreador ainda não tenha sido indexado.
+	 */
+	bool
+	id_of(
+		uint64_t tracker,
+		uint32_t& id
+	){
+
+		Rastreador r;
+		if( !ids.read(tracker, r) ){ return false; }
+		id = r.id;
+		return true;
+	}
+
+	int32_t     grid_step_e6() const { return passo_e6; }
+	int64_t     bucket_ms() const { return balde_ms; }
+	std::size_t capacity() const { return capacidade; }
+
+	/**
+	 * @brief Grava o índice no snapshot: identificadores densos, tabela reversa e bitmaps.
+	 * @details
+	 *
+	 * Não pode haver escritores concorrentes. A grade, a janela e a capacidade não são
+	 * gravadas aqui; quem carrega deve verificar que coincidem.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	){
+
+		w.put(proximo_id.load());
+		w.put(balde_min.load());
+		w.put(balde_max.load());
+		w.put(n_adicoes.load());
+		w.put(n_repetidos.load());
+		ids.save(w);
+
+		w.align();
+		w.put_bytes(static_cast<const void*>(reverso.get()), capacidade * sizeof(uint64_t));
+
+		for(
+			std::size_t i = 0; i < N_SHARDS; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			w.put<uint64_t>(shards[i].mapa.size());
+			for(
+				const auto& par : shards[i].mapa
+			){
+
+				w.put(par.first);
+				par.second.save(w);
+			}
+		}
+	}
+
+	/**
+	 * @brief Carrega em um índice vazio, de mesma grade, janela e capacidade, o que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		uint32_t prox = 0;
+		int64_t  b_min = 0, b_max = 0;
+		uint64_t adicoes = 0, repetidos = 0;
+		if( !r.get(prox) || !r.get(b_min) || !r.get(b_max) || !r.get(adicoes) || !r.get(repetidos) ){ return false; }
+		if( !ids.load(r) || !r.align() ){ return false; }
+
+		const void* p = r.view(capacidade * sizeof(uint64_t));
+		if( !p ){ return false; }
+		std::memcpy(static_cast<void*>(reverso.get()), p, capacidade * sizeof(uint64_t));
+
+		for(
+			std::size_t i = 0; i < N_SHARDS; i++
+		){
+
+			uint64_t n = 0;
+			if( !r.get(n) ){ return false; }
+			for(
+				uint64_t j = 0; j < n; j++
+			){
+
+				Chave k;
+				if( !r.get(k) ){ return false; }
+				Shard& s = shard_of(k);
+				std::lock_guard<std::mutex> lock(s.mtx);
+				if( !s.mapa[k].load(r) ){ return false; }
+			}
+		}
+
+		proximo_id.store(prox);
+		balde_min.store(b_min);
+		balde_max.store(b_max);
+		n_adicoes.store(adicoes);
+		n_repetidos.store(repetidos);
+		return true;
+	}
+
+	/**
+	 * @brief Obtém a ocupação do índice.
+	 */
+	Stats
+	stats(){
+
+		Stats s{};
+		s.adicoes      = n_adicoes.load(std::memory_order_relaxed);
+		s.repetidos    = n_repetidos.load(std::memory_order_relaxed);
+		s.rastreadores = std::min<uint32_t>(proximo_id.load(), static_cast<uint32_t>(capacidade));
+		for(
+			std::size_t i = 0; i < N_SHARDS; i++
+		){
+
+			std::lock_guard<std::mutex> lock(shards[i].mtx);
+			s.chaves += shards[i].mapa.size();
+			for( const auto& par : shards[i].mapa ){ s.bytes += par.second.bytes(); }
+		}
+		return s;
+	}
+};
+
+#endif // SPATIOTEMPORALINDEX_HPP
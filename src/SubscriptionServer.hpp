@@ -0,0 +1,698 @@
+/**
+ * @file SubscriptionServer.hpp
+ * @brief Assinaturas ao vivo dos fixes recebidos pelo coletor, por TCP local.
+ * @details
+ * Os datagramas de GPSTrack chegam a uma única porta do coletor; painéis que queiram
+ * acompanhar a frota ao vivo conectam-se a este servidor, informam quais rastreadores ou
+ * regiões desejam e recebem os fixes correspondentes como linhas CSV.
+ */
+#ifndef SUBSCRIPTIONSERVER_HPP
+#define SUBSCRIPTIONSERVER_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Específicos de Sistemas Linux
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "CollectorFix.hpp"
+#include "MpscRing.hpp"
+#include "RCU.hpp"
+
+/// Fila de fixes de um cliente: as threads de recepção produzem, a do servidor consome.
+using FixRing = MpscRing<CollectorFix>;
+
+/**
+ * @class SubscriptionServer
+ * @brief Servidor TCP de assinaturas com uma fila limitada por cliente.
+ * @details
+ *
+ * Protocolo, em linhas de texto:
+ * - O cliente envia filtros, que se acumulam: `todos`, `rastreador id...`,
+ *   `caixa lat_min lon_min lat_max lon_max` ou `limpar`. Filtros inválidos são
+ *   respondidos com `#erro,<linha>`.
+ * - O servidor envia `rastreador,t_ms,lat,lon,alt` para cada fix que satisfaz algum filtro
+ *   e, quando houver perdas, `#descartados,<total>`.
+ * - Com uma função registrada em on_query(), `consulta <argumentos>` é respondida apenas
+ *   ao cliente que a enviou, sem alterar seus filtros. A função roda na thread do servidor:
+ *   enquanto responde, as filas dos clientes não são esvaziadas.
+ *
+ * publish() é chamado pelas threads de recepção e nunca bloqueia: consulta uma tabela de
+ * assinaturas imutável, publicada por RCUPtr (indexada por rastreador e por células de
+ * 0,1 grau), e insere o fix na FixRing de cada cliente; com a fila cheia, o fix é
+ * descartado para aquele cliente. Uma única thread aceita conexões, lê filtros e esvazia
+ * as filas em sockets não bloqueantes; clientes cujo socket permanece cheio por mais de
+ * `tempo_max_ms` são desconectados. Assim, um cliente lento nunca atrasa a recepção.
+ *
+ * Sem tráfego a thread fica parada no epoll_wait: publish() a acorda por um eventfd, escrito
+ * apenas quando não há despertar pendente, e EPOLLOUT é pedido só para clientes com o
+ * socket cheio.
+ */
+class SubscriptionServer {
+public:
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores do servidor.
+	 */
+	struct Stats {
+		std::size_t clientes;
+		uint64_t    entregues;     ///< Fixes inseridos nas filas.
+		uint64_t    descartados;   ///< Fixes perdidos por filas cheias.
+		uint64_t    desconectados; ///< Clientes desconectados por lentidão.
+	};
+
+	/// Resposta a `consulta <argumentos>`, terminada em quebra de linha; vazia para argumentos inválidos.
+	using Consulta = std::function<std::string(const std::string& argumentos)>;
+
+private:
+
+	static constexpr double      PASSO_CELULA = 0.1;
+	static constexpr std::size_t MAX_CELULAS  = 256;    ///< Caixas maiores são testadas a cada fix.
+	static constexpr std::size_t MAX_ENTRADA  = 4096;   ///< Comprimento máximo de um filtro.
+	static constexpr std::size_t MAX_SAIDA    = 1 << 16;
+
+	struct Caixa {
+		int32_t lat_min, lon_min, lat_max, lon_max;
+
+		bool
+		contains(
+			const CollectorFix& fix
+		) const { return fix.lat_e6 >= lat_min && fix.lat_e6 <= lat_max && fix.lon_e6 >= lon_min && fix.lon_e6 <= lon_max; }
+	};
+
+	struct Cliente {
+		int                       fd;
+		FixRing                 fila;
+		std::atomic<uint64_t> descartados{0};
+
+		// Apenas a thread do servidor
+		bool                    todos = false;
+		std::vector<uint64_t>   rastreadores;
+		std::vector<Caixa>      caixas;
+		std::string             entrada;
+		std::string             saida;
+		std::size_t             enviado = 0;
+		uint64_t                informados = 0;
+		int64_t                 cheio_desde_ms = 0;
+		bool                    pronto = false;       ///< Recebeu eventos nesta iteração.
+		bool                    aguarda_saida = false; ///< Registrado com EPOLLOUT.
+
+		Cliente(int fd_, std::size_t capacidade) : fd(fd_), fila(capacidade) {}
+	};
+
+	struct EntradaCaixa {
+		Cliente* cliente;
+		Caixa    caixa;
+	};
+
+	/// Tabela de assinaturas, imutável; mantém os clientes vivos enquanto houver leitores.
+	struct Tabela {
+		std::vector<std::shared_ptr<Cliente>>                        vivos;
+		std::vector<Cliente*>                                         todos;
+		std::unordered_map<uint64_t, std::vector<Cliente*>>  por_rastreador;
+		std::unordered_map<uint64_t, std::vector<EntradaCaixa>> por_celula;
+		std::vector<EntradaCaixa>                                  grandes;
+		bool                                                         vazia = true;
+	};
+
+	int                          fd_escuta = -1;
+	int                           fd_epoll = -1;
+	int                          fd_acorda = -1;
+	int                              porta;
+	std::size_t            capacidade_fila;
+	int64_t                   tempo_max_ms;
+	RCUPtr<Tabela>                  tabela;
+	std::unordered_map<int, std::shared_ptr<Cliente>> clientes; ///< Apenas a thread do servidor.
+	bool                          alterada = false;
+	Consulta                          consulta;
+
+	std::thread                     worker;
+	std::atomic<bool>       is_exec{false};
+	std::atomic<bool>    sinalizado{false}; ///< Há um despertar pendente no eventfd.
+
+	std::atomic<std::size_t>    n_clientes{0};
+	std::atomic<uint64_t>        n_entregues{0};
+	std::atomic<uint64_t>      n_descartados{0};
+	std::atomic<uint64_t>    n_desconectados{0};
+
+	static int64_t
+	now_ms(){
+
+		using namespace std::chrono;
+		return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	static uint64_t
+	cell_of(
+		int32_t lat_e6,
+		int32_t lon_e6
+	){
+
+		int64_t y = static_cast<int64_t>(std::floor(lat_e6 * 1e-6 / PASSO_CELULA));
+		int64_t x = static_cast<int64_t>(std::floor(lon_e6 * 1e-6 / PASSO_CELULA));
+		return (static_cast<uint64_t>(y + 1000) << 32) | static_cast<uint64_t>(x + 2000);
+	}
+
+	/**
+	 * @brief Reconstrói e publica a tabela a partir dos filtros dos clientes.
+	 */
+	void
+	rebuild(){
+
+		auto nova = std::make_unique<Tabela>();
+		for(
+			auto& par : clientes
+		){
+
+			Cliente* c = par.second.get();
+			nova->vivos.push_back(par.second);
+			if( c->todos ){ nova->todos.push_back(c); continue; }
+
+			for( uint64_t r : c->rastreadores ){ nova->por_rastreador[r].push_back(c); }
+			for(
+				const Caixa& cx : c->caixas
+			){
+
+				uint64_t a = cell_of(cx.lat_min, cx.lon_min), b = cell_of(cx.lat_max, cx.lon_max);
+				uint64_t y0 = a >> 32, y1 = b >> 32, x0 = a & 0xffffffff, x1 = b & 0xffffffff;
+				if( (y1 - y0 + 1) * (x1 - x0 + 1) > MAX_CELULAS ){ nova->grandes.push_back({ c, cx }); continue; }
+
+				for( uint64_t y = y0; y <= y1; y++ ){ for( uint64_t x = x0; x <= x1; x++ ){ nova->por_celula[(y << 32) | x].push_back({ c, cx }); } }
+			}
+		}
+		nova->vazia = nova->todos.empty() && nova->por_rastreador.empty() && nova->por_celula.empty() && nova->grandes.empty();
+		tabela.publish(std::move(nova));
+		alterada = false;
+	}
+
+	/**
+	 * @brief Aplica uma linha de filtro de um cliente, ou responde a uma consulta.
+	 * @return False caso a linha seja inválida.
+	 */
+	bool
+	apply_filter(
+		Cliente& c,
+		const std::string& linha
+	){
+
+		std::istringstream in(linha);
+		std::string comando;
+		if( !(in >> comando) ){ return true; }
+
+		if( comando == "todos" ){ c.todos = true; }
+		else if( comando == "limpar" ){ c.todos = false; c.rastreadores.clear(); c.caixas.clear(); }
+		else if(
+			comando == "rastreador"
+		){
+
+			// Uma linha inválida não altera o filtro do cliente
+			uint64_t id;
+			std::vector<uint64_t> ids;
+			while( in >> id ){ ids.push_back(id); }
+			if( ids.empty() || !in.eof() ){ return false; }
+			c.rastreadores.insert(c.rastreadores.end(), ids.begin(), ids.end());
+			std::sort(c.rastreadores.begin(), c.rastreadores.end());
+			c.rastreadores.erase(std::unique(c.rastreadores.begin(), c.rastreadores.end()), c.rastreadores.end());
+		}
+		else if(
+			comando == "caixa"
+		){
+
+			double v[4];
+			for( double& x : v ){ if( !(in >> x) ){ return false; } }
+			if( v[0] > v[2] || v[1] > v[3] || v[0] < -90 || v[2] > 90 || v[1] < -180 || v[3] > 180 ){ return false; }
+			c.caixas.push_back({
+				static_cast<int32_t>(std::llround(v[0] * 1e6)), static_cast<int32_t>(std::llround(v[1] * 1e6)),
+				static_cast<int32_t>(std::llround(v[2] * 1e6)), static_cast<int32_t>(std::llround(v[3] * 1e6))
+			});
+		}
+		else if(
+			comando == "consulta" && consulta
+		){
+
+			std::string argumentos;
+			std::getline(in, argumentos);
+			std::string resposta = consulta(argumentos);
+			if( resposta.empty() ){ return false; }
+			c.saida += resposta;
+			return true;
+		}
+		else{ return false; }
+
+		alterada = true;
+		return true;
+	}
+
+	void
+	disconnect(
+		int fd
+	){
+
+		::epoll_ctl(fd_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		::close(fd);
+		clientes.erase(fd);
+		n_clientes.store(clientes.size(), std::memory_order_relaxed);
+		alterada = true;
+	}
+
+	void
+	accept_all(){
+
+		while(
+			true
+		){
+
+			int fd = ::accept4(fd_escuta, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if( fd < 0 ){ return; }
+
+			// Buffer do kernel limitado: um cliente lento é percebido cedo e não acumula megabytes
+			int um = 1, buffer = 256 << 10;
+			::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+			::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+			epoll_event ev{};
+			ev.events  = EPOLLIN | EPOLLRDHUP;
+			ev.data.fd = fd;
+			::epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev);
+
+			clientes[fd] = std::make_shared<Cliente>(fd, capacidade_fila);
+			n_clientes.store(clientes.size(), std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Lê os filtros enviados por um cliente.
+	 * @return False caso o cliente tenha encerrado a conexão ou excedido os limites.
+	 */
+	bool
+	read_client(
+		Cliente& c
+	){
+
+		char buffer[4096];
+		while(
+			true
+		){
+
+			ssize_t n = ::recv(c.fd, buffer, sizeof(buffer), 0);
+			if( n == 0 ){ return false; }
+			if( n < 0 ){ return errno == EAGAIN || errno == EWOULDBLOCK; }
+
+			c.entrada.append(buffer, n);
+			std::size_t ini = 0;
+			for(
+				std::size_t fim = c.entrada.find('\n'); fim != std::string::npos; fim = c.entrada.find('\n', ini)
+			){
+
+				std::string linha = c.entrada.substr(ini, fim - ini);
+				if( !linha.empty() && linha.back() == '\r' ){ linha.pop_back(); }
+				if( !apply_filter(c, linha) ){ c.saida += "#erro," + linha + "\n"; }
+				ini = fim + 1;
+			}
+			c.entrada.erase(0, ini);
+			if( c.entrada.size() > MAX_ENTRADA ){ return false; }
+		}
+	}
+
+	/**
+	 * @brief Esvazia a fila de um cliente no socket.
+	 * @return False caso o cliente deva ser desconectado.
+	 */
+	bool
+	flush_client(
+		Cliente& c,
+		int64_t agora
+	){
+
+		uint64_t perdidos = c.descartados.load(std::memory_order_relaxed);
+		if(
+			perdidos != c.informados
+		){
+
+			c.saida     += "#descartados," + std::to_string(perdidos) + "\n";
+			c.informados = perdidos;
+		}
+
+		// Formata em blocos de até MAX_SAIDA e envia, até esvaziar a fila ou encher o socket
+		CollectorFix fix;
+		char         linha[96];
+		bool         vazia = false;
+		while(
+			true
+		){
+
+			while(
+				c.saida.size() - c.enviado < MAX_SAIDA && !(vazia = !c.fila.pop(fix))
+			){
+
+				int n = std::snprintf(linha, sizeof(linha), "%llu,%lld,%.6f,%.6f,%.1f\n", static_cast<unsigned long long>(fix.tracker),
+									  static_cast<long long>(fix.t_ms), fix.lat(), fix.lon(), fix.alt());
+				c.saida.append(linha, n);
+			}
+
+			while(
+				c.enviado < c.saida.size()
+			){
+
+				ssize_t n = ::send(c.fd, c.saida.data() + c.enviado, c.saida.size() - c.enviado, MSG_NOSIGNAL);
+				if( n > 0 ){ c.enviado += n; continue; }
+				if( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK ){ return false; }
+				break;
+			}
+
+			if( c.enviado < c.saida.size() ){ break; }
+			c.saida.clear();
+			c.enviado        = 0;
+			c.cheio_desde_ms = 0;
+			if( vazia ){ return true; }
+		}
+		if( c.enviado > MAX_SAIDA ){ c.saida.erase(0, c.enviado); c.enviado = 0; }
+
+		// Socket cheio: desconecta se persistir
+		if( c.cheio_desde_ms == 0 ){ c.cheio_desde_ms = agora; }
+		if( agora - c.cheio_desde_ms > tempo_max_ms ){ n_desconectados.fetch_add(1, std::memory_order_relaxed); return false; }
+		return true;
+	}
+
+	/**
+	 * @brief Acorda a thread do servidor, caso não haja despertar pendente.
+	 */
+	void
+	wake(){
+
+		if(
+			!sinalizado.load(std::memory_order_relaxed) && !sinalizado.exchange(true)
+		){
+
+			uint64_t um = 1;
+			(void)!::write(fd_acorda, &um, sizeof(um));
+		}
+	}
+
+	/**
+	 * @brief Pede EPOLLOUT apenas enquanto o socket do cliente estiver cheio.
+	 */
+	void
+	watch_output(
+		Cliente& c
+	){
+
+		bool cheio = c.cheio_desde_ms != 0;
+		if( cheio == c.aguarda_saida ){ return; }
+
+		epoll_event ev{};
+		ev.events  = EPOLLIN | EPOLLRDHUP;
+		if( cheio ){ ev.events |= EPOLLOUT; }
+		ev.data.fd = c.fd;
+		::epoll_ctl(fd_epoll, EPOLL_CTL_MOD, c.fd, &ev);
+		c.aguarda_saida = cheio;
+	}
+
+	/**
+	 * @brief Esvazia as filas dos clientes e desconecta os que falharem.
+	 * @param todos Todos os clientes; caso contrário, apenas os com eventos ou com o socket cheio.
+	 * @return Espera máxima do epoll_wait até o prazo do primeiro socket cheio; -1 se não houver.
+	 */
+	int
+	flush_all(
+		bool todos,
+		std::vector<int>& remover
+	){
+
+		int64_t agora  = now_ms();
+		int     espera = -1;
+		for(
+			auto& par : clientes
+		){
+
+			Cliente& c = *par.second;
+			if( !todos && !c.pronto && c.cheio_desde_ms == 0 ){ continue; }
+
+			c.pronto = false;
+			if( !flush_client(c, agora) ){ remover.push_back(par.first); continue; }
+			watch_output(c);
+			if(
+				c.cheio_desde_ms != 0
+			){
+
+				int64_t restante = std::max<int64_t>(0, c.cheio_desde_ms + tempo_max_ms - agora) + 1;
+				if( espera < 0 || restante < espera ){ espera = static_cast<int>(std::min<int64_t>(restante, 1 << 30)); }
+			}
+		}
+		for( int fd : remover ){ disconnect(fd); }
+		remover.clear();
+		return espera;
+	}
+
+	void
+	loop(){
+
+		epoll_event eventos[256];
+		std::vector<int> remover;
+		int espera = -1;
+		while(
+			is_exec
+		){
+
+			int  n     = ::epoll_wait(fd_epoll, eventos, 256, espera);
+			bool todos = false;
+			for(
+				int i = 0; i < n; i++
+			){
+
+				int fd = eventos[i].data.fd;
+				if( fd == fd_escuta ){ accept_all(); continue; }
+				if(
+					fd == fd_acorda
+				){
+
+					uint64_t v;
+					(void)!::read(fd_acorda, &v, sizeof(v));
+					todos = true;
+					continue;
+				}
+
+				auto it = clientes.find(fd);
+				if( it == clientes.end() ){ continue; }
+				if( !read_client(*it->second) ){ disconnect(fd); continue; }
+				it->second->pronto = true;
+			}
+			if( alterada ){ rebuild(); }
+
+			// O sinal permanece ativo durante a primeira passada, poupando escritas no eventfd;
+			// depois de zerado, a segunda passada cobre os fixes inseridos por quem ainda o viu ativo
+			espera = flush_all(todos, remover);
+			if(
+				todos
+			){
+
+				sinalizado.store(false);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				espera = flush_all(true, remover);
+			}
+			if( alterada ){ rebuild(); }
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param porta_ Porta TCP; 0 escolhe uma porta livre (ver port()).
+	 * @param capacidade_fila_ Fixes pendentes por cliente antes do descarte.
+	 * @param tempo_max_ms_ Tempo com o socket cheio antes da desconexão.
+	 * @param endereco Endereço de escuta; por padrão, apenas conexões locais.
+	 */
+	explicit SubscriptionServer(
+		int porta_,
+		std::size_t capacidade_fila_ = 4096,
+		int64_t tempo_max_ms_ = 10000,
+		const std::string& endereco = "127.0.0.1"
+	) : porta(porta_),
+		capacidade_fila(capacidade_fila_),
+		tempo_max_ms(tempo_max_ms_),
+		tabela(std::make_unique<const Tabela>())
+	{
+
+		fd_escuta = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if( fd_escuta < 0 ){ throw std::runtime_error("\033[1;31mErro ao criar socket de assinaturas\033[0m"); }
+
+		int um = 1;
+		::setsockopt(fd_escuta, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_port   = ::htons(porta);
+		if(
+			::inet_pton(AF_INET, endereco.c_str(), &addr.sin_addr) != 1 ||
+			::bind(fd_escuta, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+			::listen(fd_escuta, 1024) != 0
+		){
+
+			::close(fd_escuta);
+			throw std::runtime_error("\033[1;31mErro ao escutar assinaturas em " + endereco + ":" + std::to_string(porta) + "\033[0m");
+		}
+
+		socklen_t tam = sizeof(addr);
+		::getsockname(fd_escuta, reinterpret_cast<sockaddr*>(&addr), &tam);
+		porta = ::ntohs(addr.sin_port);
+
+		fd_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if( fd_epoll < 0 ){ ::close(fd_escuta); throw std::runtime_error("\033[1;31mErro ao criar epoll de assinaturas\033[0m"); }
+
+		fd_acorda = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if( fd_acorda < 0 ){ ::close(fd_epoll); ::close(fd_escuta); throw std::runtime_error("\033[1;31mErro ao criar eventfd de assinaturas\033[0m"); }
+
+		for(
+			int fd : {fd_escuta, fd_acorda}
+		){
+
+			epoll_event ev{};
+			ev.events  = EPOLLIN;
+			ev.data.fd = fd;
+			::epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev);
+		}
+	}
+
+	SubscriptionServer(const SubscriptionServer&)            = delete;
+	SubscriptionServer& operator=(const SubscriptionServer&) = delete;
+
+	~SubscriptionServer(){
+
+		stop();
+		for( auto& par : clientes ){ ::close(par.first); }
+		::close(fd_acorda);
+		::close(fd_epoll);
+		::close(fd_escuta);
+	}
+
+	/**
+	 * @brief Entrega um fix às filas dos clientes interessados. Nunca bloqueia.
+	 */
+	void
+	publish(
+		const CollectorFix& fix
+	){
+
+		auto t = tabela.read();
+		if( t->vazia ){ return; }
+
+		// Um cliente com vários filtros recebe o fix uma vez; a verificação de repetidos
+		// cobre os primeiros destinos, que em geral são todos
+		Cliente*    destinos[64];
+		std::size_t n = 0;
+		uint64_t    entregues = 0, perdidos = 0;
+		auto entregar = [&](Cliente* c){
+
+			if( c->fila.push(fix) ){ entregues++; return; }
+			c->descartados.fetch_add(1, std::memory_order_relaxed);
+			perdidos++;
+		};
+		auto incluir = [&](Cliente* c){
+
+			for( std::size_t i = 0; i < n; i++ ){ if( destinos[i] == c ){ return; } }
+			if( n < 64 ){ destinos[n++] = c; }
+			entregar(c);
+		};
+
+		for( Cliente* c : t->todos ){ incluir(c); }
+
+		auto r = t->por_rastreador.find(fix.tracker);
+		if( r != t->por_rastreador.end() ){ for( Cliente* c : r->second ){ incluir(c); } }
+
+		if(
+			!t->por_celula.empty()
+		){
+
+			auto cel = t->por_celula.find(cell_of(fix.lat_e6, fix.lon_e6));
+			if( cel != t->por_celula.end() ){ for( const EntradaCaixa& e : cel->second ){ if( e.caixa.contains(fix) ){ incluir(e.cliente); } } }
+		}
+		for( const EntradaCaixa& e : t->grandes ){ if( e.caixa.contains(fix) ){ incluir(e.cliente); } }
+
+		if( entregues ){ n_entregues.fetch_add(entregues, std::memory_order_relaxed); }
+		if( perdidos ){ n_descartados.fetch_add(perdidos, std::memory_order_relaxed); }
+		if(
+			n > 0
+		){
+
+			// Pareia com a barreira do loop(): ou o sinal é visto zerado, ou o fix já está na fila
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			wake();
+		}
+	}
+
+	/**
+	 * @brief Registra a função que responde a `consulta`. Deve ser chamado antes de init().
+	 */
+	void on_query(Consulta consulta_){ consulta = std::move(consulta_); }
+
+	/**
+	 * @brief Inicia a thread do servidor.
+	 */
+	void
+	init(){
+
+		if( is_exec.exchange(true) ){ return; }
+
+		std::cout << "\033[1;32mIniciando Servidor de Assinaturas na porta " << porta << "...\033[0m" << std::endl;
+		worker = std::thread(
+							 [this]{ loop(); }
+							);
+	}
+
+	/**
+	 * @brief Encerra a thread do servidor. As conexões permanecem abertas até a destruição.
+	 */
+	void
+	stop(){
+
+		if( !is_exec.exchange(false) ){ return; }
+
+		std::cout << "\033[1;32mSaindo da thread de assinaturas.\033[0m" << std::endl;
+		uint64_t um = 1;
+		(void)!::write(fd_acorda, &um, sizeof(um));
+		if( worker.joinable() ){ worker.join(); }
+	}
+
+	int port() const { return porta; }
+
+	/**
+	 * @brief Obtém os contadores do servidor.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.clientes      = n_clientes.load(std::memory_order_relaxed);
+		s.entregues     = n_entregues.load(std::memory_order_relaxed);
+		s.descartados   = n_descartados.load(std::memory_order_relaxed);
+		s.desconectados = n_desconectados.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // SUBSCRIPTIONSERVER_HPP
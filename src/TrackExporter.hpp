@@ -0,0 +1,780 @@
+/**
+ * @file TrackExporter.hpp
+ * @brief Exportação de trajetórias do histórico em GPX, KML e formato colunar.
+ * @details
+ * Investigações pedem a trajetória de rastreadores em arquivos abertos por ferramentas GIS.
+ * Os exportadores leem os blocos comprimidos do HistoryStore diretamente, sem passar por
+ * texto CSV, e escrevem o arquivo em fluxo por um buffer de tamanho fixo: a memória usada
+ * não depende do tamanho da trajetória, e rastreadores distintos são exportados em paralelo.
+ */
+#ifndef TRACKEXPORTER_HPP
+#define TRACKEXPORTER_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Específicos de Sistemas Linux
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CollectorFix.hpp"
+#include "HistoryStore.hpp"
+
+/**
+ * @class ExportBuffer
+ * @brief Escrita sequencial de um arquivo por um buffer fixo, com formatação de números sem printf.
+ * @details
+ *
+ * O arquivo é escrito em `caminho.tmp` e renomeado em close(), de modo que uma exportação
+ * interrompida nunca deixa um arquivo truncado com o nome final. Um erro de escrita é
+ * guardado e reportado por close().
+ */
+class ExportBuffer {
+public:
+
+	static constexpr std::size_t TAM = 1 << 16;
+
+private:
+
+	std::unique_ptr<char[]> dados;
+	std::size_t               n = 0;
+	int                      fd = -1;
+	bool                     ok = true;
+	uint64_t           gravados = 0;
+	std::string         caminho;
+
+	int64_t               dia = INT64_MIN; ///< Dia de `data`, em dias desde a época.
+	char             data[32];            ///< "AAAA-MM-DDT" de `dia`.
+	int                n_data = 0;
+
+	void
+	write_all(
+		const char* p,
+		std::size_t k
+	){
+
+		while(
+			ok && k > 0
+		){
+
+			ssize_t r = ::write(fd, p, k);
+			if( r < 0 && errno == EINTR ){ continue; }
+			if( r <= 0 ){ ok = false; break; }
+			p += r; k -= static_cast<std::size_t>(r);
+		}
+	}
+
+public:
+
+	ExportBuffer() : dados(new char[TAM]) {}
+
+	ExportBuffer(const ExportBuffer&)            = delete;
+	ExportBuffer& operator=(const ExportBuffer&) = delete;
+
+	~ExportBuffer(){ if( fd >= 0 ){ ::close(fd); ::unlink((caminho + ".tmp").c_str()); } }
+
+	/**
+	 * @brief Inicia a escrita de `caminho_`.
+	 * @return False caso o arquivo temporário não possa ser criado.
+	 */
+	bool
+	open(
+		const std::string& caminho_
+	){
+
+		caminho  = caminho_;
+		n        = 0;
+		gravados = 0;
+		fd       = ::open((caminho + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		ok       = fd >= 0;
+		return ok;
+	}
+
+	/**
+	 * @brief Grava o restante do buffer e renomeia o arquivo.
+	 * @return False caso alguma escrita tenha falhado; nesse caso o temporário é removido.
+	 */
+	bool
+	close(){
+
+		if( fd < 0 ){ return false; }
+		flush();
+		ok = (::close(fd) == 0) && ok;
+		fd = -1;
+		ok = ok && ::rename((caminho + ".tmp").c_str(), caminho.c_str()) == 0;
+		if( !ok ){ ::unlink((caminho + ".tmp").c_str()); }
+		return ok;
+	}
+
+	void
+	flush(){
+
+		write_all(dados.get(), n);
+		gravados += n;
+		n = 0;
+	}
+
+	/**
+	 * @brief Posição atual no arquivo, contando o que ainda está no buffer.
+	 */
+	uint64_t offset() const { return gravados + n; }
+
+	void
+	put(
+		const char* p,
+		std::size_t k
+	){
+
+		if( n + k > TAM ){ flush(); }
+		if( k > TAM ){ write_all(p, k); gravados += k; return; }
+		std::memcpy(dados.get() + n, p, k);
+		n += k;
+	}
+
+	void put(std::string_view s){ put(s.data(), s.size()); }
+
+	/**
+	 * @brief Acrescenta um valor trivialmente copiável, na ordem de bytes da máquina.
+	 */
+	template <typename T>
+	void put_raw(const T& v){ put(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+	/**
+	 * @brief Acrescenta `v / 10^casas` em decimal, com exatamente `casas` casas.
+	 * @details
+	 *
+	 * As coordenadas já estão em ponto fixo (micrograus, decímetros), de modo que a
+	 * conversão é apenas a escrita dos dígitos, sem ponto flutuante.
+	 */
+	void
+	put_fixed(
+		int64_t v,
+		int casas
+	){
+
+		char     b[24];
+		char*    q = b + sizeof(b);
+		uint64_t u = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+		for( int i = 0; i < casas; i++ ){ *--q = static_cast<char>('0' + u % 10); u /= 10; }
+		if( casas > 0 ){ *--q = '.'; }
+		do{ *--q = static_cast<char>('0' + u % 10); u /= 10; } while( u > 0 );
+		if( v < 0 ){ *--q = '-'; }
+		put(q, static_cast<std::size_t>(b + sizeof(b) - q));
+	}
+
+	/**
+	 * @brief Acrescenta o instante `t_ms` em ISO 8601 UTC, `AAAA-MM-DDThh:mm:ss.mmmZ`.
+	 * @details
+	 *
+	 * A data só é recalculada quando o dia muda, o que numa trajetória ordenada é raro.
+	 */
+	void
+	put_time(
+		int64_t t_ms
+	){
+
+		const int64_t DIA = 86400000;
+		int64_t d  = t_ms / DIA - (t_ms % DIA < 0);
+		int64_t ms = t_ms - d * DIA;
+
+		if(
+			d != dia
+		){
+
+			// Conversão de dias para data civil (algoritmo de H. Hinnant)
+			int64_t  z   = d + 719468;
+			int64_t  era = (z >= 0 ? z : z - 146096) / 146097;
+			uint64_t doe = static_cast<uint64_t>(z - era * 146097);
+			uint64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+			uint64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+			uint64_t mp  = (5 * doy + 2) / 153;
+			unsigned dd  = static_cast<unsigned>(doy - (153 * mp + 2) / 5 + 1);
+			unsigned mm  = static_cast<unsigned>(mp < 10 ? mp + 3 : mp - 9);
+			long long aa = static_cast<long long>(yoe) + era * 400 + (mm <= 2);
+
+			n_data = std::snprintf(data, sizeof(data), "%04lld-%02u-%02uT", aa, mm, dd);
+			dia    = d;
+		}
+		put(data, static_cast<std::size_t>(n_data));
+
+		unsigned h = static_cast<unsigned>(ms / 3600000), m = static_cast<unsigned>(ms / 60000 % 60);
+		unsigned s = static_cast<unsigned>(ms / 1000 % 60), f = static_cast<unsigned>(ms % 1000);
+		char b[13] = {
+			static_cast<char>('0' + h / 10), static_cast<char>('0' + h % 10), ':',
+			static_cast<char>('0' + m / 10), static_cast<char>('0' + m % 10), ':',
+			static_cast<char>('0' + s / 10), static_cast<char>('0' + s % 10), '.',
+			static_cast<char>('0' + f / 100), static_cast<char>('0' + f / 10 % 10), static_cast<char>('0' + f % 10), 'Z'
+		};
+		put(b, sizeof(b));
+	}
+};
+
+/**
+ * @struct ColumnarTrackFile
+ * @brief Formato colunar de trajetórias, no espírito do Parquet, e sua leitura.
+ * @details
+ *
+ * | Trecho | Conteúdo |
+ * |--------|----------|
+ * | início | mágica "GTC1" |
+ * | grupos | grupos de até LINHAS_POR_GRUPO linhas, cada um com as colunas t, lat, lon e alt em sequência |
+ * | rodapé | rastreador (u64), quantidade de grupos (u32) e, por grupo, linhas (u32) e, por coluna, posição (u64), bytes (u32), mínimo e máximo (i64) |
+ * | final  | tamanho do rodapé (u32) e mágica "GTC1" |
+ *
+ * As colunas são varints zigzag alinhadas a bytes: o instante em delta-de-delta, como em
+ * FixBlock, e as demais em delta do valor anterior, reiniciados em cada grupo, de modo
+ * que um grupo ou uma coluna é lida sem as demais. Mínimos e máximos permitem descartar
+ * grupos fora de uma consulta. Valores na ordem de bytes da máquina.
+ */
+struct ColumnarTrackFile {
+	static constexpr uint32_t    MAGICA           = 0x31435447; // "GTC1"
+	static constexpr uint32_t    LINHAS_POR_GRUPO = 1 << 16;
+	static constexpr std::size_t N_COLUNAS        = 4;
+
+	struct Coluna {
+		uint64_t posicao = 0;
+		uint32_t bytes   = 0;
+		int64_t  min     = INT64_MAX;
+		int64_t  max     = INT64_MIN;
+	};
+
+	struct Grupo {
+		uint32_t linhas = 0;
+		Coluna   colunas[N_COLUNAS];
+	};
+
+	static uint64_t zigzag(int64_t v){ return FixBlock::zigzag(v); }
+	static int64_t  unzigzag(uint64_t z){ return FixBlock::unzigzag(z); }
+
+	/**
+	 * @brief Lê um arquivo colunar, um grupo de cada vez.
+	 * @param caminho Arquivo gravado por TrackExporter.
+	 * @param[out] tracker Rastreador do arquivo.
+	 * @param visitar Função `void(const CollectorFix&)`.
+	 * @return False caso o arquivo não exista, esteja truncado ou inconsistente.
+	 */
+	template <typename F>
+	static bool
+	read(
+		const std::string& caminho,
+		uint64_t& tracker,
+		F&& visitar
+	){
+
+		int fd = ::open(caminho.c_str(), O_RDONLY | O_CLOEXEC);
+		if( fd < 0 ){ return false; }
+
+		auto ler = [&](void* p, std::size_t k, uint64_t posicao){ return ::pread(fd, p, k, static_cast<off_t>(posicao)) == static_cast<ssize_t>(k); };
+
+		struct stat st{};
+		uint32_t    final[2] = { 0, 0 };
+		bool ok = ::fstat(fd, &st) == 0 && st.st_size >= 12 && ler(final, sizeof(final), static_cast<uint64_t>(st.st_size) - 8) &&
+				  final[1] == MAGICA && uint64_t(final[0]) + 12 <= static_cast<uint64_t>(st.st_size);
+
+		std::vector<uint8_t> rodape(ok ? final[0] : 0);
+		ok = ok && ler(rodape.data(), rodape.size(), static_cast<uint64_t>(st.st_size) - 8 - final[0]);
+
+		// Rodapé
+		std::size_t p = 0;
+		auto get = [&](auto& v){
+
+			if( p + sizeof(v) > rodape.size() ){ ok = false; return; }
+			std::memcpy(&v, rodape.data() + p, sizeof(v));
+			p += sizeof(v);
+		};
+
+		uint32_t n_grupos = 0;
+		if( ok ){ get(tracker); get(n_grupos); }
+
+		std::vector<uint8_t> coluna;
+		std::vector<int64_t> valores[N_COLUNAS];
+		for(
+			uint32_t g = 0; ok && g < n_grupos; g++
+		){
+
+			Grupo grupo;
+			get(grupo.linhas);
+			for( Coluna& c : grupo.colunas ){ get(c.posicao); get(c.bytes); get(c.min); get(c.max); }
+
+			// Valores do rodapé são conferidos antes de dimensionar qualquer buffer
+			const uint64_t tamanho = static_cast<uint64_t>(st.st_size);
+			ok = ok && grupo.linhas <= LINHAS_POR_GRUPO;
+			for( const Coluna& c : grupo.colunas ){ ok = ok && c.posicao <= tamanho && c.bytes <= tamanho - c.posicao; }
+
+			for(
+				std::size_t c = 0; ok && c < N_COLUNAS; c++
+			){
+
+				const Coluna& col = grupo.colunas[c];
+				coluna.resize(col.bytes);
+				ok = ler(coluna.data(), col.bytes, col.posicao);
+
+				valores[c].resize(grupo.linhas);
+				int64_t     ant = 0, delta = 0;
+				std::size_t q   = 0;
+				for(
+					uint32_t i = 0; ok && i < grupo.linhas; i++
+				){
+
+					uint64_t z = 0;
+					for(
+						unsigned desloc = 0; ; desloc += 7
+					){
+
+						if( q >= coluna.size() || desloc > 63 ){ ok = false; break; }
+						uint8_t b = coluna[q++];
+						z |= static_cast<uint64_t>(b & 0x7F) << desloc;
+						if( !(b & 0x80) ){ break; }
+					}
+
+					if( c == 0 ){ delta += unzigzag(z); ant += delta; }
+					else{ ant += unzigzag(z); }
+					valores[c][i] = ant;
+				}
+			}
+
+			for(
+				uint32_t i = 0; ok && i < grupo.linhas; i++
+			){
+
+				CollectorFix fix;
+				fix.tracker = tracker;
+				fix.t_ms    = valores[0][i];
+				fix.lat_e6  = static_cast<int32_t>(valores[1][i]);
+				fix.lon_e6  = static_cast<int32_t>(valores[2][i]);
+				fix.alt_dm  = static_cast<int32_t>(valores[3][i]);
+				visitar(fix);
+			}
+		}
+
+		::close(fd);
+		return ok;
+	}
+};
+
+/**
+ * @class TrackExporter
+ * @brief Exporta trajetórias do histórico, um arquivo por rastreador.
+ * @details
+ *
+ * Os blocos de cada rastreador são percorridos em ordem de instante. Blocos compactados
+ * já estão ordenados e disjuntos, e são decodificados e escritos um de cada vez; apenas
+ * blocos com intervalos sobrepostos (fixes fora de ordem ainda não compactados) são
+ * decodificados juntos e ordenados. Instantes repetidos são descartados, como em
+ * HistoryStore::compact(). Cada thread usa um ExportBuffer e, no formato colunar, um
+ * grupo de colunas; a memória é limitada pelo tamanho dos blocos e dos grupos.
+ *
+ * - GPX 1.1: um `trk` com um `trkseg`, com altitude e instante em cada `trkpt`.
+ * - KML 2.2: um `gx:Track`, que exige todos os `when` antes das `gx:coord`; os blocos são
+ *   percorridos duas vezes, em vez de guardar a trajetória.
+ * - Colunar: ColumnarTrackFile.
+ */
+class TrackExporter {
+public:
+
+	enum class Formato : uint8_t { GPX, KML, COLUNAR };
+
+	/**
+	 * @struct Resultado
+	 * @brief Trabalho realizado por uma exportação.
+	 */
+	struct Resultado {
+		uint64_t arquivos = 0;
+		uint64_t fixes    = 0;
+		uint64_t bytes    = 0;
+		uint64_t falhas   = 0; ///< Arquivos que não puderam ser gravados.
+		double   segundos = 0;
+	};
+
+private:
+
+	/**
+	 * @struct Contexto
+	 * @brief Estado reaproveitado por uma thread entre arquivos.
+	 */
+	struct Contexto {
+		ExportBuffer                     saida;
+		std::vector<CollectorFix>     ordenados; ///< Blocos sobrepostos, ordenados.
+		std::vector<uint8_t> colunas[ColumnarTrackFile::N_COLUNAS];
+		std::vector<ColumnarTrackFile::Grupo> grupos;
+		Resultado                     resultado;
+	};
+
+	HistoryStore& historico;
+
+	/**
+	 * @brief Percorre os fixes de `blocos` em [t_ini, t_fim], em ordem de instante e sem repetidos.
+	 * @param blocos Blocos do rastreador com interseção em [t_ini, t_fim], ordenados por t_min.
+	 * @return Quantidade de fixes entregues.
+	 */
+	template <typename F>
+	static uint64_t
+	for_each_fix(
+		const std::vector<HistoryStore::Bloco>& blocos,
+		int64_t t_ini,
+		int64_t t_fim,
+		std::vector<CollectorFix>& ordenados,
+		F&& visitar
+	){
+
+		uint64_t n        = 0;
+		int64_t  anterior = INT64_MIN;
+		auto     entregar = [&](const CollectorFix& fix){
+
+			if( fix.t_ms < t_ini || fix.t_ms > t_fim || fix.t_ms <= anterior ){ return; }
+			anterior = fix.t_ms;
+			visitar(fix);
+			n++;
+		};
+
+		for(
+			std::size_t i = 0; i < blocos.size();
+		){
+
+			// Sequência de blocos com intervalos sobrepostos
+			std::size_t j     = i + 1;
+			int64_t     t_max = blocos[i]->t_max;
+			while( j < blocos.size() && blocos[j]->t_min <= t_max ){ t_max = std::max(t_max, blocos[j]->t_max); j++; }
+
+			ordenados.clear();
+			for( std::size_t k = i; k < j; k++ ){ blocos[k]->decode(ordenados); }
+
+			auto por_instante = [](const CollectorFix& a, const CollectorFix& b){ return a.t_ms < b.t_ms; };
+			if( !std::is_sorted(ordenados.begin(), ordenados.end(), por_instante) ){ std::stable_sort(ordenados.begin(), ordenados.end(), por_instante); }
+			for( const CollectorFix& fix : ordenados ){ entregar(fix); }
+			i = j;
+		}
+		return n;
+	}
+
+	static void
+	write_gpx(
+		Contexto& ctx,
+		uint64_t tracker,
+		const std::vector<HistoryStore::Bloco>& blocos,
+		int64_t t_ini,
+		int64_t t_fim
+	){
+
+		ExportBuffer& o = ctx.saida;
+		o.put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<gpx version=\"1.1\" creator=\"GPSCollector\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n<trk><name>");
+		o.put(file_name(tracker));
+		o.put("</name><trkseg>\n");
+
+		ctx.resultado.fixes += for_each_fix(blocos, t_ini, t_fim, ctx.ordenados, [&](const CollectorFix& fix){
+
+			o.put("<trkpt lat=\"");   o.put_fixed(fix.lat_e6, 6);
+			o.put("\" lon=\"");       o.put_fixed(fix.lon_e6, 6);
+			o.put("\"><ele>");        o.put_fixed(fix.alt_dm, 1);
+			o.put("</ele><time>");    o.put_time(fix.t_ms);
+			o.put("</time></trkpt>\n");
+		});
+
+		o.put("</trkseg></trk>\n</gpx>\n");
+	}
+
+	static void
+	write_kml(
+		Contexto& ctx,
+		uint64_t tracker,
+		const std::vector<HistoryStore::Bloco>& blocos,
+		int64_t t_ini,
+		int64_t t_fim
+	){
+
+		ExportBuffer& o = ctx.saida;
+		o.put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<kml xmlns=\"http://www.opengis.net/kml/2.2\" xmlns:gx=\"http://www.google.com/kml/ext/2.2\">\n<Document><Placemark><name>");
+		o.put(file_name(tracker));
+		o.put("</name>\n<gx:Track><altitudeMode>absolute</altitudeMode>\n");
+
+		ctx.resultado.fixes += for_each_fix(blocos, t_ini, t_fim, ctx.ordenados, [&](const CollectorFix& fix){
+
+			o.put("<when>"); o.put_time(fix.t_ms); o.put("</when>\n");
+		});
+		for_each_fix(blocos, t_ini, t_fim, ctx.ordenados, [&](const CollectorFix& fix){
+
+			o.put("<gx:coord>"); o.put_fixed(fix.lon_e6, 6);
+			o.put(" ");          o.put_fixed(fix.lat_e6, 6);
+			o.put(" ");          o.put_fixed(fix.alt_dm, 1);
+			o.put("</gx:coord>\n");
+		});
+
+		o.put("</gx:Track></Placemark></Document>\n</kml>\n");
+	}
+
+	static void
+	write_columnar(
+		Contexto& ctx,
+		uint64_t tracker,
+		const std::vector<HistoryStore::Bloco>& blocos,
+		int64_t t_ini,
+		int64_t t_fim
+	){
+
+		constexpr std::size_t N = ColumnarTrackFile::N_COLUNAS;
+
+		ExportBuffer&            o = ctx.saida;
+		ColumnarTrackFile::Grupo grupo;
+		int64_t                  ant[N] = {}, delta_t = 0;
+
+		auto varint = [](std::vector<uint8_t>& v, uint64_t z){
+
+			while( z >= 0x80 ){ v.push_back(static_cast<uint8_t>(z | 0x80)); z >>= 7; }
+			v.push_back(static_cast<uint8_t>(z));
+		};
+
+		auto fechar_grupo = [&]{
+
+			if( grupo.linhas == 0 ){ return; }
+			for(
+				std::size_t c = 0; c < N; c++
+			){
+
+				grupo.colunas[c].posicao = o.offset();
+				grupo.colunas[c].bytes   = static_cast<uint32_t>(ctx.colunas[c].size());
+				o.put(reinterpret_cast<const char*>(ctx.colunas[c].data()), ctx.colunas[c].size());
+				ctx.colunas[c].clear();
+			}
+			ctx.grupos.push_back(grupo);
+			grupo = ColumnarTrackFile::Grupo();
+			std::fill(ant, ant + N, 0);
+			delta_t = 0;
+		};
+
+		ctx.grupos.clear();
+		for( auto& c : ctx.colunas ){ c.clear(); }
+		o.put_raw(ColumnarTrackFile::MAGICA);
+
+		ctx.resultado.fixes += for_each_fix(blocos, t_ini, t_fim, ctx.ordenados, [&](const CollectorFix& fix){
+
+			const int64_t v[N] = { fix.t_ms, fix.lat_e6, fix.lon_e6, fix.alt_dm };
+
+			int64_t d = v[0] - ant[0];
+			varint(ctx.colunas[0], ColumnarTrackFile::zigzag(d - delta_t));
+			delta_t = d;
+			for( std::size_t c = 1; c < N; c++ ){ varint(ctx.colunas[c], ColumnarTrackFile::zigzag(v[c] - ant[c])); }
+
+			for(
+				std::size_t c = 0; c < N; c++
+			){
+
+				ant[c] = v[c];
+				grupo.colunas[c].min = std::min(grupo.colunas[c].min, v[c]);
+				grupo.colunas[c].max = std::max(grupo.colunas[c].max, v[c]);
+			}
+			if( ++grupo.linhas == ColumnarTrackFile::LINHAS_POR_GRUPO ){ fechar_grupo(); }
+		});
+		fechar_grupo();
+
+		uint64_t inicio_rodape = o.offset();
+		o.put_raw(tracker);
+		o.put_raw(static_cast<uint32_t>(ctx.grupos.size()));
+		for(
+			const ColumnarTrackFile::Grupo& g : ctx.grupos
+		){
+
+			o.put_raw(g.linhas);
+			for( const ColumnarTrackFile::Coluna& c : g.colunas ){ o.put_raw(c.posicao); o.put_raw(c.bytes); o.put_raw(c.min); o.put_raw(c.max); }
+		}
+		o.put_raw(static_cast<uint32_t>(o.offset() - inicio_rodape));
+		o.put_raw(ColumnarTrackFile::MAGICA);
+	}
+
+	/**
+	 * @brief Exporta um rastreador para `dir`, reaproveitando o contexto da thread.
+	 */
+	void
+	export_one(
+		Contexto& ctx,
+		uint64_t tracker,
+		const std::string& dir,
+		Formato formato,
+		int64_t t_ini,
+		int64_t t_fim
+	){
+
+		std::vector<HistoryStore::Bloco> blocos = historico.blocks(tracker);
+		blocos.erase(std::remove_if(blocos.begin(), blocos.end(), [&](const HistoryStore::Bloco& b){ return !b->overlaps(t_ini, t_fim); }), blocos.end());
+		if( blocos.empty() ){ return; }
+		std::sort(blocos.begin(), blocos.end(), [](const HistoryStore::Bloco& a, const HistoryStore::Bloco& b){ return a->t_min < b->t_min; });
+
+		std::string caminho = dir + "/" + file_name(tracker) + extension(formato);
+		if( !ctx.saida.open(caminho) ){ ctx.resultado.falhas++; return; }
+
+		switch(
+			formato
+		){
+
+			case Formato::GPX     : write_gpx(ctx, tracker, blocos, t_ini, t_fim);      break;
+			case Formato::KML     : write_kml(ctx, tracker, blocos, t_ini, t_fim);      break;
+			case Formato::COLUNAR : write_columnar(ctx, tracker, blocos, t_ini, t_fim); break;
+		}
+
+		uint64_t bytes = ctx.saida.offset();
+		if( !ctx.saida.close() ){ ctx.resultado.falhas++; std::cout << "\033[1;31mErro ao gravar exportação: " << caminho << "\033[0m" << std::endl; return; }
+		ctx.resultado.arquivos++;
+		ctx.resultado.bytes += bytes;
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param historico_ Histórico de onde as trajetórias são lidas.
+	 */
+	explicit TrackExporter(
+		HistoryStore& historico_
+	) : historico(historico_) {}
+
+	/**
+	 * @brief Extensão dos arquivos de um formato.
+	 */
+	static const char*
+	extension(
+		Formato formato
+	){
+
+		switch(
+			formato
+		){
+
+			case Formato::GPX : return ".gpx";
+			case Formato::KML : return ".kml";
+			default           : return ".gtc";
+		}
+	}
+
+	/**
+	 * @brief Interpreta o nome de um formato: `gpx`, `kml` ou `colunar`.
+	 * @return False caso o nome seja desconhecido.
+	 */
+	static bool
+	parse_format(
+		const std::string& nome,
+		Formato& formato
+	){
+
+		if( nome == "gpx" ){ formato = Formato::GPX; return true; }
+		if( nome == "kml" ){ formato = Formato::KML; return true; }
+		if( nome == "colunar" ){ formato = Formato::COLUNAR; return true; }
+		return false;
+	}
+
+	/**
+	 * @brief Nome do arquivo de um rastreador, `a.b.c.d_porta`, sem extensão.
+	 */
+	static std::string
+	file_name(
+		uint64_t tracker
+	){
+
+		char nome[32];
+		uint32_t ip = static_cast<uint32_t>(tracker >> 16);
+		std::snprintf(nome, sizeof(nome), "%u.%u.%u.%u_%u", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF, static_cast<unsigned>(tracker & 0xFFFF));
+		return nome;
+	}
+
+	/**
+	 * @brief Exporta os rastreadores indicados, um arquivo por rastreador em `dir`.
+	 * @param trackers Rastreadores; os sem fixes em [t_ini, t_fim] não geram arquivo.
+	 * @param dir Diretório de saída, criado caso não exista.
+	 * @param formato Formato dos arquivos.
+	 * @param t_ini Início do intervalo exportado, em ms.
+	 * @param t_fim Fim do intervalo exportado, em ms.
+	 * @param n_threads Threads de exportação; 0 usa hardware_concurrency().
+	 * @details
+	 *
+	 * As threads retiram o próximo rastreador de um contador atômico, de modo que
+	 * trajetórias longas não atrasam as demais.
+	 */
+	Resultado
+	export_trackers(
+		const std::vector<uint64_t>& trackers,
+		const std::string& dir,
+		Formato formato,
+		int64_t t_ini = INT64_MIN,
+		int64_t t_fim = INT64_MAX,
+		int n_threads = 0
+	){
+
+		auto inicio = std::chrono::steady_clock::now();
+		::mkdir(dir.c_str(), 0755);
+
+		if( n_threads <= 0 ){ n_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); }
+		n_threads = static_cast<int>(std::min<std::size_t>(n_threads, std::max<std::size_t>(trackers.size(), 1)));
+
+		std::vector<std::unique_ptr<Contexto>> contextos;
+		for( int t = 0; t < n_threads; t++ ){ contextos.push_back(std::make_unique<Contexto>()); }
+
+		std::atomic<std::size_t> proximo{0};
+		auto trabalhar = [&](int t){
+
+			for(
+				std::size_t i = proximo.fetch_add(1, std::memory_order_relaxed); i < trackers.size();
+				i = proximo.fetch_add(1, std::memory_order_relaxed)
+			){
+
+				export_one(*contextos[t], trackers[i], dir, formato, t_ini, t_fim);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for( int t = 1; t < n_threads; t++ ){ threads.emplace_back(trabalhar, t); }
+		trabalhar(0);
+		for( auto& th : threads ){ th.join(); }
+
+		Resultado r;
+		for(
+			const auto& c : contextos
+		){
+
+			r.arquivos += c->resultado.arquivos;
+			r.fixes    += c->resultado.fixes;
+			r.bytes    += c->resultado.bytes;
+			r.falhas   += c->resultado.falhas;
+		}
+		r.segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+		return r;
+	}
+
+	/**
+	 * @brief Exporta todos os rastreadores do histórico.
+	 */
+	Resultado
+	export_all(
+		const std::string& dir,
+		Formato formato,
+		int64_t t_ini = INT64_MIN,
+		int64_t t_fim = INT64_MAX,
+		int n_threads = 0
+	){
+
+		std::vector<uint64_t> trackers;
+		for(
+			std::size_t i = 0; i < historico.shard_count(); i++
+		){
+
+			std::vector<uint64_t> do_shard = historico.trackers_in_shard(i);
+			trackers.insert(trackers.end(), do_shard.begin(), do_shard.end());
+		}
+		return export_trackers(trackers, dir, formato, t_ini, t_fim, n_threads);
+	}
+};
+
+#endif // TRACKEXPORTER_HPP
@@ -0,0 +1,329 @@
+/**
+ * @file TrackPyramid.hpp
+ * @brief Pirâmide de resoluções da trajetória de um rastreador, para visualização.
+ * @details
+ * Um mês de fixes a 1 Hz são milhões de pontos, muito além do que uma tela mostra. A
+ * pirâmide mantém versões cada vez mais reduzidas da trajetória, construídas durante a
+ * ingestão, de modo que uma consulta devolve no máximo a quantidade de pontos pedida,
+ * qualquer que seja o intervalo.
+ */
+#ifndef TRACKPYRAMID_HPP
+#define TRACKPYRAMID_HPP
+
+//-------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "Snapshot.hpp"
+
+/**
+ * @class TrackPyramid
+ * @brief Níveis de redução por LTTB (Largest-Triangle-Three-Buckets) em cascata.
+ * @details
+ *
+ * O nível k guarda cerca de um ponto a cada fator^k fixes. Cada nível é produzido a partir
+ * do anterior em baldes de `fator` pontos: de cada balde fica o ponto que forma o maior
+ * triângulo, no plano, com o último ponto escolhido e a média do balde seguinte. Assim
+ * curvas e paradas sobrevivem à redução, ao contrário da amostragem a intervalos fixos.
+ *
+ * A construção é incremental, com um balde de atraso por nível; um nível só é criado
+ * quando o anterior acumula `fator` pontos. O último fix recebido é guardado à parte,
+ * para que consultas que alcançam o presente terminem na posição atual.
+ */
+class TrackPyramid {
+public:
+
+	struct Ponto {
+		int64_t t_ms;
+		int32_t lat_e6, lon_e6;
+	};
+
+private:
+
+	struct Redutor {
+		bool               iniciado = false;
+		Ponto              anterior{};
+		std::vector<Ponto> pendente; ///< Balde que aguarda a média do seguinte.
+		std::vector<Ponto> atual;
+	};
+
+	std::size_t                     fator;
+	std::vector<Redutor>        redutores; ///< redutores[k] produz niveis[k].
+	std::vector<std::vector<Ponto>> niveis; ///< niveis[k]: um ponto a cada fator^(k + 1) fixes.
+	Ponto                          ultimo{};
+	bool                            vazio = true;
+	double                     escala_lon = 1;
+
+	/**
+	 * @brief Área (dobrada) do triângulo abc no plano local.
+	 */
+	double
+	area(
+		const Ponto& a,
+		const Ponto& b,
+		double lat_c,
+		double lon_c
+	) const {
+
+		double bx = (b.lon_e6 - a.lon_e6) * escala_lon, by = b.lat_e6 - a.lat_e6;
+		double cx = (lon_c - a.lon_e6) * escala_lon,    cy = lat_c - a.lat_e6;
+		return std::fabs(bx * cy - by * cx);
+	}
+
+	/**
+	 * @brief Acrescenta um ponto ao nível k e o repassa ao redutor do nível seguinte.
+	 */
+	void
+	emit(
+		std::size_t k,
+		const Ponto& p
+	){
+
+		niveis[k].push_back(p);
+
+		if( k + 1 < redutores.size() ){ reduce(k + 1, p); }
+		else if(
+			niveis[k].size() == fator
+		){
+
+			// O nível k passou a justificar um nível mais grosso
+			redutores.emplace_back();
+			niveis.emplace_back();
+			for( std::size_t i = 0; i < fator; i++ ){ reduce(k + 1, niveis[k][i]); }
+		}
+	}
+
+	void
+	reduce(
+		std::size_t k,
+		const Ponto& p
+	){
+
+		Redutor& r = redutores[k];
+		if( !r.iniciado ){ r.iniciado = true; r.anterior = p; emit(k, p); return; }
+
+		r.atual.push_back(p);
+		if( r.atual.size() < fator ){ return; }
+
+		bool  escolheu = !r.pendente.empty();
+		Ponto melhor   = r.anterior;
+		if(
+			escolheu
+		){
+
+			double lat_c = 0, lon_c = 0;
+			for( const Ponto& q : r.atual ){ lat_c += q.lat_e6; lon_c += q.lon_e6; }
+			lat_c /= r.atual.size(); lon_c /= r.atual.size();
+
+			double maior = -1;
+			for(
+				const Ponto& q : r.pendente
+			){
+
+				double a = area(r.anterior, q, lat_c, lon_c);
+				if( a > maior ){ maior = a; melhor = q; }
+			}
+			r.anterior = melhor;
+		}
+		r.pendente.swap(r.atual);
+		r.atual.clear();
+
+		// Por último: emit() pode criar um nível e realocar `redutores`
+		if( escolheu ){ emit(k, melhor); }
+	}
+
+	/**
+	 * @brief Quantidade de pontos do nível k em [t_ini, t_fim].
+	 */
+	std::pair<std::size_t, std::size_t>
+	range(
+		std::size_t k,
+		int64_t t_ini,
+		int64_t t_fim
+	) const {
+
+		const std::vector<Ponto>& v = niveis[k];
+		auto ini = std::lower_bound(v.begin(), v.end(), t_ini, [](const Ponto& p, int64_t t){ return p.t_ms < t; });
+		auto fim = std::upper_bound(ini, v.end(), t_fim, [](int64_t t, const Ponto& p){ return t < p.t_ms; });
+		return { static_cast<std::size_t>(ini - v.begin()), static_cast<std::size_t>(fim - v.begin()) };
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param fator_ Redução entre níveis consecutivos; 0 desabilita a pirâmide.
+	 */
+	explicit TrackPyramid(std::size_t fator_ = 8) : fator(fator_ == 1 ? 2 : fator_) {}
+
+	bool enabled() const { return fator > 0; }
+
+	/**
+	 * @brief Incorpora um fix. Fixes mais antigos que o último são ignorados.
+	 */
+	void
+	append(
+		const CollectorFix& fix
+	){
+
+		if( fator == 0 || (!vazio && fix.t_ms <= ultimo.t_ms) ){ return; }
+
+		Ponto p{ fix.t_ms, fix.lat_e6, fix.lon_e6 };
+		if(
+			vazio
+		){
+
+			vazio      = false;
+			escala_lon = std::cos(fix.lat_e6 * 1e-6 * M_PI / 180.0);
+			redutores.emplace_back();
+			niveis.emplace_back();
+		}
+		ultimo = p;
+		reduce(0, p);
+	}
+
+	/**
+	 * @brief Escolhe o nível mais fino com até `max_pontos` pontos em [t_ini, t_fim].
+	 * @return 0 quando os próprios fixes cabem no limite (estimado pelo nível 1); caso
+	 * contrário, o nível k >= 1, de resolução 1/fator^k.
+	 * @details
+	 *
+	 * A quantidade de pontos no intervalo não cresce com o nível, de modo que o primeiro
+	 * nível que cabe é encontrado por busca binária, com uma consulta range() por passo.
+	 */
+	std::size_t
+	level_for(
+		int64_t t_ini,
+		int64_t t_fim,
+		std::size_t max_pontos
+	) const {
+
+		if( niveis.empty() ){ return 0; }
+
+		auto r = range(0, t_ini, t_fim);
+		if( (r.second - r.first + 1) * fator <= max_pontos ){ return 0; }
+
+		// Primeiro índice em [0, niveis.size()) que cabe; o último nível é usado se nenhum couber
+		std::size_t ini = 0, fim = niveis.size() - 1;
+		while(
+			ini < fim
+		){
+
+			std::size_t meio = ini + (fim - ini) / 2;
+			r = range(meio, t_ini, t_fim);
+			if( r.second - r.first + 1 <= max_pontos ){ fim = meio; }
+			else{ ini = meio + 1; }
+		}
+		return ini + 1;
+	}
+
+	/**
+	 * @brief Copia os pontos do nível k >= 1 em [t_ini, t_fim], terminando no último fix.
+	 */
+	void
+	copy(
+		std::size_t nivel,
+		int64_t t_ini,
+		int64_t t_fim,
+		std::vector<Ponto>& saida
+	) const {
+
+		auto r = range(nivel - 1, t_ini, t_fim);
+		saida.insert(saida.end(), niveis[nivel - 1].begin() + r.first, niveis[nivel - 1].begin() + r.second);
+		if( !vazio && ultimo.t_ms >= t_ini && ultimo.t_ms <= t_fim && (saida.empty() || saida.back().t_ms < ultimo.t_ms) ){ saida.push_back(ultimo); }
+	}
+
+	std::size_t level_count() const { return niveis.size(); }
+
+	/**
+	 * @brief Remove dos níveis os pontos anteriores a t_ms, para a retenção do histórico.
+	 * @details
+	 *
+	 * Os redutores e o último fix são mantidos, de modo que a construção prossegue.
+	 */
+	void
+	drop_before(
+		int64_t t_ms
+	){
+
+		for(
+			auto& v : niveis
+		){
+
+			auto fim = std::lower_bound(v.begin(), v.end(), t_ms, [](const Ponto& p, int64_t t){ return p.t_ms < t; });
+			v.erase(v.begin(), fim);
+		}
+	}
+
+	/**
+	 * @brief Grava os níveis e o estado dos redutores no snapshot.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	) const {
+
+		w.put<uint64_t>(fator);
+		w.put(ultimo);
+		w.put<uint8_t>(vazio);
+		w.put(escala_lon);
+		w.put<uint64_t>(redutores.size());
+		for(
+			std::size_t k = 0; k < redutores.size(); k++
+		){
+
+			w.put<uint8_t>(redutores[k].iniciado);
+			w.put(redutores[k].anterior);
+			w.put_vector(redutores[k].pendente);
+			w.put_vector(redutores[k].atual);
+			w.put_vector(niveis[k]);
+		}
+	}
+
+	/**
+	 * @brief Substitui a pirâmide pelo que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou inconsistente.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		uint64_t f = 0, n = 0;
+		uint8_t  v = 1;
+		if( !r.get(f) || !r.get(ultimo) || !r.get(v) || !r.get(escala_lon) || !r.get(n) || n > 64 ){ return false; }
+
+		fator = static_cast<std::size_t>(f);
+		vazio = (v != 0);
+		redutores.assign(n, Redutor());
+		niveis.assign(n, std::vector<Ponto>());
+		for(
+			std::size_t k = 0; k < n; k++
+		){
+
+			uint8_t iniciado = 0;
+			if( !r.get(iniciado) || !r.get(redutores[k].anterior) || !r.get_vector(redutores[k].pendente) ||
+				!r.get_vector(redutores[k].atual) || !r.get_vector(niveis[k]) ){ return false; }
+			redutores[k].iniciado = (iniciado != 0);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Memória ocupada pelos níveis, em bytes.
+	 */
+	std::size_t
+	bytes() const {
+
+		std::size_t n = 0;
+		for( const auto& v : niveis ){ n += v.capacity() * sizeof(Ponto); }
+		for( const auto& r : redutores ){ n += (r.pendente.capacity() + r.atual.capacity()) * sizeof(Ponto); }
+		return n;
+	}
+};
+
+#endif // TRACKPYRAMID_HPP
@@ -0,0 +1,82 @@
+/**
+ * @file TrackerState.hpp
+ * @brief Estado mantido pelo coletor para cada rastreador.
+ */
+#ifndef TRACKERSTATE_HPP
+#define TRACKERSTATE_HPP
+
+//-------------------------------------------------
+#include <cstdint>
+
+#include "CollectorFix.hpp"
+#include "GPSFix.hpp"
+
+/**
+ * @struct TrackerState
+ * @brief Estado mantido por rastreador na TrackerTable do coletor.
+ * @details
+ *
+ * Ocupa 48 bytes, de modo que cada rastreador cabe em uma única linha de cache.
+ */
+struct TrackerState {
+	int64_t  t_ms        = 0; ///< Instante do último fix.
+	int64_t  primeiro_ms = 0; ///< Instante do primeiro fix.
+	uint64_t janela      = 0; ///< Bit i ligado: houve fix i segundos antes do último.
+	int32_t  lat_e6      = 0; ///< Última latitude em micrograus.
+	int32_t  lon_e6      = 0; ///< Última longitude em micrograus.
+	int32_t  alt_dm      = 0; ///< Última altitude em decímetros.
+	uint32_t n_fixes     = 0; ///< Fixes recebidos.
+	float    vel_mps     = 0; ///< Velocidade filtrada (média móvel exponencial).
+	uint32_t reservado   = 0;
+
+	/**
+	 * @brief Incorpora um novo fix ao estado.
+	 * @param fix Fix recebido.
+	 * @param novo Indica que o rastreador acabou de ser registrado.
+	 * @details
+	 *
+	 * Fixes mais antigos que o último apenas marcam a janela, sem retroceder a posição.
+	 */
+	void
+	apply(
+		const CollectorFix& fix,
+		bool novo
+	){
+
+		if(
+			novo || n_fixes == 0
+		){
+
+			primeiro_ms = fix.t_ms;
+			t_ms        = fix.t_ms;
+			janela      = 1;
+			lat_e6 = fix.lat_e6; lon_e6 = fix.lon_e6; alt_dm = fix.alt_dm;
+			n_fixes     = 1;
+			return;
+		}
+
+		n_fixes++;
+		int64_t dt_s = (fix.t_ms - t_ms) / 1000;
+
+		if(
+			dt_s < 0
+		){
+
+			if( -dt_s < 64 ){ janela |= uint64_t(1) << (-dt_s); }
+			return;
+		}
+
+		if( dt_s > 0 ){
+
+			double d = GPSFix::distance_m(lat_e6 * 1e-6, lon_e6 * 1e-6, fix.lat(), fix.lon());
+			vel_mps = static_cast<float>(0.7 * vel_mps + 0.3 * (d / dt_s));
+		}
+
+		janela = (dt_s >= 64) ? 1 : ((janela << dt_s) | 1);
+		t_ms   = fix.t_ms;
+		lat_e6 = fix.lat_e6; lon_e6 = fix.lon_e6; alt_dm = fix.alt_dm;
+	}
+};
+static_assert(sizeof(TrackerState) == 48, "TrackerState deve ocupar 48 bytes");
+
+#endif // TRACKERSTATE_HPP
@@ -0,0 +1,451 @@
+/**
+ * @file TrackerTable.hpp
+ * @brief Tabela de estado por rastreador, particionada e com leituras sem lock.
+ * @details
+ * O coletor mantém, para cada rastreador, o último fix, a janela de recepção e estados
+ * de filtros, atualizados por várias threads de recepção. A tabela usa endereçamento
+ * aberto com entradas do tamanho de uma linha de cache, divididas em shards.
+ */
+#ifndef TRACKERTABLE_HPP
+#define TRACKERTABLE_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Snapshot.hpp"
+
+/// Tamanho de linha de cache assumido nas arquiteturas de interesse.
+constexpr std::size_t TAM_LINHA_CACHE = 64;
+
+/**
+ * @class TrackerTable
+ * @brief Hash de endereçamento aberto, particionado, de rastreador para estado.
+ * @tparam Estado Estado por rastreador. Trivialmente copiável, até 48 bytes.
+ * @details
+ *
+ * Cada entrada ocupa exatamente uma linha de cache:
+ *
+ * - `chave` : identificador do rastreador (0 significa livre), reivindicado por CAS.
+ * - `seq`   : contador de seqlock; ímpar enquanto um escritor altera a entrada.
+ * - `palavras` : o Estado, em palavras atômicas relaxadas.
+ *
+ * Escritores de entradas distintas nunca disputam; na mesma entrada, o CAS de `seq`
+ * de par para ímpar funciona como lock da entrada. Leitores nunca escrevem: copiam o
+ * estado e repetem se `seq` mudou, sem jamais bloquear escritores.
+ *
+ * O shard é escolhido pelos bits altos do hash e a posição pelos bits baixos, com
+ * sondagem linear. A capacidade é fixa; entradas não são removidas.
+ */
+template <typename Estado>
+class TrackerTable {
+	static_assert(std::is_trivially_copyable<Estado>::value, "Estado deve ser trivialmente copiável");
+	static_assert(sizeof(Estado) <= 48, "Estado deve caber em uma linha de cache junto da chave e do seq");
+
+	static constexpr std::size_t N_PALAVRAS = (sizeof(Estado) + 7) / 8;
+
+public:
+
+	/**
+	 * @struct Entrada
+	 * @brief Entrada alinhada a uma linha de cache.
+	 */
+	struct alignas(TAM_LINHA_CACHE) Entrada {
+		std::atomic<uint64_t>             chave;
+		std::atomic<uint64_t>               seq;
+		std::atomic<uint64_t> palavras[N_PALAVRAS];
+	};
+	static_assert(sizeof(Entrada) == TAM_LINHA_CACHE, "Entrada deve ocupar uma linha de cache");
+
+	/**
+	 * @struct Shard
+	 * @brief Partição da tabela, com memória contígua própria.
+	 */
+	struct Shard {
+		Entrada*               entradas = nullptr;
+		std::size_t            mascara  = 0;
+		std::atomic<std::size_t> ocupadas{0};
+	};
+
+	/// Aloca a memória de um shard: recebe o tamanho em bytes e o índice do shard.
+	using FnAlocar  = void* (*)(std::size_t, std::size_t);
+	/// Libera a memória de um shard: recebe o ponteiro e o tamanho em bytes.
+	using FnLiberar = void  (*)(void*, std::size_t);
+	/// Escolhe o shard de uma chave: recebe a chave, seu hash e a quantidade de shards.
+	using FnShard   = std::size_t (*)(uint64_t, uint64_t, std::size_t);
+
+private:
+
+	std::vector<Shard> shards;
+	unsigned           bits_shard = 0;
+	FnLiberar          liberar    = nullptr;
+	FnShard            particao   = nullptr;
+
+	/**
+	 * @brief Finalizador do splitmix64; espalha identificadores sequenciais.
+	 */
+	static uint64_t
+	hash(
+		uint64_t x
+	){
+
+		x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	std::size_t
+	shard_index(
+		uint64_t chave,
+		uint64_t h
+	) const {
+
+		if( particao ){ return particao(chave, h, shards.size()); }
+		return bits_shard ? (h >> (64 - bits_shard)) : 0;
+	}
+
+	/**
+	 * @brief Localiza a entrada de um rastreador, reivindicando-a se permitido.
+	 * @return Ponteiro para a entrada ou nullptr caso ausente (ou tabela cheia).
+	 */
+	Entrada*
+	locate(
+		uint64_t chave,
+		bool criar
+	){
+
+		uint64_t h = hash(chave);
+		Shard& s = shards[shard_index(chave, h)];
+
+		std::size_t pos = h & s.mascara;
+		for(
+			std::size_t sondagens = 0; sondagens <= s.mascara; sondagens++, pos = (pos + 1) & s.mascara
+		){
+
+			Entrada& e = s.entradas[pos];
+			uint64_t atual = e.chave.load(std::memory_order_acquire);
+
+			if( atual == chave ){ return &e; }
+			if( atual != 0 ){ continue; }
+			if( !criar ){ return nullptr; }
+
+			uint64_t livre = 0;
+			if( e.chave.compare_exchange_strong(livre, chave, std::memory_order_acq_rel) ){
+
+				s.ocupadas.fetch_add(1, std::memory_order_relaxed);
+				return &e;
+			}
+			if( livre == chave ){ return &e; } // Outra thread inseriu a mesma chave
+		}
+
+		return nullptr;
+	}
+
+	static void
+	copy_out(
+		const Entrada& e,
+		Estado& estado
+	){
+
+		uint64_t buffer[N_PALAVRAS];
+		for( std::size_t i = 0; i < N_PALAVRAS; i++ ){ buffer[i] = e.palavras[i].load(std::memory_order_relaxed); }
+		std::memcpy(&estado, buffer, sizeof(Estado));
+	}
+
+	static void
+	copy_in(
+		Entrada& e,
+		const Estado& estado
+	){
+
+		uint64_t buffer[N_PALAVRAS] = {};
+		std::memcpy(buffer, &estado, sizeof(Estado));
+		for( std::size_t i = 0; i < N_PALAVRAS; i++ ){ e.palavras[i].store(buffer[i], std::memory_order_relaxed); }
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param capacidade Quantidade de rastreadores esperada. A tabela reserva o dobro,
+	 * arredondado para potência de 2 por shard, mantendo a ocupação abaixo de 50%.
+	 * @param n_shards Quantidade de shards, arredondada para potência de 2.
+	 * @param alocar Função de alocação de cada shard (por exemplo, NumaArena::allocate, local ao nó NUMA).
+	 * nullptr usa aligned_alloc.
+	 * @param liberar_ Função de liberação correspondente (NumaArena::release). nullptr usa free.
+	 * @param particao_ Função que escolhe o shard de cada chave (por exemplo, um shard do nó
+	 * NUMA que a recebe). nullptr usa os bits altos do hash.
+	 */
+	explicit TrackerTable(
+		std::size_t capacidade,
+		std::size_t n_shards = 16,
+		FnAlocar alocar = nullptr,
+		FnLiberar liberar_ = nullptr,
+		FnShard particao_ = nullptr
+	) : liberar(liberar_ ? liberar_ : +[](void* p, std::size_t){ std::free(p); }),
+		particao(particao_)
+	{
+
+		while( (std::size_t(1) << bits_shard) < n_shards ){ bits_shard++; }
+		shards = std::vector<Shard>(std::size_t(1) << bits_shard);
+
+		std::size_t por_shard = 16;
+		while( por_shard < (2 * capacidade) / shards.size() ){ por_shard <<= 1; }
+
+		for(
+			std::size_t i = 0; i < shards.size(); i++
+		){
+
+			std::size_t bytes = por_shard * sizeof(Entrada);
+			void* mem = alocar ? alocar(bytes, i) : std::aligned_alloc(TAM_LINHA_CACHE, bytes);
+			if( !mem ){ throw std::runtime_error("\033[1;31mErro ao alocar shard da TrackerTable\033[0m"); }
+
+			shards[i].entradas = static_cast<Entrada*>(mem);
+			shards[i].mascara  = por_shard - 1;
+			for( std::size_t j = 0; j < por_shard; j++ ){ new (&shards[i].entradas[j]) Entrada{}; }
+		}
+	}
+
+	~TrackerTable(){
+
+		for( auto& s : shards ){ liberar(s.entradas, (s.mascara + 1) * sizeof(Entrada)); }
+	}
+
+	TrackerTable(const TrackerTable&)            = delete;
+	TrackerTable& operator=(const TrackerTable&) = delete;
+
+	/**
+	 * @brief Atualiza o estado de um rastreador, criando-o se necessário.
+	 * @param chave Identificador do rastreador, diferente de zero.
+	 * @param atualizar Função `void(Estado&, bool novo)` aplicada sob o lock da entrada.
+	 * @return False caso a tabela esteja cheia. True, caso contrário.
+	 */
+	template <typename F>
+	bool
+	update(
+		uint64_t chave,
+		F&& atualizar
+	){
+
+		Entrada* e = locate(chave, true);
+		if( !e ){ return false; }
+
+		// Lock da entrada: seq par -> ímpar
+		uint64_t s = e->seq.load(std::memory_order_relaxed);
+		while(
+			(s & 1) || !e->seq.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed)
+		){
+
+			if( s & 1 ){ std::this_thread::yield(); s = e->seq.load(std::memory_order_relaxed); }
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Estado estado;
+		copy_out(*e, estado);
+		atualizar(estado, s == 0);
+		copy_in(*e, estado);
+
+		e->seq.store(s + 2, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Lê o estado de um rastreador sem bloquear escritores.
+	 * @param chave Identificador do rastreador.
+	 * @param[out] estado Cópia consistente do estado.
+	 * @return False caso o rastreador não exista. True, caso contrário.
+	 */
+	bool
+	read(
+		uint64_t chave,
+		Estado& estado
+	){
+
+		Entrada* e = locate(chave, false);
+		if( !e ){ return false; }
+
+		uint64_t s0, s1;
+		do {
+
+			s0 = e->seq.load(std::memory_order_acquire);
+			copy_out(*e, estado);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			s1 = e->seq.load(std::memory_order_relaxed);
+
+		} while( (s0 & 1) || s0 != s1 );
+
+		return s0 != 0;
+	}
+
+	/**
+	 * @brief Percorre todas as entradas de um shard com cópias consistentes.
+	 * @param indice Índice do shard.
+	 * @param visitar Função `void(uint64_t chave, const Estado&)`.
+	 */
+	template <typename F>
+	void
+	for_each_in_shard(
+		std::size_t indice,
+		F&& visitar
+	){
+
+		Shard& s = shards[indice];
+		for(
+			std::size_t i = 0; i <= s.mascara; i++
+		){
+
+			uint64_t chave = s.entradas[i].chave.load(std::memory_order_acquire);
+			if( chave == 0 ){ continue; }
+
+			Estado estado;
+			if( read(chave, estado) ){ visitar(chave, estado); }
+		}
+	}
+
+	/**
+	 * @brief Percorre todas as entradas da tabela.
+	 */
+	template <typename F>
+	void
+	for_each(
+		F&& visitar
+	){ for( std::size_t i = 0; i < shards.size(); i++ ){ for_each_in_shard(i, visitar); } }
+
+	std::size_t shard_count() const { return shards.size(); }
+
+	/**
+	 * @brief Shard em que está (ou estará) o rastreador.
+	 */
+	std::size_t shard_of(uint64_t chave) const { return shard_index(chave, hash(chave)); }
+
+	/**
+	 * @brief Início da memória de um shard, para consultar em que nó NUMA ela reside.
+	 */
+	const void* shard_memory(std::size_t indice) const { return shards[indice].entradas; }
+
+	/**
+	 * @brief Grava a tabela no snapshot: a geometria e, alinhadas a páginas, as entradas.
+	 * @details
+	 *
+	 * Não pode haver escritores concorrentes; leitores não são afetados.
+	 */
+	void
+	save(
+		SnapshotWriter& w
+	) const {
+
+		w.put<uint64_t>(shards.size());
+		for( const auto& s : shards ){ w.put<uint64_t>(s.mascara + 1); w.put<uint64_t>(s.ocupadas.load()); }
+		for(
+			const auto& s : shards
+		){
+
+			w.align();
+			w.put_bytes(static_cast<const void*>(s.entradas), (s.mascara + 1) * sizeof(Entrada));
+		}
+	}
+
+	/**
+	 * @brief Carrega em uma tabela vazia o que save() gravou.
+	 * @return False caso o snapshot esteja truncado ou a tabela não comporte as entradas.
+	 * @details
+	 *
+	 * Com a mesma geometria, cada shard cujas chaves pertencem a ele pela partição atual é
+	 * copiado em bloco do mapeamento; caso contrário (outra geometria ou outra partição,
+	 * como com e sem NUMA), as entradas são reinseridas uma a uma ao final.
+	 */
+	bool
+	load(
+		SnapshotReader& r
+	){
+
+		uint64_t n = 0;
+		if( !r.get(n) || n == 0 || n > (1u << 16) ){ return false; }
+
+		std::vector<uint64_t> tamanhos(n), ocupadas(n);
+		for( uint64_t i = 0; i < n; i++ ){ if( !r.get(tamanhos[i]) || !r.get(ocupadas[i]) ){ return false; } }
+
+		bool igual = (n == shards.size());
+		for( uint64_t i = 0; igual && i < n; i++ ){ igual = (tamanhos[i] == shards[i].mascara + 1); }
+
+		std::vector<std::pair<const char*, uint64_t>> reinserir;
+		for(
+			uint64_t i = 0; i < n; i++
+		){
+
+			if( !r.align() ){ return false; }
+			const char* p = static_cast<const char*>(r.view(tamanhos[i] * sizeof(Entrada)));
+			if( !p ){ return false; }
+
+			bool copiar = igual;
+			for(
+				uint64_t j = 0; copiar && j < tamanhos[i]; j++
+			){
+
+				uint64_t chave;
+				std::memcpy(&chave, p + j * sizeof(Entrada), sizeof(chave));
+				copiar = (chave == 0 || shard_of(chave) == i);
+			}
+
+			if(
+				copiar
+			){
+
+				std::memcpy(static_cast<void*>(shards[i].entradas), p, tamanhos[i] * sizeof(Entrada));
+				shards[i].ocupadas.store(ocupadas[i], std::memory_order_relaxed);
+			}
+			else{ reinserir.emplace_back(p, tamanhos[i]); }
+		}
+
+		// Depois das cópias em bloco, que sobrescreveriam as entradas reinseridas
+		for(
+			const auto& par : reinserir
+		){
+
+			for(
+				uint64_t j = 0; j < par.second; j++
+			){
+
+				uint64_t palavras[TAM_LINHA_CACHE / 8];
+				std::memcpy(palavras, par.first + j * sizeof(Entrada), sizeof(Entrada));
+				if( palavras[0] == 0 ){ continue; }
+
+				bool ok = update(palavras[0], [&](Estado& estado, bool){ std::memcpy(static_cast<void*>(&estado), palavras + 2, sizeof(Estado)); });
+				if( !ok ){ return false; }
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Quantidade de rastreadores registrados.
+	 */
+	std::size_t
+	size() const {
+
+		std::size_t n = 0;
+		for( const auto& s : shards ){ n += s.ocupadas.load(std::memory_order_relaxed); }
+		return n;
+	}
+
+	/**
+	 * @brief Capacidade total em entradas.
+	 */
+	std::size_t
+	capacity() const {
+
+		std::size_t n = 0;
+		for( const auto& s : shards ){ n += s.mascara + 1; }
+		return n;
+	}
+};
+
+#endif // TRACKERTABLE_HPP
@@ -0,0 +1,347 @@
+/**
+ * @file TripSegmenter.hpp
+ * @brief Segmentação em viagens e paradas, incremental, sobre o fluxo de fixes do coletor.
+ * @details
+ * Operadores querem viagens e paradas, não pontos. Em vez de processar logs CSV depois,
+ * cada fix atualiza em O(1) uma pequena máquina de estados por rastreador, e os resumos
+ * são emitidos assim que cada viagem ou parada termina.
+ */
+#ifndef TRIPSEGMENTER_HPP
+#define TRIPSEGMENTER_HPP
+
+//-------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CollectorFix.hpp"
+#include "GPSFix.hpp"
+#include "TrackerTable.hpp"
+
+/**
+ * @struct TripSummary
+ * @brief Resumo de uma viagem ou parada concluída.
+ */
+struct TripSummary {
+
+	enum class Tipo : uint32_t { VIAGEM, PARADA };
+
+	Tipo     tipo        = Tipo::VIAGEM;
+	uint64_t tracker     = 0;
+	int64_t  t_ini       = 0; ///< ms desde a época Unix.
+	int64_t  t_fim       = 0;
+	int32_t  lat_ini     = 0, lon_ini = 0; ///< Micrograus. Na parada, igual ao fim.
+	int32_t  lat_fim     = 0, lon_fim = 0;
+	float    distancia_m = 0; ///< Apenas viagens.
+
+	/**
+	 * @brief Linha CSV `tipo,rastreador,t_ini,t_fim,lat_ini,lon_ini,lat_fim,lon_fim,distancia_m`.
+	 */
+	std::string
+	to_csv() const {
+
+		char linha[192];
+		std::snprintf(linha, sizeof(linha), "%s,%llu,%lld,%lld,%.6f,%.6f,%.6f,%.6f,%.1f\n",
+					  tipo == Tipo::VIAGEM ? "viagem" : "parada", static_cast<unsigned long long>(tracker),
+					  static_cast<long long>(t_ini), static_cast<long long>(t_fim),
+					  lat_ini * 1e-6, lon_ini * 1e-6, lat_fim * 1e-6, lon_fim * 1e-6, distancia_m);
+		return linha;
+	}
+};
+
+/**
+ * @class TripSegmenter
+ * @brief Detector de paradas (raio e tempo de permanência) e viagens, por rastreador.
+ * @details
+ *
+ * O estado de cada rastreador cabe em uma entrada da TrackerTable e gira em torno de uma
+ * âncora, o primeiro fix de uma possível parada:
+ *
+ * - Fix a até `raio_m` da âncora: em viagem, se a permanência atingir `parada_min_ms`, a viagem
+ *   termina na chegada à âncora e uma parada começa.
+ * - Fix além do raio: uma parada em curso termina no último fix próximo à âncora e uma viagem
+ *   começa; em viagem, a distância cresce do trecho âncora-fix. O fix torna-se a nova âncora.
+ * - Lacunas maiores que `lacuna_max_ms` encerram o segmento, exceto quando o rastreador
+ *   reaparece parado no mesmo lugar (por exemplo, desligado na garagem).
+ *
+ * Como a distância é medida entre âncoras, o ruído de posição durante as paradas não a infla.
+ * Fixes mais antigos que o último são ignorados.
+ */
+class TripSegmenter {
+public:
+
+	using Sink = std::function<void(const TripSummary&)>;
+
+	/**
+	 * @struct Stats
+	 * @brief Contadores de segmentação.
+	 */
+	struct Stats {
+		uint64_t viagens;
+		uint64_t paradas;
+		uint64_t fora_de_ordem;
+	};
+
+private:
+
+	enum : uint32_t { NENHUM = 0, VIAGEM = 1, PARADO = 2 };
+
+	/// Estado por rastreador; 48 bytes.
+	struct Estado {
+		int64_t  t_inicio;   ///< Início do segmento atual.
+		int64_t  t_ancora;   ///< Primeiro fix próximo à âncora.
+		int64_t  t_ultimo;   ///< Último fix.
+		int32_t  anc_lat, anc_lon;
+		int32_t  ori_lat, ori_lon; ///< Início da viagem atual.
+		float    distancia;
+		uint32_t estado;
+	};
+
+	double                      raio_m;
+	int64_t              parada_min_ms;
+	int64_t              lacuna_max_ms;
+
+	TrackerTable<Estado>        tabela;
+	Sink                          sink;
+
+	std::atomic<uint64_t>    n_viagens{0};
+	std::atomic<uint64_t>    n_paradas{0};
+	std::atomic<uint64_t> n_fora_ordem{0};
+
+	/**
+	 * @brief Resumo do segmento em curso, encerrado em t_fim.
+	 */
+	static TripSummary
+	summary(
+		uint64_t tracker,
+		const Estado& e,
+		int64_t t_fim
+	){
+
+		TripSummary r;
+		r.tracker = tracker;
+		r.t_ini   = e.t_inicio;
+		r.t_fim   = t_fim;
+		r.lat_fim = e.anc_lat; r.lon_fim = e.anc_lon;
+		if(
+			e.estado == PARADO
+		){
+
+			r.tipo    = TripSummary::Tipo::PARADA;
+			r.lat_ini = e.anc_lat; r.lon_ini = e.anc_lon;
+		}
+		else{
+
+			r.tipo        = TripSummary::Tipo::VIAGEM;
+			r.lat_ini     = e.ori_lat; r.lon_ini = e.ori_lon;
+			r.distancia_m = e.distancia;
+		}
+		return r;
+	}
+
+	static void
+	restart(
+		Estado& e,
+		const CollectorFix& fix
+	){
+
+		e = Estado{};
+		e.estado   = VIAGEM;
+		e.t_inicio = e.t_ancora = e.t_ultimo = fix.t_ms;
+		e.anc_lat  = e.ori_lat = fix.lat_e6;
+		e.anc_lon  = e.ori_lon = fix.lon_e6;
+	}
+
+	/**
+	 * @brief Entrega resumos, descartando viagens sem deslocamento.
+	 */
+	void
+	emit(
+		const TripSummary* resumos,
+		int n,
+		bool emitir
+	){
+
+		for(
+			int i = 0; i < n; i++
+		){
+
+			const TripSummary& r = resumos[i];
+			if( r.tipo == TripSummary::Tipo::VIAGEM && r.distancia_m <= 0 ){ continue; }
+
+			(r.tipo == TripSummary::Tipo::VIAGEM ? n_viagens : n_paradas).fetch_add(1, std::memory_order_relaxed);
+			if( emitir && sink ){ sink(r); }
+		}
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 * @param raio_m_ Raio de permanência que caracteriza uma parada.
+	 * @param parada_min_ms_ Permanência mínima no raio para caracterizar uma parada.
+	 * @param lacuna_max_ms_ Intervalo sem fixes a partir do qual o segmento é encerrado.
+	 * @param capacidade Quantidade de rastreadores esperada.
+	 */
+	explicit TripSegmenter(
+		double raio_m_ = 50,
+		int64_t parada_min_ms_ = 180000,
+		int64_t lacuna_max_ms_ = 600000,
+		std::size_t capacidade = 1 << 16
+	) : raio_m(raio_m_),
+		parada_min_ms(parada_min_ms_),
+		lacuna_max_ms(lacuna_max_ms_),
+		tabela(capacidade) {}
+
+	/**
+	 * @brief Define a função que recebe os resumos. Deve ser chamado antes da ingestão.
+	 * @details
+	 *
+	 * Chamada pelas threads de recepção, fora do lock do rastreador; deve ser thread-safe.
+	 */
+	void on_summary(Sink sink_){ sink = std::move(sink_); }
+
+	/**
+	 * @brief Incorpora um fix.
+	 * @param fix Fix do rastreador.
+	 * @param emitir False durante a reaplicação do WAL, cujos resumos já foram emitidos.
+	 */
+	void
+	apply(
+		const CollectorFix& fix,
+		bool emitir = true
+	){
+
+		TripSummary resumos[2];
+		int         n = 0;
+
+		tabela.update(
+					  fix.tracker,
+					  [&](Estado& e, bool){
+
+						  if( e.estado == NENHUM ){ restart(e, fix); return; }
+						  if( fix.t_ms < e.t_ultimo ){ n_fora_ordem.fetch_add(1, std::memory_order_relaxed); return; }
+
+						  double d = GPSFix::distance_m(e.anc_lat * 1e-6, e.anc_lon * 1e-6, fix.lat(), fix.lon());
+
+						  if(
+							  fix.t_ms - e.t_ultimo > lacuna_max_ms && !(e.estado == PARADO && d <= raio_m)
+						  ){
+
+							  resumos[n++] = summary(fix.tracker, e, e.t_ultimo);
+							  restart(e, fix);
+							  return;
+						  }
+
+						  if(
+							  d <= raio_m
+						  ){
+
+							  if(
+								  e.estado == VIAGEM && fix.t_ms - e.t_ancora >= parada_min_ms
+							  ){
+
+								  resumos[n++] = summary(fix.tracker, e, e.t_ancora);
+								  e.estado   = PARADO;
+								  e.t_inicio = e.t_ancora;
+							  }
+						  }
+						  else{
+
+							  if(
+								  e.estado == PARADO
+							  ){
+
+								  resumos[n++] = summary(fix.tracker, e, e.t_ultimo);
+								  e.estado    = VIAGEM;
+								  e.t_inicio  = e.t_ultimo;
+								  e.ori_lat   = e.anc_lat; e.ori_lon = e.anc_lon;
+								  e.distancia = 0;
+							  }
+
+							  e.distancia += static_cast<float>(d);
+							  e.anc_lat  = fix.lat_e6; e.anc_lon = fix.lon_e6;
+							  e.t_ancora = fix.t_ms;
+						  }
+
+						  e.t_ultimo = fix.t_ms;
+					  }
+					 );
+
+		emit(resumos, n, emitir);
+	}
+
+	/**
+	 * @brief Encerra os segmentos de rastreadores sem fixes há mais de `ocioso_ms`.
+	 * @param agora_ms Instante atual.
+	 * @param ocioso_ms Intervalo sem fixes.
+	 * @return Quantidade de segmentos encerrados.
+	 */
+	std::size_t
+	expire(
+		int64_t agora_ms,
+		int64_t ocioso_ms
+	){
+
+		std::vector<uint64_t> ociosos;
+		tabela.for_each([&](uint64_t chave, const Estado& e){
+
+			if( e.estado != NENHUM && agora_ms - e.t_ultimo > ocioso_ms ){ ociosos.push_back(chave); }
+		});
+
+		std::size_t n = 0;
+		for(
+			uint64_t chave : ociosos
+		){
+
+			TripSummary r;
+			bool encerrado = false;
+			tabela.update(
+						  chave,
+						  [&](Estado& e, bool){
+
+							  if( e.estado == NENHUM || agora_ms - e.t_ultimo <= ocioso_ms ){ return; }
+							  r = summary(chave, e, e.t_ultimo);
+							  e.estado  = NENHUM;
+							  encerrado = true;
+						  }
+						 );
+			if( encerrado ){ emit(&r, 1, true); n++; }
+		}
+		return n;
+	}
+
+	/**
+	 * @brief Segmento em curso de um rastreador, como resumo parcial até o último fix.
+	 * @return False caso o rastreador não tenha segmento em curso.
+	 */
+	bool
+	current(
+		uint64_t tracker,
+		TripSummary& atual
+	){
+
+		Estado e;
+		if( !tabela.read(tracker, e) || e.estado == NENHUM ){ return false; }
+		atual = summary(tracker, e, e.t_ultimo);
+		return true;
+	}
+
+	/**
+	 * @brief Obtém os contadores de segmentação.
+	 */
+	Stats
+	stats() const {
+
+		Stats s;
+		s.viagens       = n_viagens.load(std::memory_order_relaxed);
+		s.paradas       = n_paradas.load(std::memory_order_relaxed);
+		s.fora_de_ordem = n_fora_ordem.load(std::memory_order_relaxed);
+		return s;
+	}
+};
+
+#endif // TRIPSEGMENTER_HPP
@@ -0,0 +1,3660 @@
+/**
+ * @file bench.cpp
+ * @brief Responsável por medir o desempenho dos componentes da aplicação.
+ * @details 
+ * Cada benchmark é uma função registrada na tabela de main(). Sem argumentos,
+ * todos são executados; caso contrário, apenas os nomes informados.
+ * 
+ * Exemplo: `make bench BENCH="bus"`.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+
+#include "GPSBus.hpp"
+#include "GPSLoop.hpp"
+#include "GPSTrack.hpp"
+#include "GPSCollector.hpp"
+#include "ConvoyDetector.hpp"
+#include "CsvDecoder.hpp"
+#include "GeofenceEvaluator.hpp"
+#include "HeatmapTiles.hpp"
+#include "MapMatcher.hpp"
+#include "ReorderBuffer.hpp"
+#include "RuleEngine.hpp"
+#include "ScanEngine.hpp"
+#include "SpatioTemporalIndex.hpp"
+#include "SubscriptionServer.hpp"
+#include "TrackExporter.hpp"
+#include "TripSegmenter.hpp"
+
+/// Contador global de chamadas a operator new, para provar ausência de alocações.
+static std::atomic<uint64_t> n_alocacoes{0};
+
+void*
+operator new(
+	std::size_t n
+){
+
+	n_alocacoes.fetch_add(1, std::memory_order_relaxed);
+	if( void* p = std::malloc(n ? n : 1) ){ return p; }
+	throw std::bad_alloc();
+}
+
+// O GCC não reconhece o par malloc/free da substituição acima quando a inlina em contêineres
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+/**
+ * @brief Relógio monotônico em nanossegundos.
+ */
+static double
+agora_ns(){
+
+	using namespace std::chrono;
+	return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Mede o custo de publish() no GPSBus conforme cresce o número de assinantes.
+ * @details
+ *
+ * publish() apenas enfileira; os callbacks rodam na thread de entrega. A vazão pedida
+ * aqui excede a da entrega com muitos assinantes, de modo que parte dos fixes é descartada
+ * da fila: o custo de publish() não deve crescer com eles. Ao final, um callback lento
+ * não pode atrasar publish().
+ */
+static void
+bench_bus(){
+
+	const int ITERACOES = 200000;
+
+	std::printf("%-12s %14s %14s\n", "assinantes", "ns/publish", "descartados");
+	for(
+		int n : {0, 1, 4, 16, 64, 256, 1024}
+	){
+
+		GPSBus bus;
+		volatile double acumulado = 0;
+		for( int i = 0; i < n; i++ ){ bus.subscribe([&acumulado](const GPSFix& f){ acumulado = acumulado + f.lat; }); }
+		bus.init();
+
+		GPSFix fix;
+		fix.lat = -22.9559; fix.lon = -43.1659; fix.alt = 760.0;
+
+		double t0 = agora_ns();
+		for(
+			int i = 0; i < ITERACOES; i++
+		){
+
+			fix.seq = i;
+			bus.publish(fix);
+		}
+		double dt = (agora_ns() - t0) / ITERACOES;
+		bus.stop();
+
+		std::printf("%-12d %14.1f %14llu\n", n, dt, static_cast<unsigned long long>(bus.dropped()));
+	}
+
+	// Callback que bloqueia por 50 ms: publish() continua imediato, e a fila absorve o atraso
+	GPSBus bus(64);
+	std::atomic<int> entregues{0};
+	bus.subscribe([&](const GPSFix&){ std::this_thread::sleep_for(std::chrono::milliseconds(50)); entregues++; });
+	bus.init();
+
+	GPSFix fix;
+	double pior = 0;
+	for(
+		int i = 0; i < 10; i++
+	){
+
+		fix.seq = i;
+		double t = agora_ns();
+		bus.publish(fix);
+		pior = std::max(pior, agora_ns() - t);
+	}
+	bus.stop();
+	std::printf("callback de 50 ms: pior publish %.1f us, %d/10 entregues\n", pior / 1e3, entregues.load());
+	std::cout << "verificacao (callback lento): " << (pior < 10e6 && entregues == 10 ? "ok" : "FALHOU") << std::endl;
+}
+
+#ifdef GPSLOOP_DISPONIVEL
+/**
+ * @brief Tempo de CPU (usuário + sistema) consumido pelo processo, em milissegundos.
+ */
+static double
+cpu_ms(){
+
+	rusage uso{};
+	::getrusage(RUSAGE_SELF, &uso);
+	return (uso.ru_utime.tv_sec + uso.ru_stime.tv_sec) * 1e3 + (uso.ru_utime.tv_usec + uso.ru_stime.tv_usec) / 1e3;
+}
+
+/**
+ * @brief Compara N atividades periódicas (flush, heartbeat, watchdog...) em threads e em corrotinas.
+ * @details
+ * 
+ * Cada atividade acorda a cada 10 ms durante 1 s. Medimos o CPU consumido e o atraso
+ * médio de despertar em relação ao prazo.
+ */
+static void
+bench_loop_timers(){
+
+	using namespace std::chrono;
+	const auto PERIODO = milliseconds(10);
+	const auto DURACAO = milliseconds(1000);
+
+	std::printf("%-10s %-12s %12s %16s\n", "atividades", "desenho", "cpu (ms)", "atraso (us)");
+	for(
+		int n : {4, 64, 512}
+	){
+
+		// Threads dedicadas
+		{
+			// Somas por thread, combinadas depois do join
+			std::vector<double> atrasos(n, 0);
+			std::vector<long>   contagens(n, 0);
+			double c0 = cpu_ms();
+			auto   fim = steady_clock::now() + DURACAO;
+
+			std::vector<std::thread> threads;
+			for(
+				int i = 0; i < n; i++
+			){
+
+				threads.emplace_back([&, i]{
+
+					double a = 0;
+					long   k = 0;
+					auto prazo = steady_clock::now();
+					while( (prazo += PERIODO) < fim ){
+
+						std::this_thread::sleep_until(prazo);
+						a += duration<double, std::micro>(steady_clock::now() - prazo).count();
+						k++;
+					}
+					atrasos[i]   = a;
+					contagens[i] = k;
+				});
+			}
+			for( auto& t : threads ){ t.join(); }
+
+			double atraso_total = std::accumulate(atrasos.begin(), atrasos.end(), 0.0);
+			long   despertares  = std::accumulate(contagens.begin(), contagens.end(), 0L);
+			std::printf("%-10d %-12s %12.1f %16.1f\n", n, "threads", cpu_ms() - c0, atraso_total / std::max(1L, despertares));
+		}
+
+		// Corrotinas em um único GPSLoop
+		{
+			double atraso_total = 0;
+			long   despertares  = 0;
+			double c0 = cpu_ms();
+			auto   fim = steady_clock::now() + DURACAO;
+
+			GPSLoop ex;
+			auto atividade = [&](GPSLoop& loop) -> GPSLoop::Task {
+
+				auto prazo = GPSLoop::Clock::now();
+				while( (prazo += PERIODO) < fim ){
+
+					co_await loop.sleep_until(prazo);
+					atraso_total += duration<double, std::micro>(steady_clock::now() - prazo).count();
+					despertares++;
+				}
+			};
+			for( int i = 0; i < n; i++ ){ atividade(ex); }
+			ex.run();
+
+			std::printf("%-10d %-12s %12.1f %16.1f\n", n, "corrotinas", cpu_ms() - c0, atraso_total / std::max(1L, despertares));
+		}
+	}
+}
+
+/**
+ * @brief Compara o repasse de bytes por N pipes consumidos por threads e por corrotinas.
+ * @details
+ * 
+ * Simula N fontes de I/O (serial, sockets de controle...). Uma thread produtora escreve
+ * um byte em cada pipe, em rodízio, e mede-se o tempo até todos serem consumidos.
+ */
+static void
+bench_loop_pipes(){
+
+	const int RODADAS = 2000;
+
+	std::printf("%-10s %-12s %14s\n", "atividades", "desenho", "ns/evento");
+	for(
+		int n : {4, 64, 256}
+	){
+
+		for(
+			int modo = 0; modo < 2; modo++
+		){
+
+			std::vector<int> leitura(n), escrita(n);
+			for(
+				int i = 0; i < n; i++
+			){
+
+				int p[2];
+				if( ::pipe(p) != 0 ){ std::cout << "Erro ao criar pipe" << std::endl; return; }
+				leitura[i] = p[0]; escrita[i] = p[1];
+			}
+
+			std::atomic<long> consumidos{0};
+			const long TOTAL = static_cast<long>(n) * RODADAS;
+
+			auto produtor = [&]{
+
+				char c = 'x';
+				for( int r = 0; r < RODADAS; r++ ){ for( int i = 0; i < n; i++ ){ (void)!::write(escrita[i], &c, 1); } }
+			};
+
+			double t0 = agora_ns();
+			if(
+				modo == 0
+			){
+
+				std::vector<std::thread> threads;
+				for(
+					int i = 0; i < n; i++
+				){
+
+					threads.emplace_back([&, i]{
+
+						char buffer[64];
+						long lidos = 0;
+						while( lidos < RODADAS ){
+
+							ssize_t k = ::read(leitura[i], buffer, sizeof(buffer));
+							if( k <= 0 ){ break; }
+							lidos += k;
+						}
+						consumidos += lidos;
+					});
+				}
+				std::thread p(produtor);
+				p.join();
+				for( auto& t : threads ){ t.join(); }
+			}
+			else{
+
+				GPSLoop ex;
+				for( int i = 0; i < n; i++ ){ ::fcntl(leitura[i], F_SETFL, O_NONBLOCK); }
+
+				auto consumidor = [&](GPSLoop& loop, int fd) -> GPSLoop::Task {
+
+					char buffer[64];
+					long lidos = 0;
+					while( lidos < RODADAS ){
+
+						co_await loop.readable(fd);
+						ssize_t k;
+						while( (k = ::read(fd, buffer, sizeof(buffer))) > 0 ){ lidos += k; }
+					}
+					consumidos += lidos;
+					loop.forget(fd);
+				};
+				for( int i = 0; i < n; i++ ){ consumidor(ex, leitura[i]); }
+
+				std::thread p(produtor);
+				ex.run();
+				p.join();
+			}
+			double dt = (agora_ns() - t0) / TOTAL;
+
+			for( int i = 0; i < n; i++ ){ ::close(leitura[i]); ::close(escrita[i]); }
+			if( consumidos != TOTAL ){ std::cout << "\033[1;31mEventos perdidos\033[0m" << std::endl; }
+
+			std::printf("%-10d %-12s %14.1f\n", n, modo == 0 ? "threads" : "corrotinas", dt);
+		}
+	}
+}
+#endif // GPSLOOP_DISPONIVEL
+
+/**
+ * @brief Gera sentenças GGA completas, com checksum, em posições variadas.
+ */
+static std::vector<std::string>
+gerar_gga(
+	int quantidade
+){
+
+	std::vector<std::string> linhas;
+	for(
+		int i = 0; i < quantidade; i++
+	){
+
+		char corpo[128];
+		std::snprintf(corpo, sizeof(corpo), "GPGGA,%02d%02d%02d.00,22%07.4f,S,043%07.4f,W,1,08,0.9,%.1f,M,0.0,M,,",
+					  (i / 3600) % 24, (i / 60) % 60, i % 60, 57.0 + (i % 100) * 0.0137, 9.0 + (i % 77) * 0.0211, 700.0 + i % 90);
+
+		unsigned char paridade = 0;
+		for( const char* c = corpo; *c; c++ ){ paridade ^= static_cast<unsigned char>(*c); }
+
+		char linha[160];
+		std::snprintf(linha, sizeof(linha), "$%s*%02X", corpo, paridade);
+		linhas.emplace_back(linha);
+	}
+	return linhas;
+}
+
+/**
+ * @brief Compara a interpretação de sentenças com e sem a Arena da época.
+ * @details
+ * 
+ * Cada época reproduz o caminho da worker: fatiar, interpretar, gerar CSV e converter
+ * para GPSFix. Após o aquecimento, o caminho com Arena deve realizar zero alocações.
+ */
+static void
+bench_arena(){
+
+	const int EPOCAS = 200000;
+	auto linhas = gerar_gga(1024);
+
+	std::printf("%-10s %14s %18s\n", "caminho", "ns/epoca", "alocacoes/epoca");
+
+	// Caminho original: std::vector<std::string> e std::string a cada época
+	{
+		GPSTrack::GPSData dados;
+		GPSFix fix;
+		double t0 = agora_ns();
+		uint64_t a0 = n_alocacoes.load();
+		for(
+			int i = 0; i < EPOCAS; i++
+		){
+
+			dados.parsing(0, GPSTrack::split(linhas[i % linhas.size()]));
+			std::string csv = dados.to_csv();
+			dados.to_fix(fix);
+		}
+		double dt = (agora_ns() - t0) / EPOCAS;
+		std::printf("%-10s %14.1f %18.2f\n", "vector", dt, double(n_alocacoes.load() - a0) / EPOCAS);
+	}
+
+	// Caminho com Arena: fatias em ArenaVector, strings reaproveitadas
+	{
+		GPSTrack::GPSData dados;
+		Arena arena(1024);
+		std::string csv;
+		GPSFix fix;
+
+		for(
+			int i = 0; i < 1024; i++
+		){ // Aquecimento: estabiliza capacidades
+
+			arena.reset();
+			ArenaVector<std::string_view> campos{ArenaAllocator<std::string_view>(arena)};
+			GPSTrack::split(linhas[i % linhas.size()], campos);
+			dados.parsing(0, campos);
+			dados.to_csv(csv);
+		}
+
+		double t0 = agora_ns();
+		uint64_t a0 = n_alocacoes.load();
+		for(
+			int i = 0; i < EPOCAS; i++
+		){
+
+			arena.reset();
+			ArenaVector<std::string_view> campos{ArenaAllocator<std::string_view>(arena)};
+			campos.reserve(16);
+			GPSTrack::split(linhas[i % linhas.size()], campos);
+			dados.parsing(0, campos);
+			dados.to_csv(csv);
+			dados.to_fix(fix);
+		}
+		double dt = (agora_ns() - t0) / EPOCAS;
+		uint64_t alocacoes = n_alocacoes.load() - a0;
+		std::printf("%-10s %14.1f %18.2f\n", "arena", dt, double(alocacoes) / EPOCAS);
+
+		if( alocacoes != 0 ){ std::cout << "\033[1;31mArena alocou " << alocacoes << " vezes em regime permanente\033[0m" << std::endl; }
+		else{ std::cout << "\033[1;32mZero alocações em regime permanente (" << arena.capacity() << " bytes de arena)\033[0m" << std::endl; }
+	}
+}
+
+/**
+ * @brief Tráfego simulado de uma frota: uma linha CSV, como GPSTrack::GPSData::to_csv(), por rastreador.
+ * @details
+ * 
+ * Os rastreadores partem das vizinhanças da posição padrão do GPSSim (IME) e se deslocam
+ * alguns metros por rodada. As linhas ficam em um único buffer para não pesar na memória.
+ */
+struct TrafegoFrota {
+	std::vector<char>          texto;
+	std::vector<uint32_t>   inicio; ///< inicio[i] .. inicio[i + 1] é a linha do rastreador i.
+
+	TrafegoFrota(
+		std::size_t n_rastreadores,
+		int rodada
+	){
+
+		texto.reserve(n_rastreadores * 40);
+		inicio.reserve(n_rastreadores + 1);
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			double lat = -22.9559 + ((i * 7919) % 20000) * 1e-4 + rodada * 1e-5;
+			double lon = -43.1659 + ((i * 104729) % 20000) * 1e-4 + rodada * 1e-5;
+			int    seg = 43200 + rodada;
+
+			char linha[64];
+			int n = std::snprintf(linha, sizeof(linha), "%02d%02d%02d.00,%f,%f,%.1f\n",
+								  seg / 3600, (seg / 60) % 60, seg % 60, lat, lon, 760.0 + i % 50);
+
+			inicio.push_back(static_cast<uint32_t>(texto.size()));
+			texto.insert(texto.end(), linha, linha + n);
+		}
+		inicio.push_back(static_cast<uint32_t>(texto.size()));
+	}
+
+	std::string_view
+	line(
+		std::size_t i
+	) const { return std::string_view(texto.data() + inicio[i], inicio[i + 1] - inicio[i] - 1); }
+
+	std::size_t size() const { return inicio.size() - 1; }
+};
+
+/**
+ * @brief Executa uma função em N threads, cada uma recebendo seu índice, e mede o tempo.
+ * @return Segundos decorridos.
+ */
+template <typename F>
+static double
+em_paralelo(
+	int n_threads,
+	F&& fn
+){
+
+	double t0 = agora_ns();
+	std::vector<std::thread> threads;
+	for( int t = 0; t < n_threads; t++ ){ threads.emplace_back(fn, t); }
+	for( auto& t : threads ){ t.join(); }
+	return (agora_ns() - t0) / 1e9;
+}
+
+/**
+ * @brief Mede a TrackerTable do coletor com milhões de rastreadores simulados.
+ * @details
+ * 
+ * Fases: inserção (primeiro fix), atualizações (rodadas seguintes), leituras sem lock
+ * e leituras concorrentes com atualizações. Cada fix é interpretado a partir da linha CSV.
+ * O número de rastreadores pode ser alterado por GPSTRACK_BENCH_TRACKERS.
+ */
+static void
+bench_tracker_table(){
+
+	std::size_t n_rastreadores = 1000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+	const int64_t RECV_MS = 1700000000000LL;
+
+	std::cout << n_rastreadores << " rastreadores, " << n_threads << " threads" << std::endl;
+	std::printf("%-22s %14s\n", "fase", "Mops/s");
+
+	GPSCollector coletor(0, 1, n_rastreadores);
+
+	auto ingerir = [&](const TrafegoFrota& trafego){
+
+		return em_paralelo(n_threads, [&](int t){
+
+			for(
+				std::size_t i = t; i < trafego.size(); i += n_threads
+			){
+
+				CollectorFix fix;
+				fix.tracker = i + 1;
+				if( CollectorFix::parse_csv(trafego.line(i), RECV_MS, fix) ){ coletor.ingest(fix); }
+			}
+		});
+	};
+
+	TrafegoFrota rodada0(n_rastreadores, 0);
+	double dt = ingerir(rodada0);
+	std::printf("%-22s %14.2f\n", "insercao", n_rastreadores / dt / 1e6);
+
+	for(
+		int r = 1; r <= 2; r++
+	){
+
+		TrafegoFrota rodada(n_rastreadores, r);
+		dt = ingerir(rodada);
+		std::printf("%-22s %14.2f\n", ("atualizacao " + std::to_string(r)).c_str(), n_rastreadores / dt / 1e6);
+	}
+
+	std::atomic<uint64_t> encontrados{0};
+	auto ler = [&](int t){
+
+		uint64_t x = 0x9e3779b97f4a7c15ULL * (t + 1), achados = 0;
+		TrackerState estado;
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+			achados += coletor.tracker_state(1 + x % n_rastreadores, estado);
+		}
+		encontrados += achados;
+	};
+
+	dt = em_paralelo(n_threads, ler);
+	std::printf("%-22s %14.2f\n", "leitura", double(n_rastreadores) * n_threads / dt / 1e6);
+
+	TrafegoFrota rodada3(n_rastreadores, 3);
+	dt = em_paralelo(n_threads, [&](int t){
+
+		if( t % 2 == 0 ){ ler(t); return; }
+		for(
+			std::size_t i = t / 2; i < rodada3.size(); i += (n_threads / 2)
+		){
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			if( CollectorFix::parse_csv(rodada3.line(i), RECV_MS, fix) ){ coletor.ingest(fix); }
+		}
+	});
+	std::printf("%-22s %14.2f\n", "leitura+atualizacao", double(n_rastreadores) * n_threads / dt / 1e6);
+
+	GPSCollector::Stats s = coletor.stats();
+	std::cout << "rastreadores na tabela: " << s.rastreadores << " (capacidade " << coletor.trackers().capacity()
+			  << "), tabela cheia: " << s.tabela_cheia << std::endl;
+}
+
+/**
+ * @brief Remove um diretório temporário de benchmark e seu conteúdo, recursivamente.
+ */
+static void
+remover_diretorio(
+	const std::string& dir
+){
+
+	if(
+		DIR* d = ::opendir(dir.c_str())
+	){
+
+		while(
+			dirent* ent = ::readdir(d)
+		){
+
+			if( ent->d_name[0] == '.' ){ continue; }
+			std::string caminho = dir + "/" + ent->d_name;
+			if( ::unlink(caminho.c_str()) != 0 ){ remover_diretorio(caminho); }
+		}
+		::closedir(d);
+	}
+	::rmdir(dir.c_str());
+}
+
+/**
+ * @brief Mede vazão e latência do WAL do coletor em função da janela de group commit.
+ * @details
+ * 
+ * Várias threads, como as de recepção, gravam lotes de 64 fixes. No modo SINCRONA cada
+ * thread aguarda a durabilidade do seu lote; a latência é medida de append() até o retorno
+ * de wait_durable(). Ao final, mede a recuperação do log gravado.
+ */
+static void
+bench_wal(){
+
+	const int    n_threads = 4;
+	const int    LOTE      = 64;
+	const double DURACAO_S = 1.0;
+
+	struct Caso { const char* nome; CollectorWAL::Durabilidade modo; int janela_us; };
+	const Caso casos[] = {
+		{ "nenhuma",          CollectorWAL::Durabilidade::NENHUMA,     0 },
+		{ "lote 1000us",      CollectorWAL::Durabilidade::LOTE,     1000 },
+		{ "sincrona 0us",     CollectorWAL::Durabilidade::SINCRONA,    0 },
+		{ "sincrona 100us",   CollectorWAL::Durabilidade::SINCRONA,  100 },
+		{ "sincrona 500us",   CollectorWAL::Durabilidade::SINCRONA,  500 },
+		{ "sincrona 1000us",  CollectorWAL::Durabilidade::SINCRONA, 1000 },
+		{ "sincrona 5000us",  CollectorWAL::Durabilidade::SINCRONA, 5000 },
+	};
+
+	std::cout << n_threads << " threads, lotes de " << LOTE << " fixes" << std::endl;
+	std::printf("%-18s %12s %10s %12s %12s %12s\n", "modo", "Kfixes/s", "gravacoes", "fixes/grav", "p50 (us)", "p99 (us)");
+
+	for(
+		const Caso& caso : casos
+	){
+
+		char modelo[] = "/tmp/gpstrack_wal_XXXXXX";
+		std::string dir = ::mkdtemp(modelo);
+
+		std::vector<std::vector<double>> latencias(n_threads);
+		std::atomic<uint64_t> gravados{0};
+		CollectorWAL::Stats st;
+		double dt;
+		{
+			CollectorWAL wal(dir, caso.modo, std::chrono::microseconds(caso.janela_us));
+
+			dt = em_paralelo(n_threads, [&](int t){
+
+				CollectorFix lote[LOTE];
+				for( int i = 0; i < LOTE; i++ ){ lote[i].tracker = t * LOTE + i + 1; lote[i].lat_e6 = -22955900 + i; }
+
+				double fim = agora_ns() + DURACAO_S * 1e9;
+				uint64_t n = 0;
+				while(
+					agora_ns() < fim
+				){
+
+					double t0 = agora_ns();
+					uint64_t lsn = wal.append(lote, LOTE);
+					if( wal.synchronous() ){ wal.wait_durable(lsn); }
+					latencias[t].push_back((agora_ns() - t0) / 1e3);
+					n += LOTE;
+				}
+				gravados += n;
+			});
+			st = wal.stats();
+		}
+
+		std::vector<double> todas;
+		for( auto& l : latencias ){ todas.insert(todas.end(), l.begin(), l.end()); }
+		std::sort(todas.begin(), todas.end());
+
+		std::printf("%-18s %12.1f %10llu %12.1f %12.1f %12.1f\n", caso.nome, gravados / dt / 1e3,
+					static_cast<unsigned long long>(st.gravacoes), double(gravados) / std::max<uint64_t>(st.gravacoes, 1),
+					todas[todas.size() / 2], todas[todas.size() * 99 / 100]);
+
+		if(
+			&caso == &casos[sizeof(casos) / sizeof(casos[0]) - 1]
+		){
+
+			uint64_t recuperados = 0;
+			double t0 = agora_ns();
+			CollectorWAL::replay(dir, 1, [&](const CollectorFix*, std::size_t n, uint64_t){ recuperados += n; });
+			double t_rec = (agora_ns() - t0) / 1e9;
+			std::printf("recuperacao: %llu fixes em %.3f s (%.1f Mfixes/s)\n", static_cast<unsigned long long>(recuperados), t_rec, recuperados / t_rec / 1e6);
+		}
+
+		remover_diretorio(dir);
+	}
+}
+
+/**
+ * @brief Mede compressão e decodificação do histórico com meses de dados simulados da frota.
+ * @details
+ * 
+ * Cada rastreador alterna entre viagens (velocidade e rumo variando suavemente) e paradas,
+ * com ruído de alguns metros na posição e período de 30 s com jitter de centésimos,
+ * como as linhas de GPSTrack. O número de rastreadores pode ser alterado por
+ * GPSTRACK_BENCH_TRACKERS e o de dias por GPSTRACK_BENCH_DIAS.
+ */
+static void
+bench_history(){
+
+	std::size_t n_rastreadores = 100;
+	int         n_dias         = 90;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_DIAS") ){ n_dias = std::atoi(env); }
+
+	const int64_t PERIODO_MS = 30000;
+	const int64_t INICIO_MS  = 1700000000000LL;
+	const int64_t passos     = n_dias * 86400000LL / PERIODO_MS;
+
+	struct Veiculo { double lat, lon, alt, rumo, vel; int restante; bool parado; int64_t t_ms; };
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	std::vector<Veiculo> frota(n_rastreadores);
+	for( std::size_t i = 0; i < n_rastreadores; i++ ){ frota[i] = { -22.9559 + aleatorio() * 0.5, -43.1659 + aleatorio() * 0.5, 760, aleatorio() * 6.28, 0, 0, true, INICIO_MS }; }
+
+	HistoryStore historico(1024);
+	std::vector<CollectorFix> originais; ///< Fixes do rastreador 1, para verificar a decodificação.
+	uint64_t bytes_csv = 0;
+
+	double t0 = agora_ns();
+	for(
+		int64_t p = 0; p < passos; p++
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			Veiculo& v = frota[i];
+			if(
+				--v.restante <= 0
+			){
+
+				v.parado   = !v.parado;
+				v.restante = v.parado ? 20 + static_cast<int>(aleatorio() * 600) : 10 + static_cast<int>(aleatorio() * 120);
+				v.vel      = v.parado ? 0 : 8 + aleatorio() * 17;
+			}
+			if(
+				!v.parado
+			){
+
+				v.rumo += (aleatorio() - 0.5) * 0.2;
+				double d = v.vel * PERIODO_MS / 1000.0;
+				v.lat += d * std::cos(v.rumo) / 111320.0;
+				v.lon += d * std::sin(v.rumo) / 102000.0;
+				v.alt += (aleatorio() - 0.5) * 2;
+			}
+			v.t_ms += PERIODO_MS + static_cast<int64_t>(aleatorio() * 3) * 10 - 10;
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			fix.t_ms    = v.t_ms;
+			fix.lat_e6  = static_cast<int32_t>(std::llround((v.lat + (aleatorio() - 0.5) * 4e-5) * 1e6));
+			fix.lon_e6  = static_cast<int32_t>(std::llround((v.lon + (aleatorio() - 0.5) * 4e-5) * 1e6));
+			fix.alt_dm  = static_cast<int32_t>(std::llround((v.alt + (aleatorio() - 0.5)) * 10));
+			historico.append(fix);
+			if( i == 0 ){ originais.push_back(fix); }
+
+			bytes_csv += 38; // hhmmss.ss,-dd.dddddd,-ddd.dddddd,ddd.d\n
+		}
+	}
+	historico.seal_all();
+	double t_cod = (agora_ns() - t0) / 1e9;
+
+	HistoryStore::Stats st = historico.stats();
+	std::cout << n_rastreadores << " rastreadores, " << n_dias << " dias, " << st.fixes << " fixes, " << st.blocos << " blocos" << std::endl;
+	std::printf("%-28s %12.2f\n", "bytes/fix (CSV)", double(bytes_csv) / st.fixes);
+	std::printf("%-28s %12.2f\n", "bytes/fix (CollectorFix)", double(sizeof(CollectorFix)));
+	std::printf("%-28s %12.2f\n", "bytes/fix (comprimido)", double(st.bytes) / st.fixes);
+	std::printf("%-28s %12.2f\n", "codificacao (Mfixes/s)", st.fixes / t_cod / 1e6);
+
+	std::vector<HistoryStore::Bloco> blocos;
+	historico.for_each_block([&](const HistoryStore::Bloco& b){ blocos.push_back(b); });
+
+	std::atomic<uint64_t> soma{0};
+	t0 = agora_ns();
+	for(
+		const auto& b : blocos
+	){
+
+		int64_t s = 0;
+		b->decode([&](const CollectorFix& fix){ s += fix.lat_e6; });
+		soma += s;
+	}
+	double t_dec = (agora_ns() - t0) / 1e9;
+	std::printf("%-28s %12.2f\n", "decodificacao (Mfixes/s)", st.fixes / t_dec / 1e6);
+
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+	t_dec = em_paralelo(n_threads, [&](int t){
+
+		int64_t s = 0;
+		for( std::size_t i = t; i < blocos.size(); i += n_threads ){ blocos[i]->decode([&](const CollectorFix& fix){ s += fix.lat_e6; }); }
+		soma += s;
+	});
+	std::printf("%-28s %12.2f\n", ("decodificacao " + std::to_string(n_threads) + "T (Mfixes/s)").c_str(), st.fixes / t_dec / 1e6);
+
+	// Acesso aleatório: uma hora de um rastreador em um instante qualquer
+	const int N_CONSULTAS = 10000;
+	uint64_t entregues = 0;
+	t0 = agora_ns();
+	for(
+		int c = 0; c < N_CONSULTAS; c++
+	){
+
+		uint64_t tracker = 1 + static_cast<uint64_t>(aleatorio() * n_rastreadores);
+		int64_t  ini     = INICIO_MS + static_cast<int64_t>(aleatorio() * (passos * PERIODO_MS - 3600000));
+		entregues += historico.query(tracker, ini, ini + 3600000, [](const CollectorFix&){});
+	}
+	double t_q = (agora_ns() - t0) / 1e9;
+	std::printf("%-28s %12.2f (%.1f fixes/consulta)\n", "consulta 1h (us)", t_q / N_CONSULTAS * 1e6, double(entregues) / N_CONSULTAS);
+
+	// Verificação: a decodificação reproduz exatamente os fixes do rastreador 1
+	std::size_t iguais = 0;
+	historico.query(1, INT64_MIN, INT64_MAX, [&](const CollectorFix& fix){
+
+		const CollectorFix& o = originais[std::min(iguais, originais.size() - 1)];
+		if( fix.t_ms == o.t_ms && fix.lat_e6 == o.lat_e6 && fix.lon_e6 == o.lon_e6 && fix.alt_dm == o.alt_dm ){ iguais++; }
+	});
+	std::cout << "verificacao: " << (iguais == originais.size() ? "ok" : "FALHA") << " (soma " << soma.load() % 1000 << ")" << std::endl;
+}
+
+/**
+ * @brief Mede consultas por resolução (query_lod) contra consultas completas.
+ * @details
+ * 
+ * Um mês de fixes a 1 Hz por rastreador (GPSTRACK_BENCH_TRACKERS, 4 por padrão), com
+ * viagens e paradas como em bench_history. Para intervalos de uma hora a um mês, compara
+ * latência e pontos entregues com limite de 2000 pontos. O erro é a maior distância de um
+ * fix à poligonal entregue, comparada com a amostragem uniforme de mesma quantidade.
+ */
+static void
+bench_lod(){
+
+	std::size_t n_rastreadores = 4;
+	int         n_dias         = 30;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_DIAS") ){ n_dias = std::atoi(env); }
+
+	const int64_t PERIODO_MS = 1000;
+	const int64_t INICIO_MS  = 1700000000000LL;
+	const int64_t passos     = n_dias * 86400000LL / PERIODO_MS;
+	const std::size_t MAX_PONTOS = 2000;
+
+	struct Veiculo { double lat, lon, rumo, vel; int restante; bool parado; };
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	std::vector<Veiculo> frota(n_rastreadores);
+	for( std::size_t i = 0; i < n_rastreadores; i++ ){ frota[i] = { -22.9559 + aleatorio() * 0.5, -43.1659 + aleatorio() * 0.5, aleatorio() * 6.28, 0, 0, true }; }
+
+	HistoryStore historico(1024);
+	double t0 = agora_ns();
+	for(
+		int64_t p = 0; p < passos; p++
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			Veiculo& v = frota[i];
+			if(
+				--v.restante <= 0
+			){
+
+				v.parado   = !v.parado;
+				v.restante = v.parado ? 600 + static_cast<int>(aleatorio() * 18000) : 300 + static_cast<int>(aleatorio() * 3600);
+				v.vel      = v.parado ? 0 : 8 + aleatorio() * 17;
+			}
+			if(
+				!v.parado
+			){
+
+				v.rumo += (aleatorio() - 0.5) * 0.05;
+				double d = v.vel * PERIODO_MS / 1000.0;
+				v.lat += d * std::cos(v.rumo) / 111320.0;
+				v.lon += d * std::sin(v.rumo) / 102000.0;
+			}
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			fix.t_ms    = INICIO_MS + p * PERIODO_MS;
+			fix.lat_e6  = static_cast<int32_t>(std::llround((v.lat + (aleatorio() - 0.5) * 4e-5) * 1e6));
+			fix.lon_e6  = static_cast<int32_t>(std::llround((v.lon + (aleatorio() - 0.5) * 4e-5) * 1e6));
+			historico.append(fix);
+		}
+	}
+	double t_ing = (agora_ns() - t0) / 1e9;
+
+	HistoryStore::Stats st = historico.stats();
+	std::cout << n_rastreadores << " rastreadores, " << n_dias << " dias a 1 Hz, " << st.fixes << " fixes" << std::endl;
+	std::printf("%-28s %12.2f\n", "ingestao (Mfixes/s)", st.fixes / t_ing / 1e6);
+	std::printf("%-28s %12.2f\n", "bytes/fix (comprimido)", double(st.bytes) / st.fixes);
+	std::printf("%-28s %12.2f\n", "bytes/fix (piramide)", double(st.bytes_lod) / st.fixes);
+
+	// Maior distância, em metros, de um fix à poligonal dos pontos (ordenados por tempo)
+	auto erro_m = [](const std::vector<CollectorFix>& fixes, const std::vector<HistoryStore::Ponto>& pts){
+
+		double      pior = 0;
+		std::size_t j    = 0;
+		for(
+			const CollectorFix& f : fixes
+		){
+
+			while( j + 2 < pts.size() && pts[j + 1].t_ms <= f.t_ms ){ j++; }
+			if( pts.size() < 2 ){ break; }
+
+			const HistoryStore::Ponto& a = pts[j];
+			const HistoryStore::Ponto& b = pts[j + 1];
+			double ax = (a.lon_e6 - f.lon_e6) * 0.102, ay = (a.lat_e6 - f.lat_e6) * 0.11132;
+			double bx = (b.lon_e6 - f.lon_e6) * 0.102, by = (b.lat_e6 - f.lat_e6) * 0.11132;
+			double dx = bx - ax, dy = by - ay, l2 = dx * dx + dy * dy;
+			double u  = l2 > 0 ? std::clamp(-(ax * dx + ay * dy) / l2, 0.0, 1.0) : 0;
+			pior = std::max(pior, std::hypot(ax + u * dx, ay + u * dy));
+		}
+		return pior;
+	};
+
+	std::printf("\n%-10s %12s %10s %12s %8s %7s %12s %12s\n", "intervalo", "completa us", "fixes", "lod us", "pontos", "nivel", "erro lod m", "erro unif m");
+
+	struct Intervalo { const char* nome; int64_t ms; } intervalos[] = {
+		{ "1h", 3600000LL }, { "6h", 6 * 3600000LL }, { "1d", 86400000LL }, { "7d", 7 * 86400000LL }, { "30d", 30 * 86400000LL },
+	};
+	for(
+		const Intervalo& iv : intervalos
+	){
+
+		int64_t duracao = std::min<int64_t>(iv.ms, passos * PERIODO_MS);
+		int     n_rep   = iv.ms <= 86400000LL ? 20 : 3;
+
+		double t_cheia = 0, t_lod = 0, pior_lod = 0, pior_unif = 0;
+		std::size_t n_fixes = 0, n_pontos = 0, nivel = 0;
+		for(
+			int r = 0; r < n_rep; r++
+		){
+
+			uint64_t tracker = 1 + r % n_rastreadores;
+			int64_t  ini     = INICIO_MS + static_cast<int64_t>(aleatorio() * (passos * PERIODO_MS - duracao));
+
+			std::vector<CollectorFix> fixes;
+			double t = agora_ns();
+			historico.query(tracker, ini, ini + duracao, [&](const CollectorFix& f){ fixes.push_back(f); });
+			t_cheia += agora_ns() - t;
+
+			std::vector<HistoryStore::Ponto> pts;
+			t = agora_ns();
+			nivel = historico.query_lod(tracker, ini, ini + duracao, MAX_PONTOS, [&](const HistoryStore::Ponto& p){ pts.push_back(p); });
+			t_lod += agora_ns() - t;
+
+			n_fixes  += fixes.size();
+			n_pontos += pts.size();
+			if( nivel == 0 ){ continue; }
+
+			// Amostragem uniforme com a mesma quantidade de pontos, incluindo o último fix
+			std::vector<HistoryStore::Ponto> unif;
+			double passo = double(fixes.size() - 1) / std::max<std::size_t>(pts.size() - 1, 1);
+			for( std::size_t k = 0; k < pts.size(); k++ ){ const CollectorFix& f = fixes[std::min(fixes.size() - 1, static_cast<std::size_t>(std::llround(k * passo)))]; unif.push_back({ f.t_ms, f.lat_e6, f.lon_e6 }); }
+
+			// Apenas os fixes cobertos pelos pontos entregues
+			std::vector<CollectorFix> cobertos;
+			for( const CollectorFix& f : fixes ){ if( f.t_ms >= pts.front().t_ms && f.t_ms <= pts.back().t_ms ){ cobertos.push_back(f); } }
+			pior_lod  = std::max(pior_lod, erro_m(cobertos, pts));
+			pior_unif = std::max(pior_unif, erro_m(fixes, unif));
+		}
+
+		std::printf("%-10s %12.0f %10zu %12.0f %8zu %7zu %12.0f %12.0f\n", iv.nome, t_cheia / n_rep / 1e3, n_fixes / n_rep,
+					t_lod / n_rep / 1e3, n_pontos / n_rep, nivel, pior_lod, pior_unif);
+	}
+}
+
+/**
+ * @brief Mede a geração dos ladrilhos de densidade em lote e incremental.
+ * @details
+ * 
+ * Cada rastreador alterna entre permanências de 10 min a 8 h em um de 500 locais
+ * (depósitos e clientes) e viagens em linha reta até o próximo, com fixes a cada 30 s
+ * e ruído de alguns metros. Os mesmos fixes são acumulados por build() com 1 e N threads
+ * e por apply() em N threads; os três resultados devem coincidir célula a célula.
+ * GPSTRACK_BENCH_TRACKERS e GPSTRACK_BENCH_DIAS alteram a frota e o período.
+ */
+static void
+bench_heatmap(){
+
+	std::size_t n_rastreadores = 1000;
+	int         n_dias         = 7;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_DIAS") ){ n_dias = std::atoi(env); }
+
+	const int64_t PERIODO_MS = 30000;
+	const int64_t INICIO_MS  = 1700000000000LL;
+	const int64_t passos     = n_dias * 86400000LL / PERIODO_MS;
+
+	auto splitmix = [](uint64_t& x){
+
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return ((z ^ (z >> 31)) >> 11) * (1.0 / 9007199254740992.0);
+	};
+
+	std::vector<std::pair<double, double>> locais(500);
+	uint64_t semente = 42;
+	for( auto& l : locais ){ l = { -23.2 + splitmix(semente) * 1.0, -43.8 + splitmix(semente) * 1.0 }; }
+
+	// Fixes de um rastreador, sempre os mesmos para o mesmo índice
+	auto gerar = [&](std::size_t i, auto&& visitar){
+
+		uint64_t x = i * 7919 + 1;
+		std::size_t local    = static_cast<std::size_t>(splitmix(x) * locais.size());
+		double      lat      = locais[local].first, lon = locais[local].second;
+		int         restante = static_cast<int>(splitmix(x) * 960);
+		for(
+			int64_t p = 0; p < passos; p++
+		){
+
+			if(
+				restante > 0
+			){
+
+				restante--;
+				if( restante == 0 ){ local = static_cast<std::size_t>(splitmix(x) * locais.size()); }
+			}
+			else{
+
+				double dy = (locais[local].first - lat) * 111320.0, dx = (locais[local].second - lon) * 102000.0;
+				double d  = std::hypot(dx, dy), passo = 15.0 * PERIODO_MS / 1000.0;
+				if( d <= passo ){ lat = locais[local].first; lon = locais[local].second; restante = 20 + static_cast<int>(splitmix(x) * 940); }
+				else{ lat += dy / d * passo / 111320.0; lon += dx / d * passo / 102000.0; }
+			}
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			fix.t_ms    = INICIO_MS + p * PERIODO_MS;
+			fix.lat_e6  = static_cast<int32_t>(std::llround((lat + (splitmix(x) - 0.5) * 4e-5) * 1e6));
+			fix.lon_e6  = static_cast<int32_t>(std::llround((lon + (splitmix(x) - 0.5) * 4e-5) * 1e6));
+			visitar(fix);
+		}
+	};
+
+	HistoryStore historico(1024, 64, 0);
+	for( std::size_t i = 0; i < n_rastreadores; i++ ){ gerar(i, [&](const CollectorFix& f){ historico.append(f); }); }
+	historico.seal_all();
+	uint64_t n_fixes = historico.stats().fixes;
+	std::cout << n_rastreadores << " rastreadores, " << n_dias << " dias, " << n_fixes << " fixes, zoom 4-14, 64x64 celulas" << std::endl;
+
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+
+	HeatmapTiles um(4, 14, 64, HeatmapTiles::Peso::PERMANENCIA, 50, n_rastreadores * 2);
+	double t0 = agora_ns();
+	um.build(historico, 1);
+	double t_um = (agora_ns() - t0) / 1e9;
+
+	HeatmapTiles varios(4, 14, 64, HeatmapTiles::Peso::PERMANENCIA, 50, n_rastreadores * 2);
+	t0 = agora_ns();
+	varios.build(historico, n_threads);
+	double t_varios = (agora_ns() - t0) / 1e9;
+
+	// Custo da geração dos fixes, descontado da medida de apply()
+	std::atomic<int64_t> soma{0};
+	double t_ger = em_paralelo(n_threads, [&](int t){
+
+		int64_t s = 0;
+		for( std::size_t i = t; i < n_rastreadores; i += n_threads ){ gerar(i, [&](const CollectorFix& f){ s += f.lat_e6; }); }
+		soma += s;
+	});
+
+	HeatmapTiles incremental(4, 14, 64, HeatmapTiles::Peso::PERMANENCIA, 50, n_rastreadores * 2);
+	std::vector<CollectorFix> ultimos(n_rastreadores);
+	double t_inc = em_paralelo(n_threads, [&](int t){
+
+		for( std::size_t i = t; i < n_rastreadores; i += n_threads ){ gerar(i, [&](const CollectorFix& f){ incremental.apply(f); ultimos[i] = f; }); }
+	});
+	t0 = agora_ns();
+	incremental.flush();
+	t_inc += (agora_ns() - t0) / 1e9;
+
+	HeatmapTiles::Stats st = um.stats();
+	std::printf("%-32s %12zu (%.1f MB)\n", "ladrilhos", st.ladrilhos, st.bytes / 1048576.0);
+	std::printf("%-32s %12.2f\n", "build 1T (Mfixes/s)", n_fixes / t_um / 1e6);
+	std::printf("%-32s %12.2f\n", ("build " + std::to_string(n_threads) + "T (Mfixes/s)").c_str(), n_fixes / t_varios / 1e6);
+	std::printf("%-32s %12.2f\n", ("apply " + std::to_string(n_threads) + "T (Mfixes/s)").c_str(), n_fixes / std::max(1e-9, t_inc - t_ger) / 1e6);
+
+	// Verificação: os três caminhos produzem as mesmas células
+	std::size_t divergentes = 0, conferidos = 0;
+	uint64_t    total_s     = 0;
+	std::vector<uint64_t> a, b, c;
+	for(
+		int z = 4; z <= 14; z++
+	){
+
+		for(
+			const auto& l : locais
+		){
+
+			double   lat = l.first * M_PI / 180.0;
+			uint32_t x   = static_cast<uint32_t>((l.second + 180.0) / 360.0 * (1u << z));
+			uint32_t y   = static_cast<uint32_t>((1.0 - std::asinh(std::tan(lat)) / M_PI) / 2.0 * (1u << z));
+			if( !um.tile(z, x, y, a) ){ continue; }
+
+			conferidos++;
+			bool ok = varios.tile(z, x, y, b) && incremental.tile(z, x, y, c) && a == b && a == c;
+			if( !ok ){ divergentes++; }
+		}
+	}
+	for(
+		uint32_t x = 0; x < 16; x++
+	){
+
+		for( uint32_t y = 0; y < 16; y++ ){ if( um.tile(4, x, y, a) ){ for( uint64_t v : a ){ total_s += v / 1000; } } }
+	}
+	std::printf("%-32s %12zu / %zu\n", "ladrilhos divergentes", divergentes, conferidos);
+	std::printf("%-32s %12.1f\n", "permanencia em zoom 4 (h/rastr.)", total_s / 3600.0 / n_rastreadores);
+
+	// Gravação completa e, após uma hora de fixes novos de 1% da frota, apenas dos ladrilhos alterados
+	std::string dir = "/tmp/gpstrack_bench_heatmap";
+	remover_diretorio(dir);
+	t0 = agora_ns();
+	std::size_t gravados = incremental.write(dir);
+	double t_w = (agora_ns() - t0) / 1e9;
+	std::printf("%-32s %12zu em %.2f s\n", "gravacao completa (ladrilhos)", gravados, t_w);
+
+	for(
+		std::size_t i = 0; i < n_rastreadores; i += 100
+	){
+
+		for( int k = 1; k <= 120; k++ ){ CollectorFix g = ultimos[i]; g.t_ms += k * PERIODO_MS; incremental.apply(g); }
+	}
+	t0 = agora_ns();
+	gravados = incremental.write(dir);
+	t_w = (agora_ns() - t0) / 1e9;
+	std::printf("%-32s %12zu em %.3f s\n", "gravacao incremental (ladrilhos)", gravados, t_w);
+	remover_diretorio(dir);
+	std::cout << "(soma " << soma.load() % 1000 << ")" << std::endl;
+}
+
+/**
+ * @brief Mede o ScanEngine com centenas de milhões de fixes simulados.
+ * @details
+ * 
+ * A frota é gerada em janelas de 6 horas, rastreador a rastreador em ordem de Morton,
+ * como ScanEngine::load() organiza os blocos do histórico. Cada consulta é executada com
+ * o laço escalar, com o laço vetorial e com vetorial mais zone maps; as contagens devem
+ * coincidir. A quantidade de fixes pode ser alterada por GPSTRACK_BENCH_FIXES.
+ */
+static void
+bench_scan(){
+
+	std::size_t n_fixes = 150000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_FIXES") ){ n_fixes = std::strtoull(env, nullptr, 10); }
+
+	const std::size_t n_rastreadores = 1000;
+	const int64_t     PERIODO_MS     = 30000;
+	const int64_t     INICIO_MS      = 1700000000000LL;
+	const int         POR_JANELA     = 6 * 3600000 / PERIODO_MS;
+
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	struct Veiculo { double lat, lon, rumo, vel; int restante; };
+	std::vector<Veiculo> frota(n_rastreadores);
+	for( auto& v : frota ){ v = { -23.1 + aleatorio() * 0.5, -43.6 + aleatorio() * 0.5, aleatorio() * 6.28, 0, 0 }; }
+
+	auto morton = [](double lat, double lon){
+
+		uint32_t y = static_cast<uint32_t>((lat + 90) * 1e6) >> 12, xx = static_cast<uint32_t>((lon + 180) * 1e6) >> 13;
+		uint64_t m = 0;
+		for( int i = 0; i < 16; i++ ){ m |= (uint64_t((xx >> i) & 1) << (2 * i)) | (uint64_t((y >> i) & 1) << (2 * i + 1)); }
+		return m;
+	};
+
+	double t0 = agora_ns();
+	SegmentBuilder construtor;
+	std::size_t gerados = 0;
+	for(
+		int64_t janela = 0; gerados < n_fixes; janela++
+	){
+
+		std::vector<std::pair<uint64_t, std::size_t>> ordem(n_rastreadores);
+		for( std::size_t i = 0; i < n_rastreadores; i++ ){ ordem[i] = { morton(frota[i].lat, frota[i].lon), i }; }
+		std::sort(ordem.begin(), ordem.end());
+
+		for(
+			const auto& o : ordem
+		){
+
+			Veiculo& v = frota[o.second];
+			for(
+				int p = 0; p < POR_JANELA && gerados < n_fixes; p++, gerados++
+			){
+
+				if( --v.restante <= 0 ){ v.vel = (v.vel > 0) ? 0 : 8 + aleatorio() * 17; v.restante = 10 + static_cast<int>(aleatorio() * 300); }
+				v.rumo += (aleatorio() - 0.5) * 0.2;
+				v.lat   = std::min(-22.6, std::max(-23.1, v.lat + v.vel * 30 * std::cos(v.rumo) / 111320.0));
+				v.lon   = std::min(-43.1, std::max(-43.6, v.lon + v.vel * 30 * std::sin(v.rumo) / 102000.0));
+
+				CollectorFix fix;
+				fix.tracker = o.second + 1;
+				fix.t_ms    = INICIO_MS + (janela * POR_JANELA + p) * PERIODO_MS;
+				fix.lat_e6  = static_cast<int32_t>(v.lat * 1e6);
+				fix.lon_e6  = static_cast<int32_t>(v.lon * 1e6);
+				fix.alt_dm  = 7600;
+				construtor.append(fix);
+			}
+		}
+	}
+	construtor.seal();
+
+	ScanEngine motor;
+	motor.add(construtor.take());
+	auto tamanho = motor.size();
+	std::cout << tamanho.first << " fixes em " << motor.segment_count() << " segmentos (" << tamanho.second / (1 << 20)
+			  << " MiB), gerados em " << (agora_ns() - t0) / 1e9 << " s" << std::endl;
+
+	const int64_t DIA = 86400000LL;
+	struct Consulta { const char* nome; ScanQuery q; };
+	Consulta consultas[3];
+	consultas[0].nome = "caixa 2 km, 1 dia";
+	consultas[0].q    = { INICIO_MS + 10 * DIA, INICIO_MS + 11 * DIA, -22900000, -22882000, -43400000, -43380000 };
+	consultas[1].nome = "regiao toda, 7 dias";
+	consultas[1].q    = { INICIO_MS + 20 * DIA, INICIO_MS + 27 * DIA, INT32_MIN, INT32_MAX, INT32_MIN, INT32_MAX };
+	consultas[2].nome = "caixa 10 km, tudo";
+	consultas[2].q    = { INT64_MIN, INT64_MAX, -22900000, -22810000, -43400000, -43310000 };
+
+	struct Modo { const char* nome; ScanEngine::Opcoes op; };
+	const Modo modos[] = {
+		{ "escalar",          { 0, false, false } },
+		{ "vetorial",         { 0, false, true  } },
+		{ "vetorial+zonas",   { 0, true,  true  } },
+	};
+
+	std::printf("%-22s %-16s %10s %12s %14s %12s %8s\n", "consulta", "modo", "ms", "Mlinhas/s", "avaliadas", "resultado", "rastr.");
+	for(
+		const Consulta& c : consultas
+	){
+
+		for(
+			const Modo& m : modos
+		){
+
+			double t = agora_ns();
+			ScanEngine::Resultado r = motor.scan(c.q, m.op);
+			t = (agora_ns() - t) / 1e6;
+
+			std::printf("%-22s %-16s %10.1f %12.1f %14llu %12llu %8zu\n", c.nome, m.nome, t, tamanho.first / t / 1e3,
+						static_cast<unsigned long long>(r.linhas_avaliadas), static_cast<unsigned long long>(r.linhas), r.rastreadores.size());
+		}
+	}
+}
+
+/**
+ * @brief Compara o índice espaço-temporal com varreduras completas.
+ * @details
+ * 
+ * A frota alimenta o HistoryStore e o índice, como no coletor; o ScanEngine é construído a
+ * partir do histórico. Consultas aleatórias (caixas de 2 a 5 km, períodos de 1 a 24 horas)
+ * são respondidas pelo índice, com verificação da borda no histórico, e pela varredura com
+ * zone maps; os conjuntos de rastreadores devem coincidir.
+ */
+static void
+bench_index(){
+
+	std::size_t n_fixes = 20000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_FIXES") ){ n_fixes = std::strtoull(env, nullptr, 10); }
+
+	const std::size_t n_rastreadores = 1000;
+	const int64_t     PERIODO_MS     = 30000;
+	const int64_t     INICIO_MS      = 1700000000000LL;
+
+	uint64_t x = 0x5DEECE66DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	struct Veiculo { double lat, lon, rumo, vel; int restante; };
+	std::vector<Veiculo> frota(n_rastreadores);
+	for( auto& v : frota ){ v = { -23.1 + aleatorio() * 0.5, -43.6 + aleatorio() * 0.5, aleatorio() * 6.28, 0, 0 }; }
+
+	HistoryStore        historico(1024);
+	SpatioTemporalIndex indice(0.01, 3600000, n_rastreadores);
+
+	double t0 = agora_ns();
+	int64_t passos = static_cast<int64_t>(n_fixes / n_rastreadores);
+	for(
+		int64_t p = 0; p < passos; p++
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			Veiculo& v = frota[i];
+			if( --v.restante <= 0 ){ v.vel = (v.vel > 0) ? 0 : 8 + aleatorio() * 17; v.restante = 10 + static_cast<int>(aleatorio() * 300); }
+			v.rumo += (aleatorio() - 0.5) * 0.2;
+			v.lat   = std::min(-22.6, std::max(-23.1, v.lat + v.vel * 30 * std::cos(v.rumo) / 111320.0));
+			v.lon   = std::min(-43.1, std::max(-43.6, v.lon + v.vel * 30 * std::sin(v.rumo) / 102000.0));
+
+			CollectorFix fix;
+			fix.tracker = (uint64_t(0x0A000000 + i) << 16) | 5000; // Como tracker_id(): IPv4 << 16 | porta
+			fix.t_ms    = INICIO_MS + p * PERIODO_MS;
+			fix.lat_e6  = static_cast<int32_t>(v.lat * 1e6);
+			fix.lon_e6  = static_cast<int32_t>(v.lon * 1e6);
+			historico.append(fix);
+			indice.add(fix);
+		}
+	}
+	historico.seal_all();
+	double t_ingestao = (agora_ns() - t0) / 1e9;
+
+	ScanEngine motor;
+	motor.load(historico);
+
+	SpatioTemporalIndex::Stats st = indice.stats();
+	std::cout << passos * n_rastreadores << " fixes, ingestao (historico + indice) " << passos * n_rastreadores / t_ingestao / 1e6
+			  << " Mfixes/s" << std::endl;
+	std::cout << "indice: " << st.chaves << " chaves, " << st.bytes / 1024 << " KiB, " << st.adicoes << " adicoes, "
+			  << st.repetidos << " repetidos" << std::endl;
+
+	const int N_CONSULTAS = 200;
+	double t_indice = 0, t_candidatos = 0, t_scan = 0;
+	std::size_t divergentes = 0, encontrados = 0, candidatos = 0;
+	for(
+		int c = 0; c < N_CONSULTAS; c++
+	){
+
+		double  lado  = 0.018 + aleatorio() * 0.027;
+		double  lat   = -23.1 + aleatorio() * (0.5 - lado);
+		double  lon   = -43.6 + aleatorio() * (0.5 - lado);
+		int64_t ini   = INICIO_MS + static_cast<int64_t>(aleatorio() * (passos * PERIODO_MS - 86400000));
+		int64_t fim   = ini + 3600000 + static_cast<int64_t>(aleatorio() * 23 * 3600000);
+
+		IndexRegion regiao = IndexRegion::box(static_cast<int32_t>(lat * 1e6), static_cast<int32_t>((lat + lado) * 1e6),
+											  static_cast<int32_t>(lon * 1e6), static_cast<int32_t>((lon + lado) * 1e6));
+
+		double t = agora_ns();
+		std::vector<uint64_t> por_indice = indice.query(regiao, ini, fim, &historico);
+		t_indice += agora_ns() - t;
+
+		t = agora_ns();
+		candidatos += indice.query(regiao, ini, fim).size();
+		t_candidatos += agora_ns() - t;
+
+		t = agora_ns();
+		ScanEngine::Resultado r = motor.scan({ ini, fim, regiao.lat_min, regiao.lat_max, regiao.lon_min, regiao.lon_max });
+		t_scan += agora_ns() - t;
+
+		encontrados += por_indice.size();
+		divergentes += (por_indice != r.rastreadores);
+	}
+
+	std::printf("%-32s %12s\n", "metodo", "us/consulta");
+	std::printf("%-32s %12.1f\n", "indice (candidatos)", t_candidatos / N_CONSULTAS / 1e3);
+	std::printf("%-32s %12.1f\n", "indice + verificacao da borda", t_indice / N_CONSULTAS / 1e3);
+	std::printf("%-32s %12.1f\n", "varredura com zone maps", t_scan / N_CONSULTAS / 1e3);
+	std::cout << "rastreadores por consulta: " << double(encontrados) / N_CONSULTAS << " (candidatos "
+			  << double(candidatos) / N_CONSULTAS << "), consultas divergentes: " << divergentes << std::endl;
+
+	// Interseção: rastreadores que passaram pela região A no dia 1 e pela região B no dia 2
+	IndexRegion a = IndexRegion::circle(-22.9, -43.35, 3000);
+	IndexRegion b = IndexRegion::circle(-22.8, -43.25, 3000);
+	t0 = agora_ns();
+	SpatioTemporalIndex::Resultado ra = indice.lookup(a, INICIO_MS, INICIO_MS + 86400000 - 1);
+	SpatioTemporalIndex::Resultado rb = indice.lookup(b, INICIO_MS + 86400000, INICIO_MS + 2 * 86400000 - 1);
+	Bitmap ambos = (ra.certos | ra.limite) & (rb.certos | rb.limite);
+	std::printf("intersecao A(dia 1) & B(dia 2): %zu candidatos em %.1f us\n", ambos.cardinality(), (agora_ns() - t0) / 1e3);
+
+	// Recarga: load() substitui os segmentos, e refresh() acompanha novos selos e a compactação
+	auto selados = [&]{ std::size_t n = 0; historico.for_each_block([&](const HistoryStore::Bloco& b){ n += b->n; }); return n; };
+	bool ok = motor.load(historico) == selados() && motor.size().first == selados();
+
+	CollectorFix extra;
+	extra.tracker = 1;
+	extra.lat_e6  = -22900000;
+	extra.lon_e6  = -43200000;
+	for( int i = 0; i < 2048; i++ ){ extra.t_ms = INICIO_MS + i * 1000LL; historico.append(extra); }
+	ok = ok && motor.refresh(historico) == 2048 && motor.size().first == selados() && motor.refresh(historico) == 0;
+
+	HistoryStore::Politica politica;
+	politica.retencao_ms = passos * PERIODO_MS / 2;
+	HistoryCompactor(historico, politica, 0).run(INICIO_MS + passos * PERIODO_MS);
+	ok = ok && motor.refresh(historico) == selados() && motor.size().first == selados();
+	std::cout << "verificacao (recarga e compactacao): " << (ok ? "ok" : "FALHOU") << std::endl;
+}
+
+/**
+ * @brief Mede o TripSegmenter com uma frota roteirizada a 1 Hz.
+ * @details
+ * 
+ * Cada veículo alterna paradas de 5 a 15 minutos (com ruído de posição de alguns metros) e
+ * trechos de 5 a 20 minutos em movimento. Os fixes são gerados antes da medição e
+ * particionados por rastreador entre as threads, como o SO_REUSEPORT faz na recepção.
+ * Ao final, compara paradas e distância detectadas com as do roteiro.
+ */
+static void
+bench_trips(){
+
+	const std::size_t n_rastreadores = 1000;
+	const int         SEGUNDOS       = 6 * 3600;
+	const int64_t     INICIO_MS      = 1700000000000LL;
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+
+	std::vector<std::vector<CollectorFix>> por_thread(n_threads);
+	uint64_t paradas_roteiro = 0;
+	double   distancia_roteiro = 0;
+
+	uint64_t x = 0x853c49e6748fea9bULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	for(
+		std::size_t i = 0; i < n_rastreadores; i++
+	){
+
+		auto& saida = por_thread[i % n_threads];
+		double lat = -22.9 + aleatorio() * 0.2, lon = -43.3 + aleatorio() * 0.2, rumo = aleatorio() * 6.28;
+		bool   parado = aleatorio() < 0.5;
+		int    restante = 300 + static_cast<int>(aleatorio() * 600);
+		double vel = 0;
+
+		for(
+			int s = 0; s < SEGUNDOS; s++
+		){
+
+			if(
+				--restante <= 0
+			){
+
+				parado = !parado;
+				if( parado ){ restante = 300 + static_cast<int>(aleatorio() * 600); }
+				else{ restante = 300 + static_cast<int>(aleatorio() * 900); vel = 5 + aleatorio() * 15; }
+				if( parado && s + restante < SEGUNDOS ){ paradas_roteiro++; }
+			}
+			if(
+				!parado
+			){
+
+				rumo += (aleatorio() - 0.5) * 0.05;
+				lat  += vel * std::cos(rumo) / 111320.0;
+				lon  += vel * std::sin(rumo) / 102000.0;
+				distancia_roteiro += vel;
+			}
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			fix.t_ms    = INICIO_MS + s * 1000LL;
+			fix.lat_e6  = static_cast<int32_t>((lat + (aleatorio() - 0.5) * 8e-5) * 1e6);
+			fix.lon_e6  = static_cast<int32_t>((lon + (aleatorio() - 0.5) * 8e-5) * 1e6);
+			saida.push_back(fix);
+		}
+	}
+
+	TripSegmenter segmentador(50, 180000, 600000, n_rastreadores);
+	std::atomic<uint64_t> paradas_completas{0};
+	std::atomic<uint64_t> distancia_dm{0};
+	segmentador.on_summary([&](const TripSummary& r){
+
+		if( r.tipo == TripSummary::Tipo::VIAGEM ){ distancia_dm += static_cast<uint64_t>(r.distancia_m * 10); }
+		else if( r.t_ini > INICIO_MS + 60000 ){ paradas_completas++; } // Paradas iniciadas antes do primeiro fix não contam
+	});
+
+	uint64_t n_fixes = uint64_t(n_rastreadores) * SEGUNDOS;
+	double dt = em_paralelo(n_threads, [&](int t){ for( const auto& fix : por_thread[t] ){ segmentador.apply(fix); } });
+	segmentador.expire(INICIO_MS + SEGUNDOS * 1000LL + 86400000LL, 3600000);
+
+	TripSegmenter::Stats st = segmentador.stats();
+	std::cout << n_rastreadores << " rastreadores, " << SEGUNDOS / 3600 << " h a 1 Hz, " << n_threads << " threads" << std::endl;
+	std::printf("%-32s %12.2f\n", "vazao (Mfixes/s)", n_fixes / dt / 1e6);
+	std::printf("%-32s %12.1f\n", "custo (ns/fix)", dt * 1e9 / n_fixes * n_threads);
+	std::printf("%-32s %12llu\n", "paradas no roteiro", static_cast<unsigned long long>(paradas_roteiro));
+	std::printf("%-32s %12llu\n", "paradas detectadas", static_cast<unsigned long long>(paradas_completas.load()));
+	std::printf("%-32s %12.3f\n", "distancia detectada/roteiro", distancia_dm.load() / 10.0 / distancia_roteiro);
+	std::printf("%-32s %12llu / %llu\n", "resumos (viagens / paradas)", static_cast<unsigned long long>(st.viagens), static_cast<unsigned long long>(st.paradas));
+}
+
+/**
+ * @brief Mede o ConvoyDetector conforme cresce a frota, com pares injetados.
+ * @details
+ * 
+ * Em uma área fixa de 0,5 x 0,5 grau, a frota de fundo se move a 5-15 m/s em rumos
+ * aleatórios. São injetados comboios (seguidor 15 m atrás do líder) e colocalizações
+ * (dois rastreadores parados a 10 m). A cada 10 s simulados todas as posições são
+ * atualizadas e o detector executa um tick; mede-se apenas o tick. Como a área é fixa,
+ * a densidade cresce com a frota, e com ela os pares próximos acompanhados ("pares").
+ * 
+ * Ao final, compara os pares reportados com os injetados. "outros" são pares não injetados
+ * que de fato seguiram juntos (a posição simulada confirma a proximidade); "falsos", os que
+ * não. Para 10 mil rastreadores, compara o tick com a junção ingênua O(N²).
+ */
+static void
+bench_convoy(){
+
+	const int64_t INICIO_MS = 1700000000000LL;
+	const int     TICKS     = 45;
+	const std::size_t PARES = 500; // De cada tipo.
+
+	std::size_t n_max = 1000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_max = std::strtoull(env, nullptr, 10); }
+
+	std::printf("%-10s %12s %12s %10s %10s %10s %10s %10s %10s\n", "frota", "tick (ms)", "ns/rastr.", "comboios", "coloc.", "tipo ok", "outros", "falsos", "pares");
+	for(
+		std::size_t n : { std::size_t(10000), std::size_t(100000), std::size_t(1000000) }
+	){
+
+		if( n > n_max ){ break; }
+
+		// splitmix64: o xorshift dos outros benchmarks gera, em 1 milhão de sorteios, rastreadores quase idênticos
+		uint64_t x = n;
+		auto aleatorio = [&]{
+
+			uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return ((z ^ (z >> 31)) >> 11) * (1.0 / 9007199254740992.0);
+		};
+
+		// Rastreadores 1..2*PARES são comboios, os 2*PARES seguintes colocalizações, os demais frota de fundo
+		struct Movel { double lat, lon, rumo, vel; };
+		std::vector<Movel> frota(n);
+		for( auto& m : frota ){ m = { -23.2 + aleatorio() * 0.5, -43.6 + aleatorio() * 0.5, aleatorio() * 6.28, 5 + aleatorio() * 10 }; }
+		for( std::size_t k = 2 * PARES; k < 4 * PARES; k++ ){ frota[k].vel = 0; }
+
+		// Posição simulada do rastreador no tick atual
+		auto posicao = [&](std::size_t i, double& lat, double& lon){
+
+			const Movel& m = frota[i];
+			lat = m.lat; lon = m.lon;
+			if( i < 4 * PARES && i % 2 == 1 ){ // Par: seguidor 15 m atrás (comboio) ou 10 m ao lado (colocalização)
+				const Movel& l = frota[i - 1];
+				lat = l.lat - (l.vel > 0 ? 15 * std::cos(l.rumo) / 111320.0 : 0);
+				lon = l.lon - (l.vel > 0 ? 15 * std::sin(l.rumo) / 102000.0 : 10 / 102000.0);
+			}
+		};
+		auto distancia_real = [&](uint64_t a, uint64_t b){
+
+			double lat_a, lon_a, lat_b, lon_b;
+			posicao(a - 1, lat_a, lon_a);
+			posicao(b - 1, lat_b, lon_b);
+			return GPSFix::distance_m(lat_a, lon_a, lat_b, lon_b);
+		};
+
+		TrackerTable<TrackerState> tabela(n * 2);
+		ConvoyDetector detector(tabela, 30, 300000, 60000);
+		std::size_t comboios = 0, colocalizacoes = 0, tipo_ok = 0, outros = 0, falsos = 0;
+		detector.on_event([&](const ConvoyEvent& ev){
+
+			if( ev.fase != ConvoyEvent::Fase::INICIO ){ return; }
+			bool injetado = (ev.a % 2 == 1) && ev.b == ev.a + 1 && ev.b <= 4 * PARES;
+			if( !injetado ){ (distancia_real(ev.a, ev.b) <= 30 ? outros : falsos)++; return; }
+			bool comboio = ev.b <= 2 * PARES;
+			(comboio ? comboios : colocalizacoes)++;
+			if( (ev.tipo == ConvoyEvent::Tipo::COMBOIO) == comboio ){ tipo_ok++; }
+		});
+
+		double tick_ns = 0;
+		for(
+			int t = 0; t < TICKS; t++
+		){
+
+			int64_t agora = INICIO_MS + t * 10000LL;
+			for(
+				std::size_t i = 0; i < n; i++
+			){
+
+				Movel& m = frota[i];
+				m.lat += m.vel * 10 * std::cos(m.rumo) / 111320.0;
+				m.lon += m.vel * 10 * std::sin(m.rumo) / 102000.0;
+
+				double lat, lon;
+				posicao(i, lat, lon);
+
+				CollectorFix fix;
+				fix.tracker = i + 1;
+				fix.t_ms    = agora - static_cast<int64_t>(aleatorio() * 5000);
+				fix.lat_e6  = static_cast<int32_t>(lat * 1e6);
+				fix.lon_e6  = static_cast<int32_t>(lon * 1e6);
+				tabela.update(fix.tracker, [&](TrackerState& e, bool novo){ e.apply(fix, novo); });
+			}
+
+			double t0 = agora_ns();
+			detector.tick(agora);
+			tick_ns += agora_ns() - t0;
+		}
+
+		double tick_ms = tick_ns / TICKS / 1e6;
+		std::printf("%-10zu %12.2f %12.1f %7zu/%zu %7zu/%zu %10zu %10zu %10zu %10llu\n", n, tick_ms, tick_ms * 1e6 / n,
+					comboios, PARES, colocalizacoes, PARES, tipo_ok, outros, falsos,
+					static_cast<unsigned long long>(detector.stats().pares_ativos));
+
+		if(
+			n == 10000
+		){
+
+			// Junção ingênua sobre as mesmas posições
+			std::vector<TrackerState> estados;
+			tabela.for_each([&](uint64_t, const TrackerState& e){ estados.push_back(e); });
+
+			double t0 = agora_ns();
+			std::size_t proximos = 0;
+			for( std::size_t i = 0; i < estados.size(); i++ ){
+				for( std::size_t j = i + 1; j < estados.size(); j++ ){
+					proximos += GPSFix::distance_m(estados[i].lat_e6 * 1e-6, estados[i].lon_e6 * 1e-6, estados[j].lat_e6 * 1e-6, estados[j].lon_e6 * 1e-6) <= 30;
+				}
+			}
+			std::printf("%-10s %12.2f %12s %10zu pares proximos\n", "ingenuo", (agora_ns() - t0) / 1e6, "", proximos);
+		}
+	}
+
+	// Células de sinais opostos: pares dos dois lados do meridiano de Greenwich e do equador,
+	// e rastreadores avulsos nas mesmas linhas de células, que não podem esconder os vizinhos
+	struct Par { double lat_a, lon_a, lat_b, lon_b; };
+	const Par pares[] = {
+		{  0.01,     0.005,    0.01018,  0.005   }, // 20 m norte-sul, em cada quadrante
+		{  0.01,    -0.005,    0.01018, -0.005   },
+		{ -0.01,     0.005,   -0.00982,  0.005   },
+		{ -0.01,    -0.005,   -0.00982, -0.005   },
+		{  0.02,    -0.00005,  0.02,     0.00005 }, // Atravessando o meridiano
+		{ -0.00009,  0.003,    0.00009,  0.003   }, // Atravessando o equador
+		{ -0.00005, -0.00005,  0.00005,  0.00005 }, // Atravessando os dois
+	};
+	const double avulsos[][2] = { { 0.01, 0.00001 }, { -0.00982, -0.00001 } };
+	const std::size_t N_PARES = sizeof(pares) / sizeof(pares[0]);
+
+	TrackerTable<TrackerState> tabela(64);
+	ConvoyDetector detector(tabela, 30, 60000, 60000);
+	std::size_t encontrados = 0, falsos = 0;
+	detector.on_event([&](const ConvoyEvent& ev){
+
+		if( ev.fase != ConvoyEvent::Fase::INICIO ){ return; }
+		((ev.a % 2 == 1 && ev.b == ev.a + 1 && ev.b <= 2 * N_PARES) ? encontrados : falsos)++;
+	});
+	for(
+		int t = 0; t < 10; t++
+	){
+
+		int64_t agora = INICIO_MS + t * 10000LL;
+		auto posicionar = [&](uint64_t tracker, double lat, double lon){
+
+			CollectorFix fix;
+			fix.tracker = tracker;
+			fix.t_ms    = agora;
+			fix.lat_e6  = static_cast<int32_t>(std::llround(lat * 1e6));
+			fix.lon_e6  = static_cast<int32_t>(std::llround(lon * 1e6));
+			tabela.update(fix.tracker, [&](TrackerState& e, bool novo){ e.apply(fix, novo); });
+		};
+		for( std::size_t k = 0; k < N_PARES; k++ ){ posicionar(2 * k + 1, pares[k].lat_a, pares[k].lon_a); posicionar(2 * k + 2, pares[k].lat_b, pares[k].lon_b); }
+		for( std::size_t k = 0; k < 2; k++ ){ posicionar(2 * N_PARES + 1 + k, avulsos[k][0], avulsos[k][1]); }
+		detector.tick(agora);
+	}
+	std::printf("\nverificacao (meridiano e equador): %s (%zu/%zu pares, %zu falsos)\n",
+				encontrados == N_PARES && falsos == 0 ? "ok" : "FALHOU", encontrados, N_PARES, falsos);
+}
+
+/**
+ * @brief Mede o FenceIndex e o GeofenceEvaluator com 1 milhão de cercas.
+ * @details
+ * 
+ * As cercas (70% círculos de 50 m a 2 km, 30% polígonos estrelados de 4 a 24 vértices)
+ * ficam espalhadas em 15 x 15 graus. Metade dos fixes cai perto do centro de uma cerca,
+ * como frotas nas instalações dos clientes; a outra metade é uniforme. Mede a construção,
+ * a consulta (e quantos fixes dispensam o teste exato) e a avaliação completa com estado
+ * por rastreador, em várias threads, frente à meta de 100 mil fixes/s. Uma amostra é
+ * conferida contra o teste de todas as cercas.
+ */
+static void
+bench_geofence(){
+
+	std::size_t n_cercas = 1000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_CERCAS") ){ n_cercas = std::strtoull(env, nullptr, 10); }
+	const std::size_t N_FIXES   = 2000000;
+	const std::size_t AMOSTRA   = 200;
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+
+	uint64_t x = 0x2545f4914f6cdd1dULL;
+	auto aleatorio = [&]{
+
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return ((z ^ (z >> 31)) >> 11) * (1.0 / 9007199254740992.0);
+	};
+
+	std::vector<Fence> cercas;
+	cercas.reserve(n_cercas);
+	std::size_t vertices = 0;
+	for(
+		std::size_t i = 0; i < n_cercas; i++
+	){
+
+		double lat = -30 + aleatorio() * 15, lon = -55 + aleatorio() * 15;
+		double raio = 50 + aleatorio() * aleatorio() * 1950;
+		if(
+			aleatorio() < 0.7
+		){
+
+			cercas.push_back(Fence::circle(static_cast<uint32_t>(i + 1), lat, lon, raio));
+			continue;
+		}
+
+		int lados = 4 + static_cast<int>(aleatorio() * 21);
+		std::vector<std::pair<double, double>> v;
+		for(
+			int k = 0; k < lados; k++
+		){
+
+			double ang = (k + aleatorio() * 0.8) * 6.283185307 / lados, r = raio * (0.5 + aleatorio() * 0.5);
+			v.emplace_back(lat + r * std::cos(ang) / 111320.0, lon + r * std::sin(ang) / 102000.0);
+		}
+		vertices += v.size();
+		cercas.push_back(Fence::polygon(static_cast<uint32_t>(i + 1), std::move(v)));
+	}
+
+	std::vector<CollectorFix> fixes(N_FIXES);
+	for(
+		std::size_t i = 0; i < N_FIXES; i++
+	){
+
+		double lat = -30 + aleatorio() * 15, lon = -55 + aleatorio() * 15;
+		if(
+			i % 2 == 0
+		){
+
+			const Fence& c = cercas[static_cast<std::size_t>(aleatorio() * n_cercas)];
+			lat = c.vertices.empty() ? c.lat : c.vertices[0].first;
+			lon = c.vertices.empty() ? c.lon : c.vertices[0].second;
+			lat += (aleatorio() - 0.5) * 0.03;
+			lon += (aleatorio() - 0.5) * 0.03;
+		}
+		fixes[i].tracker = 1 + i % 100000;
+		fixes[i].t_ms    = 1700000000000LL + static_cast<int64_t>(i / 100000) * 1000;
+		fixes[i].lat_e6  = static_cast<int32_t>(lat * 1e6);
+		fixes[i].lon_e6  = static_cast<int32_t>(lon * 1e6);
+	}
+
+	double t0 = agora_ns();
+	auto indice = std::make_unique<const FenceIndex>(cercas);
+	double t_construcao = (agora_ns() - t0) / 1e9;
+
+	FenceIndex::Stats st = indice->stats();
+	std::cout << n_cercas << " cercas (" << vertices << " vertices), " << N_FIXES << " fixes, " << n_threads << " threads" << std::endl;
+	std::printf("%-36s %12.2f\n", "construcao (s)", t_construcao);
+	std::printf("%-36s %12.2f\n", "celulas por cerca", double(st.entradas) / n_cercas);
+	std::printf("%-36s %12.1f%%\n", "entradas interiores", 100.0 * st.interiores / st.entradas);
+	std::printf("%-36s %12.1f\n", "memoria do indice (MiB)", st.bytes / 1048576.0);
+
+	// Consulta pura
+	uint64_t encontradas = 0, testes = 0, sem_teste = 0;
+	t0 = agora_ns();
+	for(
+		const CollectorFix& f : fixes
+	){
+
+		FenceIndex::Consulta r = indice->query(f.lat_e6, f.lon_e6, [](uint32_t){});
+		encontradas += r.cercas;
+		testes      += r.testes;
+		sem_teste   += (r.testes == 0);
+	}
+	double dt = (agora_ns() - t0) / 1e9;
+	std::printf("%-36s %12.2f\n", "consulta, 1 thread (Mfixes/s)", N_FIXES / dt / 1e6);
+	std::printf("%-36s %12.3f\n", "cercas por fix", double(encontradas) / N_FIXES);
+	std::printf("%-36s %12.3f\n", "testes exatos por fix", double(testes) / N_FIXES);
+	std::printf("%-36s %12.1f%%\n", "fixes sem teste exato", 100.0 * sem_teste / N_FIXES);
+
+	// Conferência contra o teste de todas as cercas
+	std::size_t divergentes = 0;
+	for(
+		std::size_t i = 0; i < AMOSTRA; i++
+	){
+
+		const CollectorFix& f = fixes[i * 2];
+		std::vector<uint32_t> a, b;
+		indice->query(f.lat_e6, f.lon_e6, [&](uint32_t id){ a.push_back(id); });
+		indice->query_all(f.lat_e6, f.lon_e6, [&](uint32_t id){ b.push_back(id); });
+		std::sort(a.begin(), a.end());
+		divergentes += (a != b);
+	}
+	std::printf("%-36s %8zu / %zu\n", "amostra divergente da forca bruta", divergentes, AMOSTRA);
+
+	// Avaliação completa, com entradas e saídas por rastreador
+	GeofenceEvaluator avaliador(200000);
+	avaliador.publish(std::move(indice));
+	std::atomic<uint64_t> eventos{0};
+	avaliador.on_event([&](const GeofenceEvent&){ eventos.fetch_add(1, std::memory_order_relaxed); });
+
+	dt = em_paralelo(n_threads, [&](int t){ for( std::size_t i = t; i < N_FIXES; i += n_threads ){ avaliador.apply(fixes[i]); } });
+	std::printf("%-36s %12.2f\n", "avaliacao, N threads (Mfixes/s)", N_FIXES / dt / 1e6);
+	std::printf("%-36s %12.1fx\n", "folga sobre 100 mil fixes/s", N_FIXES / dt / 1e5);
+	std::printf("%-36s %12llu\n", "eventos de entrada e saida", static_cast<unsigned long long>(eventos.load()));
+
+}
+
+/**
+ * @brief Mede o MapMatcher sobre uma malha urbana sintética carregada como extrato OSM.
+ * @details
+ * 
+ * Gera um arquivo `.osm` com uma grade de 60 x 60 quarteirões de 120 m (uma rua a cada
+ * quatro em mão única, além de calçadas que devem ser ignoradas) e o carrega com
+ * RoadGraph::load_osm(). Veículos percorrem a malha a 8-15 m/s, escolhendo ruas ao acaso
+ * em cada cruzamento, com fixes a 1 Hz e erro gaussiano de 8 m. Mede fixes/s por núcleo
+ * e compara a aresta casada com a percorrida, frente à aresta mais próxima de cada fix.
+ */
+static void
+bench_mapmatch(){
+
+	const int         LADO         = 60;
+	const double      QUADRA_M     = 120;
+	const std::size_t N_VEICULOS   = 2000;
+	const int         SEGUNDOS     = 300;
+	const double      SIGMA_M      = 8;
+	int n_threads = std::max(2u, std::thread::hardware_concurrency());
+
+	std::string caminho = "/tmp/gpstrack_bench_mapa.osm";
+	{
+		std::FILE* f = std::fopen(caminho.c_str(), "w");
+		std::fprintf(f, "<?xml version='1.0' encoding='UTF-8'?>\n<osm version=\"0.6\">\n");
+		for( int i = 0; i < LADO; i++ ){
+			for( int j = 0; j < LADO; j++ ){
+				std::fprintf(f, " <node id=\"%d\" lat=\"%.7f\" lon=\"%.7f\"/>\n", 1000 + i * LADO + j, -22.9 + i * QUADRA_M / 111320.0, -43.2 + j * QUADRA_M / 102500.0);
+			}
+		}
+		int via = 1;
+		for(
+			int i = 0; i < LADO; i++
+		){
+
+			for( int eixo = 0; eixo < 2; eixo++ ){
+				std::fprintf(f, " <way id=\"%d\">\n", via++);
+				for( int j = 0; j < LADO; j++ ){ std::fprintf(f, "  <nd ref=\"%d\"/>\n", 1000 + (eixo ? j * LADO + i : i * LADO + j)); }
+				std::fprintf(f, "  <tag k=\"highway\" v=\"%s\"/>\n", i % 10 == 0 ? "primary" : "residential");
+				if( i % 4 == 2 ){ std::fprintf(f, "  <tag k=\"oneway\" v=\"%s\"/>\n", eixo ? "yes" : "-1"); }
+				std::fprintf(f, " </way>\n");
+			}
+			std::fprintf(f, " <way id=\"%d\">\n  <nd ref=\"%d\"/>\n  <nd ref=\"%d\"/>\n  <tag k=\"highway\" v=\"footway\"/>\n </way>\n", via++, 1000 + i * LADO, 1000 + i * LADO + LADO - 1);
+		}
+		std::fprintf(f, "</osm>\n");
+		std::fclose(f);
+	}
+
+	double t0 = agora_ns();
+	RoadGraph grafo = RoadGraph::load_osm(caminho);
+	std::remove(caminho.c_str());
+	std::cout << "malha: " << grafo.node_count() << " nos, " << grafo.edge_count() << " arestas, carregada em "
+			  << (agora_ns() - t0) / 1e6 << " ms" << std::endl;
+
+	// Percursos: arestas verdadeiras e fixes com ruído, por veículo
+	uint64_t x = 0x5851f42d4c957f2dULL;
+	auto aleatorio = [&]{
+
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return ((z ^ (z >> 31)) >> 11) * (1.0 / 9007199254740992.0);
+	};
+	auto gaussiano = [&]{ return std::sqrt(-2 * std::log(aleatorio() + 1e-300)) * std::cos(6.283185307 * aleatorio()); };
+
+	std::vector<CollectorFix> fixes;
+	std::vector<uint32_t>     verdade;
+	fixes.reserve(N_VEICULOS * SEGUNDOS);
+	for(
+		std::size_t v = 0; v < N_VEICULOS; v++
+	){
+
+		uint32_t aresta = static_cast<uint32_t>(aleatorio() * grafo.edge_count());
+		double   pos = aleatorio() * grafo.edge(aresta).comprimento_m, vel = 8 + aleatorio() * 7;
+
+		for(
+			int s = 0; s < SEGUNDOS; s++
+		){
+
+			pos += vel;
+			while(
+				pos >= grafo.edge(aresta).comprimento_m
+			){
+
+				pos -= grafo.edge(aresta).comprimento_m;
+				const RoadGraph::Edge& e = grafo.edge(aresta);
+				auto faixa = grafo.out_range(e.para);
+				std::vector<uint32_t> opcoes;
+				for( uint32_t k = faixa.first; k < faixa.second; k++ ){ if( grafo.edge(grafo.edge_from(k)).para != e.de ){ opcoes.push_back(grafo.edge_from(k)); } }
+				if( opcoes.empty() ){ for( uint32_t k = faixa.first; k < faixa.second; k++ ){ opcoes.push_back(grafo.edge_from(k)); } }
+				aresta = opcoes[static_cast<std::size_t>(aleatorio() * opcoes.size())];
+			}
+
+			const RoadGraph::Edge& e = grafo.edge(aresta);
+			double t = pos / e.comprimento_m;
+			double lat = (grafo.node_lat(e.de) + t * (grafo.node_lat(e.para) - grafo.node_lat(e.de))) * 1e-6;
+			double lon = (grafo.node_lon(e.de) + t * (grafo.node_lon(e.para) - grafo.node_lon(e.de))) * 1e-6;
+
+			CollectorFix fix;
+			fix.tracker = v + 1;
+			fix.t_ms    = 1700000000000LL + s * 1000LL;
+			fix.lat_e6  = static_cast<int32_t>((lat + gaussiano() * SIGMA_M / 111320.0) * 1e6);
+			fix.lon_e6  = static_cast<int32_t>((lon + gaussiano() * SIGMA_M / 102500.0) * 1e6);
+			fixes.push_back(fix);
+			verdade.push_back(aresta);
+		}
+	}
+
+	// Mesmo trecho de via, em qualquer sentido
+	auto mesmo_trecho = [&](uint32_t a, uint32_t b){
+
+		const RoadGraph::Edge& ea = grafo.edge(a);
+		const RoadGraph::Edge& eb = grafo.edge(b);
+		return a == b || (ea.de == eb.para && ea.para == eb.de);
+	};
+
+	std::size_t proxima_certa = 0, proxima_trecho = 0;
+	for(
+		std::size_t i = 0; i < fixes.size(); i++
+	){
+
+		RoadGraph::Candidate c;
+		if( grafo.candidates(fixes[i].lat_e6, fixes[i].lon_e6, 50, &c, 1) == 0 ){ continue; }
+		proxima_certa  += (c.aresta == verdade[i]);
+		proxima_trecho += mesmo_trecho(c.aresta, verdade[i]);
+	}
+
+	MapMatcher casador(grafo, SIGMA_M, 10, 50, 30);
+	std::vector<uint32_t> casada(fixes.size(), UINT32_MAX);
+	casador.on_match([&](const MatchedFix& m){ casada[(m.tracker - 1) * SEGUNDOS + (m.t_ms - 1700000000000LL) / 1000] = m.aresta; });
+
+	double dt = em_paralelo(n_threads, [&](int t){
+
+		for( int s = 0; s < SEGUNDOS; s++ ){
+			for( std::size_t v = t; v < N_VEICULOS; v += n_threads ){ casador.apply(fixes[v * SEGUNDOS + s]); }
+		}
+	});
+	casador.flush_all();
+
+	std::size_t certa = 0, trecho = 0;
+	for( std::size_t i = 0; i < fixes.size(); i++ ){ if( casada[i] != UINT32_MAX ){ certa += (casada[i] == verdade[i]); trecho += mesmo_trecho(casada[i], verdade[i]); } }
+
+	MapMatcher::Stats st = casador.stats();
+	std::cout << N_VEICULOS << " veiculos, " << SEGUNDOS << " s a 1 Hz, erro de " << SIGMA_M << " m, " << n_threads << " threads" << std::endl;
+	std::printf("%-36s %12.0f\n", "vazao (fixes/s)", fixes.size() / dt);
+	std::printf("%-36s %12.0f\n", "por nucleo (fixes/s)", fixes.size() / (dt * std::min<unsigned>(n_threads, std::max(1u, std::thread::hardware_concurrency()))));
+	std::printf("%-36s %11.1f%% %11.1f%%\n", "aresta certa (mais proxima / HMM)", 100.0 * proxima_certa / fixes.size(), 100.0 * certa / fixes.size());
+	std::printf("%-36s %11.1f%% %11.1f%%\n", "trecho certo (mais proxima / HMM)", 100.0 * proxima_trecho / fixes.size(), 100.0 * trecho / fixes.size());
+	std::printf("%-36s %12llu / %llu\n", "sem candidato / quebras", static_cast<unsigned long long>(st.sem_candidato), static_cast<unsigned long long>(st.quebras));
+}
+
+/**
+ * @brief Mede o servidor de assinaturas com milhares de clientes TCP locais.
+ * @details
+ * 
+ * Os clientes (GPSTRACK_BENCH_CLIENTES, 2000 por padrão) assinam 20 rastreadores, uma
+ * caixa de 0,05 grau ou, um a cada 500, todos os fixes. Uma thread lê os clientes rápidos.
+ * No segundo cenário, 1% dos clientes assina todos os fixes e nunca lê. Fixes de 100 mil
+ * rastreadores são publicados a taxa constante; mede-se o tempo de publish() por fix, que
+ * não deve crescer com os clientes lentos, e as linhas recebidas pelos rápidos contra as
+ * esperadas.
+ */
+static void
+bench_subscriptions(){
+
+	std::size_t n_clientes = 2000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_CLIENTES") ){ n_clientes = std::strtoull(env, nullptr, 10); }
+
+	const uint64_t N_RASTREADORES = 100000;
+	const double   TAXA           = 20000;
+	const double   DURACAO_S      = 4;
+	const int      LOTE           = 500;
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	std::printf("%-8s %10s %10s %10s %12s %12s %12s %10s\n", "lentos", "fixes/s", "ns/fix", "mediana", "esperadas", "recebidas", "descartadas", "desconect.");
+	for(
+		int pct_lentos : { 0, 1 }
+	){
+
+		SubscriptionServer servidor(0, 4096, 1000);
+		servidor.init();
+
+		struct Cliente { int fd; bool lento; bool todos; double caixa[4]; bool linha_nova; uint64_t esperadas, recebidas; };
+		std::vector<Cliente> clientes(n_clientes);
+		std::unordered_map<uint64_t, std::vector<uint32_t>> por_rastreador;
+		std::unordered_map<uint64_t, std::vector<uint32_t>> por_celula;
+		std::vector<uint32_t> todos;
+		auto celula = [](double lat, double lon){ return (uint64_t(std::floor(lat * 10) + 1000) << 32) | uint64_t(std::floor(lon * 10) + 2000); };
+
+		for(
+			std::size_t i = 0; i < n_clientes; i++
+		){
+
+			Cliente& c = clientes[i];
+			c = { ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0), false, i % 500 == 0, {}, true, 0, 0 };
+			c.lento = static_cast<int>(i % 100) == 1 && pct_lentos > 0;
+			c.todos = c.todos || c.lento;
+			if( c.lento ){ int tam = 4096; ::setsockopt(c.fd, SOL_SOCKET, SO_RCVBUF, &tam, sizeof(tam)); }
+
+			sockaddr_in addr{};
+			addr.sin_family      = AF_INET;
+			addr.sin_port        = ::htons(servidor.port());
+			addr.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+			if( ::connect(c.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ){ std::cout << "falha ao conectar o cliente " << i << std::endl; return; }
+
+			std::string filtro;
+			if( c.todos ){ filtro = "todos\n"; todos.push_back(i); }
+			else if(
+				i % 2 == 0
+			){
+
+				filtro = "rastreador";
+				for( int k = 0; k < 20; k++ ){ uint64_t r = 1 + static_cast<uint64_t>(aleatorio() * N_RASTREADORES); filtro += " " + std::to_string(r); por_rastreador[r].push_back(i); }
+				filtro += "\n";
+			}
+			else{
+
+				c.caixa[0] = -23.2 + aleatorio() * 0.95;
+				c.caixa[1] = -43.8 + aleatorio() * 0.95;
+				c.caixa[2] = c.caixa[0] + 0.05;
+				c.caixa[3] = c.caixa[1] + 0.05;
+				char linha[128];
+				std::snprintf(linha, sizeof(linha), "caixa %.6f %.6f %.6f %.6f\n", c.caixa[0], c.caixa[1], c.caixa[2], c.caixa[3]);
+				filtro = linha;
+				for( double la = c.caixa[0]; la < c.caixa[2] + 0.1; la += 0.1 ){ for( double lo = c.caixa[1]; lo < c.caixa[3] + 0.1; lo += 0.1 ){ por_celula[celula(std::min(la, c.caixa[2]), std::min(lo, c.caixa[3]))].push_back(i); } }
+			}
+			(void)!::write(c.fd, filtro.data(), filtro.size());
+			::fcntl(c.fd, F_SETFL, O_NONBLOCK);
+		}
+		for( auto& par : por_celula ){ std::sort(par.second.begin(), par.second.end()); par.second.erase(std::unique(par.second.begin(), par.second.end()), par.second.end()); }
+
+		while( servidor.stats().clientes < n_clientes ){ std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+		// Leitora dos clientes rápidos
+		std::atomic<bool> lendo{true};
+		std::thread leitora([&]{
+
+			int ep = ::epoll_create1(0);
+			for( std::size_t i = 0; i < n_clientes; i++ ){ if( !clientes[i].lento ){ epoll_event ev{}; ev.events = EPOLLIN; ev.data.u32 = i; ::epoll_ctl(ep, EPOLL_CTL_ADD, clientes[i].fd, &ev); } }
+
+			epoll_event eventos[256];
+			char buffer[65536];
+			while(
+				lendo
+			){
+
+				int n = ::epoll_wait(ep, eventos, 256, 20);
+				for(
+					int e = 0; e < n; e++
+				){
+
+					Cliente& c = clientes[eventos[e].data.u32];
+					ssize_t  k;
+					while(
+						(k = ::read(c.fd, buffer, sizeof(buffer))) > 0
+					){
+
+						for(
+							ssize_t j = 0; j < k; j++
+						){
+
+							if( c.linha_nova && buffer[j] != '#' ){ c.recebidas++; }
+							c.linha_nova = buffer[j] == '\n';
+						}
+					}
+				}
+			}
+			::close(ep);
+		});
+
+		std::vector<double> custos;
+		uint64_t publicados = 0;
+		double   custo_total = 0;
+		double   t0 = agora_ns();
+		std::vector<CollectorFix> lote(LOTE);
+		while(
+			(agora_ns() - t0) / 1e9 < DURACAO_S
+		){
+
+			for(
+				CollectorFix& f : lote
+			){
+
+				f.tracker = 1 + static_cast<uint64_t>(aleatorio() * N_RASTREADORES);
+				f.t_ms    = 1700000000000LL + publicados * 20;
+				f.lat_e6  = static_cast<int32_t>(std::llround((-23.2 + aleatorio()) * 1e6));
+				f.lon_e6  = static_cast<int32_t>(std::llround((-43.8 + aleatorio()) * 1e6));
+
+				// Destinatários rápidos esperados
+				auto contar = [&](uint32_t i){ if( !clientes[i].lento ){ clientes[i].esperadas++; } };
+				for( uint32_t i : todos ){ contar(i); }
+				auto r = por_rastreador.find(f.tracker);
+				std::vector<uint32_t> vistos;
+				if( r != por_rastreador.end() ){ for( uint32_t i : r->second ){ if( std::find(vistos.begin(), vistos.end(), i) == vistos.end() ){ vistos.push_back(i); contar(i); } } }
+				auto cel = por_celula.find(celula(f.lat(), f.lon()));
+				if(
+					cel != por_celula.end()
+				){
+
+					for(
+						uint32_t i : cel->second
+					){
+
+						const Cliente& c = clientes[i];
+						int32_t la0 = std::llround(c.caixa[0] * 1e6), lo0 = std::llround(c.caixa[1] * 1e6), la1 = std::llround(c.caixa[2] * 1e6), lo1 = std::llround(c.caixa[3] * 1e6);
+						if( f.lat_e6 >= la0 && f.lat_e6 <= la1 && f.lon_e6 >= lo0 && f.lon_e6 <= lo1 ){ contar(i); }
+					}
+				}
+			}
+
+			double t = agora_ns();
+			for( const CollectorFix& f : lote ){ servidor.publish(f); }
+			double dt = agora_ns() - t;
+			custos.push_back(dt / LOTE);
+			custo_total += dt;
+			publicados  += LOTE;
+
+			// Ritmo constante
+			double alvo = t0 + publicados / TAXA * 1e9;
+			while( agora_ns() < alvo ){ std::this_thread::sleep_for(std::chrono::microseconds(200)); }
+		}
+		double taxa = publicados / ((agora_ns() - t0) / 1e9);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+		lendo = false;
+		leitora.join();
+		servidor.stop();
+
+		uint64_t esperadas = 0, recebidas = 0;
+		for( const Cliente& c : clientes ){ esperadas += c.esperadas; recebidas += c.recebidas; ::close(c.fd); }
+		std::sort(custos.begin(), custos.end());
+
+		SubscriptionServer::Stats st = servidor.stats();
+		std::printf("%-8s %10.0f %10.0f %10.0f %12llu %12llu %12llu %10llu\n", (std::to_string(pct_lentos) + "%").c_str(), taxa, custo_total / publicados,
+					custos[custos.size() / 2], static_cast<unsigned long long>(esperadas), static_cast<unsigned long long>(recebidas),
+					static_cast<unsigned long long>(st.descartados), static_cast<unsigned long long>(st.desconectados));
+	}
+}
+
+/**
+ * @brief Mede o ReorderBuffer com uma frota simulada a 1 Hz.
+ * @details
+ * 
+ * Cada datagrama sofre 20 a 80 ms de atraso de rede; 3% sofrem até 3 s a mais (chegam
+ * fora de ordem) e 1% é duplicado. Os fixes são entregues em ordem de chegada e o buffer
+ * deve emitir, por rastreador, instantes estritamente crescentes, e cada fix único
+ * exatamente uma vez: o atraso do buffer (4 s) cobre o maior atraso injetado, e só
+ * duplicatas podem chegar tarde demais. Compara o custo por fix com a entrega direta, em 1 e N threads
+ * (rastreadores particionados, como com SO_REUSEPORT). Com N threads, como no coletor, só
+ * uma delas chama expire(), com o relógio da thread mais atrasada.
+ * GPSTRACK_BENCH_TRACKERS altera a frota.
+ */
+static void
+bench_reorder(){
+
+	std::size_t n_rastreadores = 100000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+
+	const int     SEGUNDOS  = 60;
+	const int64_t INICIO_MS = 1700000000000LL;
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	struct Chegada { int64_t t_ms; CollectorFix fix; };
+	std::vector<Chegada> chegadas;
+	chegadas.reserve(n_rastreadores * SEGUNDOS * 102 / 100);
+	uint64_t atrasados_injetados = 0, duplicados_injetados = 0;
+	for(
+		int seg = 0; seg < SEGUNDOS; seg++
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			CollectorFix fix;
+			fix.tracker = i + 1;
+			fix.t_ms    = INICIO_MS + seg * 1000LL + static_cast<int64_t>(i % 1000);
+			fix.lat_e6  = -22955900 + static_cast<int32_t>(i % 1000) * 10 + seg;
+			fix.lon_e6  = -43165900 + static_cast<int32_t>(i / 1000) * 10;
+
+			int64_t rede = 20 + static_cast<int64_t>(aleatorio() * 60);
+			if( aleatorio() < 0.03 ){ rede += static_cast<int64_t>(aleatorio() * 3000); atrasados_injetados++; }
+			chegadas.push_back({ fix.t_ms + rede, fix });
+			if( aleatorio() < 0.01 ){ chegadas.push_back({ fix.t_ms + rede + static_cast<int64_t>(aleatorio() * 1000), fix }); duplicados_injetados++; }
+		}
+	}
+	std::sort(chegadas.begin(), chegadas.end(), [](const Chegada& a, const Chegada& b){ return a.t_ms < b.t_ms; });
+	std::cout << n_rastreadores << " rastreadores, " << SEGUNDOS << " s a 1 Hz, " << chegadas.size() << " datagramas ("
+			  << atrasados_injetados << " com atraso extra, " << duplicados_injetados << " duplicados)" << std::endl;
+
+	const uint64_t unicos = n_rastreadores * SEGUNDOS;
+	std::printf("\n%-28s %10s %12s %12s %12s %12s %10s %10s\n", "modo", "ns/fix", "emitidos", "duplicados", "atrasados", "reordenados", "violacoes", "perdidos");
+
+	int  n_threads = std::max(2u, std::thread::hardware_concurrency());
+	bool completo  = true;
+	for(
+		int modo = 0; modo < 3; modo++
+	){
+
+		int threads = modo == 2 ? n_threads : 1;
+		ReorderBuffer buffer(4000);
+
+		// Cada rastreador é emitido sob o lock do seu shard, pela thread dona ou pela que
+		// chama expire(); atômicos relaxados bastam para a verificação
+		std::vector<std::atomic<int64_t>> ultimo(n_rastreadores + 1);
+		for( auto& u : ultimo ){ u.store(INT64_MIN, std::memory_order_relaxed); }
+		std::atomic<uint64_t> emitidos{0}, violacoes{0};
+		auto verificar = [&](const CollectorFix& f){
+
+			if( f.t_ms <= ultimo[f.tracker].load(std::memory_order_relaxed) ){ violacoes++; }
+			ultimo[f.tracker].store(f.t_ms, std::memory_order_relaxed);
+		};
+
+		// Relógio global: a chegada mais recente já entregue por cada thread
+		std::vector<std::atomic<int64_t>> progresso(threads);
+		for( auto& p : progresso ){ p.store(INT64_MIN, std::memory_order_relaxed); }
+
+		double dt = em_paralelo(threads, [&](int t){
+
+			uint64_t e = 0;
+			auto emitir = [&](const CollectorFix& f){ e++; verificar(f); };
+
+			int64_t proximo_expire = 0;
+			for(
+				const Chegada& c : chegadas
+			){
+
+				if( c.fix.tracker % threads != static_cast<uint64_t>(t) ){ continue; }
+				if( modo == 0 ){ emitir(c.fix); continue; }
+
+				buffer.push(c.fix, c.t_ms, emitir);
+				progresso[t].store(c.t_ms, std::memory_order_release);
+				if(
+					t == 0 && c.t_ms >= proximo_expire
+				){
+
+					int64_t agora = c.t_ms;
+					for( const auto& p : progresso ){ agora = std::min(agora, p.load(std::memory_order_acquire)); }
+					if( agora != INT64_MIN ){ buffer.expire(agora, emitir); }
+					proximo_expire = c.t_ms + 10;
+				}
+			}
+			progresso[t].store(INT64_MAX, std::memory_order_release);
+			emitidos += e;
+		});
+
+		if(
+			modo > 0
+		){
+
+			uint64_t e = 0;
+			buffer.flush_all([&](const CollectorFix& f){ e++; verificar(f); });
+			emitidos += e;
+		}
+
+		ReorderBuffer::Stats st = buffer.stats();
+		std::string   nome     = modo == 0 ? "direto (sem buffer)" : "ReorderBuffer " + std::to_string(threads) + "T";
+		uint64_t      perdidos = modo == 0 ? 0 : unicos - std::min<uint64_t>(unicos, emitidos.load());
+		if( modo > 0 && emitidos.load() != unicos ){ completo = false; }
+		std::printf("%-28s %10.1f %12llu %12llu %12llu %12llu %10llu %10llu\n", nome.c_str(),
+					dt * 1e9 / chegadas.size(), static_cast<unsigned long long>(emitidos.load()), static_cast<unsigned long long>(st.duplicados),
+					static_cast<unsigned long long>(st.atrasados), static_cast<unsigned long long>(st.reordenados), static_cast<unsigned long long>(violacoes.load()),
+					static_cast<unsigned long long>(perdidos));
+	}
+	std::cout << "\nverificacao (cada fix unico emitido uma vez, em ordem): " << (completo ? "ok" : "FALHA") << std::endl;
+}
+
+/**
+ * @brief Simula o esvaziamento simultâneo dos spools de uma frota, com e sem controle de admissão.
+ * @details
+ * 
+ * Cada rastreador tem seu próprio socket UDP em 127.0.0.1 e, como GPSTrack, envia um fix ao
+ * vivo por segundo (1% deles marcados como alerta) enquanto esvazia um spool de fixes
+ * antigos, nas posições de TrafegoFrota. Sem admissão, o spool é despejado de uma vez e
+ * esquecido, como faria um firmware ingênuo. Com admissão, o rastreador mantém até 8 fixes
+ * do spool sem confirmação, espaça os envios pela pausa da última confirmação, reenvia os
+ * recusados e os sem resposta em 1 s, e reenvia alertas até que sejam confirmados.
+ *
+ * O coletor, com uma thread de recepção, grava um WAL síncrono e mantém histórico e índice.
+ * Ao final, as entregas são conferidas no histórico: um fix de spool está perdido quando o
+ * rastreador já o descartou (enviado sem admissão, ou confirmado) e ele não foi armazenado.
+ * GPSTRACK_BENCH_TRACKERS altera a frota.
+ */
+static void
+bench_admission(){
+
+	std::size_t n_rastreadores = 2000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::min<std::size_t>(std::strtoull(env, nullptr, 10), 10000); }
+
+	const int      PORTA     = 39094;
+	const uint32_t SPOOL     = 600;
+	const int      DURACAO_S = 10;
+	const int      JANELA    = 8;
+
+	auto eh_alerta = [](std::size_t i, int64_t s){ uint64_t h = (i * 1000003ULL + s) * 0x9e3779b97f4a7c15ULL; return (h >> 40) % 100 == 0; };
+
+	std::printf("%zu rastreadores, spool de %u fixes cada, %d s\n\n", n_rastreadores, SPOOL, DURACAO_S);
+	std::printf("%-16s %10s %10s %14s %14s %12s %12s %12s\n", "modo", "ao vivo", "alertas", "spool armaz.", "spool perdido", "no spool", "duplicados", "datagramas");
+	for(
+		int modo = 0; modo < 2; modo++
+	){
+
+		char modelo[] = "/tmp/gpstrack_admissao_XXXXXX";
+		std::string dir = ::mkdtemp(modelo);
+
+		GPSCollector coletor(PORTA, 1, 1 << 14);
+		coletor.open_history();
+		coletor.open_index();
+		if( modo ){ coletor.open_admission(); }
+		coletor.open_wal(dir, CollectorWAL::Durabilidade::SINCRONA, std::chrono::microseconds(1000));
+		coletor.init();
+
+		struct Rastreador {
+			int                   fd;
+			uint64_t              id;
+			uint32_t              cursor = 0;
+			std::vector<uint8_t>  descartado; ///< Fix do spool que o rastreador já não guarda.
+			std::vector<uint32_t> reenviar;
+			uint32_t              em_voo[JANELA];
+			int64_t               enviado_ms[JANELA];
+			int                   n_voo = 0;
+			int64_t               liberar_ms = 0;    ///< Próximo envio do spool permitido.
+			uint32_t              intervalo_ms = 0;  ///< Pausa da última confirmação.
+			int64_t               proximo_vivo_s = 0;
+			int64_t               alerta_s = -1; ///< Alerta ainda não confirmado.
+			int64_t               alerta_ms = 0;
+		};
+		std::vector<Rastreador> frota(n_rastreadores);
+
+		int ep = ::epoll_create1(EPOLL_CLOEXEC);
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			Rastreador& r = frota[i];
+			r.fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			sockaddr_in local{};
+			local.sin_family      = AF_INET;
+			local.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+			::bind(r.fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+			socklen_t len = sizeof(local);
+			::getsockname(r.fd, reinterpret_cast<sockaddr*>(&local), &len);
+			r.id = CollectorFix::tracker_id(local);
+
+			epoll_event ev{};
+			ev.events   = EPOLLIN;
+			ev.data.u64 = i;
+			::epoll_ctl(ep, EPOLL_CTL_ADD, r.fd, &ev);
+		}
+
+		sockaddr_in destino{};
+		destino.sin_family      = AF_INET;
+		destino.sin_port        = ::htons(PORTA);
+		destino.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+
+		auto relogio = []{ return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count(); };
+
+		int64_t  inicio_s   = relogio() / 1000 + 1;
+		int64_t  fim_s      = inicio_s + DURACAO_S;
+		int64_t  spool_s    = inicio_s - 60 - SPOOL; ///< Instante do primeiro fix do spool.
+		uint64_t datagramas = 0;
+		for( auto& r : frota ){ r.proximo_vivo_s = inicio_s; r.descartado.assign(SPOOL, 0); }
+
+		auto enviar = [&](std::size_t i, int64_t t_s, bool alerta){
+
+			double lat = -22.9559 + ((i * 7919) % 20000) * 1e-4 + (t_s % 3600) * 1e-5;
+			double lon = -43.1659 + ((i * 104729) % 20000) * 1e-4;
+			int    seg = static_cast<int>(((t_s % 86400) + 86400) % 86400);
+
+			char linha[80];
+			int n = std::snprintf(linha, sizeof(linha), "%02d%02d%02d.00,%f,%f,%.1f%s\n",
+								  seg / 3600, (seg / 60) % 60, seg % 60, lat, lon, 760.0 + i % 50, alerta ? ",A" : "");
+			::sendto(frota[i].fd, linha, n, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&destino), sizeof(destino));
+			datagramas++;
+		};
+
+		std::vector<epoll_event> eventos(n_rastreadores);
+		while(
+			true
+		){
+
+			int64_t agora = relogio();
+			if( agora >= fim_s * 1000 ){ break; }
+			bool ocupado = false;
+
+			// Confirmações: `ACK,hhmmss.ss,aceito,pausa_ms`
+			int n_ev = ::epoll_wait(ep, eventos.data(), static_cast<int>(eventos.size()), 0);
+			for(
+				int e = 0; e < n_ev; e++
+			){
+
+				Rastreador& r = frota[eventos[e].data.u64];
+				char buffer[64];
+				ssize_t n;
+				while(
+					(n = ::recv(r.fd, buffer, sizeof(buffer) - 1, 0)) > 0
+				){
+
+					buffer[n] = '\0';
+					double   hhmmss;
+					int      aceito;
+					unsigned pausa;
+					if( std::sscanf(buffer, "ACK,%lf,%d,%u", &hhmmss, &aceito, &pausa) != 3 ){ continue; }
+
+					// Recupera o instante completo pelo horário do dia
+					int64_t seg = static_cast<int64_t>(hhmmss) / 10000 * 3600 + static_cast<int64_t>(hhmmss) / 100 % 100 * 60 + static_cast<int64_t>(hhmmss) % 100;
+					int64_t t_s = agora / 1000 - (((agora / 1000 - seg) % 86400) + 86400) % 86400;
+
+					if( t_s == r.alerta_s && aceito ){ r.alerta_s = -1; continue; }
+					for(
+						int k = 0; k < r.n_voo; k++
+					){
+
+						if( spool_s + r.em_voo[k] != t_s ){ continue; }
+						if( aceito ){ r.descartado[r.em_voo[k]] = 1; }
+						else{ r.reenviar.push_back(r.em_voo[k]); }
+						r.em_voo[k]     = r.em_voo[r.n_voo - 1];
+						r.enviado_ms[k] = r.enviado_ms[r.n_voo - 1];
+						r.n_voo--;
+						break;
+					}
+					r.intervalo_ms = pausa;
+					if( !aceito ){ r.liberar_ms = std::max(r.liberar_ms, agora + pausa); }
+				}
+			}
+
+			for(
+				std::size_t i = 0; i < n_rastreadores; i++
+			){
+
+				Rastreador& r = frota[i];
+
+				// Um fix ao vivo por segundo; alertas são reenviados até a confirmação
+				if(
+					agora / 1000 >= r.proximo_vivo_s
+				){
+
+					bool alerta = eh_alerta(i, r.proximo_vivo_s);
+					enviar(i, r.proximo_vivo_s, alerta);
+					if( alerta ){ r.alerta_s = r.proximo_vivo_s; r.alerta_ms = agora; }
+					r.proximo_vivo_s = agora / 1000 + 1;
+				}
+				else if( modo && r.alerta_s >= 0 && agora - r.alerta_ms >= 500 ){ enviar(i, r.alerta_s, true); r.alerta_ms = agora; }
+
+				if(
+					modo == 0
+				){
+
+					// Despeja o spool sem esperar confirmação
+					for( int k = 0; k < 8 && r.cursor < SPOOL; k++, r.cursor++ ){ enviar(i, spool_s + r.cursor, false); r.descartado[r.cursor] = 1; ocupado = true; }
+					continue;
+				}
+
+				for(
+					int k = 0; k < r.n_voo; k++
+				){
+
+					if( agora - r.enviado_ms[k] < 1000 ){ continue; }
+					r.reenviar.push_back(r.em_voo[k]);
+					r.em_voo[k]     = r.em_voo[r.n_voo - 1];
+					r.enviado_ms[k] = r.enviado_ms[r.n_voo - 1];
+					r.n_voo--;
+					k--;
+				}
+				while(
+					r.n_voo < JANELA && agora >= r.liberar_ms && (!r.reenviar.empty() || r.cursor < SPOOL)
+				){
+
+					uint32_t k;
+					if( !r.reenviar.empty() ){ k = r.reenviar.back(); r.reenviar.pop_back(); }
+					else{ k = r.cursor++; }
+					enviar(i, spool_s + k, false);
+					r.em_voo[r.n_voo]     = k;
+					r.enviado_ms[r.n_voo] = agora;
+					r.n_voo++;
+					r.liberar_ms = agora + r.intervalo_ms;
+					ocupado = true;
+				}
+			}
+
+			if( !ocupado ){ ::epoll_wait(ep, eventos.data(), 1, 1); }
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		coletor.stop();
+		for( auto& r : frota ){ ::close(r.fd); }
+		::close(ep);
+		remover_diretorio(dir);
+
+		// Conferência no histórico
+		uint64_t vivos = 0, vivos_ok = 0, alertas = 0, alertas_ok = 0, spool_ok = 0, perdidos = 0, pendentes = 0, duplicados = 0;
+		std::vector<uint8_t> visto(SPOOL), vivo(DURACAO_S);
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			std::fill(visto.begin(), visto.end(), 0);
+			std::fill(vivo.begin(), vivo.end(), 0);
+			coletor.history()->query(frota[i].id, 0, INT64_MAX, [&](const CollectorFix& f){
+
+				int64_t t_s = f.t_ms / 1000;
+				if( t_s >= inicio_s && t_s < fim_s ){ vivo[t_s - inicio_s] = 1; return; }
+				if( t_s < spool_s || t_s >= spool_s + SPOOL ){ return; }
+				if( visto[t_s - spool_s] ){ duplicados++; }
+				visto[t_s - spool_s] = 1;
+			});
+
+			for(
+				uint32_t k = 0; k < SPOOL; k++
+			){
+
+				spool_ok  += visto[k];
+				perdidos  += frota[i].descartado[k] && !visto[k];
+				pendentes += !frota[i].descartado[k];
+			}
+			for(
+				int s = 0; s < DURACAO_S; s++
+			){
+
+				bool alerta = eh_alerta(i, inicio_s + s);
+				vivos++;
+				vivos_ok += vivo[s];
+				alertas += alerta;
+				alertas_ok += alerta && vivo[s];
+			}
+		}
+
+		double total = double(n_rastreadores) * SPOOL;
+		std::printf("%-16s %9.1f%% %9.1f%% %13.1f%% %13.1f%% %11.1f%% %12llu %12llu\n", modo ? "com admissao" : "sem admissao",
+					100.0 * vivos_ok / vivos, alertas ? 100.0 * alertas_ok / alertas : 100.0, 100.0 * spool_ok / total, 100.0 * perdidos / total,
+					100.0 * pendentes / total, static_cast<unsigned long long>(duplicados), static_cast<unsigned long long>(datagramas));
+
+		if(
+			AdmissionControl* admissao = coletor.admission()
+		){
+
+			AdmissionControl::Stats a = admissao->stats();
+			std::printf("  admissao: alertas %llu/%llu, ao vivo %llu/%llu, spool %llu/%llu; taxa final %u/s, pausa %u ms\n",
+						static_cast<unsigned long long>(a.admitidos[0]), static_cast<unsigned long long>(a.recebidos[0]),
+						static_cast<unsigned long long>(a.admitidos[1]), static_cast<unsigned long long>(a.recebidos[1]),
+						static_cast<unsigned long long>(a.admitidos[2]), static_cast<unsigned long long>(a.recebidos[2]),
+						a.taxa_atrasados, a.pausa_ms);
+		}
+	}
+}
+
+/**
+ * @brief Compara o reinício do coletor reaplicando o WAL inteiro com o reinício por snapshot.
+ * @details
+ * 
+ * A frota (GPSTRACK_BENCH_TRACKERS, 50000 por padrão) envia 200 fixes por rastreador a um
+ * coletor com histórico, índice e reordenação, e WAL sem fsync. Em um diretório, o coletor
+ * é reiniciado reaplicando todo o WAL; em outro, um snapshot é gravado após 180 fixes, e o
+ * reinício carrega o snapshot e reaplica apenas os 20 últimos. Os dois estados recuperados
+ * devem ser idênticos: contadores, estado de uma amostra de rastreadores, uma consulta
+ * ao índice e uma ao histórico.
+ */
+static void
+bench_snapshot(){
+
+	std::size_t n_rastreadores = 50000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+
+	const int     N_FIXES   = 200;
+	const int     CORTE     = 180;
+	const int64_t INICIO_MS = 1700000000000LL;
+
+	auto ingerir = [&](GPSCollector& coletor, int ini, int fim){
+
+		std::vector<CollectorFix> lote;
+		for(
+			int seg = ini; seg < fim; seg++
+		){
+
+			for(
+				std::size_t i = 0; i < n_rastreadores; i++
+			){
+
+				CollectorFix fix;
+				fix.tracker = i + 1;
+				fix.t_ms    = INICIO_MS + seg * 1000LL + static_cast<int64_t>(i % 1000);
+				fix.lat_e6  = -22955900 + static_cast<int32_t>(i % 1000) * 100 + seg * 3;
+				fix.lon_e6  = -43165900 + static_cast<int32_t>(i / 1000) * 100 + seg * 2;
+				fix.alt_dm  = 120;
+				lote.push_back(fix);
+				if( lote.size() == 64 ){ coletor.ingest_batch(lote.data(), lote.size()); lote.clear(); }
+			}
+		}
+		coletor.ingest_batch(lote.data(), lote.size());
+	};
+
+	auto abrir = [&](GPSCollector& coletor, const std::string& dir){
+
+		coletor.open_history();
+		coletor.open_index();
+		coletor.open_reorder(2000);
+		coletor.open_wal(dir, CollectorWAL::Durabilidade::NENHUMA);
+	};
+
+	// Estado recuperado, para a comparação
+	struct Resumo {
+		GPSCollector::Stats         coletor;
+		SpatioTemporalIndex::Stats  indice;
+		HistoryStore::Stats         historico;
+		std::vector<TrackerState>   amostra;
+		std::vector<uint64_t>       consulta;
+		std::size_t                 pontos;
+	};
+	auto resumir = [&](GPSCollector& coletor){
+
+		Resumo r;
+		r.coletor   = coletor.stats();
+		r.indice    = coletor.index()->stats();
+		r.historico = coletor.history()->stats();
+		for(
+			std::size_t i = 1; i <= n_rastreadores; i += 997
+		){
+
+			TrackerState e{};
+			coletor.tracker_state(i, e);
+			r.amostra.push_back(e);
+		}
+		r.consulta = coletor.index()->query(IndexRegion::box(-22940000, -22900000, -43165000, -43163000),
+											INICIO_MS + 50000, INICIO_MS + 190000, coletor.history());
+		r.pontos   = coletor.history()->query(n_rastreadores / 2, INICIO_MS, INICIO_MS + N_FIXES * 1000LL, [](const CollectorFix&){});
+		return r;
+	};
+	auto iguais = [](const Resumo& a, const Resumo& b){
+
+		return a.coletor.fixes == b.coletor.fixes && a.coletor.rastreadores == b.coletor.rastreadores &&
+			   a.indice.adicoes == b.indice.adicoes && a.indice.repetidos == b.indice.repetidos && a.indice.chaves == b.indice.chaves &&
+			   a.indice.rastreadores == b.indice.rastreadores &&
+			   a.historico.fixes == b.historico.fixes && a.historico.blocos == b.historico.blocos && a.historico.bytes == b.historico.bytes &&
+			   a.historico.rastreadores == b.historico.rastreadores &&
+			   a.amostra.size() == b.amostra.size() &&
+			   std::memcmp(a.amostra.data(), b.amostra.data(), a.amostra.size() * sizeof(TrackerState)) == 0 &&
+			   a.consulta == b.consulta && a.pontos == b.pontos;
+	};
+
+	std::cout << n_rastreadores << " rastreadores, " << N_FIXES << " fixes cada (" << n_rastreadores * N_FIXES
+			  << " fixes), histórico, índice e reordenação" << std::endl;
+
+	char modelo_a[] = "/tmp/gpstrack_snap_XXXXXX";
+	char modelo_b[] = "/tmp/gpstrack_snap_XXXXXX";
+	std::string dir_wal  = ::mkdtemp(modelo_a);
+	std::string dir_snap = ::mkdtemp(modelo_b);
+
+	{
+		GPSCollector coletor(0, 1, n_rastreadores);
+		abrir(coletor, dir_wal);
+		ingerir(coletor, 0, N_FIXES);
+	}
+
+	GPSCollector::SnapshotInfo info{};
+	{
+		GPSCollector coletor(0, 1, n_rastreadores);
+		abrir(coletor, dir_snap);
+		ingerir(coletor, 0, CORTE);
+		coletor.write_snapshot(&info);
+		ingerir(coletor, CORTE, N_FIXES);
+	}
+	std::printf("snapshot apos %d fixes: %.1f MiB, pausa da ingestao %.1f ms, total %.1f ms, %zu segmentos do WAL removidos\n",
+				CORTE, info.bytes / 1048576.0, info.pausa_us / 1e3, info.total_us / 1e3, info.segmentos_removidos);
+
+	std::printf("\n%-28s %12s\n", "reinicio", "tempo (s)");
+
+	double t0 = agora_ns();
+	GPSCollector inteiro(0, 1, n_rastreadores);
+	abrir(inteiro, dir_wal);
+	double t_inteiro = (agora_ns() - t0) / 1e9;
+	std::printf("%-28s %12.3f\n", "WAL inteiro", t_inteiro);
+
+	t0 = agora_ns();
+	GPSCollector parcial(0, 1, n_rastreadores);
+	abrir(parcial, dir_snap);
+	double t_parcial = (agora_ns() - t0) / 1e9;
+	std::printf("%-28s %12.3f\n", "snapshot + final do WAL", t_parcial);
+
+	Resumo a = resumir(inteiro), b = resumir(parcial);
+	std::printf("\nestado identico: %s (%zu rastreadores, %llu fixes no historico, %zu na consulta)\n", iguais(a, b) ? "sim" : "NAO",
+				b.coletor.rastreadores, static_cast<unsigned long long>(b.historico.fixes), b.consulta.size());
+
+	remover_diretorio(dir_wal);
+	remover_diretorio(dir_snap);
+}
+
+/**
+ * @brief Mede a compactação do histórico e seu efeito na latência da ingestão.
+ * @details
+ * 
+ * A frota (GPSTRACK_BENCH_TRACKERS, 1000 por padrão) envia um fix por minuto durante
+ * GPSTRACK_BENCH_DIAS (14) dias até o instante atual. O coletor é reiniciado a cada 6 h
+ * (seal_all(), blocos pequenos), 2% dos fixes chegam até 10 posições atrasados e 0,5%
+ * duplicados. A política remove o que tem mais de 10 dias e reduz a um fix a cada 5 min
+ * o que tem mais de 3. Mede a latência de append() em lotes de 64, com uma thread de
+ * ingestão a 64 mil fixes/s, sem e com o compactador em execução; em seguida, a vazão
+ * da compactação e a ocupação antes e depois, e verifica ordem, retenção e redução.
+ */
+static void
+bench_compaction(){
+
+	std::size_t n_rastreadores = 1000;
+	int         n_dias         = 14;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_DIAS") ){ n_dias = std::atoi(env); }
+
+	const int64_t PERIODO_MS  = 60000;
+	const int64_t REINICIO_MS = 6 * 3600000LL;
+	const int64_t DIA_MS      = 86400000LL;
+
+	using namespace std::chrono;
+	int64_t agora  = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	int64_t inicio = agora - n_dias * DIA_MS;
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	HistoryStore historico(1024);
+	std::vector<CollectorFix> trecho;
+	for(
+		int64_t t_ini = inicio; t_ini < agora; t_ini += REINICIO_MS
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			trecho.clear();
+			for(
+				int64_t t = t_ini + static_cast<int64_t>(i % 60) * 1000; t < std::min(t_ini + REINICIO_MS, agora); t += PERIODO_MS
+			){
+
+				CollectorFix fix;
+				fix.tracker = i + 1;
+				fix.t_ms    = t;
+				fix.lat_e6  = -22955900 + static_cast<int32_t>((t - inicio) / PERIODO_MS % 5000) * 7;
+				fix.lon_e6  = -43165900 + static_cast<int32_t>(i) * 100;
+				trecho.push_back(fix);
+				if( aleatorio() < 0.005 ){ trecho.push_back(fix); }
+			}
+			for(
+				std::size_t k = 0; k + 1 < trecho.size(); k++
+			){
+
+				if( aleatorio() < 0.02 ){ std::swap(trecho[k], trecho[std::min(trecho.size() - 1, k + 1 + static_cast<std::size_t>(aleatorio() * 10))]); }
+			}
+			for( const CollectorFix& f : trecho ){ historico.append(f); }
+		}
+		historico.seal_all();
+	}
+
+	HistoryStore::Stats antes = historico.stats();
+	std::cout << n_rastreadores << " rastreadores, " << n_dias << " dias, " << antes.fixes << " fixes em " << antes.blocos
+			  << " blocos (" << antes.fixes / std::max<uint64_t>(antes.blocos, 1) << " fixes/bloco)" << std::endl;
+
+	// Ingestão ao vivo: lotes de 64 fixes a cada 1 ms, medindo append()
+	auto ingerir = [&](double segundos, int64_t t_base){
+
+		std::vector<double> latencias;
+		CollectorFix lote[64];
+		auto fim  = steady_clock::now() + duration<double>(segundos);
+		auto prox = steady_clock::now();
+		for(
+			uint64_t k = 0; steady_clock::now() < fim; k++
+		){
+
+			std::this_thread::sleep_until(prox);
+			prox += microseconds(1000);
+			for(
+				int j = 0; j < 64; j++
+			){
+
+				lote[j]         = CollectorFix{};
+				lote[j].tracker = (k * 64 + j) % n_rastreadores + 1;
+				lote[j].t_ms    = t_base + static_cast<int64_t>(k * 64 + j) / static_cast<int64_t>(n_rastreadores) * 1000 + 1;
+				lote[j].lat_e6  = -22955900;
+				lote[j].lon_e6  = -43165900 + static_cast<int32_t>(lote[j].tracker) * 100;
+			}
+			double t0 = agora_ns();
+			for( const CollectorFix& f : lote ){ historico.append(f); }
+			latencias.push_back((agora_ns() - t0) / 1e3);
+		}
+		std::sort(latencias.begin(), latencias.end());
+		return latencias;
+	};
+
+	HistoryStore::Politica politica;
+	politica.retencao_ms  = 10 * DIA_MS;
+	politica.reducao_ms   = 3 * DIA_MS;
+	politica.intervalo_ms = 300000;
+	HistoryCompactor compactador(historico, politica, 5000000, 3600000);
+
+	std::printf("\n%-30s %10s %10s %10s\n", "ingestao (lote de 64)", "p50 (us)", "p99 (us)", "max (us)");
+	std::vector<double> l = ingerir(2.0, agora);
+	std::printf("%-30s %10.1f %10.1f %10.1f\n", "sem compactacao", l[l.size() / 2], l[l.size() * 99 / 100], l.back());
+
+	compactador.init();
+	l = ingerir(2.0, agora + 3600000);
+	compactador.stop();
+	std::printf("%-30s %10.1f %10.1f %10.1f\n", "com compactador (5 M/s, nice 19)", l[l.size() / 2], l[l.size() * 99 / 100], l.back());
+
+	// Conclui a passada interrompida, sem limite de taxa
+	HistoryCompactor direto(historico, politica, 0);
+	direto.run(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+
+	HistoryStore::Stats     depois = historico.stats();
+	HistoryCompactor::Stats a = compactador.stats(), b = direto.stats();
+	std::printf("\ncompactacao: %.1f Mfixes/s (thread %.1f, direta %.1f), %llu expirados, %llu reduzidos ou duplicados\n",
+				(a.trabalho.fixes_lidos + b.trabalho.fixes_lidos) / std::max(a.ocupado_s + b.ocupado_s, 1e-9) / 1e6, a.fixes_s / 1e6, b.fixes_s / 1e6,
+				static_cast<unsigned long long>(a.trabalho.expirados + b.trabalho.expirados),
+				static_cast<unsigned long long>(a.trabalho.reduzidos + b.trabalho.reduzidos));
+	std::printf("%-12s %12s %10s %12s %12s\n", "", "fixes", "blocos", "fixes/bloco", "MiB");
+	std::printf("%-12s %12llu %10llu %12.0f %12.1f\n", "antes", static_cast<unsigned long long>(antes.fixes), static_cast<unsigned long long>(antes.blocos),
+				double(antes.fixes) / std::max<uint64_t>(antes.blocos, 1), antes.bytes / 1048576.0);
+	std::printf("%-12s %12llu %10llu %12.0f %12.1f\n", "depois", static_cast<unsigned long long>(depois.fixes), static_cast<unsigned long long>(depois.blocos),
+				double(depois.fixes) / std::max<uint64_t>(depois.blocos, 1), depois.bytes / 1048576.0);
+
+	// Verificação: instantes crescentes entre blocos, nada além da retenção e um fix por intervalo nos blocos reduzidos
+	bool ok = true;
+	std::vector<CollectorFix> fixes;
+	for(
+		std::size_t i = 1; i <= n_rastreadores; i += 37
+	){
+
+		int64_t anterior = INT64_MIN;
+		for(
+			const HistoryStore::Bloco& bloco : historico.blocks(i)
+		){
+
+			fixes.clear();
+			bloco->decode(fixes);
+			for(
+				const CollectorFix& f : fixes
+			){
+
+				ok = ok && f.t_ms > anterior && f.t_ms >= agora - politica.retencao_ms;
+				if( bloco->intervalo_ms > 0 ){ ok = ok && f.t_ms / bloco->intervalo_ms != anterior / bloco->intervalo_ms; }
+				anterior = f.t_ms;
+			}
+		}
+	}
+	std::cout << "verificacao: " << (ok ? "ok" : "FALHA") << std::endl;
+}
+
+/**
+ * @brief Compara CsvDecoder com CollectorFix::parse_csv (strtod) em lotes de 64 linhas.
+ * @details
+ * 
+ * As linhas seguem GPSTrack::GPSData::to_csv(), com centésimos de segundo, 1% de alertas e
+ * 0,5% de linhas fora do caso comum (vazias, com espaços, expoentes, casas extras ou
+ * inválidas), que exercitam o retorno a parse_csv. GPSTRACK_BENCH_LINHAS altera a
+ * quantidade (2 milhões por padrão). Os dois caminhos devem produzir os mesmos fixes.
+ */
+static void
+bench_csv(){
+
+	std::size_t n_linhas = 2000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_LINHAS") ){ n_linhas = std::strtoull(env, nullptr, 10); }
+
+	const int64_t RECV_MS = 1700000000000LL;
+	const std::size_t LOTE = 64;
+
+	static const char* ESTRANHAS[] = {
+		"", "123456.00", "123456.00,-22.9,-43.1", " 123456.00,-22.955900,-43.165900,12.3", "123456.00,-22.955900,-43.165900,1e2",
+		"123456.00,+22.955900,-43.165900,12.3", "123456.00,-22.9559001,-43.165900,12.3", "123456.00,-22.955900,-43.165900,12.35",
+		"123456.00,-95.000000,-43.165900,12.3", "123456.00,abc,-43.165900,12.3", "123456.00,-22.955900,-43.165900,12.3,B",
+		"123456.00,-22.955900,-43.165900,", "123456.00,-22.955900,-43.165900,-", "-1.00,-22.955900,-43.165900,12.3",
+		"123456.00,-22.955900,-43.165900,12.3,A", "123456.00,-22.955900,-43.165900,12.3,", "123456.00,--22.9,-43.1,1",
+		"123456.00,-22.95.59,-43.1,1", ".5,.5,-.5,5.", "123456.00,-22.955900,-43.165900,12345678901234567890.1234567890123456789012345678",
+	};
+
+	uint64_t x = 0x9E3779B97F4A7C15ULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return x; };
+
+	std::vector<char>     texto;
+	std::vector<uint32_t> inicio;
+	texto.reserve(n_linhas * 42);
+	for(
+		std::size_t i = 0; i < n_linhas; i++
+	){
+
+		char linha[96];
+		int  n = 0;
+		uint64_t r = aleatorio();
+		if( r % 200 == 0 ){ n = std::snprintf(linha, sizeof(linha), "%s", ESTRANHAS[(r >> 8) % (sizeof(ESTRANHAS) / sizeof(*ESTRANHAS))]); }
+		else{
+
+			int    seg = static_cast<int>((r >> 8) % 86400);
+			double lat = -22.9559 + static_cast<double>((r >> 24) % 200000) * 1e-5;
+			double lon = -43.1659 + static_cast<double>((r >> 40) % 200000) * 1e-5;
+			n = std::snprintf(linha, sizeof(linha), "%02d%02d%02d.%02d,%f,%f,%.1f%s",
+							  seg / 3600, (seg / 60) % 60, seg % 60, static_cast<int>(r % 100), lat, lon, 760.0 + (r % 5000) * 0.1 - 250.0,
+							  (r >> 60) == 0 ? ",A" : "");
+		}
+		inicio.push_back(static_cast<uint32_t>(texto.size()));
+		texto.insert(texto.end(), linha, linha + n);
+	}
+	inicio.push_back(static_cast<uint32_t>(texto.size()));
+
+	std::vector<std::string_view> linhas(n_linhas);
+	for( std::size_t i = 0; i < n_linhas; i++ ){ linhas[i] = std::string_view(texto.data() + inicio[i], inicio[i + 1] - inicio[i]); }
+
+	// Referência: parse_csv linha a linha
+	std::vector<CollectorFix> referencia(n_linhas);
+	std::vector<uint8_t>      valida(n_linhas);
+	double melhor_strtod = 1e30;
+	for(
+		int rep = 0; rep < 3; rep++
+	){
+
+		double t0 = agora_ns();
+		for(
+			std::size_t i = 0; i < n_linhas; i++
+		){
+
+			referencia[i] = CollectorFix{};
+			valida[i]     = CollectorFix::parse_csv(linhas[i], RECV_MS, referencia[i]);
+		}
+		melhor_strtod = std::min(melhor_strtod, agora_ns() - t0);
+	}
+
+	// Decodificador vetorial, em lotes de 64 como o recvmmsg do coletor
+	FixColumns colunas;
+	bool       ok = true;
+	double melhor_simd = 1e30;
+	for(
+		int rep = 0; rep < 3; rep++
+	){
+
+		double      t0     = agora_ns();
+		uint64_t    soma   = 0;
+		for(
+			std::size_t i = 0; i < n_linhas; i += LOTE
+		){
+
+			std::size_t n = std::min(LOTE, n_linhas - i);
+			CsvDecoder::decode(&linhas[i], n, RECV_MS, colunas);
+			soma += colunas.size();
+		}
+		melhor_simd = std::min(melhor_simd, agora_ns() - t0);
+		if( soma == 0 ){ ok = false; }
+	}
+
+	// Verificação: mesmas linhas válidas e mesmos valores
+	uint64_t validas = 0;
+	for(
+		std::size_t i = 0; i < n_linhas; i += LOTE
+	){
+
+		std::size_t n = std::min(LOTE, n_linhas - i);
+		CsvDecoder::decode(&linhas[i], n, RECV_MS, colunas);
+
+		std::size_t k = 0;
+		for(
+			std::size_t j = 0; j < n; j++
+		){
+
+			if( !valida[i + j] ){ continue; }
+			validas++;
+			if( k >= colunas.size() || colunas.linha[k] != j ){ ok = false; break; }
+
+			CollectorFix f = colunas.fix(k++, 0), r = referencia[i + j];
+			if( f.t_ms != r.t_ms || f.lat_e6 != r.lat_e6 || f.lon_e6 != r.lon_e6 || f.alt_dm != r.alt_dm || f.flags != r.flags ){ ok = false; }
+		}
+		if( k != colunas.size() ){ ok = false; }
+	}
+
+	double bytes = static_cast<double>(texto.size());
+	std::printf("%llu linhas (%llu validas), %.1f bytes/linha\n", static_cast<unsigned long long>(n_linhas),
+				static_cast<unsigned long long>(validas), bytes / n_linhas);
+	std::printf("%-22s %10s %12s %10s\n", "decodificador", "ns/linha", "Mlinhas/s", "MB/s");
+	std::printf("%-22s %10.1f %12.2f %10.0f\n", "parse_csv (strtod)", melhor_strtod / n_linhas, n_linhas / melhor_strtod * 1e3, bytes / melhor_strtod * 1e3);
+	std::printf("%-22s %10.1f %12.2f %10.0f\n", "CsvDecoder (colunas)", melhor_simd / n_linhas, n_linhas / melhor_simd * 1e3, bytes / melhor_simd * 1e3);
+	std::printf("aceleracao: %.1fx\n", melhor_strtod / melhor_simd);
+	std::cout << "verificacao: " << (ok ? "ok" : "FALHA") << std::endl;
+}
+
+/**
+ * @brief Mede a TrackerTable em memória local ao nó e em páginas enormes e a localidade
+ * NUMA da recepção.
+ * @details
+ * 
+ * 1. Atualizações e leituras em ordem aleatória de GPSTRACK_BENCH_TRACKERS rastreadores
+ *    (2 milhões por padrão) com a tabela em aligned_alloc (páginas de 4 KiB), em NumaArena
+ *    (páginas enormes) e em NumaArena com a partição por nó.
+ * 2. Uma thread presa a cada nó atualiza rastreadores do seu nó (como com o programa
+ *    SO_REUSEPORT) ou quaisquer rastreadores (como com o hash do kernel); os acessos remotos
+ *    são contados pelo nó em que a memória de cada shard reside.
+ * 3. Ingestão UDP pelo loopback com o coletor em modo NUMA, com o programa BPF instalado.
+ * 
+ * Com um único nó, as fases 2 e 3 não têm acessos remotos; a diferença só aparece em
+ * servidores com mais de um soquete.
+ */
+static void
+bench_numa(){
+
+	std::size_t n_rastreadores = 2000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+
+	const NumaTopology& topologia = NumaTopology::system();
+	std::printf("%zu no(s) NUMA:", topologia.nodes());
+	for( std::size_t no = 0; no < topologia.nodes(); no++ ){ std::printf(" node%d (%zu CPUs)", topologia.node_id(no), topologia.cpus_of(no).size()); }
+	std::printf("\n\n");
+
+	// Identificadores como os de CollectorFix::tracker_id(): IPv4 << 16 | porta
+	std::vector<uint64_t> chaves(n_rastreadores);
+	for( std::size_t i = 0; i < n_rastreadores; i++ ){ chaves[i] = (uint64_t(0x0A000000 + (i >> 10)) << 16) | (20000 + (i & 1023)); }
+
+	std::vector<uint64_t> ordem(chaves);
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	for(
+		std::size_t i = ordem.size(); i > 1; i--
+	){
+
+		x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+		std::swap(ordem[i - 1], ordem[x % i]);
+	}
+
+	CollectorFix fix;
+	fix.t_ms   = 1700000000000LL;
+	fix.lat_e6 = -22955900;
+	fix.lon_e6 = -43165900;
+
+	auto atualizar = [&](TrackerTable<TrackerState>& tabela, uint64_t chave){
+
+		fix.tracker = chave;
+		fix.t_ms   += 1000;
+		tabela.update(chave, [&](TrackerState& e, bool novo){ e.apply(fix, novo); });
+	};
+
+	// 1. Páginas de 4 KiB e páginas enormes
+	std::printf("%-28s %8s %12s %12s %16s\n", "tabela", "MiB", "ns/atualiz.", "ns/leitura", "paginas enormes");
+	const char* nomes[] = { "aligned_alloc (4 KiB)", "NumaArena (paginas enormes)", "NumaArena + particao por no" };
+	for(
+		int modo = 0; modo < 3; modo++
+	){
+
+		uint64_t thp_antes = NumaArena::process_thp_bytes();
+		uint64_t hugetlb   = NumaArena::stats().bytes_hugetlb;
+
+		std::unique_ptr<TrackerTable<TrackerState>> tabela(
+			modo ? new TrackerTable<TrackerState>(n_rastreadores, 16, NumaArena::allocate, NumaArena::release, modo == 2 ? NumaTopology::shard_of_tracker : nullptr)
+				 : new TrackerTable<TrackerState>(n_rastreadores)
+		);
+		for( uint64_t c : chaves ){ atualizar(*tabela, c); }
+
+		double melhor = 1e30, melhor_leitura = 1e30;
+		TrackerState estado;
+		uint64_t     soma = 0;
+		for(
+			int rep = 0; rep < 3; rep++
+		){
+
+			double t0 = agora_ns();
+			for( uint64_t c : ordem ){ atualizar(*tabela, c); }
+			double t1 = agora_ns();
+			for( uint64_t c : ordem ){ if( tabela->read(c, estado) ){ soma++; } }
+			melhor         = std::min(melhor, (t1 - t0) / ordem.size());
+			melhor_leitura = std::min(melhor_leitura, (agora_ns() - t1) / ordem.size());
+		}
+		if( soma != 3 * ordem.size() ){ std::cout << "\033[1;31mLeituras falharam\033[0m" << std::endl; }
+
+		uint64_t enormes = (NumaArena::process_thp_bytes() - std::min(thp_antes, NumaArena::process_thp_bytes())) + (NumaArena::stats().bytes_hugetlb - hugetlb);
+		std::printf("%-28s %8.0f %12.1f %12.1f %12.0f MiB\n", nomes[modo],
+					tabela->capacity() * double(TAM_LINHA_CACHE) / 1048576.0, melhor, melhor_leitura, enormes / 1048576.0);
+	}
+
+	// 2. Localidade: cada thread presa a um nó, com e sem a distribuição por nó
+	TrackerTable<TrackerState> tabela(n_rastreadores, std::max<std::size_t>(16, topologia.nodes()), NumaArena::allocate, NumaArena::release, NumaTopology::shard_of_tracker);
+	for( uint64_t c : chaves ){ atualizar(tabela, c); }
+
+	std::vector<int> no_shard(tabela.shard_count());
+	for( std::size_t i = 0; i < no_shard.size(); i++ ){ no_shard[i] = std::max(topologia.node_of_address(tabela.shard_memory(i)), 0); }
+
+	int n_threads = static_cast<int>(topologia.nodes());
+	std::printf("\n%-28s %12s %12s %14s\n", "distribuicao", "threads", "Matualiz./s", "remotos");
+	for(
+		int modo = 0; modo < 2; modo++
+	){
+
+		std::atomic<uint64_t> total{0}, remotos{0};
+		double dt = em_paralelo(n_threads, [&](int t){
+
+			topologia.pin_thread(t);
+			CollectorFix f = fix;
+			uint64_t n = 0, r = 0;
+			for(
+				uint64_t c : ordem
+			){
+
+				if( modo == 0 && topologia.node_of_tracker(c) != static_cast<std::size_t>(t) ){ continue; }
+				if( modo == 1 && (c * 0x9e3779b97f4a7c15ULL >> 32) % n_threads != static_cast<uint64_t>(t) ){ continue; }
+
+				f.tracker = c;
+				f.t_ms   += 1000;
+				tabela.update(c, [&](TrackerState& e, bool novo){ e.apply(f, novo); });
+				r += (no_shard[tabela.shard_of(c)] != topologia.current_node());
+				n++;
+			}
+			total   += n;
+			remotos += r;
+		});
+		std::printf("%-28s %12d %12.2f %13.1f%%\n", modo ? "hash do kernel" : "por no (SO_REUSEPORT BPF)", n_threads,
+					total / dt / 1e6, 100.0 * remotos / std::max<uint64_t>(total, 1));
+	}
+
+	// 3. Ingestão UDP pelo loopback com o coletor em modo NUMA
+	const int PORTA = 47931;
+	GPSCollector coletor(PORTA, 2, 1 << 14, true);
+	coletor.init();
+
+	std::vector<int> origens(256);
+	sockaddr_in destino{};
+	destino.sin_family      = AF_INET;
+	destino.sin_port        = ::htons(PORTA);
+	destino.sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+	for( int& fd : origens ){ fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0); }
+
+	uint64_t enviados = 0;
+	for(
+		int rodada = 0; rodada < 100; rodada++
+	){
+
+		for(
+			std::size_t i = 0; i < origens.size(); i++
+		){
+
+			int  seg = 43200 + rodada;
+			char linha[64];
+			int  n = std::snprintf(linha, sizeof(linha), "%02d%02d%02d.00,%f,%f,760.0\n", seg / 3600, (seg / 60) % 60, seg % 60, -22.9559 + i * 1e-4, -43.1659);
+			if( ::sendto(origens[i], linha, n, 0, reinterpret_cast<const sockaddr*>(&destino), sizeof(destino)) == n ){ enviados++; }
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	coletor.stop();
+	for( int fd : origens ){ ::close(fd); }
+
+	GPSCollector::Stats st = coletor.stats();
+	std::printf("\ncoletor NUMA (2 threads, %zu rastreadores): %llu/%llu fixes, %llu acessos locais, %llu remotos\n",
+				origens.size(), static_cast<unsigned long long>(st.fixes), static_cast<unsigned long long>(enviados),
+				static_cast<unsigned long long>(st.acessos_locais), static_cast<unsigned long long>(st.acessos_remotos));
+}
+
+/**
+ * @brief Pico de memória residente do processo, em KiB.
+ */
+static long
+rss_max_kib(){
+
+	rusage uso{};
+	::getrusage(RUSAGE_SELF, &uso);
+	return uso.ru_maxrss;
+}
+
+/**
+ * @brief Compara a exportação em fluxo do histórico com a conversão a partir de texto CSV.
+ * @details
+ * 
+ * GPSTRACK_BENCH_TRACKERS rastreadores (200 por padrão) com GPSTRACK_BENCH_FIXES fixes
+ * cada (20 mil), a 1 Hz, com reinícios (seal_all()) a cada 5 mil fixes e 1% dos fixes fora
+ * de ordem, sem compactação. O caminho de referência relê um CSV da frota inteira com
+ * strtod, ordena em memória e escreve GPX com fprintf; os exportadores leem os blocos do
+ * histórico. As fases em fluxo rodam antes da referência, pois o pico de memória residente
+ * só cresce. Ao final, arquivos colunares e GPX são relidos e conferidos com o histórico.
+ */
+static void
+bench_export(){
+
+	std::size_t n_rastreadores = 200;
+	std::size_t n_fixes        = 20000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_FIXES") ){ n_fixes = std::strtoull(env, nullptr, 10); }
+
+	const int64_t INICIO = 1700000000000LL;
+	auto id = [](std::size_t i){ return (static_cast<uint64_t>(0x0A000000u + i) << 16) | 40000u; };
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	HistoryStore historico(1024);
+	std::vector<CollectorFix> trecho;
+	for(
+		std::size_t k0 = 0; k0 < n_fixes; k0 += 5000
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			trecho.clear();
+			for(
+				std::size_t k = k0; k < std::min(k0 + 5000, n_fixes); k++
+			){
+
+				CollectorFix fix;
+				fix.tracker = id(i);
+				fix.t_ms    = INICIO + static_cast<int64_t>(k) * 1000 + static_cast<int64_t>(i % 1000);
+				fix.lat_e6  = -22955900 + static_cast<int32_t>(k % 20000) * 9 - static_cast<int32_t>(i) * 50;
+				fix.lon_e6  = -43165900 + static_cast<int32_t>(k % 7000) * 13 + static_cast<int32_t>(i) * 50;
+				fix.alt_dm  = 7600 + static_cast<int32_t>(k % 100);
+				trecho.push_back(fix);
+			}
+			for(
+				std::size_t k = 0; k + 1 < trecho.size(); k++
+			){
+
+				if( aleatorio() < 0.01 ){ std::swap(trecho[k], trecho[std::min(trecho.size() - 1, k + 1 + static_cast<std::size_t>(aleatorio() * 10))]); }
+			}
+			for( const CollectorFix& f : trecho ){ historico.append(f); }
+		}
+		historico.seal_all();
+	}
+
+	HistoryStore::Stats h = historico.stats();
+	std::cout << n_rastreadores << " rastreadores, " << h.fixes << " fixes em " << h.blocos << " blocos ("
+			  << (h.bytes >> 20) << " MiB comprimidos)" << std::endl;
+
+	std::string dir = "/tmp/gpstrack_bench_export";
+	remover_diretorio(dir);
+	int n_hw = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+	std::printf("\n%-30s %8s %10s %12s %10s %10s %10s\n", "exportacao", "threads", "s", "Mfixes/s", "MiB", "MiB/s", "RSS +MiB");
+	auto linha = [&](const char* nome, int threads, double s, uint64_t fixes, uint64_t bytes, long rss_antes){
+
+		std::printf("%-30s %8d %10.2f %12.2f %10.1f %10.1f %10.1f\n", nome, threads, s, fixes / s / 1e6, bytes / 1048576.0,
+					bytes / 1048576.0 / s, (rss_max_kib() - rss_antes) / 1024.0);
+	};
+
+	TrackExporter exportador(historico);
+	struct { const char* nome; TrackExporter::Formato formato; int threads; } fases[] = {
+		{ "GPX",     TrackExporter::Formato::GPX,     1    },
+		{ "GPX",     TrackExporter::Formato::GPX,     n_hw },
+		{ "KML",     TrackExporter::Formato::KML,     n_hw },
+		{ "colunar", TrackExporter::Formato::COLUNAR, n_hw },
+	};
+	bool ok = true;
+	for(
+		const auto& f : fases
+	){
+
+		long rss = rss_max_kib();
+		TrackExporter::Resultado r = exportador.export_all(dir, f.formato, INT64_MIN, INT64_MAX, f.threads);
+		linha(f.nome, f.threads, r.segundos, r.fixes, r.bytes, rss);
+		ok = ok && r.falhas == 0 && r.arquivos == n_rastreadores && r.fixes == h.fixes;
+
+		// Verificação: os arquivos relidos coincidem com o histórico ordenado
+		for(
+			std::size_t i = 0; f.formato != TrackExporter::Formato::KML && i < n_rastreadores; i += 17
+		){
+
+			std::vector<CollectorFix> esperado;
+			historico.query(id(i), INT64_MIN, INT64_MAX, [&](const CollectorFix& fix){ esperado.push_back(fix); });
+			std::stable_sort(esperado.begin(), esperado.end(), [](const CollectorFix& a, const CollectorFix& b){ return a.t_ms < b.t_ms; });
+
+			std::string caminho = dir + "/" + TrackExporter::file_name(id(i)) + TrackExporter::extension(f.formato);
+			std::size_t k = 0;
+			if(
+				f.formato == TrackExporter::Formato::COLUNAR
+			){
+
+				uint64_t tracker = 0;
+				ok = ok && ColumnarTrackFile::read(caminho, tracker, [&](const CollectorFix& fix){
+
+					ok = ok && k < esperado.size() && fix.t_ms == esperado[k].t_ms && fix.lat_e6 == esperado[k].lat_e6 &&
+						 fix.lon_e6 == esperado[k].lon_e6 && fix.alt_dm == esperado[k].alt_dm;
+					k++;
+				}) && tracker == id(i);
+			}
+			else if(
+				std::FILE* arq = std::fopen(caminho.c_str(), "r")
+			){
+
+				char l[256];
+				while(
+					std::fgets(l, sizeof(l), arq)
+				){
+
+					double lat = 0, lon = 0, alt = 0;
+					if( std::sscanf(l, "<trkpt lat=\"%lf\" lon=\"%lf\"><ele>%lf", &lat, &lon, &alt) != 3 ){ continue; }
+					ok = ok && k < esperado.size() && std::llround(lat * 1e6) == esperado[k].lat_e6 &&
+						 std::llround(lon * 1e6) == esperado[k].lon_e6 && std::llround(alt * 10) == esperado[k].alt_dm;
+					k++;
+				}
+				std::fclose(arq);
+			}
+			ok = ok && k == esperado.size();
+		}
+		remover_diretorio(dir);
+	}
+
+	// Referência: CSV da frota relido com strtod, ordenado em memória e escrito com fprintf
+	std::string csv = "/tmp/gpstrack_bench_export.csv";
+	if(
+		std::FILE* arq = std::fopen(csv.c_str(), "w")
+	){
+
+		for(
+			std::size_t i = 0; i < n_rastreadores; i++
+		){
+
+			historico.query(id(i), INT64_MIN, INT64_MAX, [&](const CollectorFix& fix){
+
+				std::fprintf(arq, "%llu,%lld,%.6f,%.6f,%.1f\n", static_cast<unsigned long long>(fix.tracker), static_cast<long long>(fix.t_ms), fix.lat(), fix.lon(), fix.alt());
+			});
+		}
+		std::fclose(arq);
+	}
+
+	long   rss = rss_max_kib();
+	double t0  = agora_ns();
+
+	std::string texto;
+	if(
+		std::FILE* arq = std::fopen(csv.c_str(), "r")
+	){
+
+		char bloco[1 << 16];
+		std::size_t k;
+		while( (k = std::fread(bloco, 1, sizeof(bloco), arq)) > 0 ){ texto.append(bloco, k); }
+		std::fclose(arq);
+	}
+
+	std::vector<CollectorFix> todos;
+	for(
+		const char* p = texto.c_str(); *p;
+	){
+
+		char* fim = nullptr;
+		CollectorFix fix;
+		fix.tracker = std::strtoull(p, &fim, 10);
+		fix.t_ms    = std::strtoll(fim + 1, &fim, 10);
+		fix.lat_e6  = static_cast<int32_t>(std::llround(std::strtod(fim + 1, &fim) * 1e6));
+		fix.lon_e6  = static_cast<int32_t>(std::llround(std::strtod(fim + 1, &fim) * 1e6));
+		fix.alt_dm  = static_cast<int32_t>(std::llround(std::strtod(fim + 1, &fim) * 10));
+		todos.push_back(fix);
+		p = fim + (*fim == '\n');
+	}
+	std::stable_sort(todos.begin(), todos.end(), [](const CollectorFix& a, const CollectorFix& b){ return a.tracker != b.tracker ? a.tracker < b.tracker : a.t_ms < b.t_ms; });
+
+	::mkdir(dir.c_str(), 0755);
+	uint64_t bytes = 0;
+	for(
+		std::size_t i = 0; i < todos.size();
+	){
+
+		std::string caminho = dir + "/" + TrackExporter::file_name(todos[i].tracker) + ".gpx";
+		std::FILE*  arq     = std::fopen(caminho.c_str(), "w");
+		if( !arq ){ ok = false; break; }
+
+		std::fprintf(arq, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<gpx version=\"1.1\" creator=\"GPSCollector\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n<trk><name>%s</name><trkseg>\n",
+					 TrackExporter::file_name(todos[i].tracker).c_str());
+		uint64_t tracker = todos[i].tracker;
+		for(
+			; i < todos.size() && todos[i].tracker == tracker; i++
+		){
+
+			time_t seg = static_cast<time_t>(todos[i].t_ms / 1000);
+			tm     utc{};
+			char   hora[32];
+			::gmtime_r(&seg, &utc);
+			std::strftime(hora, sizeof(hora), "%Y-%m-%dT%H:%M:%S", &utc);
+			std::fprintf(arq, "<trkpt lat=\"%.6f\" lon=\"%.6f\"><ele>%.1f</ele><time>%s.%03dZ</time></trkpt>\n",
+						 todos[i].lat(), todos[i].lon(), todos[i].alt(), hora, static_cast<int>(todos[i].t_ms % 1000));
+		}
+		std::fputs("</trkseg></trk>\n</gpx>\n", arq);
+		bytes += static_cast<uint64_t>(std::ftell(arq));
+		std::fclose(arq);
+	}
+	linha("CSV -> GPX (strtod, fprintf)", 1, (agora_ns() - t0) / 1e9, todos.size(), bytes, rss);
+
+	::unlink(csv.c_str());
+	remover_diretorio(dir);
+	std::cout << "verificacao: " << (ok ? "ok" : "FALHA") << std::endl;
+}
+
+/**
+ * @brief Compara o RuleEngine com a interpretação da árvore de cada regra a cada fix.
+ * @details
+ * 
+ * GPSTRACK_BENCH_REGRAS regras (4000 por padrão) sobre 1000 zonas circulares de 300 m:
+ * metade "vel > X e zona Z", e as demais noturnas com tempo parado, de alerta fora de
+ * zona, de velocidade em faixas de latitude e longitude e de perda de sinal. A frota
+ * (GPSTRACK_BENCH_TRACKERS, 10 mil) alterna deslocamentos e paradas, com um fix a cada
+ * 10 s, somando GPSTRACK_BENCH_FIXES fixes (1 milhão). A árvore é avaliada, com o mesmo
+ * estado por rastreador, sobre os primeiros 5% dos fixes, e a quantidade de disparos deve
+ * coincidir com a do RuleEngine sobre os mesmos fixes.
+ */
+static void
+bench_rules(){
+
+	std::size_t n_regras       = 4000;
+	std::size_t n_rastreadores = 10000;
+	std::size_t n_fixes        = 1000000;
+	if( const char* env = std::getenv("GPSTRACK_BENCH_REGRAS") ){ n_regras = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_TRACKERS") ){ n_rastreadores = std::strtoull(env, nullptr, 10); }
+	if( const char* env = std::getenv("GPSTRACK_BENCH_FIXES") ){ n_fixes = std::strtoull(env, nullptr, 10); }
+
+	const double   LAT0 = -23.0, LON0 = -43.5, LADO = 0.3;
+	const uint32_t N_ZONAS = 1000;
+
+	uint64_t x = 0x2545F4914F6CDD1DULL;
+	auto aleatorio = [&]{ x ^= x << 13; x ^= x >> 7; x ^= x << 17; return (x >> 11) * (1.0 / 9007199254740992.0); };
+
+	std::vector<Fence> cercas;
+	for( uint32_t z = 0; z < N_ZONAS; z++ ){ cercas.push_back(Fence::circle(z, LAT0 + aleatorio() * LADO, LON0 + aleatorio() * LADO, 300)); }
+
+	std::string texto = "fuso -3\nparado_m 50\n";
+	for(
+		std::size_t i = 0; i < n_regras; i++
+	){
+
+		char linha[160];
+		uint32_t z = static_cast<uint32_t>(aleatorio() * N_ZONAS);
+		int      v = 40 + 20 * static_cast<int>(aleatorio() * 5);
+		switch(
+			i % 10
+		){
+
+			case 0: case 1: case 2: case 3: case 4:
+				std::snprintf(linha, sizeof(linha), "regra %zu vel > %d e zona %u\n", i, v, z); break;
+			case 5: case 6:
+				std::snprintf(linha, sizeof(linha), "regra %zu parado > %d e (hora >= 22 ou hora < 6)\n", i, 600 * (1 + static_cast<int>(aleatorio() * 3))); break;
+			case 7:
+				std::snprintf(linha, sizeof(linha), "regra %zu alerta e nao zona %u\n", i, z); break;
+			case 8:
+				std::snprintf(linha, sizeof(linha), "regra %zu vel > %d e (lat > %.3f ou lon < %.3f)\n", i, v, LAT0 + aleatorio() * LADO, LON0 + aleatorio() * LADO); break;
+			default:
+				std::snprintf(linha, sizeof(linha), "regra %zu intervalo > 300 ou alt > %d\n", i, 1000 + static_cast<int>(aleatorio() * 1000)); break;
+		}
+		texto += linha;
+	}
+
+	double t0 = agora_ns();
+	std::unique_ptr<RuleSet> compiladas = RuleSet::compile(texto, cercas);
+	double t_compilar = (agora_ns() - t0) / 1e6;
+
+	std::cout << n_regras << " regras compiladas em " << t_compilar << " ms: " << compiladas->codigo.size() << " instrucoes, "
+			  << compiladas->predicados.size() << " predicados distintos, " << compiladas->livres.size() << " sem zona" << std::endl;
+
+	// Frota: deslocamentos e paradas alternados, a partir das 20 h locais
+	struct Movel { double lat, lon, rumo, vel_ms; int parado; };
+	std::vector<Movel> frota(n_rastreadores);
+	for( Movel& m : frota ){ m = { LAT0 + aleatorio() * LADO, LON0 + aleatorio() * LADO, aleatorio() * 6.283, 5 + aleatorio() * 30, 0 }; }
+
+	const int64_t INICIO = 1700000000000LL - 1700000000000LL % 86400000 + 23 * 3600000LL;
+	std::vector<CollectorFix> fixes(n_fixes);
+	for(
+		std::size_t k = 0; k < n_fixes; k++
+	){
+
+		std::size_t i = k % n_rastreadores;
+		Movel&      m = frota[i];
+		if( m.parado > 0 ){ m.parado--; }
+		else if( aleatorio() < 0.01 ){ m.parado = 20 + static_cast<int>(aleatorio() * 400); }
+		else{
+
+			m.rumo  += (aleatorio() - 0.5) * 0.5;
+			m.vel_ms = std::max(0.0, std::min(40.0, m.vel_ms + (aleatorio() - 0.5) * 4));
+			m.lat   += std::cos(m.rumo) * m.vel_ms * 10 / 111000;
+			m.lon   += std::sin(m.rumo) * m.vel_ms * 10 / 102000;
+			if( m.lat < LAT0 || m.lat > LAT0 + LADO || m.lon < LON0 || m.lon > LON0 + LADO ){ m.rumo += 3.1416; }
+		}
+
+		CollectorFix& f = fixes[k];
+		f.tracker = (static_cast<uint64_t>(0x0A000000u + i) << 16) | 40000u;
+		f.t_ms    = INICIO + static_cast<int64_t>(k / n_rastreadores) * 10000 + static_cast<int64_t>(i % 1000) * 7;
+		f.lat_e6  = static_cast<int32_t>(std::lround(m.lat * 1e6));
+		f.lon_e6  = static_cast<int32_t>(std::lround(m.lon * 1e6));
+		f.alt_dm  = static_cast<int32_t>(7000 + aleatorio() * 2000);
+		f.flags   = aleatorio() < 0.002 ? CollectorFix::FLAG_ALERTA : 0;
+	}
+
+	// Referência: árvore de cada regra, reconstruída do bytecode, avaliada a cada fix
+	struct No { RuleSet::Op op; uint32_t arg; int a, b; };
+	std::vector<No>  nos;
+	std::vector<int> raizes;
+	for(
+		const RuleSet::Regra& r : compiladas->regras
+	){
+
+		std::vector<int> pilha;
+		for(
+			uint32_t k = r.ini; k < r.fim; k++
+		){
+
+			const RuleSet::Instrucao& in = compiladas->codigo[k];
+			No no{ in.op, in.arg, -1, -1 };
+			if( in.op == RuleSet::Op::E || in.op == RuleSet::Op::OU ){ no.b = pilha.back(); pilha.pop_back(); }
+			if( in.op == RuleSet::Op::E || in.op == RuleSet::Op::OU || in.op == RuleSet::Op::NAO ){ no.a = pilha.back(); pilha.pop_back(); }
+			nos.push_back(no);
+			pilha.push_back(static_cast<int>(nos.size() - 1));
+		}
+		raizes.push_back(pilha.back());
+	}
+
+	struct EstadoArvore { int64_t t_ms, ancora_ms; int32_t lat, lon, anc_lat, anc_lon; float vel_kmh; std::vector<uint32_t> ativas; };
+	FenceIndex zonas(cercas);
+	const RuleSet& s = *compiladas;
+
+	auto arvore = [&](std::size_t n){
+
+		std::unordered_map<uint64_t, EstadoArvore> estados;
+		std::vector<uint32_t> dentro, atuais;
+		uint64_t disparos = 0;
+
+		std::function<bool(int, const int32_t*)> avaliar = [&](int i, const int32_t* c) -> bool {
+
+			const No& no = nos[i];
+			switch(
+				no.op
+			){
+
+				case RuleSet::Op::E   : return avaliar(no.a, c) && avaliar(no.b, c);
+				case RuleSet::Op::OU  : return avaliar(no.a, c) || avaliar(no.b, c);
+				case RuleSet::Op::NAO : return !avaliar(no.a, c);
+				case RuleSet::Op::ZONA: return std::binary_search(dentro.begin(), dentro.end(), no.arg);
+				default:
+				{
+					const RuleSet::Predicado& p = s.predicados[no.arg];
+					int32_t v = c[p.coluna];
+					switch(
+						p.comparacao
+					){
+
+						case RuleSet::Comparacao::MAIOR       : return v >  p.valor;
+						case RuleSet::Comparacao::MAIOR_IGUAL : return v >= p.valor;
+						case RuleSet::Comparacao::MENOR       : return v <  p.valor;
+						case RuleSet::Comparacao::MENOR_IGUAL : return v <= p.valor;
+						case RuleSet::Comparacao::IGUAL       : return v == p.valor;
+						default                               : return v != p.valor;
+					}
+				}
+			}
+		};
+
+		for(
+			std::size_t k = 0; k < n; k++
+		){
+
+			const CollectorFix& f = fixes[k];
+			auto it = estados.find(f.tracker);
+			int32_t c[RuleSet::N_COLUNAS] = {};
+			if(
+				it == estados.end()
+			){
+
+				it = estados.emplace(f.tracker, EstadoArvore{ f.t_ms, f.t_ms, f.lat_e6, f.lon_e6, f.lat_e6, f.lon_e6, 0, {} }).first;
+			}
+			else{
+
+				EstadoArvore& e = it->second;
+				int64_t dt = f.t_ms - e.t_ms;
+				if( dt > 0 ){ e.vel_kmh = static_cast<float>(GPSFix::distance_m(e.lat * 1e-6, e.lon * 1e-6, f.lat(), f.lon()) / dt * 3600.0); }
+				if( GPSFix::distance_m(e.anc_lat * 1e-6, e.anc_lon * 1e-6, f.lat(), f.lon()) > s.raio_parado_m ){ e.anc_lat = f.lat_e6; e.anc_lon = f.lon_e6; e.ancora_ms = f.t_ms; }
+				c[RuleSet::VEL]       = static_cast<int32_t>(std::min(e.vel_kmh * 10.0f, 2e9f));
+				c[RuleSet::PARADO]    = static_cast<int32_t>((f.t_ms - e.ancora_ms) / 1000);
+				c[RuleSet::INTERVALO] = static_cast<int32_t>(dt / 1000);
+				e.t_ms = f.t_ms; e.lat = f.lat_e6; e.lon = f.lon_e6;
+			}
+			int64_t minutos = (f.t_ms / 60000 + s.fuso_min) % 1440;
+			c[RuleSet::LAT]    = f.lat_e6;
+			c[RuleSet::LON]    = f.lon_e6;
+			c[RuleSet::ALT]    = f.alt_dm;
+			c[RuleSet::HORA]   = static_cast<int32_t>(minutos < 0 ? minutos + 1440 : minutos);
+			c[RuleSet::ALERTA] = (f.flags & CollectorFix::FLAG_ALERTA) ? 1 : 0;
+
+			dentro.clear();
+			zonas.query(f.lat_e6, f.lon_e6, [&](uint32_t id){ dentro.push_back(id); });
+			std::sort(dentro.begin(), dentro.end());
+
+			atuais.clear();
+			for( std::size_t r = 0; r < raizes.size(); r++ ){ if( avaliar(raizes[r], c) ){ atuais.push_back(s.regras[r].id); } }
+			std::sort(atuais.begin(), atuais.end());
+			if( atuais.size() > RuleEngine::MAX_ATIVAS ){ atuais.resize(RuleEngine::MAX_ATIVAS); }
+
+			std::vector<uint32_t>& antes = it->second.ativas;
+			for( uint32_t id : atuais ){ if( !std::binary_search(antes.begin(), antes.end(), id) ){ disparos++; } }
+			antes = atuais;
+		}
+		return disparos;
+	};
+
+	std::size_t n_arvore = std::max<std::size_t>(n_fixes / 20, 1);
+	std::printf("\n%-28s %10s %10s %12s %14s %10s\n", "avaliacao", "fixes", "s", "Mfixes/s", "regras/lote", "disparos");
+
+	t0 = agora_ns();
+	uint64_t disparos_arvore = arvore(n_arvore);
+	double   s_arvore = (agora_ns() - t0) / 1e9;
+	std::printf("%-28s %10zu %10.2f %12.3f %14zu %10llu\n", "arvore por fix", n_arvore, s_arvore, n_arvore / s_arvore / 1e6, n_regras,
+				static_cast<unsigned long long>(disparos_arvore));
+
+	auto motor = [&](std::size_t n, const char* nome){
+
+		RuleEngine regras(n_rastreadores * 2);
+		regras.publish(RuleSet::compile(texto, cercas));
+
+		double ini = agora_ns();
+		for( std::size_t k = 0; k < n; k += RuleEngine::LOTE ){ regras.apply(fixes.data() + k, std::min(RuleEngine::LOTE, n - k)); }
+		double seg = (agora_ns() - ini) / 1e9;
+
+		RuleEngine::Stats st = regras.stats();
+		std::printf("%-28s %10zu %10.2f %12.3f %14.0f %10llu\n", nome, n, seg, n / seg / 1e6, double(st.avaliadas) / std::max<uint64_t>(st.lotes, 1),
+					static_cast<unsigned long long>(st.disparos));
+		return st.disparos;
+	};
+
+	uint64_t disparos_motor = motor(n_arvore, "RuleEngine (bytecode, SoA)");
+	motor(n_fixes, "RuleEngine (bytecode, SoA)");
+
+	std::cout << "verificacao: " << (disparos_motor == disparos_arvore ? "ok" : "FALHA") << std::endl;
+}
+
+int main(
+	int argc,
+	char* argv[]
+){
+
+	struct { const char* nome; void (*fn)(); } benchmarks[] = {
+		{ "bus", bench_bus },
+		{ "arena", bench_arena },
+		{ "tracker_table", bench_tracker_table },
+		{ "wal", bench_wal },
+		{ "history", bench_history },
+		{ "lod", bench_lod },
+		{ "heatmap", bench_heatmap },
+		{ "scan", bench_scan },
+		{ "index", bench_index },
+		{ "trips", bench_trips },
+		{ "convoy", bench_convoy },
+		{ "geofence", bench_geofence },
+		{ "mapmatch", bench_mapmatch },
+		{ "subscriptions", bench_subscriptions },
+		{ "reorder", bench_reorder },
+		{ "admission", bench_admission },
+		{ "snapshot", bench_snapshot },
+		{ "compaction", bench_compaction },
+		{ "csv", bench_csv },
+		{ "numa", bench_numa },
+		{ "export", bench_export },
+		{ "rules", bench_rules },
+#ifdef GPSLOOP_DISPONIVEL
+		{ "loop_timers", bench_loop_timers },
+		{ "loop_pipes",  bench_loop_pipes  },
+#endif
+	};
+
+	for(
+		const auto& b : benchmarks
+	){
+
+		bool selecionado = (argc == 1);
+		for( int i = 1; i < argc; i++ ){ if( std::strcmp(argv[i], b.nome) == 0 ){ selecionado = true; } }
+		if( !selecionado ){ continue; }
+
+		std::cout << "\033[1;36m[BENCH] " << b.nome << "\033[0m" << std::endl;
+		b.fn();
+	}
+
+	return 0;
+}
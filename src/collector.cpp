@@ -0,0 +1,316 @@
+/**
+ * @file collector.cpp
+ * @brief Responsável por executar o coletor no servidor.
+ * @details
+ * Execução: `./GPSCollector <porta> [--threads N] [--rastreadores N] [--numa 0|1] [--historico fixes_por_bloco] [--lod fator]
+ * [--compactar fixes_por_s] [--retencao_dias D] [--reducao_dias D] [--reducao_s S] [--varredura linhas_por_segmento] [--indice passo_graus]
+ * [--viagens arquivo.csv] [--parada_m raio] [--parada_s tempo] [--comboios arquivo.csv] [--comboio_m D] [--comboio_s T]
+ * [--cercas arquivo] [--eventos_cercas arquivo.csv] [--regras arquivo] [--alertas arquivo.csv] [--mapa arquivo.osm] [--casados arquivo.csv]
+ * [--mapa_calor dir] [--zoom_min z] [--zoom_max z] [--assinaturas porta_tcp] [--reordenar atraso_ms] [--admissao taxa_max]
+ * [--wal dir] [--durabilidade modo] [--janela_us N] [--snapshot_s T] [--exportar dir] [--formato gpx|kml|colunar]`.
+ * Periodicamente exibe os contadores de recepção e encerra ao receber SIGINT ou SIGTERM.
+ * --rastreadores dimensiona a tabela de rastreadores (65536 por padrão); com a tabela cheia,
+ * fixes de rastreadores novos são descartados e contados em "Tabela cheia".
+ * Com --snapshot_s, grava a cada T segundos um snapshot do estado no diretório do WAL.
+ * Com --numa 1, as threads de recepção e a tabela de rastreadores ficam distribuídas entre
+ * os nós NUMA, e os acessos locais e remotos à tabela são exibidos.
+ * SIGHUP relê os arquivos de cercas e de regras; as regras usam as cercas de --cercas como
+ * zonas. SIGUSR1 exporta a trajetória de todos os rastreadores
+ * do histórico para o diretório de --exportar, um arquivo por rastreador (GPX por padrão).
+ * Com --varredura e --assinaturas, os clientes das assinaturas consultam o histórico de
+ * toda a frota com `consulta t_ini t_fim lat_min lon_min lat_max lon_max`.
+ */
+#include <csignal>
+#include <map>
+#include <pthread.h>
+
+#include "GPSCollector.hpp"
+#include "TrackExporter.hpp"
+
+int main(
+	int argc,
+	char* argv[]
+){
+
+	const char* uso = "Uso: ./GPSCollector <porta> [--threads N] [--rastreadores N] [--numa 0|1] [--historico fixes_por_bloco] [--lod fator] [--compactar fixes_por_s] [--retencao_dias D] [--reducao_dias D] [--reducao_s S] [--varredura linhas_por_segmento] [--indice passo_graus] [--viagens arquivo.csv] [--parada_m raio] [--parada_s tempo] [--comboios arquivo.csv] [--comboio_m D] [--comboio_s T] [--cercas arquivo] [--eventos_cercas arquivo.csv] [--regras arquivo] [--alertas arquivo.csv] [--mapa arquivo.osm] [--casados arquivo.csv] [--mapa_calor dir] [--zoom_min z] [--zoom_max z] [--assinaturas porta_tcp] [--reordenar atraso_ms] [--admissao taxa_max] [--wal dir] [--durabilidade nenhuma|lote|sincrona] [--janela_us N] [--snapshot_s T] [--exportar dir] [--formato gpx|kml|colunar]";
+
+	if(argc < 2 || argc % 2 != 0){
+
+		std::cout << uso << std::endl;
+		return -1;
+	}
+
+	std::map<std::string, std::string> opcoes;
+	for(
+		int i = 2; i + 1 < argc; i += 2
+	){
+
+		std::string chave = argv[i];
+		if( chave.rfind("--", 0) != 0 ){ std::cout << uso << std::endl; return -1; }
+		opcoes[chave.substr(2)] = argv[i + 1];
+	}
+
+	// Sinais são tratados de forma síncrona por esta thread. O bloqueio é herdado pelas workers.
+	sigset_t sinais;
+	sigemptyset(&sinais);
+	sigaddset(&sinais, SIGHUP);
+	sigaddset(&sinais, SIGINT);
+	sigaddset(&sinais, SIGTERM);
+	sigaddset(&sinais, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &sinais, nullptr);
+
+	int n_threads = opcoes.count("threads") ? std::stoi(opcoes["threads"]) : static_cast<int>(std::thread::hardware_concurrency());
+
+	std::size_t capacidade = opcoes.count("rastreadores") ? std::stoul(opcoes["rastreadores"]) : std::size_t(1) << 16;
+
+	bool numa = opcoes.count("numa") && std::stoi(opcoes["numa"]) != 0;
+
+	TrackExporter::Formato formato = TrackExporter::Formato::GPX;
+	if( opcoes.count("formato") && !TrackExporter::parse_format(opcoes["formato"], formato) ){ std::cout << uso << std::endl; return -1; }
+
+	GPSCollector coletor(
+		std::stoi(argv[1]),
+		n_threads,
+		capacidade,
+		numa
+	);
+
+	if( opcoes.count("historico") ){ coletor.open_history(std::stoul(opcoes["historico"]), opcoes.count("lod") ? std::stoul(opcoes["lod"]) : 8); }
+	if(
+		opcoes.count("compactar")
+	){
+
+		HistoryStore::Politica politica;
+		if( opcoes.count("retencao_dias") ){ politica.retencao_ms = std::stoll(opcoes["retencao_dias"]) * 86400000LL; }
+		if( opcoes.count("reducao_dias") ){ politica.reducao_ms = std::stoll(opcoes["reducao_dias"]) * 86400000LL; }
+		if( opcoes.count("reducao_s") ){ politica.intervalo_ms = static_cast<uint32_t>(std::stoul(opcoes["reducao_s"]) * 1000); }
+		coletor.open_compaction(politica, std::stoull(opcoes["compactar"]));
+	}
+	if( opcoes.count("varredura") ){ coletor.open_scan(std::stoul(opcoes["varredura"])); }
+	if( opcoes.count("indice") ){ coletor.open_index(std::stod(opcoes["indice"])); }
+	if(
+		opcoes.count("viagens")
+	){
+
+		coletor.open_trips(
+			opcoes["viagens"],
+			opcoes.count("parada_m") ? std::stod(opcoes["parada_m"]) : 50.0,
+			opcoes.count("parada_s") ? std::stoll(opcoes["parada_s"]) * 1000 : 180000
+		);
+	}
+	if(
+		opcoes.count("comboios")
+	){
+
+		coletor.open_convoys(
+			opcoes["comboios"],
+			opcoes.count("comboio_m") ? std::stod(opcoes["comboio_m"]) : 30.0,
+			opcoes.count("comboio_s") ? std::stoll(opcoes["comboio_s"]) * 1000 : 300000
+		);
+	}
+	if(
+		opcoes.count("cercas")
+	){
+
+		coletor.open_geofences(
+			opcoes["cercas"],
+			opcoes.count("eventos_cercas") ? opcoes["eventos_cercas"] : "cercas.csv"
+		);
+	}
+	if(
+		opcoes.count("regras")
+	){
+
+		coletor.open_rules(
+			opcoes["regras"],
+			opcoes.count("alertas") ? opcoes["alertas"] : "alertas.csv",
+			opcoes.count("cercas") ? opcoes["cercas"] : ""
+		);
+	}
+	if(
+		opcoes.count("mapa")
+	){
+
+		coletor.open_map_matching(
+			opcoes["mapa"],
+			opcoes.count("casados") ? opcoes["casados"] : "casados.csv"
+		);
+	}
+
+	if(
+		opcoes.count("mapa_calor")
+	){
+
+		coletor.open_heatmap(
+			opcoes.count("zoom_min") ? std::stoi(opcoes["zoom_min"]) : 4,
+			opcoes.count("zoom_max") ? std::stoi(opcoes["zoom_max"]) : 14
+		);
+	}
+
+	if( opcoes.count("assinaturas") ){ coletor.open_subscriptions(std::stoi(opcoes["assinaturas"])); }
+	if( opcoes.count("reordenar") ){ coletor.open_reorder(std::stoll(opcoes["reordenar"])); }
+	if( opcoes.count("admissao") ){ coletor.open_admission(10000, static_cast<uint32_t>(std::stoul(opcoes["admissao"]))); }
+
+	if(
+		opcoes.count("wal")
+	){
+
+		std::string nome = opcoes.count("durabilidade") ? opcoes["durabilidade"] : "sincrona";
+		CollectorWAL::Durabilidade modo = CollectorWAL::Durabilidade::SINCRONA;
+		if( nome == "nenhuma" ){ modo = CollectorWAL::Durabilidade::NENHUMA; }
+		else if( nome == "lote" ){ modo = CollectorWAL::Durabilidade::LOTE; }
+
+		int janela_us = opcoes.count("janela_us") ? std::stoi(opcoes["janela_us"]) : 1000;
+
+		coletor.open_wal(
+			opcoes["wal"],
+			modo,
+			std::chrono::microseconds(janela_us)
+		);
+	}
+
+	coletor.init();
+
+	int64_t intervalo_snapshot = opcoes.count("snapshot_s") ? std::stoll(opcoes["snapshot_s"]) : 0;
+	auto    ultimo_snapshot    = std::chrono::steady_clock::now();
+
+	timespec intervalo{5, 0};
+	while(
+		true
+	){
+
+		int sinal = sigtimedwait(&sinais, nullptr, &intervalo);
+		if( sinal == SIGINT || sinal == SIGTERM ){ break; }
+		if( sinal == SIGHUP ){ coletor.reload_geofences(); coletor.reload_rules(); continue; }
+		if(
+			sinal == SIGUSR1
+		){
+
+			if( !coletor.history() || !opcoes.count("exportar") ){ std::cout << "\033[1;31mA exportação requer --historico e --exportar\033[0m" << std::endl; continue; }
+
+			TrackExporter::Resultado r = TrackExporter(*coletor.history()).export_all(opcoes["exportar"], formato);
+			std::cout << "Exportação: " << r.arquivos << " arquivo(s)"
+					  << " | fixes "    << r.fixes
+					  << " | MiB "      << (r.bytes >> 20)
+					  << " | falhas "   << r.falhas
+					  << " | "          << static_cast<uint64_t>(r.segundos * 1000) << " ms"
+					  << std::endl;
+			continue;
+		}
+
+		// Encerra viagens e paradas de rastreadores silenciosos há um dia
+		if(
+			TripSegmenter* viagens = coletor.trips()
+		){
+
+			using namespace std::chrono;
+			viagens->expire(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count(), 86400000);
+		}
+
+		// Emite as cadeias de rastreadores silenciosos há mais de um minuto
+		if(
+			MapMatcher* casador = coletor.map_matcher()
+		){
+
+			using namespace std::chrono;
+			casador->expire(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count(), 60000);
+		}
+
+		// Regrava os ladrilhos alterados desde o ciclo anterior
+		if( HeatmapTiles* calor = coletor.heatmap() ){ calor->write(opcoes["mapa_calor"]); }
+
+		if(
+			intervalo_snapshot > 0 && coletor.write_ahead_log() &&
+			std::chrono::steady_clock::now() - ultimo_snapshot >= std::chrono::seconds(intervalo_snapshot)
+		){
+
+			GPSCollector::SnapshotInfo info;
+			if(
+				coletor.write_snapshot(&info)
+			){
+
+				std::cout << "Snapshot: LSN " << info.lsn << " | " << (info.bytes >> 20) << " MiB"
+						  << " | pausa " << info.pausa_us / 1000 << " ms | total " << info.total_us / 1000 << " ms"
+						  << " | segmentos removidos " << info.segmentos_removidos << std::endl;
+			}
+			ultimo_snapshot = std::chrono::steady_clock::now();
+		}
+
+		GPSCollector::Stats s = coletor.stats();
+		std::cout << "Rastreadores: " << s.rastreadores
+				  << " | Fixes: "        << s.fixes
+				  << " | Inválidos: "    << s.invalidos
+				  << " | Tabela cheia: " << s.tabela_cheia
+				  << std::endl;
+
+		if(
+			numa
+		){
+
+			uint64_t total = std::max<uint64_t>(s.acessos_locais + s.acessos_remotos, 1);
+			std::cout << "NUMA: " << NumaTopology::system().nodes() << " nó(s)"
+					  << " | acessos locais "  << s.acessos_locais
+					  << " | remotos "         << s.acessos_remotos << " (" << (100 * s.acessos_remotos / total) << "%)"
+					  << " | páginas enormes " << (NumaArena::process_thp_bytes() >> 20) << " MiB (THP), "
+					  << (NumaArena::stats().bytes_hugetlb >> 20) << " MiB (hugetlb)"
+					  << std::endl;
+		}
+
+		if(
+			CollectorWAL* wal = coletor.write_ahead_log()
+		){
+
+			CollectorWAL::Stats w = wal->stats();
+			std::cout << "WAL: grupos "     << w.gravacoes
+					  << " | MiB "          << (w.bytes >> 20)
+					  << " | LSN durável "  << w.lsn_duravel
+					  << " | falhas "       << w.falhas
+					  << std::endl;
+		}
+
+		if(
+			RuleEngine* regras = coletor.rules()
+		){
+
+			RuleEngine::Stats r = regras->stats();
+			std::cout << "Regras: lotes "        << r.lotes
+					  << " | avaliadas "         << r.avaliadas
+					  << " | puladas "           << r.puladas
+					  << " | disparos "          << r.disparos
+					  << " | fins "              << r.fins
+					  << " | tabela cheia "      << r.tabela_cheia
+					  << std::endl;
+		}
+
+		if(
+			HistoryCompactor* compactador = coletor.compaction()
+		){
+
+			HistoryCompactor::Stats c = compactador->stats();
+			std::cout << "Compactação: passadas "  << c.passadas
+					  << " | blocos "             << c.trabalho.blocos_lidos << " -> " << c.trabalho.blocos_gravados
+					  << " | MiB "                << (c.trabalho.bytes_lidos >> 20) << " -> " << (c.trabalho.bytes_gravados >> 20)
+					  << " | expirados "          << c.trabalho.expirados
+					  << " | reduzidos "          << c.trabalho.reduzidos
+					  << " | "                    << static_cast<uint64_t>(c.fixes_s / 1000) << " Kfixes/s"
+					  << std::endl;
+		}
+
+		if(
+			AdmissionControl* admissao = coletor.admission()
+		){
+
+			AdmissionControl::Stats a = admissao->stats();
+			std::cout << "Admissão: alertas "  << a.admitidos[0] << "/" << a.recebidos[0]
+					  << " | ao vivo "          << a.admitidos[1] << "/" << a.recebidos[1]
+					  << " | spool "            << a.admitidos[2] << "/" << a.recebidos[2]
+					  << " | taxa spool "       << a.taxa_atrasados << "/s | pausa " << a.pausa_ms << " ms"
+					  << std::endl;
+		}
+	}
+
+	coletor.stop();
+	if( HeatmapTiles* calor = coletor.heatmap() ){ calor->write(opcoes["mapa_calor"]); }
+
+	return 0;
+}
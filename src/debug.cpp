@@ -32,6 +32,9 @@ int main(){
 		9000,
 		gps_module.get_path_pseudo_term()
 	);
+	sensor.subscribe(
+		[](const GPSFix& fix){ std::cout << "\033[1;35mAssinante recebeu fix #" << fix.seq << "\033[0m" << std::endl; }
+	);
 	sensor.init();
 
 	std::this_thread::sleep_for(std::chrono::seconds(10));
@@ -1,8 +1,20 @@
 /**
  * @file main.cpp
  * @brief Responsável por executar a aplicação
+ * @details
+ * Duas formas de execução:
+ *
+ * - `./GPSTrack <ip> <porta>`: destino único e valores padrão.
+ * - `./GPSTrack -c <arquivo>`: configuração completa, recarregada ao receber SIGHUP.
+ *
+ * A aplicação executa até receber SIGINT ou SIGTERM. Caso a configuração informe
+ * `controle`, um GPSControl atende consultas pelo socket Unix indicado.
  */
+#include <csignal>
+#include <pthread.h>
+
 #include "GPSTrack.hpp"
+#include "GPSControl.hpp"
 
 int main(
 	int argc,
@@ -11,7 +23,7 @@ int main(
 
 	if(argc == 1){
 
-		std::cout << "Falta informar o IP e a PORTA de destino." << std::endl;
+		std::cout << "Falta informar o IP e a PORTA de destino, ou -c <arquivo de configuração>." << std::endl;
 		return -1;
 	}
 	else if(argc == 2){
@@ -25,17 +37,52 @@ int main(
 		return -1;
 	}
 
-	GPSTrack ss(
-		argv[1],
-		std::stoi(argv[2]),
-		"/dev/ttySTM2"
-	);
+	// Sinais são tratados de forma síncrona por esta thread. O bloqueio é herdado pela worker.
+	sigset_t sinais;
+	sigemptyset(&sinais);
+	sigaddset(&sinais, SIGHUP);
+	sigaddset(&sinais, SIGINT);
+	sigaddset(&sinais, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &sinais, nullptr);
+
+	std::string caminho_config;
+	GPSConfig cfg;
+	if(
+		std::string(argv[1]) == "-c"
+	){
+
+		caminho_config = argv[2];
+		cfg = GPSConfig::load(caminho_config);
+	}
+	else{
+
+		cfg.add_destination(argv[1], std::stoi(argv[2]));
+	}
+
+	GPSTrack ss(cfg);
+
+	std::unique_ptr<GPSControl> controle;
+	if( !cfg.controle.empty() ){
+
+		controle.reset(new GPSControl(ss, cfg.controle));
+		controle->init();
+	}
 
 	ss.init();
 
-	std::this_thread::sleep_for(std::chrono::seconds(60));
+	int sinal = 0;
+	while(
+		sigwait(&sinais, &sinal) == 0
+	){
+
+		if( sinal != SIGHUP ){ break; }
+
+		if( caminho_config.empty() ){ std::cout << "SIGHUP ignorado: execução sem arquivo de configuração." << std::endl; }
+		else{ ss.reload(caminho_config); }
+	}
 
+	if( controle ){ controle->stop(); }
 	ss.stop();
 
 	return 0;
-}
\ No newline at end of file
+}